@@ -0,0 +1,603 @@
+/*
+ * Benchmarks for the element tree, so changes that slow things down are seen before they are deployed.
+ *
+ * Builds synthetic trees, from 100 to 100,000 elements, and measures how long Layout, Update, Draw and CursorEvent hit testing take.
+ *     wide      One parent with all the elements in its grid.
+ *     deep      Chains of elements each inside the last, 100 deep, side by side.
+ *     grid      Grids of 4x4 inside grids of 4x4 until there are enough elements.
+ *     controls  Panels of a Button, Checkbox and Slider, needs a font.
+ * Text is measured on its own as well, FontGetRect and FontPrint of a line of text, and TextPrint of the same line from a text run.
+ * Loading is measured too, a set of font sizes loaded and their printable ASCII measured, as an application does when it starts.
+ *
+ * Drawing uses the software renderer so it runs the same on any machine, with or without a GPU or display.
+ * Times are the mean of as many runs as fit in the minimum time, after one run to warm up.
+ *
+ * EdgeUI.Bench [options]
+ *     --json <file>        Write the results to file as JSON, use this to make a baseline.
+ *     --baseline <file>    Compare with the results in file, a run from --json. Returns 1 if anything is slower than the tolerance, or the file is not a baseline.
+ *     --tolerance <pct>    How much slower is a regression, 15 by default. Timings are noisy, make baselines on a quiet machine.
+ *     --font <file>        TrueType font for the controls and text benchmarks, they are skipped if there is not one.
+ *     --max-nodes <n>      Largest tree, 100000 by default.
+ *     --min-time <ms>      How long to run each benchmark for, 200 by default.
+ *     --filter <text>      Only run benchmarks with this in their name.
+ *
+ * Example, make a baseline then check a change against it.
+ *     ./EdgeUI.Bench --json baseline.json
+ *     ./EdgeUI.Bench --baseline baseline.json --json latest.json
+ */
+#include "Graphics.h"
+#include "Element.h"
+#include "controls/Controls.h"
+
+#include <math.h>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <map>
+#include <functional>
+
+using namespace eui;
+
+static const int DISPLAY_WIDTH = 1024;
+static const int DISPLAY_HEIGHT = 600;
+static const uint32_t CHAIN_DEPTH = 100;
+
+/**
+ * @brief What was measured for one benchmark.
+ */
+struct Result
+{
+	std::string name;
+	uint32_t nodes = 0;
+	uint32_t iterations = 0;
+	double nsPerOp = 0.0;		//!< Mean time of one layout, update, draw, hit test or print.
+	double nsPerNode = 0.0;		//!< nsPerOp divided by the number of elements in the tree, zero for the text benchmarks.
+};
+
+struct Settings
+{
+	std::string jsonFile;
+	std::string baselineFile;
+	std::string fontFile;
+	std::string filter;
+	double tolerance = 15.0;
+	uint32_t maxNodes = 100000;
+	double minTime = 200.0;
+};
+
+/**
+ * @brief Runs pFunction once to warm up, then until pMinTime milliseconds have passed and it has run at least three times.
+ * Returns the mean nanoseconds per run.
+ */
+static double Measure(double pMinTime,uint32_t& rIterations,const std::function<void()>& pFunction)
+{
+	pFunction();
+
+	rIterations = 0;
+	const auto start = std::chrono::steady_clock::now();
+	std::chrono::duration<double,std::milli> taken(0);
+	do
+	{
+		pFunction();
+		rIterations++;
+		taken = std::chrono::steady_clock::now() - start;
+	}while( taken.count() < pMinTime || rIterations < 3 );
+
+	return (taken.count() * 1000000.0) / rIterations;
+}
+
+/**
+ * @brief Something that looks like a UI, a few colours and boarders so the renderer has a mix of work.
+ */
+static void StyleElement(Element* pElement,uint32_t pIndex)
+{
+	static const Colour colours[] = {MakeColour(40,60,90),MakeColour(70,90,120),MakeColour(120,60,60),MakeColour(60,120,60)};
+	const BoarderStyle boarders[] = {BS_SOLID,BS_RAISED,BS_SOLID,BS_DEPRESSED};
+	pElement->SetStyle(colours[pIndex%4],boarders[pIndex%4],(pIndex%4) == 0 ? 0.0f : 2.0f,(pIndex%3) == 0 ? 0.1f : 0.0f,0);
+}
+
+/**
+ * @brief The smallest square grid that pCount items fit in.
+ */
+static uint32_t GridSize(uint32_t pCount)
+{
+	return std::max(1u,(uint32_t)ceil(sqrt((double)pCount)));
+}
+
+static Element* BuildWide(uint32_t pNodes)
+{
+	Element* root = new Element();
+	const uint32_t children = pNodes - 1;
+	const uint32_t size = GridSize(children);
+	root->SetGrid(size,size);
+	for( uint32_t n = 0 ; n < children ; n++ )
+	{
+		Element* e = new Element();
+		StyleElement(e,n);
+		e->SetPos(n%size,n/size);
+		root->Attach(e);
+	}
+	return root;
+}
+
+static Element* BuildDeep(uint32_t pNodes)
+{
+	Element* root = new Element();
+	const uint32_t chains = std::max(1u,(pNodes - 1) / CHAIN_DEPTH);
+	const uint32_t depth = (pNodes - 1) / chains;
+	const uint32_t size = GridSize(chains);
+	root->SetGrid(size,size);
+	uint32_t index = 0;
+	for( uint32_t c = 0 ; c < chains ; c++ )
+	{
+		Element* parent = root;
+		for( uint32_t d = 0 ; d < depth ; d++ )
+		{
+			Element* e = new Element();
+			StyleElement(e,index++);
+			if( parent == root )
+			{
+				e->SetPos(c%size,c/size);
+			}
+			else
+			{// Each one a little smaller than the last, so they can all be seen.
+				e->SetPadding(0.01f);
+			}
+			parent->Attach(e);
+			parent = e;
+		}
+	}
+	return root;
+}
+
+static Element* BuildGrid(uint32_t pNodes)
+{
+	Element* root = new Element();
+	uint32_t remaining = pNodes - 1;
+	uint32_t index = 0;
+
+	// Breadth first so the tree is as even as it can be.
+	std::vector<Element*> parents = {root};
+	while( remaining > 0 )
+	{
+		std::vector<Element*> next;
+		for( Element* parent : parents )
+		{
+			parent->SetGrid(4,4);
+			for( uint32_t n = 0 ; n < 16 && remaining > 0 ; n++, remaining-- )
+			{
+				Element* e = new Element();
+				StyleElement(e,index++);
+				e->SetPos(n%4,n/4);
+				parent->Attach(e);
+				next.push_back(e);
+			}
+			if( remaining == 0 )
+			{
+				break;
+			}
+		}
+		parents.swap(next);
+	}
+	return root;
+}
+
+static Element* BuildControls(uint32_t pNodes,uint32_t pFont)
+{
+	Element* root = new Element();
+	const uint32_t panels = std::max(1u,(pNodes - 1) / 4);
+	const uint32_t size = GridSize(panels);
+	root->SetGrid(size,size);
+	for( uint32_t n = 0 ; n < panels ; n++ )
+	{
+		Element* panel = new Element();
+		StyleElement(panel,n);
+		panel->SetPos(n%size,n/size);
+		panel->SetGrid(1,3);
+		panel->SetStyle(panel->GetStyle().mBackground,BS_SOLID,0.0f,0.0f,pFont);
+
+		panel->Attach((new Button("OK",pFont))->SetPos(0,0));
+		panel->Attach((new Checkbox("On",pFont))->SetPos(0,1));
+		panel->Attach((new Slider(0,100,1))->SetPos(0,2));
+		root->Attach(panel);
+	}
+	return root;
+}
+
+static uint32_t CountNodes(Element* pElement)
+{
+	uint32_t count = 1;
+	for( auto child : pElement->GetChildren() )
+	{
+		count += CountNodes(child);
+	}
+	return count;
+}
+
+/**
+ * @brief Draws the whole tree, as Application::DrawFrame does when everything has changed.
+ */
+static void DrawTree(Graphics* pGraphics,Element* pRoot)
+{
+	pRoot->Invalidate();
+	pRoot->SubmitDamage(pGraphics);
+	pGraphics->BeginFrame();
+	for( size_t n = 0 ; n < pGraphics->GetRedrawRegions().size() ; n++ )
+	{
+		pGraphics->SetRedrawRegion(n);
+		pRoot->Draw(pGraphics);
+	}
+	pGraphics->EndFrame();
+	pRoot->ClearDirty();
+}
+
+static bool Wanted(const Settings& pSettings,const std::string& pName)
+{
+	return pSettings.filter.size() == 0 || pName.find(pSettings.filter) != std::string::npos;
+}
+
+static void Report(std::vector<Result>& rResults,const std::string& pName,uint32_t pNodes,uint32_t pIterations,double pNanoseconds)
+{
+	Result r;
+	r.name = pName;
+	r.nodes = pNodes;
+	r.iterations = pIterations;
+	r.nsPerOp = pNanoseconds;
+	r.nsPerNode = pNodes > 0 ? pNanoseconds / pNodes : 0.0;
+	rResults.push_back(r);
+
+	std::cout << std::fixed << std::setprecision(1) << "  " << std::left << std::setw(32) << pName << std::right <<
+		std::setw(14) << pNanoseconds << " ns/op";
+	if( pNodes > 0 )
+	{
+		std::cout << std::setw(10) << r.nsPerNode << " ns/node";
+	}
+	std::cout << std::setw(8) << pIterations << " runs\n";
+}
+
+/**
+ * @brief The names have the size asked for, so they stay the same if a tree's shape is changed. The results have the real number of elements.
+ */
+static void RunTree(const Settings& pSettings,Graphics* pGraphics,const std::string& pShape,uint32_t pSize,Element* pRoot,std::vector<Result>& rResults)
+{
+	const Rectangle display(0,0,DISPLAY_WIDTH,DISPLAY_HEIGHT);
+	const uint32_t nodes = CountNodes(pRoot);
+	const std::string suffix = "/" + pShape + "/" + std::to_string(pSize);
+	uint32_t iterations;
+
+	pRoot->Layout(display);
+	if( Wanted(pSettings,"layout" + suffix) )
+	{
+		const double ns = Measure(pSettings.minTime,iterations,[&](){pRoot->Layout(display);});
+		Report(rResults,"layout" + suffix,nodes,iterations,ns);
+	}
+
+	if( Wanted(pSettings,"update" + suffix) )
+	{
+		const double ns = Measure(pSettings.minTime,iterations,[&](){pRoot->Update();});
+		Report(rResults,"update" + suffix,nodes,iterations,ns);
+	}
+
+	if( Wanted(pSettings,"draw" + suffix) )
+	{
+		const double ns = Measure(pSettings.minTime,iterations,[&](){DrawTree(pGraphics,pRoot);});
+		Report(rResults,"draw" + suffix,nodes,iterations,ns);
+	}
+
+	if( Wanted(pSettings,"hittest" + suffix) )
+	{// The cursor moving over the display without touching, so controls look but do not change.
+		static const int EVENTS = 64;
+		float points[EVENTS][2];
+		uint32_t seed = 12345;
+		for( auto& p : points )
+		{
+			seed = (seed * 1103515245) + 12345;
+			p[0] = (float)((seed >> 8) % DISPLAY_WIDTH);
+			seed = (seed * 1103515245) + 12345;
+			p[1] = (float)((seed >> 8) % DISPLAY_HEIGHT);
+		}
+		volatile bool sink = false;
+		const double ns = Measure(pSettings.minTime,iterations,[&]()
+		{
+			for( const auto& p : points )
+			{
+				sink = pRoot->CursorEvent(p[0],p[1],false,true);
+			}
+		});
+		Report(rResults,"hittest" + suffix,nodes,iterations * EVENTS,ns / EVENTS);
+	}
+}
+
+static void RunText(const Settings& pSettings,Graphics* pGraphics,const char* pFontFile,uint32_t pFont,std::vector<Result>& rResults)
+{
+	const std::string line = "The quick brown fox jumps over the lazy dog 0123456789";
+	uint32_t iterations;
+	volatile float sink = 0.0f;
+
+	if( Wanted(pSettings,"text/measure") )
+	{
+		const double ns = Measure(pSettings.minTime,iterations,[&](){sink = sink + pGraphics->FontGetRect(pFont,line).GetWidth();});
+		Report(rResults,"text/measure",0,iterations,ns);
+	}
+
+	if( Wanted(pSettings,"text/print") )
+	{// A screen of lines, drawn in one frame.
+		static const int LINES = 20;
+		pGraphics->BeginFrame();
+		const double ns = Measure(pSettings.minTime,iterations,[&]()
+		{
+			for( int n = 0 ; n < LINES ; n++ )
+			{
+				pGraphics->FontPrint(pFont,10.0f,30.0f + (n * 28.0f),COLOUR_WHITE,line);
+			}
+		});
+		pGraphics->EndFrame();
+		Report(rResults,"text/print",0,iterations * LINES,ns / LINES);
+	}
+
+	if( Wanted(pSettings,"text/run") )
+	{// The same screen of lines from text runs, as static labels are drawn.
+		static const int LINES = 20;
+		std::vector<uint32_t> runs(LINES,0);
+		pGraphics->BeginFrame();
+		const double ns = Measure(pSettings.minTime,iterations,[&]()
+		{
+			for( int n = 0 ; n < LINES ; n++ )
+			{
+				const Rectangle rect(10.0f,n * 28.0f,DISPLAY_WIDTH - 10.0f,(n + 1) * 28.0f);
+				pGraphics->TextPrint(runs[n],pFont,rect,ALIGN_LEFT_CENTER,COLOUR_WHITE,line);
+			}
+		});
+		pGraphics->EndFrame();
+		for( uint32_t run : runs )
+		{
+			pGraphics->TextDelete(run);
+		}
+		Report(rResults,"text/run",0,iterations * LINES,ns / LINES);
+	}
+
+	if( Wanted(pSettings,"text/load") )
+	{// Eight sizes, loaded then every printable character used, so the time includes rendering the glyphs.
+		static const int FONTS = 8;
+		std::string ascii;
+		for( char c = ' ' ; c <= '~' ; c++ )
+		{
+			ascii += c;
+		}
+		const double ns = Measure(pSettings.minTime,iterations,[&]()
+		{
+			uint32_t fonts[FONTS];
+			for( int n = 0 ; n < FONTS ; n++ )
+			{
+				fonts[n] = pGraphics->FontLoad(pFontFile,14 + (n * 4));// Not 16, the size the other benchmarks use.
+			}
+			for( int n = 0 ; n < FONTS ; n++ )
+			{
+				sink = sink + pGraphics->FontGetRect(fonts[n],ascii).GetWidth();
+			}
+			for( int n = 0 ; n < FONTS ; n++ )
+			{
+				pGraphics->FontDelete(fonts[n]);
+			}
+		});
+		Report(rResults,"text/load",FONTS,iterations,ns);
+	}
+}
+
+static void WriteJSON(const std::string& pFilename,const std::vector<Result>& pResults)
+{
+	std::ofstream file(pFilename);
+	if( !file )
+	{
+		std::cerr << "Failed to open " << pFilename << " to write the results to\n";
+		return;
+	}
+
+	// One result a line, so baselines diff nicely.
+	file << std::fixed << std::setprecision(3);
+	file << "{\n  \"display\": [" << DISPLAY_WIDTH << "," << DISPLAY_HEIGHT << "],\n  \"results\": [\n";
+	for( size_t n = 0 ; n < pResults.size() ; n++ )
+	{
+		const Result& r = pResults[n];
+		file << "    {\"name\": \"" << r.name << "\", \"nodes\": " << r.nodes << ", \"iterations\": " << r.iterations <<
+			", \"ns_per_op\": " << r.nsPerOp << ", \"ns_per_node\": " << r.nsPerNode << "}" << (n + 1 < pResults.size() ? "," : "") << "\n";
+	}
+	file << "  ]\n}\n";
+}
+
+/**
+ * @brief Reads the ns_per_op of each result in a file written by WriteJSON, returns false and says why if it is not one.
+ */
+static bool ReadBaseline(const std::string& pFilename,std::map<std::string,double>& rBaseline)
+{
+	std::ifstream file(pFilename);
+	if( !file )
+	{
+		std::cerr << "Failed to open baseline " << pFilename << "\n";
+		return false;
+	}
+	std::stringstream text;
+	text << file.rdbuf();
+
+	try
+	{
+		tinyjson::JsonProcessor json(text.str());
+		const tinyjson::JsonValue& root = json.GetRoot();
+		if( root.GetType() != tinyjson::JsonValueType::OBJECT || root.HasValue("results") == false || root["results"].GetType() != tinyjson::JsonValueType::ARRAY )
+		{
+			std::cerr << "Baseline " << pFilename << " has no results array\n";
+			return false;
+		}
+
+		for( const tinyjson::JsonValue& result : root["results"].mArray )
+		{
+			if( result.GetType() != tinyjson::JsonValueType::OBJECT ||
+				result.HasValue("name") == false || result["name"].GetType() != tinyjson::JsonValueType::STRING ||
+				result.HasValue("ns_per_op") == false || result["ns_per_op"].GetType() != tinyjson::JsonValueType::NUMBER )
+			{
+				std::cerr << "Baseline " << pFilename << " has a result without a name and ns_per_op\n";
+				return false;
+			}
+			rBaseline[result["name"].GetString()] = result["ns_per_op"];
+		}
+	}
+	catch( const std::exception& e )
+	{
+		std::cerr << "Baseline " << pFilename << " is not valid JSON, " << e.what() << "\n";
+		return false;
+	}
+	return true;
+}
+
+/**
+ * @brief Prints how each result compares with the baseline, returns the number that are slower than the tolerance, -1 if the baseline could not be read.
+ */
+static int Compare(const Settings& pSettings,const std::vector<Result>& pResults)
+{
+	std::map<std::string,double> baseline;
+	if( ReadBaseline(pSettings.baselineFile,baseline) == false )
+	{
+		return -1;
+	}
+
+	int regressions = 0;
+	std::cout << "Compared with " << pSettings.baselineFile << ", tolerance " << pSettings.tolerance << "%\n";
+	for( const Result& r : pResults )
+	{
+		const auto found = baseline.find(r.name);
+		if( found == baseline.end() || found->second <= 0.0 )
+		{
+			std::cout << "  " << std::left << std::setw(32) << r.name << std::right << "   not in baseline\n";
+			continue;
+		}
+
+		const double change = ((r.nsPerOp - found->second) / found->second) * 100.0;
+		const bool regressed = change > pSettings.tolerance;
+		if( regressed )
+		{
+			regressions++;
+		}
+		std::cout << "  " << std::left << std::setw(32) << r.name << std::right << std::showpos << std::setw(10) << change << "%" << std::noshowpos <<
+			(regressed ? "  REGRESSION" : "") << "\n";
+	}
+	std::cout << regressions << " regressions\n";
+	return regressions;
+}
+
+static const char* FindFont(const std::string& pFontFile)
+{
+	if( pFontFile.size() > 0 )
+	{
+		return pFontFile.c_str();
+	}
+
+	static const char* fonts[] =
+	{
+		"/usr/share/fonts/truetype/dejavu/DejaVuSans.ttf",
+		"/usr/share/fonts/truetype/liberation/LiberationSans-Regular.ttf",
+		"/usr/share/fonts/truetype/freefont/FreeSans.ttf",
+		"/usr/share/fonts/TTF/DejaVuSans.ttf",
+	};
+	for( const char* font : fonts )
+	{
+		if( std::ifstream(font).good() )
+		{
+			return font;
+		}
+	}
+	return nullptr;
+}
+
+int main(int argc, char *argv[])
+{
+	Settings settings;
+	for( int n = 1 ; n < argc ; n++ )
+	{
+		const std::string arg = argv[n];
+		const char* value = n + 1 < argc ? argv[n + 1] : nullptr;
+		if( value == nullptr )
+		{
+			std::cerr << "Missing value for " << arg << "\n";
+			return 2;
+		}
+		n++;
+
+		if( arg == "--json" )				settings.jsonFile = value;
+		else if( arg == "--baseline" )		settings.baselineFile = value;
+		else if( arg == "--tolerance" )		settings.tolerance = std::atof(value);
+		else if( arg == "--font" )			settings.fontFile = value;
+		else if( arg == "--max-nodes" )		settings.maxNodes = (uint32_t)std::atoi(value);
+		else if( arg == "--min-time" )		settings.minTime = std::atof(value);
+		else if( arg == "--filter" )		settings.filter = value;
+		else
+		{
+			std::cerr << "Unknown option " << arg << ", see the top of bench/EdgeUIBench.cpp\n";
+			return 2;
+		}
+	}
+
+	Graphics* graphics = new Graphics();
+	graphics->InitialiseGL(DISPLAY_WIDTH,DISPLAY_HEIGHT);
+
+	uint32_t font = 0;
+	const char* fontFile = FindFont(settings.fontFile);
+	if( fontFile )
+	{
+		font = graphics->FontLoad(fontFile,16);
+	}
+
+	std::vector<Result> results;
+	std::cout << "Element trees on a " << DISPLAY_WIDTH << "x" << DISPLAY_HEIGHT << " display, software renderer\n";
+	for( uint32_t nodes = 100 ; nodes <= settings.maxNodes ; nodes *= 10 )
+	{
+		const std::vector<std::pair<std::string,std::function<Element*()>>> shapes =
+		{
+			{"wide",[nodes](){return BuildWide(nodes);}},
+			{"deep",[nodes](){return BuildDeep(nodes);}},
+			{"grid",[nodes](){return BuildGrid(nodes);}},
+			{"controls",[nodes,font](){return font ? BuildControls(nodes,font) : nullptr;}},
+		};
+
+		for( const auto& shape : shapes )
+		{
+			Element* root = shape.second();
+			if( root )
+			{
+				RunTree(settings,graphics,shape.first,nodes,root,results);
+				delete root;
+			}
+			else
+			{
+				std::cout << "  " << shape.first << "/" << nodes << " skipped, no font, see --font\n";
+			}
+		}
+	}
+
+	if( font )
+	{
+		RunText(settings,graphics,fontFile,font,results);
+	}
+	else
+	{
+		std::cout << "  text skipped, no font, see --font\n";
+	}
+
+	delete graphics;
+
+	if( settings.jsonFile.size() > 0 )
+	{
+		WriteJSON(settings.jsonFile,results);
+	}
+
+	if( settings.baselineFile.size() > 0 && Compare(settings,results) != 0 )
+	{
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,256 @@
+/*
+ * Checks and measures the pixel kernels used when loading images and copying frames, source/PixelKernels.h.
+ *
+ * First every version the CPU has, SSE2, AVX2 or NEON, is checked against the plain C++ version on random pixels.
+ * Lengths from 1 to 100 pixels are used so all the leftover cases are covered, and the kernels that can work in place are checked in place too.
+ * Returns 1 if any version gives different results.
+ *
+ * Then each kernel is run over a 1024 x 1024 image for each version and the speed reported in MB/s of source pixels read.
+ * The PNG filters are run over the rows one after the other, as the decoder does, for three and four byte pixels.
+ *
+ * Does not need a display, the kernels only work on memory.
+ */
+#include "PixelKernels.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace eui;
+
+static const size_t IMAGE_SIZE = 1024;
+static const double MIN_SECONDS = 0.2;
+
+/**
+ * @brief One of the kernels, run over pCount pixels of pSource into rDest.
+ */
+struct Kernel
+{
+	std::string name;
+	size_t sourceBytes;		//!< Per pixel.
+	size_t destBytes;		//!< Per pixel.
+	bool inPlace;			//!< Can rDest be pSource.
+	void (*run)(uint8_t* rDest,const uint8_t* pSource,size_t pCount);
+};
+
+static void SwapRedBlue3(uint8_t* rDest,const uint8_t* pSource,size_t pCount){pixels::SwapRedBlue3(rDest,pSource,pCount);}
+static void SwapRedBlue4(uint8_t* rDest,const uint8_t* pSource,size_t pCount){pixels::SwapRedBlue4(rDest,pSource,pCount);}
+static void ExpandRGBToRGBA(uint8_t* rDest,const uint8_t* pSource,size_t pCount){pixels::ExpandRGBToRGBA(rDest,pSource,pCount);}
+static void ExpandBGRToRGBA(uint8_t* rDest,const uint8_t* pSource,size_t pCount){pixels::ExpandBGRToRGBA(rDest,pSource,pCount);}
+static void PackRGB565(uint8_t* rDest,const uint8_t* pSource,size_t pCount){pixels::PackRGB565((uint16_t*)rDest,(const uint32_t*)pSource,pCount);}
+
+static const Kernel KERNELS[] =
+{
+	{"SwapRedBlue3",3,3,true,SwapRedBlue3},
+	{"SwapRedBlue4",4,4,true,SwapRedBlue4},
+	{"ExpandRGBToRGBA",3,4,false,ExpandRGBToRGBA},
+	{"ExpandBGRToRGBA",3,4,false,ExpandBGRToRGBA},
+	{"PackRGB565",4,2,false,PackRGB565},
+};
+
+/**
+ * @brief Undoes pFilter for all the rows of rImage, each row has pPixelBytes of zeros before it as the decoder has.
+ * The row before the first is pZeros.
+ */
+static bool UnfilterImage(std::vector<uint8_t>& rImage,const std::vector<uint8_t>& pZeros,size_t pRowBytes,size_t pRows,uint8_t pFilter,size_t pPixelBytes)
+{
+	const size_t stride = pPixelBytes + pRowBytes;
+	const uint8_t* previous = pZeros.data() + pPixelBytes;
+	for( size_t y = 0 ; y < pRows ; y++ )
+	{
+		uint8_t* row = rImage.data() + (y * stride) + pPixelBytes;
+		if( pixels::UnfilterRow(pFilter,row,previous,pRowBytes,pPixelBytes) == false )
+		{
+			return false;
+		}
+		previous = row;
+	}
+	return true;
+}
+
+static std::vector<uint8_t> MakeFilteredImage(std::mt19937& rRandom,size_t pRowBytes,size_t pRows,size_t pPixelBytes)
+{
+	std::vector<uint8_t> image((pPixelBytes + pRowBytes) * pRows,0);
+	for( size_t y = 0 ; y < pRows ; y++ )
+	{
+		uint8_t* row = image.data() + (y * (pPixelBytes + pRowBytes)) + pPixelBytes;
+		for( size_t x = 0 ; x < pRowBytes ; x++ )
+		{
+			row[x] = (uint8_t)rRandom();
+		}
+	}
+	return image;
+}
+
+static std::vector<uint8_t> MakePixels(std::mt19937& rRandom,size_t pBytes)
+{
+	std::vector<uint8_t> bytes(pBytes);
+	for( auto& b : bytes )
+	{
+		b = (uint8_t)rRandom();
+	}
+	return bytes;
+}
+
+template <class FUNCTION> static double Measure(size_t pBytes,FUNCTION pFunction)
+{
+	pFunction();// Warm up.
+
+	size_t iterations = 0;
+	const auto start = std::chrono::steady_clock::now();
+	std::chrono::duration<double> taken;
+	do
+	{
+		pFunction();
+		iterations++;
+		taken = std::chrono::steady_clock::now() - start;
+	}while( taken.count() < MIN_SECONDS );
+
+	return ((double)pBytes * iterations) / taken.count() / (1024.0 * 1024.0);
+}
+
+/**
+ * @brief Checks the versions against the plain C++ one, returns the number of differences found.
+ */
+static int Check(const std::vector<pixels::Instructions>& pInstructions)
+{
+	std::mt19937 random(1234);
+	int failures = 0;
+
+	for( const Kernel& kernel : KERNELS )
+	{
+		for( size_t count = 1 ; count <= 100 ; count++ )
+		{
+			const std::vector<uint8_t> source = MakePixels(random,count * kernel.sourceBytes);
+
+			pixels::SetInstructions(pixels::Instructions::SCALAR);
+			std::vector<uint8_t> expected(count * kernel.destBytes);
+			kernel.run(expected.data(),source.data(),count);
+
+			for( auto i : pInstructions )
+			{
+				pixels::SetInstructions(i);
+				std::vector<uint8_t> dest(count * kernel.destBytes);
+				kernel.run(dest.data(),source.data(),count);
+
+				std::vector<uint8_t> inPlace = source;
+				if( kernel.inPlace )
+				{
+					kernel.run(inPlace.data(),inPlace.data(),count);
+				}
+
+				if( dest != expected || (kernel.inPlace && inPlace != expected) )
+				{
+					std::cout << "  " << kernel.name << " " << pixels::GetInstructionsName(i) << " differs for " << count << " pixels\n";
+					failures++;
+				}
+			}
+		}
+	}
+
+	for( size_t pixelBytes = 1 ; pixelBytes <= 8 ; pixelBytes++ )
+	{
+		const std::vector<uint8_t> zeros(pixelBytes + (100 * 8),0);
+		for( uint8_t filter = 0 ; filter <= 4 ; filter++ )
+		{
+			for( size_t width = 1 ; width <= 100 ; width++ )
+			{
+				const size_t rowBytes = width * pixelBytes;
+				const std::vector<uint8_t> filtered = MakeFilteredImage(random,rowBytes,4,pixelBytes);
+
+				pixels::SetInstructions(pixels::Instructions::SCALAR);
+				std::vector<uint8_t> expected = filtered;
+				UnfilterImage(expected,zeros,rowBytes,4,filter,pixelBytes);
+
+				for( auto i : pInstructions )
+				{
+					pixels::SetInstructions(i);
+					std::vector<uint8_t> image = filtered;
+					UnfilterImage(image,zeros,rowBytes,4,filter,pixelBytes);
+					if( image != expected )
+					{
+						std::cout << "  UnfilterRow " << (int)filter << " " << pixels::GetInstructionsName(i) << " differs for " << width << " pixels of " << pixelBytes << " bytes\n";
+						failures++;
+					}
+				}
+			}
+		}
+	}
+
+	return failures;
+}
+
+int main()
+{
+	const pixels::Instructions best = pixels::GetInstructions();
+
+	std::vector<pixels::Instructions> available;
+	for( auto i : {pixels::Instructions::SCALAR,pixels::Instructions::SSE2,pixels::Instructions::AVX2,pixels::Instructions::NEON} )
+	{
+		if( pixels::SetInstructions(i) )
+		{
+			available.push_back(i);
+		}
+	}
+
+	std::cout << "Pixel kernels, using " << pixels::GetInstructionsName(best) << " by default, have";
+	for( auto i : available )
+	{
+		std::cout << " " << pixels::GetInstructionsName(i);
+	}
+	std::cout << "\n";
+
+	const int failures = Check(available);
+	std::cout << "Checked against scalar, " << failures << " differences\n";
+
+	std::mt19937 random(5678);
+	const size_t count = IMAGE_SIZE * IMAGE_SIZE;
+	const std::vector<uint8_t> source = MakePixels(random,count * 4);
+	std::vector<uint8_t> dest(count * 4);
+
+	std::cout << std::fixed << std::setprecision(0);
+	std::cout << IMAGE_SIZE << "x" << IMAGE_SIZE << " image, MB/s of source pixels, speed up over scalar in brackets\n";
+	for( const Kernel& kernel : KERNELS )
+	{
+		std::cout << "  " << std::left << std::setw(24) << kernel.name << std::right;
+		double scalar = 0.0;
+		for( auto i : available )
+		{
+			pixels::SetInstructions(i);
+			const double mbs = Measure(count * kernel.sourceBytes,[&](){kernel.run(dest.data(),source.data(),count);});
+			scalar = i == pixels::Instructions::SCALAR ? mbs : scalar;
+			std::cout << "  " << pixels::GetInstructionsName(i) << std::setw(7) << mbs << " (" << std::setprecision(1) << mbs / scalar << "x)" << std::setprecision(0);
+		}
+		std::cout << "\n";
+	}
+
+	for( size_t pixelBytes = 3 ; pixelBytes <= 4 ; pixelBytes++ )
+	{
+		const size_t rowBytes = IMAGE_SIZE * pixelBytes;
+		const std::vector<uint8_t> zeros(pixelBytes + rowBytes,0);
+		std::vector<uint8_t> image = MakeFilteredImage(random,rowBytes,IMAGE_SIZE,pixelBytes);
+		for( uint8_t filter = 1 ; filter <= 4 ; filter++ )
+		{
+			const char* names[] = {"None","Sub","Up","Average","Paeth"};
+			std::cout << "  " << std::left << std::setw(24) << (std::string("Unfilter ") + names[filter] + " " + std::to_string(pixelBytes * 8) + "bit") << std::right;
+			double scalar = 0.0;
+			for( auto i : available )
+			{
+				pixels::SetInstructions(i);
+				// In place, the pixels change each time but that does not change the speed.
+				const double mbs = Measure(rowBytes * IMAGE_SIZE,[&](){UnfilterImage(image,zeros,rowBytes,IMAGE_SIZE,filter,pixelBytes);});
+				scalar = i == pixels::Instructions::SCALAR ? mbs : scalar;
+				std::cout << "  " << pixels::GetInstructionsName(i) << std::setw(7) << mbs << " (" << std::setprecision(1) << mbs / scalar << "x)" << std::setprecision(0);
+			}
+			std::cout << "\n";
+		}
+	}
+
+	pixels::SetInstructions(best);
+	return failures > 0 ? 1 : 0;
+}
@@ -0,0 +1,257 @@
+/*
+ * Measures the cost, per rectangle, of building the points for rounded rectangles and their boarders.
+ * Compares the original version that calls sin and cos for every point, always 31 per corner, with the table built in InitRoundedRect
+ * that also picks the number of points from the size of the corner, and with the points being reused from the geometry cache,
+ * which is what happens for widgets that do not change.
+ *
+ * Does not need a display, the functions measured do not use GL.
+ */
+#include "Graphics.h"
+#include "GeometryCache.h"
+
+#include <math.h>
+#include <cstdlib>
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <vector>
+
+using namespace eui;
+
+static const int NUM_POINTS_PER_CORNER = 31;
+static const int NUM_QUADRANTS = 4;
+static const int NUM_VERTICES = NUM_POINTS_PER_CORNER * NUM_QUADRANTS;
+static const int NUM_BOARDER_VERTICES = ((NUM_POINTS_PER_CORNER * NUM_QUADRANTS * 2) + 2);
+
+// The original versions, before the sin / cos table was added. Kept here to compare against.
+static void ReferenceRoundedRectanglePoints(const Rectangle& pRect,VertXY::Buffer& rBuffer,float pRadius)
+{
+	VertXY* verts = rBuffer.Restart(NUM_VERTICES);
+
+	float A = 0.0f;// This starts the circle at the top, so the first corner is the right top one.
+	const float AD = GetRadian() / ((float)(NUM_POINTS_PER_CORNER-1) * NUM_QUADRANTS);
+
+	const float size = std::min(pRect.GetWidth()*pRadius,pRect.GetHeight()*pRadius);
+	for( int n = 0 ; n < NUM_POINTS_PER_CORNER ; n++, verts++, A += AD )
+	{
+		const float sA = sin(A);
+		const float cA = cos(A);
+
+		const float x = (1.0f - sA) * size;
+		const float y = (1.0f - cA) * size;
+
+		verts->x = pRect.right - x;
+		verts->y = pRect.top +   y;
+	}
+	A -= AD;
+
+	for( int n = 0 ; n < NUM_POINTS_PER_CORNER ; n++ , verts++, A += AD )
+	{
+		const float sA = sin(A);
+		const float cA = cos(A);
+
+		const float x = (1.0f - sA) * size;
+		const float y = (cA + 1.0f) * size;
+
+		verts->x = pRect.right -  x;
+		verts->y = pRect.bottom - y;
+	}
+	A -= AD;
+
+	for( int n = 0 ; n < NUM_POINTS_PER_CORNER ; n++ , verts++, A += AD )
+	{
+		const float sA = sin(A);
+		const float cA = cos(A);
+
+		const float x = (sA + 1.0f) * size;
+		const float y = (cA + 1.0f) * size;
+
+		verts->x = pRect.left +   x;
+		verts->y = pRect.bottom - y;
+	}
+	A -= AD;
+
+	for( int n = 0 ; n < NUM_POINTS_PER_CORNER ; n++ , verts++, A += AD )
+	{
+		const float sA = sin(A);
+		const float cA = cos(A);
+
+		const float x = (sA + 1.0f) * size;
+		const float y = (1.0f - cA) * size;
+
+		verts->x = pRect.left + x;
+		verts->y = pRect.top +  y;
+	}
+}
+
+static void ReferenceRoundedRectangleBoarderPoints(const Rectangle& pRect,VertXY::Buffer& rBuffer,float pRadius,float pThickness)
+{
+	VertXY* verts = rBuffer.Restart(NUM_BOARDER_VERTICES);
+	VertXY* first = verts;
+
+	const float outerSize = std::min(pRect.GetWidth()*pRadius,pRect.GetHeight()*pRadius);
+
+	float A = 0.0f;// This starts the circle at the top, so the first corner is the right top one.
+	const float AD = GetRadian() / ((float)(NUM_POINTS_PER_CORNER-1) * NUM_QUADRANTS);
+
+	for( int n = 0 ; n < NUM_POINTS_PER_CORNER ; n++, verts += 2, A += AD )
+	{
+		const float sA = sin(A);
+		const float cA = cos(A);
+
+		const float x = (1.0f - sA) * outerSize;
+		const float y = (1.0f - cA) * outerSize;
+
+		verts[1].x = pRect.right - x;
+		verts[1].y = pRect.top +   y;
+
+		verts[0].x = verts[1].x - (sA * pThickness);
+		verts[0].y = verts[1].y + (cA * pThickness);
+	}
+	A -= AD;
+
+	for( int n = 0 ; n < NUM_POINTS_PER_CORNER ; n++ , verts += 2, A += AD )
+	{
+		const float sA = sin(A);
+		const float cA = cos(A);
+
+		const float x = (1.0f - sA) * outerSize;
+		const float y = (cA + 1.0f) * outerSize;
+
+		verts[1].x = pRect.right -  x;
+		verts[1].y = pRect.bottom - y;
+
+		verts[0].x = verts[1].x - (sA * pThickness);
+		verts[0].y = verts[1].y + (cA * pThickness);
+
+	}
+	A -= AD;
+
+	for( int n = 0 ; n < NUM_POINTS_PER_CORNER ; n++ , verts += 2, A += AD )
+	{
+		const float sA = sin(A);
+		const float cA = cos(A);
+
+		const float x = (sA + 1.0f) * outerSize;
+		const float y = (cA + 1.0f) * outerSize;
+
+		verts[1].x = pRect.left +   x;
+		verts[1].y = pRect.bottom - y;
+
+		verts[0].x = verts[1].x - (sA * pThickness);
+		verts[0].y = verts[1].y + (cA * pThickness);
+	}
+	A -= AD;
+
+	for( int n = 0 ; n < NUM_POINTS_PER_CORNER ; n++ , verts += 2, A += AD )
+	{
+		const float sA = sin(A);
+		const float cA = cos(A);
+
+		const float x = (sA + 1.0f) * outerSize;
+		const float y = (1.0f - cA) * outerSize;
+
+		verts[1].x = pRect.left + x;
+		verts[1].y = pRect.top +  y;
+
+		verts[0].x = verts[1].x - (sA * pThickness);
+		verts[0].y = verts[1].y + (cA * pThickness);
+	}
+
+	verts[0] = first[0];
+	verts[1] = first[1];
+}
+
+/**
+ * @brief Calls pFunction pIterations times for each rectangle and returns the average time taken per rectangle in nanoseconds.
+ */
+template <class FUNCTION> static double Measure(const std::vector<Rectangle>& pRects,int pIterations,FUNCTION pFunction)
+{
+	const auto start = std::chrono::steady_clock::now();
+	for( int i = 0 ; i < pIterations ; i++ )
+	{
+		for( const auto& r : pRects )
+		{
+			pFunction(r,i);
+		}
+	}
+	const std::chrono::duration<double,std::nano> taken = std::chrono::steady_clock::now() - start;
+	return taken.count() / ((double)pIterations * pRects.size());
+}
+
+int main(int argc, char *argv[])
+{
+	const int ITERATIONS = argc > 1 ? std::atoi(argv[1]) : 10000;
+	const float RADIUS = 0.1f;
+	const float THICKNESS = 5.0f;
+
+	// A screen full of buttons, 100 of them.
+	std::vector<Rectangle> rects;
+	for( int y = 0 ; y < 10 ; y++ )
+	{
+		for( int x = 0 ; x < 10 ; x++ )
+		{
+			rects.emplace_back(x * 100.0f,y * 60.0f,(x * 100.0f) + 90.0f,(y * 60.0f) + 50.0f);
+		}
+	}
+
+	// Not deleted, the destructor releases GL resources and there is no GL context.
+	Graphics* graphics = new Graphics();
+	VertXY::Buffer buffer;
+	GeometryCache cache;
+	volatile float sink = 0.0f;// Stops the compiler removing the work.
+
+	const double trigFill = Measure(rects,ITERATIONS,[&](const Rectangle& r,int)
+	{
+		ReferenceRoundedRectanglePoints(r,buffer,RADIUS);
+		sink = sink + buffer.Data()[NUM_VERTICES/2].x;
+	});
+
+	const double tableFill = Measure(rects,ITERATIONS,[&](const Rectangle& r,int)
+	{
+		graphics->GetRoundedRectanglePoints(r,buffer,RADIUS);
+		sink = sink + buffer.Data()[buffer.Used()/2].x;
+	});
+
+	const double trigBoarder = Measure(rects,ITERATIONS,[&](const Rectangle& r,int)
+	{
+		ReferenceRoundedRectangleBoarderPoints(r,buffer,RADIUS,THICKNESS);
+		sink = sink + buffer.Data()[NUM_BOARDER_VERTICES/2].x;
+	});
+
+	const double tableBoarder = Measure(rects,ITERATIONS,[&](const Rectangle& r,int)
+	{
+		graphics->GetRoundedRectangleBoarderPoints(r,buffer,RADIUS,THICKNESS);
+		sink = sink + buffer.Data()[buffer.Used()/2].x;
+	});
+
+	// Same rectangles every frame, as it is for a UI that is not changing, so after the first frame they all come from the cache.
+	uint32_t frame = 0;
+	const double cachedFill = Measure(rects,ITERATIONS,[&](const Rectangle& r,int)
+	{
+		if( &r == &rects.front() )
+		{
+			cache.BeginFrame(++frame);
+		}
+		const auto& points = cache.Get(GeometryCache::MakeKey(GeometryCache::SHAPE_ROUNDED_RECTANGLE,r,RADIUS),[&](std::vector<VertXY>& rPoints)
+		{
+			graphics->GetRoundedRectanglePoints(r,buffer,RADIUS);
+			rPoints.assign(buffer.Data(),buffer.Data() + buffer.Used());
+		});
+		sink = sink + points[points.size()/2].x;
+	});
+
+	std::cout << std::fixed << std::setprecision(1);
+	std::cout << "Rounded rectangle geometry, " << rects.size() << " rectangles x " << ITERATIONS << " iterations, nanoseconds per rectangle\n";
+	std::cout << "  fill    sin/cos " << std::setw(8) << trigFill << "  table " << std::setw(8) << tableFill << "  (" << trigFill / tableFill << "x)  cached " << std::setw(8) << cachedFill << "  (" << trigFill / cachedFill << "x)\n";
+	std::cout << "  boarder sin/cos " << std::setw(8) << trigBoarder << "  table " << std::setw(8) << tableBoarder << "  (" << trigBoarder / tableBoarder << "x)\n";
+	// The number of points per corner depends on the size of the corner.
+	graphics->GetRoundedRectanglePoints(rects[0],buffer,RADIUS);
+	const size_t fillVertices = buffer.Used();
+	graphics->GetRoundedRectangleBoarderPoints(rects[0],buffer,RADIUS,THICKNESS);
+	const size_t boarderVertices = buffer.Used();
+	std::cout << "  vertices per rectangle, fill " << NUM_VERTICES << " -> " << fillVertices << "  boarder " << NUM_BOARDER_VERTICES << " -> " << boarderVertices << "\n";
+	std::cout << "  cache hits " << cache.GetHits() << " misses " << cache.GetMisses() << "\n";
+
+	return 0;
+}
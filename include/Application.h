@@ -2,9 +2,11 @@
 #define APPLICATION_H__
 
 #include <assert.h>
+#include <chrono>
 
 #include "Graphics.h"
 #include "Element.h"
+#include "FrameProfiler.h"
 
 namespace eui{
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////    
@@ -31,21 +33,29 @@ public:
 
     // Overload this for application specific custom rendering logic.
     // For most applications this is not required because a custom control will be more suitible.
+    // When nothing has changed nothing is drawn, the platform code only swaps the buffers if Graphics::BeginFrame was called.
     virtual void OnFrame(Graphics* pGraphics,const Rectangle& pDisplayRectangle)
     {
         assert(pGraphics);
-        Element* root = GetRootElement();
-        if( root )
+        if( UpdateFrame(pGraphics,pDisplayRectangle) )
         {
-            OnUpdate(); // Tick that app, if it wants it.
-            root->Layout(pDisplayRectangle);
-            root->Update();
-            pGraphics->BeginFrame();
-            root->Draw(pGraphics);
-            pGraphics->EndFrame();
+            DrawFrame(pGraphics);
         }
     }
 
+    // True when OnFrame would draw without anything else changing, the root or display has changed, the tree is dirty or images are waiting.
+    // For platforms, like GTK, that have to ask for the draw to happen later. Does not tick the app, OnFrame does that.
+    bool GetFrameWanted(Graphics* pGraphics,const Rectangle& pDisplayRectangle)
+    {
+        assert(pGraphics);
+        const Element* root = GetRootElement();
+        if( root == nullptr )
+        {
+            return false;
+        }
+        return root != mLastRoot || pDisplayRectangle != mLastDisplayRectangle || root->GetIsDirty() || pGraphics->TextureGetLoadsWaiting();
+    }
+
     // The minimum rate that the OnFrame is called, in milliseconds, if zero, will go as fast as possible.
     // This is very handy for when you don't need high speed rate and so want to save CPU cycles.
     virtual uint32_t GetUpdateInterval()const{return 0;}
@@ -58,12 +68,139 @@ public:
     // Will return when the app is done, after OnClose is called. Just delete your object and return.
     static void MainLoop(Application* pApplication);
 
+    // Milliseconds since the first frame, the same for the whole of a frame. Use this rather than the system clock for anything animated,
+    // the headless platform steps it by a fixed amount each frame so that runs can be repeated.
+    uint64_t GetClock()const{return mClock.now;}
+
+    // Used by the platform specific code, when not zero the clock moves on by this many milliseconds each frame rather than following real time.
+    void SetFixedClockStep(uint32_t pMilliseconds){mClock.fixedStep = pMilliseconds;}
+
+    // Times each part of the frame, off until you call GetProfiler().SetEnabled(true). The platform code times the swap.
+    FrameProfiler& GetProfiler(){return mProfiler;}
+    const FrameProfiler& GetProfiler()const{return mProfiler;}
+
     virtual int GetEmulatedWidth()const{return 1024;}
     virtual int GetEmulatedHeight()const{return 600;}
     virtual const char* GetName()const{return "edge.ui";}
 
+protected:
+    // Ticks the app and the elements, the tree is only laid out when something in it has changed.
+    // Returns true if the tree needs to be drawn. The elements are always updated as their OnUpdate may change what is displayed.
+    // Split from DrawFrame so an OnFrame override can do its own drawing around the tree's.
+    bool UpdateFrame(Graphics* pGraphics,const Rectangle& pDisplayRectangle)
+    {
+        assert(pGraphics);
+        mProfiler.BeginFrame();
+        TickClock();
+        mProfiler.Begin(FramePhase::APP_UPDATE);
+        OnUpdate(); // Tick that app, if it wants it.
+        mProfiler.End(FramePhase::APP_UPDATE);
+        Element* root = GetRootElement();
+        if( root == nullptr )
+        {
+            return false;
+        }
+
+        if( root != mLastRoot || pDisplayRectangle != mLastDisplayRectangle )
+        {
+            mLastRoot = root;
+            mLastDisplayRectangle = pDisplayRectangle;
+            root->Invalidate();
+        }
+        else if( pGraphics->TextureGetLoadsWaiting() )
+        {// Images loaded with TextureLoadAsync are uploaded in BeginFrame, we do not know which elements use them.
+            root->Invalidate();
+        }
+
+        bool laidOut = false;
+        if( root->GetIsDirty() )
+        {
+            mProfiler.Begin(FramePhase::LAYOUT);
+            root->Layout(pDisplayRectangle);
+            mProfiler.End(FramePhase::LAYOUT);
+            laidOut = true;
+        }
+
+        mProfiler.Begin(FramePhase::ELEMENT_UPDATE);
+        root->Update();
+        mProfiler.End(FramePhase::ELEMENT_UPDATE);
+
+        if( root->GetIsDirty() == false )
+        {
+            return false;
+        }
+
+        if( laidOut == false )
+        {// Something changed during the update.
+            mProfiler.Begin(FramePhase::LAYOUT);
+            root->Layout(pDisplayRectangle);
+            mProfiler.End(FramePhase::LAYOUT);
+        }
+        return true;
+    }
+
+    // Draws the parts of the tree that have changed and then marks it as clean.
+    void DrawFrame(Graphics* pGraphics)
+    {
+        assert(pGraphics);
+        Element* root = GetRootElement();
+        if( root )
+        {
+            mProfiler.Begin(FramePhase::DRAW);
+            pGraphics->SetGPUTiming(mProfiler.GetEnabled());
+            root->SubmitDamage(pGraphics);
+            pGraphics->BeginFrame();
+            // Only the areas that changed are drawn, the tree is drawn once for each of them.
+            for( size_t n = 0 ; n < pGraphics->GetRedrawRegions().size() ; n++ )
+            {
+                pGraphics->SetRedrawRegion(n);
+                root->Draw(pGraphics);
+            }
+            pGraphics->EndFrame();
+            root->ClearDirty();
+            mProfiler.End(FramePhase::DRAW);
+
+            // The GPU times come in a few frames after the frame was drawn.
+            double gpuTime;
+            while( mProfiler.GetEnabled() && pGraphics->GetGPUFrameTime(gpuTime) )
+            {
+                mProfiler.AddSample(FramePhase::GPU,gpuTime);
+            }
+        }
+    }
+
 private:
     bool mKeepGoing = true;
+    Element* mLastRoot = nullptr;           //!< When the root changes the whole tree has to be drawn.
+    Rectangle mLastDisplayRectangle = {0,0,0,0};  //!< When the display changes size the whole tree has to be laid out and drawn.
+
+    FrameProfiler mProfiler;
+
+    struct
+    {
+        bool started = false;
+        std::chrono::steady_clock::time_point start;
+        uint64_t now = 0;
+        uint32_t fixedStep = 0;
+    }mClock;
+
+    void TickClock()
+    {
+        if( mClock.started == false )
+        {
+            mClock.started = true;
+            mClock.start = std::chrono::steady_clock::now();
+            mClock.now = 0;
+        }
+        else if( mClock.fixedStep > 0 )
+        {
+            mClock.now += mClock.fixedStep;
+        }
+        else
+        {
+            mClock.now = (uint64_t)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - mClock.start).count();
+        }
+    }
 };
 
 
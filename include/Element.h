@@ -62,6 +62,7 @@ public:
 
     /**
      * @brief Gets a reference to the internal style so you can modify it.
+     * The element can not see changes made this way, call Invalidate after so it is redrawn.
      */
     Style& GetStyle(){return mStyle;}
 
@@ -72,6 +73,7 @@ public:
     Style GetStyle()const{return mStyle;}
 
     bool GetIsVisible()const{return mVisible;}
+    bool GetIsCached()const{return mCached;}
     bool GetIsActive()const{return mActive;}
 
     ElementPtr GetChildByID(const std::string_view& pID);
@@ -91,22 +93,52 @@ public:
     ElementPtr SetPadding(const Rectangle& pPadding);
 
     ElementPtr SetID(const std::string& pID){mID = pID;return this;}
-    ElementPtr SetText(const std::string& pText){mText = pText;return this;}
+    ElementPtr SetText(const std::string& pText){if( mText != pText ){mText = pText;Invalidate();}return this;}
     ElementPtr SetTextF(const char* pFmt,...);
 
-    ElementPtr SetStyle(const Style& pStyle){mStyle = pStyle;return this;}
+    ElementPtr SetStyle(const Style& pStyle){mStyle = pStyle;Invalidate();return this;}
     ElementPtr SetStyle(const tinyjson::JsonValue &root,ResouceMap* pLoadResources);
     ElementPtr SetStyle(eui::Colour pColour,BoarderStyle pBoarderStyle,float pBoarderSize,float pRadius,uint32_t pFont);
 
 
-    ElementPtr SetVisible(bool pVisible){mVisible = pVisible;return this;}
-    ElementPtr SetActive(bool pActive){mActive = pActive;return this;}
+    ElementPtr SetVisible(bool pVisible){if( mVisible != pVisible ){mVisible = pVisible;Invalidate();}return this;}
+    ElementPtr SetActive(bool pActive){if( mActive != pActive ){mActive = pActive;Invalidate();}return this;}
+
+    /**
+     * @brief When true the element and its children are rendered into a layer, a texture, which is then drawn until one of them changes.
+     * Good for panels that are costly to draw but rarely change. Only what is inside the content rectangle is kept.
+     * Cached elements inside a cached element are rendered into the outer one's layer. See Graphics::LayerBegin.
+     */
+    ElementPtr SetCached(bool pCached){if( mCached != pCached ){mCached = pCached;Invalidate();}return this;}
 
     ElementPtr SetUserValue(uint32_t pUserValue){mUserValue = pUserValue;return this;}
 
     ElementPtr Attach(ElementPtr pElement);
     ElementPtr Remove(ElementPtr pElement);
 
+    /**
+     * @brief Marks the element as needing to be redrawn and tells its parents, so the frame is not skipped.
+     * The setters do this for you. Call it yourself when custom OnDraw content changes or after modifying the style via GetStyle.
+     */
+    ElementPtr Invalidate();
+
+    /**
+     * @brief True if this element, or any of its children, need redrawing.
+     */
+    bool GetIsDirty()const{return mDirty || mChildDirty;}
+
+    /**
+     * @brief Called once the tree has been drawn, marks this element and all its children as clean.
+     */
+    void ClearDirty();
+
+    /**
+     * @brief Tells graphics which areas of the display the dirty elements cover, both where they were last drawn and where they are now.
+     * Called before the frame is drawn so only the areas that changed are redrawn. Anything drawn outside of the content rectangle
+     * of an element, like text that does not fit, may not be redrawn.
+     */
+    void SubmitDamage(Graphics* pGraphics);
+
     /**
      * @brief Calculates it's content rect based on it's parents.
      * For correct updating and rendering, call before update.
@@ -182,6 +214,11 @@ private:
     bool mAlreadyDrawing = false;           //!< Used to catch unintentional recursion. Will one day change API so can not happen.
     bool mAutoGrid = false;                 //!< If true the grid size is based on the number of children.
     bool mAutoGridHorizontal = false;       //!< States if the grid is horizontal or vertical.
+    bool mDirty = true;                     //!< Set when this element needs redrawing. Starts true so it is drawn the first time.
+    bool mChildDirty = false;               //!< Set when one of the children, or their children, needs redrawing.
+    bool mCached = false;                   //!< If true this element and its children are drawn from a layer, see SetCached.
+    uint32_t mLayer = 0;                    //!< The handle of the layer when cached, zero until it is first drawn.
+    uint32_t mTextRun = 0;                  //!< The handle of the text's glyph quads, zero until the text is first drawn.
 
     Style mStyle;
     uint32_t mX = 0;
@@ -193,6 +230,7 @@ private:
 
     Rectangle mPadding = {0.0f,0.0f,1.0f,1.0f};
     Rectangle mContentRectangle = {0.0f,0.0f,1.0f,1.0f};
+    Rectangle mDrawnRectangle = {0.0f,0.0f,0.0f,0.0f};   //!< Where the element was when it was last drawn, empty if it was not. Needed to redraw where it was if it moves.
 
     OnDrawCB mOnDrawCB = nullptr;
     OnUpdateCB mOnUpdateCB = nullptr;
@@ -200,6 +238,11 @@ private:
     OnKeyboardCB mOnKeyboardCB = nullptr;
 
     void CalculateContentRectangle(const Rectangle& pParentRect);
+
+    /**
+     * @brief Draws this element and its children, called by Draw either directly or into the element's layer.
+     */
+    void DrawContent(Graphics* pGraphics);
     ElementPtr LoadControl(const tinyjson::JsonValue &root,ResouceMap* pLoadResources);
 };
 
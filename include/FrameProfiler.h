@@ -0,0 +1,167 @@
+#ifndef FRAME_PROFILER_H__
+#define FRAME_PROFILER_H__
+
+#include <vector>
+#include <chrono>
+#include <cstdint>
+
+namespace eui{
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * @brief The parts of a frame that are timed, in the order they happen.
+ */
+enum struct FramePhase
+{
+	APP_UPDATE,		//!< Application::OnUpdate.
+	LAYOUT,			//!< Laying out the element tree, only in frames where something changed.
+	ELEMENT_UPDATE,	//!< The elements' OnUpdate.
+	DRAW,			//!< Drawing the tree, from the damage being worked out to Graphics::EndFrame.
+	SWAP,			//!< The platform showing the frame, eglSwapBuffers and the like.
+	GPU,			//!< How long the GPU took to draw the frame, from timer queries. Arrives a few frames late.
+	FRAME,			//!< From the start of one frame to the start of the next, so includes any time waiting.
+
+	COUNT
+};
+
+/**
+ * @brief Min, mean, percentiles and max of a phase over the frames kept, in milliseconds.
+ */
+struct FramePhaseStatistics
+{
+	uint32_t samples = 0;	//!< How many frames the figures are from, phases that did not run in a frame are not counted.
+	double last = 0.0;
+	double min = 0.0;
+	double mean = 0.0;
+	double p95 = 0.0;
+	double p99 = 0.0;
+	double max = 0.0;
+};
+
+/**
+ * @brief Times the phases of each frame and keeps the last few hundred so you can see where the time goes.
+ * Owned by the Application, off by default. When off every call is a test of one bool, so the calls can be left in.
+ * The same phase can be timed more than once in a frame, the times are added together.
+ */
+class FrameProfiler
+{
+public:
+	static constexpr size_t DEFAULT_HISTORY = 300;	//!< Five seconds at 60 frames a second.
+
+	/**
+	 * @brief Turns profiling on or off, pHistory is how many frames the statistics are worked out over. Turning it on clears what was kept.
+	 */
+	void SetEnabled(bool pEnabled,size_t pHistory = DEFAULT_HISTORY);
+	bool GetEnabled()const{return mEnabled;}
+
+	/**
+	 * @brief Called at the start of each frame, the times of the last frame are added to the history.
+	 */
+	void BeginFrame()
+	{
+		if( mEnabled )
+		{
+			NextFrame(Clock::now());
+		}
+	}
+
+	/**
+	 * @brief Adds the times of the frame being timed to the history, the next BeginFrame starts a new one.
+	 * Call once the last frame is done, before reading the statistics, else it is not counted.
+	 */
+	void EndFrame()
+	{
+		if( mEnabled && mFrame.started )
+		{
+			NextFrame(Clock::now());
+			mFrame.started = false;
+		}
+	}
+
+	void Begin(FramePhase pPhase)
+	{
+		if( mEnabled )
+		{
+			mFrame.start[(size_t)pPhase] = Clock::now();
+		}
+	}
+
+	void End(FramePhase pPhase)
+	{
+		if( mEnabled )
+		{
+			const size_t n = (size_t)pPhase;
+			mFrame.time[n] += std::chrono::duration<double,std::milli>(Clock::now() - mFrame.start[n]).count();
+			mFrame.ran[n] = true;
+		}
+	}
+
+	/**
+	 * @brief Adds a time that was not measured with Begin and End, for example the GPU time that arrives frames later.
+	 */
+	void AddSample(FramePhase pPhase,double pMilliseconds)
+	{
+		if( mEnabled )
+		{
+			mPhases[(size_t)pPhase].Add(pMilliseconds);
+		}
+	}
+
+	/**
+	 * @brief Works the statistics out from the frames kept, this sorts them so is not free. Fine to call once a second for an overlay.
+	 */
+	FramePhaseStatistics GetStatistics(FramePhase pPhase)const;
+
+	static const char* GetPhaseName(FramePhase pPhase);
+
+	/**
+	 * @brief The pPercent percentile of pSorted, smallest first, by nearest rank so p99 of fewer than a hundred times is the slowest.
+	 * GetStatistics uses it, use it for any other times reported beside the profiler's so they agree. pSorted must not be empty.
+	 */
+	static double GetPercentile(const std::vector<double>& pSorted,double pPercent);
+
+private:
+	using Clock = std::chrono::steady_clock;
+
+	/**
+	 * @brief The times of one phase for the last few frames, a ring buffer.
+	 */
+	struct History
+	{
+		std::vector<float> times;
+		size_t next = 0;
+		size_t count = 0;
+
+		void Add(double pMilliseconds)
+		{
+			if( times.size() > 0 )
+			{
+				times[next] = (float)pMilliseconds;
+				next = (next + 1) % times.size();
+				if( count < times.size() )
+				{
+					count++;
+				}
+			}
+		}
+	};
+
+	bool mEnabled = false;
+	History mPhases[(size_t)FramePhase::COUNT];
+
+	struct
+	{//!< The frame being timed.
+		bool started = false;
+		Clock::time_point frameStart;
+		Clock::time_point start[(size_t)FramePhase::COUNT];
+		double time[(size_t)FramePhase::COUNT];
+		bool ran[(size_t)FramePhase::COUNT];
+	}mFrame;
+
+	void NextFrame(Clock::time_point pNow);
+	void ClearFrame();
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+}//namespace eui{
+
+#endif //#ifndef FRAME_PROFILER_H__
@@ -4,9 +4,13 @@
 #include "GraphicsTypes.h"
 #include "Rectangle.h"
 #include "Point.h"
+#include "HandleTable.h"
 
 #include <memory>
 #include <map>
+#include <set>
+#include <deque>
+#include <vector>
 #include <functional>
 
 #include <freetype2/ft2build.h> //sudo apt install libfreetype6-dev
@@ -26,7 +30,138 @@ enum struct TextureFormat
 	FORMAT_ALPHA    //<! Alpha only, mainly used for font rendering.
 };
 
+/**
+ * @brief How many draw calls the last frame needed, before and after primitives where merged into batches.
+ */
+struct DrawListStatistics
+{
+	uint32_t primitives = 0;	//!< Number of primitives drawn, this is how many draw calls would be needed without batching.
+	uint32_t drawCalls = 0;		//!< Number of draw calls that where actually made.
+	uint32_t vertices = 0;		//!< Number of vertices submitted.
+};
+
+/**
+ * @brief How many GL state changes the last frame made, and how many were skipped because GL was already in that state.
+ */
+struct GLStateStatistics
+{
+	uint32_t issued = 0;		//!< Calls that changed the program, texture, vertex attribute arrays or a uniform.
+	uint32_t skipped = 0;		//!< Calls that were not made as they would not have changed anything.
+	uint32_t programs = 0;		//!< Of the issued calls, how many changed the program.
+	uint32_t textures = 0;		//!< How many bound a texture.
+	uint32_t uniforms = 0;		//!< How many set a uniform.
+};
+
+/**
+ * @brief How full the pages of the texture atlas are.
+ */
+struct TextureAtlasStatistics
+{
+	uint32_t pages = 0;					//!< Each page is one GL texture.
+	uint32_t images = 0;				//!< Images in all the pages.
+	uint32_t usedPixels = 0;			//!< Pixels in all the pages that are used by images, including their padding.
+	float percentage = 0.0f;			//!< How much of all the pages is used.
+	std::vector<float> pageOccupancy;	//!< The percentage used of each page.
+};
+
+/**
+ * @brief What the texture cache did since it was set, see Graphics::SetTextureCache. Read after the first screen has loaded
+ * to see how many images came from the cache and how many were decoded.
+ */
+struct TextureCacheStatistics
+{
+	uint32_t hits = 0;				//!< Images loaded from the cache, they were not decoded.
+	uint32_t misses = 0;			//!< Images that were decoded, either new to the cache or changed since they were stored.
+	uint32_t stale = 0;				//!< Of the misses, images that had changed since they were stored.
+	uint32_t writes = 0;			//!< Decoded images stored in the cache.
+	uint32_t failedWrites = 0;		//!< Decoded images that could not be stored, the directory is full or read only.
+};
+
+/**
+ * @brief How a font's glyph cache is doing, see Graphics::FontGetStatistics. The counts are from when the font was loaded.
+ */
+struct GlyphCacheStatistics
+{
+	uint32_t glyphs = 0;			//!< Characters in the cache, including ones with no pixels like space.
+	uint32_t pages = 0;				//!< Texture pages the glyphs are packed into.
+	uint32_t maxPages = 0;			//!< Pages the cache can have before it starts emptying them, see FontSetGlyphCachePages.
+	int pageSize = 0;				//!< Width and height of the pages in pixels.
+	uint64_t hits = 0;				//!< Characters drawn or measured that were in the cache.
+	uint64_t misses = 0;			//!< Characters that FreeType had to render.
+	uint64_t evictions = 0;			//!< Glyphs thrown away to make room. If this keeps going up the font needs more pages.
+	uint64_t pageEvictions = 0;		//!< Pages emptied to make room, the least recently used page is emptied in one go.
+	uint64_t prerendered = 0;		//!< Glyphs rendered by the worker threads when the font was loaded, see FontSetPrerender.
+};
+
+/**
+ * @brief What the FreeType face of a font costs, see Graphics::FontGetFaceStatistics. Sizes loaded from the same file share one face.
+ */
+struct FontFaceStatistics
+{
+	size_t fileBytes = 0;			//!< Size of the font file, it is mapped and not read in.
+	size_t residentFileBytes = 0;	//!< How much of the mapped file is in memory, the pages FreeType has read.
+	size_t faceBytes = 0;			//!< What FreeType allocated to open the face.
+	size_t sizeBytes = 0;			//!< What FreeType allocated for this font's size of the face.
+	uint32_t sizes = 0;				//!< Fonts using the face now, zero once released.
+	bool released = false;			//!< The font let go of the face with FontReleaseFace.
+	size_t bytesSaved = 0;			//!< Compared with the font having a face of its own, its share of the face it uses, or all of it and its size once released.
+};
+
+/**
+ * @brief How much of the display the last frame redrew.
+ */
+struct RedrawStatistics
+{
+	uint32_t regions = 0;		//!< Number of scissor regions the frame was drawn with.
+	uint32_t pixels = 0;		//!< Number of pixels inside the regions.
+	float percentage = 0.0f;	//!< The pixels redrawn as a percentage of the display, 100 when it was all redrawn.
+	bool fullRedraw = true;		//!< True if the whole display was redrawn, for example because the buffer age was unknown.
+};
+
+/**
+ * @brief How the layers used to cache elements did in the last frame, see Graphics::LayerBegin.
+ */
+struct LayerStatistics
+{
+	uint32_t layers = 0;		//!< Layers held at the end of the frame.
+	uint32_t bytes = 0;			//!< VRAM used by them.
+	uint32_t budget = 0;		//!< The most VRAM layers are allowed to use.
+	uint32_t hits = 0;			//!< Layers drawn without rendering their content.
+	uint32_t misses = 0;		//!< Layers that had to be made, because they were new, had been thrown away or had changed size.
+	uint32_t rerenders = 0;		//!< Layers whose content had changed and so were rendered again.
+	uint32_t evictions = 0;		//!< Layers thrown away to keep to the budget or because they were no longer being used.
+	uint32_t unavailable = 0;	//!< Times there was no room for a layer, so the content was drawn directly.
+};
+
+/**
+ * @brief Counts of the work done for a frame, for tuning screens. Work done between frames, a texture filled in an OnUpdate say,
+ * is counted in the next frame drawn.
+ */
+struct FrameStatistics
+{
+	uint32_t frameNumber = 0;			//!< The frame the counts are for.
+	uint32_t triangleDrawCalls = 0;		//!< Draw calls of triangles, triangle fans and strips are turned into triangles.
+	uint32_t lineDrawCalls = 0;			//!< Draw calls of lines and line loops.
+	uint32_t shapeDrawCalls = 0;		//!< Draw calls of signed distance field shapes, for the software renderer every shape it draws.
+	uint32_t vertices = 0;				//!< Vertices submitted.
+	uint32_t indices = 0;				//!< Indices submitted.
+	uint32_t shaderChanges = 0;			//!< Times the program was changed.
+	uint32_t textureBinds = 0;			//!< Times the bound texture was changed.
+	uint32_t uniformUploads = 0;		//!< Uniforms sent to GL, the ones that were already set are not counted.
+	uint32_t textureUploads = 0;		//!< Times pixels were sent to a texture, by TextureCreate and TextureFill.
+	uint64_t textureUploadBytes = 0;	//!< The bytes sent.
+	uint32_t scratchGrowths = 0;		//!< Times a work buffer had to be made bigger, should be zero once the UI has been drawn a few times.
+};
+
 struct FreeTypeFont;
+struct FreeTypeFace;
+struct FreeTypeMemory;
+struct GlyphRasterizer;
+struct ImageDecoder;
+struct WorkerPool;
+struct ImageDecodeJob;
+struct TextureCache;
+struct SoftwareTexture;
 class GLTexture;
 class GLShader;
 
@@ -34,7 +169,7 @@ typedef GLShader* GLShaderPtr;
 
 
 /**
- * @brief This is the interface definition to a facade this is implemented by the hardware (GPU) renderer chosen, for example GL. 
+ * @brief This is the interface definition to a facade this is implemented by the renderer chosen, GL or, for systems with no GPU, software.
  */
 class Graphics
 {
@@ -54,6 +189,36 @@ public:
         ROTATE_FRAME_LANDSCAPE,		//!< If the hardware reports a portrait mode (width < height) will apply a 90 degree rotation
     };
 
+	/**
+	 * @brief How the points of a primitive are joined together, the same as the GL primitive types.
+	 */
+	enum struct Topology
+	{
+		TRIANGLES,
+		TRIANGLE_FAN,
+		TRIANGLE_STRIP,
+		LINES,
+		LINE_LOOP
+	};
+
+	/**
+	 * @brief How fonts loaded by FontLoad are drawn.
+	 */
+	enum struct FontRendering
+	{
+		BITMAP,					//!< Each size has its own face and glyph cache, the glyphs are drawn a pixel to a texel. The sharpest at small sizes.
+		SIGNED_DISTANCE_FIELD	//!< All sizes of a face share one face and one cache of distance field glyphs, drawn by a shader that can add an outline and shadow.
+	};
+
+	/**
+	 * @brief How rectangles, boarders and rounded lines are drawn.
+	 */
+	enum struct ShapeRendering
+	{
+		TESSELLATED,			//!< Built from triangles on the CPU. The least work per pixel, edges are not anti aliased.
+		SIGNED_DISTANCE_FIELD	//!< One quad per shape, the fragment shader works out the edges. Anti aliased and fewer vertices, more work per pixel.
+	};
+
     Graphics();
     virtual ~Graphics();
 	void InitialiseGL(int pWidth,int pHeight);
@@ -68,6 +233,143 @@ public:
 	 */
 	void EndFrame();
 
+	/**
+	 * @brief Turns on and off the merging of primitives into batches. On by default.
+	 * When off each primitive is sent to GL with its own draw call, handy for A/B comparisons.
+	 */
+	void SetBatching(bool pEnabled);
+	bool GetBatching()const{return mBatching.enabled;}
+
+	/**
+	 * @brief Draw call counts for the last completed frame, so you can see how well batching is working for your UI.
+	 */
+	const DrawListStatistics& GetDrawListStatistics()const{return mBatching.lastFrame;}
+
+	/**
+	 * @brief GL state calls made and skipped for the last completed frame.
+	 */
+	const GLStateStatistics& GetGLStateStatistics()const;
+
+	/**
+	 * @brief The counts of the last completed frame, see FrameStatistics.
+	 */
+	const FrameStatistics& GetFrameStatistics()const{return mDiagnostics.lastFrame;}
+
+	/**
+	 * @brief Counts the calls to BeginFrame. The platform code compares it before and after Application::OnFrame to know if a frame was drawn that needs swapping.
+	 */
+	uint32_t GetFrameNumber()const{return mDiagnostics.frameNumber;}
+
+	/**
+	 * @brief When on, and GL has timer queries, the GPU time of each frame is measured. Off by default, the Application turns it on with its profiler.
+	 * Uses EXT_disjoint_timer_query on GLES and ARB_timer_query on desktop GL, without either it does nothing.
+	 */
+	void SetGPUTiming(bool pEnabled){mGPUTiming = pEnabled;}
+	bool GetGPUTiming()const{return mGPUTiming;}
+
+	/**
+	 * @brief Takes the oldest GPU frame time, in milliseconds, that GL has finished measuring. Returns false if there is not one yet.
+	 * The results arrive a few frames after the frame was drawn, so call until it returns false. Always false for the software renderer.
+	 */
+	bool GetGPUFrameTime(double& rMilliseconds);
+
+	/**
+	 * @brief Picks how shapes are drawn, TESSELLATED by default. Can be changed at any time, even part way through a frame.
+	 * Textured rounded rectangles are always tessellated.
+	 */
+	void SetShapeRendering(ShapeRendering pShapeRendering){mShapeRendering = pShapeRendering;}
+	ShapeRendering GetShapeRendering()const{return mShapeRendering;}
+
+	/**
+	 * @brief Adds an area of the display that has changed and so has to be redrawn. Call before BeginFrame.
+	 * If nothing is added the whole display is redrawn.
+	 */
+	void AddDamage(const Rectangle& pRect);
+
+	/**
+	 * @brief Called by the platform code before the frame is drawn with how many frames old the content of the back buffer is.
+	 * Zero means unknown, in which case the whole display is redrawn. Platforms that do not know always redraw everything.
+	 */
+	void SetBufferAge(uint32_t pAge){mRedraw.bufferAge = pAge;}
+
+	/**
+	 * @brief Turns on and off only redrawing the areas that changed. On by default, off is handy for A/B comparisons.
+	 */
+	void SetPartialRedraw(bool pEnabled){mRedraw.enabled = pEnabled;}
+	bool GetPartialRedraw()const{return mRedraw.enabled;}
+
+	/**
+	 * @brief The areas of the display being redrawn this frame, worked out in BeginFrame from the damage and the buffer age.
+	 * The frame has to be drawn once for each, after calling SetRedrawRegion.
+	 */
+	const std::vector<Rectangle>& GetRedrawRegions()const{return mRedraw.regions;}
+
+	/**
+	 * @brief Sets the scissor to one of the redraw regions, everything drawn after is clipped to it.
+	 */
+	void SetRedrawRegion(size_t pIndex);
+
+	/**
+	 * @brief Returns true if any of the rectangle is inside the redraw region being drawn. Used to skip drawing what would be clipped away.
+	 */
+	bool GetIsInRedrawRegion(const Rectangle& pRect)const;
+
+	/**
+	 * @brief The areas that changed in the last frame drawn, in physical window pixels with the origin at the bottom left, as swap with damage wants them.
+	 * Empty if the whole display changed.
+	 */
+	const std::vector<Rectangle>& GetFrameDamage()const{return mRedraw.frameDamage;}
+
+	/**
+	 * @brief Called from BeginFrame with the redraw regions, in the same coordinates as GetFrameDamage, before anything is drawn.
+	 * Only called when part of the display is redrawn. Used by the platform code for EGL_KHR_partial_update.
+	 */
+	void SetOnRedrawRegions(std::function<void(const std::vector<Rectangle>& pWindowRegions)> pOnRedrawRegions){mRedraw.onRedrawRegions = pOnRedrawRegions;}
+
+	/**
+	 * @brief How much of the display the last frame redrew.
+	 */
+	const RedrawStatistics& GetRedrawStatistics()const{return mRedraw.statistics;}
+
+	/**
+	 * @brief What LayerBegin wants the caller to do next.
+	 */
+	enum struct LayerState
+	{
+		UP_TO_DATE,		//!< The layer still holds the content, just call LayerDraw.
+		RENDER,			//!< Draw the content now, it goes into the layer, then call LayerEnd and LayerDraw.
+		UNAVAILABLE		//!< There is no layer, draw the content as normal. Happens when over budget or already rendering into a layer.
+	};
+
+	/**
+	 * @brief Layers hold a rendered copy of some content, so content that has not changed can be drawn with one textured quad.
+	 * rLayer is the caller's handle for the layer, start it at zero. If the layer has gone, been thrown away to keep to the budget,
+	 * or the size of pRect has changed a new one is made and rLayer updated. pContentChanged forces the content to be rendered again.
+	 * Nothing drawn outside of pRect goes into the layer. Layers not drawn for a while are deleted, so there is no need to free them.
+	 */
+	LayerState LayerBegin(uint32_t& rLayer,const Rectangle& pRect,bool pContentChanged);
+
+	/**
+	 * @brief Call after the content has been drawn when LayerBegin returned RENDER, drawing goes back to the display.
+	 */
+	void LayerEnd();
+
+	/**
+	 * @brief Draws the layer's content at pRect, which should be the same rectangle passed to LayerBegin.
+	 */
+	void LayerDraw(uint32_t pLayer,const Rectangle& pRect);
+
+	/**
+	 * @brief The most VRAM, in bytes, layers can use. The least recently used layers are thrown away to keep to it. 16MB by default.
+	 */
+	void SetLayerBudget(uint32_t pBytes){mLayers.budget = pBytes;}
+	uint32_t GetLayerBudget()const{return mLayers.budget;}
+
+	/**
+	 * @brief How the layers did in the last completed frame.
+	 */
+	const LayerStatistics& GetLayerStatistics()const{return mLayers.lastFrame;}
+
     /**
      * @brief Get the display rectangle
      */
@@ -106,9 +408,67 @@ public:
     void FontPrint(const uint32_t pFont,float pX,float pY,Colour pColour,const std::string_view& pText);
     void FontPrintf(const uint32_t pFont,float pX,float pY,Colour pColour,const char* pFmt,...);
     void FontPrint(const uint32_t pFont,const Rectangle& pRect,const Alignment pAlignment,Colour pColour,const std::string_view& pText);
-    Rectangle FontGetRect(const uint32_t pFont,const std::string_view& pText)const;
+
+    /**
+     * @brief The size of pText in pFont. Not const, glyphs not yet in the font's cache are rendered into it to be measured.
+     */
+    Rectangle FontGetRect(const uint32_t pFont,const std::string_view& pText);
+
+	/**
+	 * @brief Draws text in pRect like FontPrint, but keeps the glyph quads so text that has not changed is not measured and built again.
+	 * rText is the caller's handle for the text run, start it at zero. If the run has gone a new one is made and rText updated.
+	 * The quads are only rebuilt when the font, rectangle, alignment or text change, the colour can change every frame for free.
+	 * Text runs not drawn for a while are deleted, so there is no need to free them. TextDelete frees one sooner.
+	 */
+	void TextPrint(uint32_t& rText,const uint32_t pFont,const Rectangle& pRect,const Alignment pAlignment,Colour pColour,const std::string_view& pText);
+	void TextDelete(uint32_t pText);
+
+	/**
+	 * @brief Where the text of the run was last drawn, an empty rectangle if the run has gone.
+	 */
+	Rectangle TextGetRect(uint32_t pText)const;
 	void FontSetMaximumAllowedGlyph(int pMaxSize){mMaximumAllowedGlyph = pMaxSize;} // The default size is 128 per character. Any bigger will throw an exception, this allows you to go bigger, but kiss good by to vram. Really should do something else instead!
 
+	/**
+	 * @brief How many texture pages the glyph cache of fonts loaded after this can grow to, four by default.
+	 * Glyphs are rendered the first time they are drawn. When the pages are full the least recently used one is emptied.
+	 */
+	void FontSetGlyphCachePages(int pPages){mGlyphCachePages = pPages;}
+	GlyphCacheStatistics FontGetStatistics(const uint32_t pFont)const;
+
+	/**
+	 * @brief The characters rendered on worker threads when a font is loaded, printable ASCII by default. An empty string turns it off.
+	 * Loading fonts returns straight away, the glyphs are rendered on all the cores and added to the cache when the font is first drawn.
+	 */
+	void FontSetPrerender(const std::string& pCharacters){mPrerenderCharacters = pCharacters;}
+
+	/**
+	 * @brief Fonts loaded from the same file share its face, the file is mapped once and each size costs only a little more.
+	 * Once a font's glyphs are cached it does not need the face, FontReleaseFace lets it go to save the memory.
+	 * The characters in pKeep are added to the cache first, after this any others are drawn as a space.
+	 */
+	void FontReleaseFace(const uint32_t pFont,const std::string_view& pKeep);
+	FontFaceStatistics FontGetFaceStatistics(const uint32_t pFont)const;
+
+	/**
+	 * @brief Picks how fonts loaded after this are drawn, BITMAP by default. Fonts smaller than pMinimumSize, in pixels, are always
+	 * bitmaps as distance fields look soft when that small. The software renderer only draws bitmaps.
+	 */
+	void FontSetRendering(FontRendering pFontRendering,int pMinimumSize = 16){mFontRendering = pFontRendering;mDistanceFieldMinimumSize = pMinimumSize;}
+	FontRendering FontGetRendering()const{return mFontRendering;}
+
+	/**
+	 * @brief Draws an outline around the font's text, a colour with an alpha of zero turns it off. Only distance field fonts have outlines.
+	 * The outline can be up to about a sixth of the font's size wide.
+	 */
+	void FontSetOutline(const uint32_t pFont,float pWidth,Colour pColour);
+
+	/**
+	 * @brief Draws a shadow under the font's text, moved by pOffsetX,pOffsetY and blurred over pSoftness pixels.
+	 * A colour with an alpha of zero turns it off. Only distance field fonts have shadows.
+	 */
+	void FontSetShadow(const uint32_t pFont,float pOffsetX,float pOffsetY,float pSoftness,Colour pColour);
+
 	/**
 	 * @brief Draws the rectangle based on style.
 	 * If texture is set, will fill with texture, otherwise
@@ -136,16 +496,67 @@ public:
 	 * Will open the header and look for formats it knows.
 	 * Because of this only formats with headers that are easy to tell the difference
 	 * from are supported.
+	 * If pUseAtlas is true see TextureCreate.
+	 */
+	uint32_t TextureLoad(const std::string& pFilename,bool pFiltered = false,bool pGenerateMipmaps = false,bool pUseAtlas = false);
+
+	/**
+	 * @brief Where an image loaded with TextureLoadAsync has got to.
+	 */
+	enum struct TextureState
+	{
+		PENDING,	//!< Being read and decoded, or waiting to be uploaded. Draws as the diagnostics texture.
+		READY,		//!< Uploaded, or the texture was not loaded with TextureLoadAsync.
+		FAILED		//!< The file could not be read or decoded. Stays as the diagnostics texture, delete it as any other.
+	};
+
+	/**
+	 * @brief TextureLoad with the file read and decoded on worker threads, so a screen with lots of images does not stall.
+	 * The handle is returned at once, until the image is uploaded it draws as the diagnostics texture and its size is that of the diagnostics texture.
+	 * Decoded images are uploaded in BeginFrame, within the budget set with SetTextureUploadBudget. The handle does not change when it is.
+	 * Use TextureGetLoadsWaiting to know when a frame needs drawing so the images are uploaded.
+	 */
+	uint32_t TextureLoadAsync(const std::string& pFilename,bool pFiltered = false,bool pGenerateMipmaps = false,bool pUseAtlas = false);
+
+	/**
+	 * @brief Whether a texture from TextureLoadAsync has been loaded, throws if the texture does not exist.
+	 */
+	TextureState TextureGetState(uint32_t pTexture)const;
+
+	/**
+	 * @brief True when images from TextureLoadAsync have been decoded and are waiting to be uploaded by the next BeginFrame.
+	 * Application redraws everything when this is true, it does not know where the textures are used.
+	 */
+	bool TextureGetLoadsWaiting()const;
+
+	/**
+	 * @brief The most bytes of pixels TextureLoadAsync uploads each frame, 4MB by default. Images over the budget wait for the next frame.
+	 * One image is always uploaded each frame, even if it is bigger than the budget, so nothing waits for ever.
 	 */
-	uint32_t TextureLoad(const std::string& pFilename,bool pFiltered = false,bool pGenerateMipmaps = false);
+	void SetTextureUploadBudget(size_t pBytes){mTextureLoads.uploadBudget = pBytes;}
+	size_t GetTextureUploadBudget()const{return mTextureLoads.uploadBudget;}
+
+	/**
+	 * @brief Keeps the images TextureLoad and TextureLoadAsync decode in pDirectory, so the next start maps them in instead of decoding them again.
+	 * An image that has changed since it was stored is decoded again. The directory is made if it is not there, returns false if it can not be.
+	 * Pass an empty string to stop using the cache, which is how it starts. Entries are the size of the pixels, nothing is deleted from the directory.
+	 */
+	bool SetTextureCache(const std::string& pDirectory);
+
+	/**
+	 * @brief Hits and misses of the texture cache since SetTextureCache, all zero if it is not set.
+	 */
+	TextureCacheStatistics GetTextureCacheStatistics()const;
 
 	/**
 	 * @brief Create a Texture object with the size passed in and a given name. 
 	 * pPixels is either RGB format 24bit or RGBA 32bit format is pHasAlpha is true.
 	 * pPixels can be null if you're going to use FillTexture later to set the image data.
 	 * But there is a GL gotcha with passing null, if you don't write to ALL the pixels the texture will not work. So if you're texture is always black you may not have filled it all.
+	 * If pUseAtlas is true and the image is small enough it is put into a page shared with other images, so lots of icons can be drawn without changing texture.
+	 * The handle returned can be used like any other, but the texture transform and texture wrapping do not work with atlas images. Images with mipmaps are never put in the atlas.
 	 */
-	uint32_t TextureCreate(int pWidth,int pHeight,const uint8_t* pPixels,TextureFormat pFormat,bool pFiltered = false,bool pGenerateMipmaps = false);
+	uint32_t TextureCreate(int pWidth,int pHeight,const uint8_t* pPixels,TextureFormat pFormat,bool pFiltered = false,bool pGenerateMipmaps = false,bool pUseAtlas = false);
 
 	/**
 	 * @brief Fill a sub rectangle, or the whole texture. Pixels is expected to be a continuous image data. So it's size is Width by Height of the region being updated.
@@ -160,13 +571,13 @@ public:
 	void TextureDelete(uint32_t pTexture);
 
 	/**
-	 * @brief Gets the width of the texture. Not recommended that this is called 1000's of times in a frame as it has to search a std::map for the object.
+	 * @brief Gets the width of the texture. Cheap to call, it is one look up in an array.
 	 */
 	int TextureGetWidth(uint32_t pTexture)const;
 
 
 	/**
-	 * @brief Gets the height of the texture. Not recommended that this is called 1000's of times in a frame as it has to search a std::map for the object.
+	 * @brief Gets the height of the texture. Cheap to call, it is one look up in an array.
 	 */
 	int TextureGetHeight(uint32_t pTexture)const;
 
@@ -175,6 +586,25 @@ public:
 	 */
 	uint32_t TextureGetDiagnostics()const{return mDiagnostics.texture;}
 
+	/**
+	 * @brief How full the texture atlas pages are, see TextureCreate.
+	 */
+	TextureAtlasStatistics GetTextureAtlasStatistics()const;
+
+#ifdef PLATFORM_SOFTWARE
+	/**
+	 * @brief The software renderer's frame buffer, GetDisplayWidth x GetDisplayHeight pixels with the top row first.
+	 * The pixels are in Colour's ARGB layout. The display rotation is not applied, see CopyFrameBuffer.
+	 */
+	const uint32_t* GetFrameBufferPixels()const;
+
+	/**
+	 * @brief Copies the frame buffer to a display the physical size passed to InitialiseGL, applying the display rotation.
+	 * pBitsPerPixel can be 32, pixels stored as Colour, or 16 for RGB565. pPitch is the bytes from one row to the next.
+	 */
+	void CopyFrameBuffer(uint8_t* rDest,int pPitch,int pBitsPerPixel)const;
+#endif
+
 private:
     bool mExitRequest = false;
 	DisplayRotation mDisplayRotation = ROTATE_FRAME_BUFFER_0;
@@ -191,11 +621,85 @@ private:
 		ScratchBuffer<uint8_t,128,16,512*512*4> scratchRam;// gets used for some temporary texture operations.
 		VertXY::Buffer vertices;
 		VertXY::Buffer uvs;
+		std::vector<uint32_t> glyphTextures;	//!< The texture of each glyph quad FreeTypeFont::BuildQuads writes.
 	}mWorkBuffers;
 
 	std::unique_ptr<struct IMAGE_LOADER>mImageLoader;
+#ifdef PLATFORM_SOFTWARE
+	std::unique_ptr<struct SoftwareRasterizer>mRasterizer;	//!< Draws into the frame buffer in memory, there is no GPU.
+#else
+	std::unique_ptr<struct GLDrawList>mDrawList;		//!< What has been drawn this frame but not yet sent to GL.
+	std::unique_ptr<struct GLState>mGLState;			//!< What GL state has been set, so calls that would not change it are skipped.
+	std::unique_ptr<struct TextureAtlas>mTextureAtlas;	//!< Small images that share texture pages, see TextureCreate.
+	std::unique_ptr<struct GeometryCache>mGeometryCache;//!< Rounded rectangle points from previous frames, so widgets that don't change don't rebuild them.
+	std::unique_ptr<struct GLTimerQueries>mTimerQueries;//!< Measures the GPU time of frames, see SetGPUTiming.
+#endif
+
+	struct
+	{
+		bool enabled = true;
+		DrawListStatistics current;		//!< Being counted for the frame being drawn.
+		DrawListStatistics lastFrame;	//!< Copied from current in EndFrame.
+	}mBatching;
 
-	std::map<uint32_t,std::unique_ptr<GLTexture>> mTextures; 	//!< Our textures. I reuse the GL texture index (handle) for my own. A handy value and works well.
+	ShapeRendering mShapeRendering = ShapeRendering::TESSELLATED;
+	bool mGPUTiming = false;
+
+	struct RedrawData
+	{
+		static constexpr size_t MAX_HISTORY = 4;		//!< Buffer ages older than this are treated as unknown.
+		static constexpr size_t MAX_REGIONS = 8;		//!< If the damage needs more regions than this the closest are merged.
+		static constexpr size_t MAX_DAMAGE = 64;		//!< If more damage than this is added it is all merged into one region, saves time.
+
+		bool enabled = true;
+		uint32_t bufferAge = 0;						//!< Set by the platform code for the next frame. Reset to zero, unknown, in EndFrame.
+		std::vector<Rectangle> damage;				//!< Added to with AddDamage for the frame about to be drawn.
+		std::vector<Rectangle> history[MAX_HISTORY];//!< The damage of the last few frames, most recent first. Needed when the buffer is more than one frame old.
+		size_t historyCount = 0;
+		std::vector<Rectangle> regions;				//!< What is being redrawn this frame.
+		size_t currentRegion = 0;
+		std::vector<Rectangle> frameDamage;			//!< Window coordinates, see GetFrameDamage.
+		std::vector<Rectangle> windowRegions;		//!< Work buffer for onRedrawRegions.
+		std::function<void(const std::vector<Rectangle>& pWindowRegions)> onRedrawRegions;
+		RedrawStatistics statistics;				//!< Set in BeginFrame for the frame being drawn.
+	}mRedraw;
+
+	struct LayerData
+	{
+		static constexpr uint32_t MAX_AGE = 300;	//!< Layers not drawn for this many frames are deleted, their element has most likely gone.
+
+		struct Layer
+		{
+			uint32_t framebuffer = 0;	//!< The GL framebuffer object that renders into the texture.
+			uint32_t texture = 0;		//!< Texture handle, from TextureCreate.
+			int width = 0,height = 0;
+			uint32_t bytes = 0;
+			uint32_t lastUsed = 0;		//!< Frame number it was last drawn in.
+			uint32_t renderedFrame = 0;	//!< Frame number its content was last rendered in.
+		};
+
+		HandleTable<Layer> layers;
+		uint32_t budget = 16*1024*1024;
+		uint32_t bytes = 0;
+		uint32_t rendering = 0;		//!< The layer being rendered into, zero when drawing to the display.
+
+		struct
+		{//!< What LayerBegin changed, put back by LayerEnd.
+			int framebuffer;
+			int viewport[4];
+			float clearColour[4];
+			float projection[4][4];
+		}saved;
+
+		LayerStatistics current;	//!< Being counted for the frame being drawn.
+		LayerStatistics lastFrame;	//!< Copied from current in EndFrame.
+	}mLayers;
+
+#ifdef PLATFORM_SOFTWARE
+	HandleTable<SoftwareTexture> mTextures;	//!< Our textures, the pixels are kept in memory in the form the rasterizer reads them.
+#else
+	HandleTable<GLTexture> mTextures; 	//!< Our textures. The handles are not the GL texture names, that is kept in the GLTexture.
+#endif
 
 	/**
 	 * @brief Some data used for diagnostics/
@@ -204,6 +708,9 @@ private:
 	{
 		uint32_t texture = 0; //!< A handy texture used in debugging. 16x16 check board.
 		uint32_t frameNumber = 0; //!< What frame we're on. incremented in BeginFrame() So first frame will be 1
+		FrameStatistics current;	//!< Being counted for the next frame, reset when it is copied to lastFrame in EndFrame.
+		FrameStatistics lastFrame;
+		size_t scratchGrowths = 0;	//!< The grow count of all the work buffers at the end of the last frame.
 	}mDiagnostics;
 
 	struct
@@ -211,7 +718,9 @@ private:
 		GLShaderPtr ColourOnly;
 		GLShaderPtr TextureColour;
 		GLShaderPtr TextureAlphaOnly;
-		GLShaderPtr RectangleBorder;
+		GLShaderPtr TextDistanceField;	//!< Distance field fonts, uses the shape vertices for the outline and softness.
+		GLShaderPtr Shape;				//!< Signed distance field rectangles, boarders and capsules.
+		GLShaderPtr TextureLayer;		//!< For layers, their content has premultiplied alpha.
 
 		GLShaderPtr CurrentShader = nullptr;
 	}mShaders;
@@ -228,20 +737,101 @@ private:
 
 	struct RoundedRectData
 	{
-		static const int NUM_POINTS_PER_CORNER = 31;
+		static constexpr int MIN_POINTS_PER_CORNER = 2;
+		static constexpr int MAX_POINTS_PER_CORNER = 31;
 		static const int NUM_QUADRANTS = 4;
-		static const int NUM_VERTICES = NUM_POINTS_PER_CORNER * NUM_QUADRANTS;
-		static const int NUM_BOARDER_VERTICES = ((NUM_POINTS_PER_CORNER * NUM_QUADRANTS * 2) + 2);
-		const float ANGLE_INC = GetRadian() / ((float)(NUM_POINTS_PER_CORNER-1) * NUM_QUADRANTS);
-
-		std::vector<eui::Colour> BoarderRaised,BoarderDepressed,BoarderWhite;
+		static const int MAX_TABLE_RADIUS = 1024;	//!< Corners with a bigger radius, in pixels, always use MAX_POINTS_PER_CORNER.
+		static constexpr float MAX_ERROR = 0.25f;	//!< The most, in pixels, the edge of a corner is allowed to be from a true circle.
+
+		/**
+		 * @brief Everything needed to draw a rounded rectangle with a given number of points per corner.
+		 * Built once in InitRoundedRect so we don't call sin / cos for every rectangle drawn.
+		 */
+		struct LevelOfDetail
+		{
+			int pointsPerCorner = 0;
+			int numVertices = 0;
+			int numBoarderVertices = 0;
+
+			struct UnitCirclePoint
+			{
+				float s,c;
+			};
+			std::vector<UnitCirclePoint> UnitCircle;	//!< Sine and cosine for each point around the four corners.
+
+			std::vector<eui::Colour> BoarderRaised,BoarderDepressed,BoarderWhite;
+		};
+
+		LevelOfDetail Levels[MAX_POINTS_PER_CORNER + 1];			//!< Indexed by the number of points per corner, below MIN_POINTS_PER_CORNER are not used.
+		uint8_t PointsPerCornerForRadius[MAX_TABLE_RADIUS + 1];	//!< Indexed by the corner radius in pixels, rounded up.
+
+		/**
+		 * @brief Picks the level of detail for the corner radius, in pixels, so small corners use a lot less vertices.
+		 */
+		const LevelOfDetail& GetLevel(float pRadius)const
+		{
+			const int radius = (int)ceil(pRadius);
+			if( radius > MAX_TABLE_RADIUS )
+			{
+				return Levels[MAX_POINTS_PER_CORNER];
+			}
+			return Levels[PointsPerCornerForRadius[std::max(0,radius)]];
+		}
 	}mRoundedRect;
 
 	int mMaximumAllowedGlyph = 128;
-	uint32_t mNextFreeTypeFontsId = 1;
-	std::map<uint32_t,std::unique_ptr<FreeTypeFont>> mFreeTypeFonts;
+	int mGlyphCachePages = 4;
+	FontRendering mFontRendering = FontRendering::BITMAP;
+	int mDistanceFieldMinimumSize = 16;
+	std::map<std::string,std::weak_ptr<FreeTypeFace>> mFontFaces;				//!< The open font files, a face goes when the last font using it does.
+	std::map<std::string,std::shared_ptr<FreeTypeFont>> mDistanceFieldFaces;	//!< The face and glyphs of each distance field font, shared by all its sizes.
+	HandleTable<FreeTypeFont> mFreeTypeFonts;
+
+	struct TextRunData
+	{
+		static constexpr uint32_t MAX_AGE = 300;	//!< Text runs not drawn for this many frames are deleted, their element has most likely gone.
+
+		struct TextRun
+		{
+			uint32_t font = 0;
+			Rectangle rect;				//!< What the text was aligned in.
+			Alignment alignment = 0;
+			std::string text;
+			Rectangle bounds;			//!< Where the text ended up.
+			VertXY::Vector vertices;	//!< Six a glyph, in the same form FreeTypeFont::BuildQuads writes them.
+			VertXY::Vector uvs;
+			std::vector<uint32_t> textures;	//!< Of each glyph, they can be in different pages of the font's glyph cache.
+			uint32_t generation = 0;	//!< The font's cache generation when the quads were built, if it changes they are built again.
+			uint32_t lastUsed = 0;		//!< Frame number it was last drawn in.
+		};
+
+		HandleTable<TextRun> runs;
+	}mTextRuns;
+
+	struct TextureLoadData
+	{
+		struct Load
+		{
+			uint32_t texture = 0;	//!< The handle given out, a placeholder until the image is uploaded.
+			bool filtered = false;
+			bool generateMipmaps = false;
+			bool useAtlas = false;
+			std::shared_ptr<ImageDecodeJob> job;
+		};
+
+		std::deque<Load> pending;		//!< In the order they were asked for.
+		std::set<uint32_t> failed;		//!< Textures whose file could not be loaded, kept so TextureGetState can say so.
+		size_t uploadBudget = 4*1024*1024;
+		uint32_t loadedFrame = 0;		//!< Frame number images were last uploaded in, layers rendered before it may show the placeholders.
+	}mTextureLoads;
+	std::unique_ptr<WorkerPool> mWorkerPool;		//!< Made when first needed, the image decoder and glyph rasterizer share it so must go first.
+	std::unique_ptr<ImageDecoder> mImageDecoder;	//!< Made on the first TextureLoadAsync.
+	std::shared_ptr<TextureCache> mTextureCache;	//!< Shared with the decode jobs, see SetTextureCache.
 
 	FT_Library mFreetype = nullptr;
+	std::unique_ptr<FreeTypeMemory> mFreetypeMemory;	//!< Counts what FreeType allocates, so the cost of faces can be reported.
+	std::unique_ptr<GlyphRasterizer> mGlyphRasterizer;	//!< Made when the first font is loaded.
+	std::string mPrerenderCharacters = " !\"#$%&'()*+,-./0123456789:;<=>?@ABCDEFGHIJKLMNOPQRSTUVWXYZ[\\]^_`abcdefghijklmnopqrstuvwxyz{|}~";
 
 	/**
 	 * @brief Sets some common rendering states for a nice starting point.
@@ -249,9 +839,109 @@ private:
 	void SetRenderingDefaults();
 
 	void BuildDebugTexture();
+
+	/**
+	 * @brief Adds the pixels sent to a texture to the frame's counts.
+	 */
+	void CountTextureUpload(int pWidth,int pHeight,TextureFormat pFormat);
+
+	/**
+	 * @brief Called from EndFrame once the renderer has filled in its counts, makes them the last frame's and starts counting the next.
+	 * pScratchGrowCount is the total grow count of all the renderer's work buffers.
+	 */
+	void FinishFrameStatistics(size_t pScratchGrowCount);
+
+	/**
+	 * @brief Works out where to put text so that it is aligned in pRect, pTextRect is from FontGetRect.
+	 */
+	static void GetAlignedTextPosition(const Rectangle& pRect,const Rectangle& pTextRect,const Alignment pAlignment,float& rX,float& rY);
+
+	/**
+	 * @brief Submits the glyph quads of a text run, done by the renderer.
+	 */
+	void TextDraw(const TextRunData::TextRun& pRun,Colour pColour);
+
+	/**
+	 * @brief Draws glyph quads, six vertices a glyph, pTextures has the texture of each glyph.
+	 */
+	void DrawGlyphs(const FreeTypeFont& pFont,const uint32_t* pTextures,const VertXY* pVerts,const VertXY* pUVs,size_t pNumVerts,Colour pColour);
+
+	/**
+	 * @brief Deletes the text runs that have not been drawn for a while, called from BeginFrame.
+	 */
+	void TextRunsAgeOut();
+
+	/**
+	 * @brief Makes the texture TextureLoadAsync hands out, it shares the pixels of the diagnostics texture. Done by the renderer.
+	 */
+	uint32_t TextureCreatePlaceholder();
+
+	/**
+	 * @brief Moves pTexture to the handle of the placeholder, which is deleted, so the handle given out now draws the image. Done by the renderer.
+	 */
+	void TextureReplacePlaceholder(uint32_t pPlaceholder,uint32_t pTexture);
+
+	/**
+	 * @brief Uploads the images the decoder has finished, up to the upload budget, called from BeginFrame.
+	 */
+	void TextureLoadsUpload();
+
+	/**
+	 * @brief The threads fonts and images are loaded on, made the first time it is asked for.
+	 */
+	WorkerPool& GetWorkerPool();
+
+	/**
+	 * @brief Stops waiting for the image of a texture being deleted.
+	 */
+	void TextureLoadForget(uint32_t pTexture);
+
+	/**
+	 * @brief TextureFill for images in the texture atlas. Converts the pixels to RGBA, the format of the pages.
+	 */
+	void TextureAtlasFill(const GLTexture& pTexture,int pX,int pY,int pWidth,int pHeight,const uint8_t* pPixels,TextureFormat pFormat);
+
+	/**
+	 * @brief Works out the redraw regions for the frame from the damage added and the buffer age. Called from BeginFrame.
+	 */
+	void BuildRedrawRegions();
+
+	/**
+	 * @brief Makes a layer, throwing away the least recently used ones if needed to keep to the budget.
+	 * Returns zero if there is no room, or the framebuffer could not be made.
+	 */
+	uint32_t LayerCreate(int pWidth,int pHeight);
+
+	/**
+	 * @brief Deletes the least recently used layer that has not been drawn this frame. Returns false if there is not one.
+	 */
+	bool LayerEvict();
+	void LayerDelete(uint32_t pLayer);
+
+	/**
+	 * @brief Layers are pixel aligned, this rounds the rectangle out to whole pixels.
+	 */
+	static Rectangle GetLayerRect(const Rectangle& pRect);
+
+	/**
+	 * @brief Sends the projection and transform to the current shader again, after the projection has been changed for a layer.
+	 */
+	void ReloadShader();
+
+	/**
+	 * @brief Converts a rectangle in display coordinates to physical window pixels, origin bottom left. Takes the display rotation into account.
+	 */
+	Rectangle GetWindowRect(const Rectangle& pRect)const;
 	void InitFreeTypeFont();
 	void InitRoundedRect();
 
+	/**
+	 * @brief Returns the points for a rounded rectangle, or its boarder, reusing the ones built in a previous frame if the rectangle has not changed.
+	 */
+	const std::vector<VertXY>& GetRoundedRectangleCached(const Rectangle& pRect,float pRadius);
+	const std::vector<VertXY>& GetRoundedRectangleUVsCached(const Rectangle& pRect,float pRadius);
+	const std::vector<VertXY>& GetRoundedRectangleBoarderCached(const Rectangle& pRect,float pRadius,float pThickness);
+
 	/**
 	 * @brief Set the Projection for 2D rendering.
 	 * This is how we rotate the screen for free.
@@ -282,7 +972,31 @@ private:
 	void BuildShaders();
 
 	void EnableShader(GLShaderPtr pShader);
-	void VertexPtr(int pNum_coord, uint32_t pType,const void* pPointer);
+
+	/**
+	 * @brief Adds a primitive to the draw list. The colour is multiplied with the per point colours, if they are passed.
+	 * pUVs can be null for shaders that do not use a texture.
+	 */
+	void AddPrimitive(Topology pTopology,GLShaderPtr pShader,uint32_t pTexture,const VertXY* pPoints,const VertXY* pUVs,size_t pCount,Colour pColour,const Colour* pColours = nullptr);
+
+	/**
+	 * @brief Adds a shape for the signed distance field shader, a rounded box centred on pCentreX,pCentreY.
+	 * pAxisX,pAxisY is the unit direction of the box's width, so capsules can be drawn at any angle.
+	 * All sizes are in pixels, a thickness of zero means no boarder.
+	 */
+	void AddShape(float pCentreX,float pCentreY,float pAxisX,float pAxisY,float pHalfWidth,float pHalfHeight,float pRadius,float pThickness,Colour pFill,Colour pBorder,BoarderStyle pBoarderStyle);
+
+	/**
+	 * @brief Adds glyph quads of a distance field font for the TextDistanceField shader, moved by pOffsetX,pOffsetY.
+	 * pScale turns the distance in the glyphs to pixels, pOutline and pSoftness are in pixels.
+	 */
+	void AddDistanceFieldGlyphs(const uint32_t* pTextures,const VertXY* pVerts,const VertXY* pUVs,size_t pNumVerts,float pOffsetX,float pOffsetY,float pScale,float pOutline,float pSoftness,Colour pColour,Colour pOutlineColour);
+
+	/**
+	 * @brief Sends all that is in the draw list to GL and empties it.
+	 * Called at the end of the frame and when ever GL state that the draw list depends on is about to change.
+	 */
+	void FlushDrawList();
 };
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -49,6 +49,18 @@ constexpr Colour SetAlpha(Colour pColour,uint8_t pA = 255)
     return (pA<<24) | (pColour&0x00ffffff);
 }
 
+/**
+ * @brief Multiplies the two colours together, channel by channel, the same as a shader would.
+ */
+constexpr Colour ModulateColour(const Colour pA,const Colour pB)
+{
+    return MakeColour(
+        (GetRed(pA) * GetRed(pB)) / 255,
+        (GetGreen(pA) * GetGreen(pB)) / 255,
+        (GetBlue(pA) * GetBlue(pB)) / 255,
+        (GetAlpha(pA) * GetAlpha(pB)) / 255);
+}
+
 static const Colour COLOUR_NONE = 0;
 static const Colour COLOUR_BLACK = MakeColour(0,0,0);
 static const Colour COLOUR_WHITE = MakeColour(255,255,255);
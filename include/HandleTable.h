@@ -0,0 +1,162 @@
+#ifndef HANDLE_TABLE_H__
+#define HANDLE_TABLE_H__
+
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <string>
+#include <stdexcept>
+
+namespace eui{
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Handle table, turns a uint32_t handle into an object with one array access.
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * @brief Keeps objects in a dense array and hands out uint32_t handles to them.
+ * A handle is the slot index plus one in the low INDEX_BITS, so zero is never a valid handle, with the slot's generation above it.
+ * When an object is removed the generation of its slot goes up, so old handles to a reused slot are seen as stale and not found.
+ */
+template<typename HANDLE_TYPE> struct HandleTable
+{
+	static constexpr uint32_t INDEX_BITS = 20;	//!< Allows for a million objects, leaves 12 bits of generation.
+	static constexpr uint32_t INDEX_MASK = (1u << INDEX_BITS) - 1;
+
+	/**
+	 * @brief Adds the object and returns its handle.
+	 */
+	uint32_t Add(std::unique_ptr<HANDLE_TYPE> pObject)
+	{
+		uint32_t index;
+		if( mFreeSlots.size() > 0 )
+		{
+			index = mFreeSlots.back();
+			mFreeSlots.pop_back();
+		}
+		else
+		{
+			if( mSlots.size() >= INDEX_MASK )
+			{
+				throw std::runtime_error("HandleTable is full");
+			}
+			index = (uint32_t)mSlots.size();
+			mSlots.emplace_back();
+		}
+
+		mSlots[index].object = std::move(pObject);
+		return (mSlots[index].generation << INDEX_BITS) | (index + 1);
+	}
+
+	/**
+	 * @brief Returns the object or null if the handle is not valid or is stale.
+	 */
+	HANDLE_TYPE* Find(uint32_t pHandle){return FindSlotObject(pHandle);}
+	const HANDLE_TYPE* Find(uint32_t pHandle)const{return FindSlotObject(pHandle);}
+
+	/**
+	 * @brief Returns the object, throws an exception if the handle is not valid or is stale.
+	 */
+	HANDLE_TYPE& Get(uint32_t pHandle){return *GetSlotObject(pHandle);}
+	const HANDLE_TYPE& Get(uint32_t pHandle)const{return *GetSlotObject(pHandle);}
+
+	/**
+	 * @brief Deletes the object and frees the slot for reuse. Returns false if the handle was not valid.
+	 */
+	bool Remove(uint32_t pHandle)
+	{
+		if( Find(pHandle) == nullptr )
+		{
+			return false;
+		}
+
+		const uint32_t index = (pHandle&INDEX_MASK) - 1;
+		mSlots[index].object.reset();
+		mSlots[index].generation = (mSlots[index].generation + 1) & (0xffffffff >> INDEX_BITS);
+		mFreeSlots.push_back(index);
+		return true;
+	}
+
+	/**
+	 * @brief Puts the object of pFrom in place of the object of pTo, which is deleted, and removes pFrom.
+	 * Lets an object be swapped for another without the handles given out for it changing. Throws if either handle is not valid.
+	 */
+	void Move(uint32_t pFrom,uint32_t pTo)
+	{
+		if( pFrom == pTo )
+		{
+			return;
+		}
+		Get(pFrom);
+		Get(pTo);
+		std::swap(mSlots[(pFrom&INDEX_MASK) - 1].object,mSlots[(pTo&INDEX_MASK) - 1].object);
+		Remove(pFrom);// Now holds the object of pTo.
+	}
+
+	/**
+	 * @brief Calls pFunction(handle,object) for all the objects in the table.
+	 */
+	template<class FUNCTION> void ForEach(FUNCTION pFunction)
+	{
+		for( uint32_t index = 0 ; index < mSlots.size() ; index++ )
+		{
+			if( mSlots[index].object )
+			{
+				pFunction((mSlots[index].generation << INDEX_BITS) | (index + 1),*mSlots[index].object);
+			}
+		}
+	}
+
+	template<class FUNCTION> void ForEach(FUNCTION pFunction)const
+	{
+		for( uint32_t index = 0 ; index < mSlots.size() ; index++ )
+		{
+			if( mSlots[index].object )
+			{
+				pFunction((mSlots[index].generation << INDEX_BITS) | (index + 1),(const HANDLE_TYPE&)*mSlots[index].object);
+			}
+		}
+	}
+
+	void Clear()
+	{
+		mSlots.clear();
+		mFreeSlots.clear();
+	}
+
+	size_t GetSize()const{return mSlots.size() - mFreeSlots.size();}
+
+private:
+	struct Slot
+	{
+		uint32_t generation = 0;
+		std::unique_ptr<HANDLE_TYPE> object;
+	};
+
+	std::vector<Slot> mSlots;
+	std::vector<uint32_t> mFreeSlots;
+
+	// The const and non const versions of Find and Get share these, a const table only hands out const objects.
+	HANDLE_TYPE* FindSlotObject(uint32_t pHandle)const
+	{
+		const uint32_t index = (pHandle&INDEX_MASK) - 1;// Zero wraps around to a huge number, so fails the size check.
+		if( index < mSlots.size() && mSlots[index].generation == (pHandle >> INDEX_BITS) )
+		{
+			return mSlots[index].object.get();
+		}
+		return nullptr;
+	}
+
+	HANDLE_TYPE* GetSlotObject(uint32_t pHandle)const
+	{
+		HANDLE_TYPE* object = FindSlotObject(pHandle);
+		if( object == nullptr )
+		{
+			throw std::runtime_error("HandleTable handle " + std::to_string(pHandle) + " is not valid");
+		}
+		return object;
+	}
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+}//namespace eui{
+
+#endif //#ifndef HANDLE_TABLE_H__
@@ -32,6 +32,16 @@ struct Rectangle
         return pRect;
     }
 
+    bool operator == (const Rectangle& pRect)const
+    {
+        return left == pRect.left && top == pRect.top && right == pRect.right && bottom == pRect.bottom;
+    }
+
+    bool operator != (const Rectangle& pRect)const
+    {
+        return !(*this == pRect);
+    }
+
     void Set(float pLeft,float pTop,float pRight,float pBottom)
     {
         left = pLeft;
@@ -40,6 +50,53 @@ struct Rectangle
         bottom = pBottom;
     }
 
+    /**
+     * @brief True if the rectangle has no area.
+     */
+    bool GetIsEmpty()const
+    {
+        return right <= left || bottom <= top;
+    }
+
+    /**
+     * @brief True if the two rectangles share any area.
+     */
+    bool GetOverlaps(const Rectangle& pRect)const
+    {
+        return left < pRect.right && pRect.left < right &&
+               top < pRect.bottom && pRect.top < bottom;
+    }
+
+    /**
+     * @brief True if the two rectangles share any area or their edges touch.
+     */
+    bool GetTouches(const Rectangle& pRect)const
+    {
+        return left <= pRect.right && pRect.left <= right &&
+               top <= pRect.bottom && pRect.top <= bottom;
+    }
+
+    /**
+     * @brief The smallest rectangle that contains both.
+     */
+    Rectangle GetUnion(const Rectangle& pRect)const
+    {
+        return Rectangle(std::min(left,pRect.left),std::min(top,pRect.top),std::max(right,pRect.right),std::max(bottom,pRect.bottom));
+    }
+
+    /**
+     * @brief The area the two share, will be empty if they do not overlap.
+     */
+    Rectangle GetIntersection(const Rectangle& pRect)const
+    {
+        return Rectangle(std::max(left,pRect.left),std::max(top,pRect.top),std::min(right,pRect.right),std::min(bottom,pRect.bottom));
+    }
+
+    float GetArea()const
+    {
+        return GetIsEmpty() ? 0.0f : GetWidth() * GetHeight();
+    }
+
     bool ContainsPoint(float pX,float pY)const
     {
         return pX >= left && pX <= right &&
@@ -48,6 +48,11 @@ template<typename SCRATCH_MEMORY_TYPE,int START_TYPE_COUNT,int GROWN_TYPE_COUNT,
 	 */
 	const size_t MemoryUsed()const{return mCount * sizeof(SCRATCH_MEMORY_TYPE);}
 
+	/**
+	 * @brief Diagnostics tool, how many times the memory has had to be reallocated.
+	 */
+	const size_t GrowCount()const{return mGrowCount;}
+
 	/**
 	 * @brief The root of our memory, handy for when you've finished filling the buffer and need to now do work with it.
 	 * You should fetch this memory pointer AFTER you have done your work as it may change as you fill the data.
@@ -58,6 +63,7 @@ private:
 	SCRATCH_MEMORY_TYPE* mMemory; //<! Our memory, only reallocated when it's too small. That is the speed win!
 	size_t mCount; //<! How many there are available to write too.
 	size_t mNextIndex; //<! Where we can write to next.
+	size_t mGrowCount = 0; //<! How many times the memory has been reallocated.
 
 	/**
 	 * @brief Makes sure we always have space.
@@ -73,10 +79,11 @@ private:
 		{
 			const size_t newCount = mCount + pExtraSpaceNeeded + GROWN_TYPE_COUNT;
 			SCRATCH_MEMORY_TYPE* newMemory = new SCRATCH_MEMORY_TYPE[newCount];
-			std::memmove(newMemory,mMemory,mCount);
+			std::memmove(newMemory,mMemory,mNextIndex * sizeof(SCRATCH_MEMORY_TYPE));
 			delete []mMemory;
 			mMemory = newMemory;
 			mCount = newCount;
+			mGrowCount++;
 		}
 	}
 };
@@ -57,6 +57,7 @@ private:
 
     virtual bool OnTouched(float pLocalX,float pLocalY,bool pTouched,bool pMoving)
     {
+        const eui::BoarderStyle oldStyle = GetStyle().mBoarderStyle;
         if( pTouched )
         {
             GetStyle().mBoarderStyle = eui::BS_DEPRESSED;
@@ -74,6 +75,11 @@ private:
             }
         }
 
+        if( oldStyle != GetStyle().mBoarderStyle )
+        {
+            Invalidate();
+        }
+
         return false;
     }
 };
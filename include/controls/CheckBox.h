@@ -60,6 +60,7 @@ public:
         if( pTouched && pMoving == false )
         {
             mChecked = !mChecked;
+            Invalidate();
             if( mBoundBool )
             {
                 *mBoundBool = mChecked;
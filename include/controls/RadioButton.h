@@ -57,7 +57,7 @@ public:
         return true;
     }
 
-    RadioButtonPtr SetChecked(bool pChecked){mChecked = pChecked; return this;}
+    RadioButtonPtr SetChecked(bool pChecked){if( mChecked != pChecked ){mChecked = pChecked;Invalidate();} return this;}
 
 private:
     bool mChecked = false;
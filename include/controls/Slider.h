@@ -96,7 +96,12 @@ public:
             pLocalX = mSliderRect.ClampX(pLocalX);
             float XPercent = pLocalX / mSliderRect.GetWidth();
 
-            mValue = (int)(mMin + ((mMax - mMin) * XPercent));
+            const int newValue = (int)(mMin + ((mMax - mMin) * XPercent));
+            if( newValue != mValue )
+            {
+                mValue = newValue;
+                Invalidate();
+            }
 
             return true;
         }
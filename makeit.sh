@@ -37,3 +37,12 @@ cmake --build build/debug --target EdgeUI.DRM -- -j${NUMBER_OF_THREADS}
  
 #cmake --build build/debug --target EdgeUI.GTK4 -- -j${NUMBER_OF_THREADS}
 #cmake --build build/release --target EdgeUI.GTK4 -- -j${NUMBER_OF_THREADS}
+
+#cmake --build build/debug --target EdgeUI.Headless -- -j${NUMBER_OF_THREADS}
+#cmake --build build/release --target EdgeUI.Headless -- -j${NUMBER_OF_THREADS}
+
+#cmake --build build/debug --target EdgeUI.Software -- -j${NUMBER_OF_THREADS}
+#cmake --build build/release --target EdgeUI.Software -- -j${NUMBER_OF_THREADS}
+
+#cmake --build build/release --target EdgeUI.RoundedRectBench -- -j${NUMBER_OF_THREADS}
+#cmake --build build/release --target EdgeUI.Bench -- -j${NUMBER_OF_THREADS}
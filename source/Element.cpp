@@ -147,6 +147,10 @@ Element::Element(const tinyjson::JsonValue &root,ResouceMap* pLoadResources)
         {
             SetVisible(child.second);
         }
+        else if( child.first == "cached" )
+        {
+            SetCached(child.second);
+        }
         else if( child.first == "active" )
         {
             SetActive(child.second);
@@ -241,6 +245,7 @@ ElementPtr Element::SetPos(uint32_t pX,uint32_t pY)
 {
     mX = pX;
     mY = pY;
+    Invalidate();
     return this;
 }
 
@@ -249,6 +254,7 @@ ElementPtr Element::SetGrid(uint32_t pWidth,uint32_t pHeight)
     mAutoGrid = false;
     mWidth = pWidth;
     mHeight = pHeight;
+    Invalidate();
     return this;
 }
 
@@ -256,6 +262,7 @@ ElementPtr Element::SetAutoGrid(bool pHorizontal)
 {
     mAutoGrid = true;
     mAutoGridHorizontal = pHorizontal;
+    Invalidate();
     return this;
 }
 
@@ -264,6 +271,7 @@ ElementPtr Element::SetSpan(uint32_t pX,uint32_t pY)
     mAutoGrid = false;
     mSpanX = pX;
     mSpanY = pY;
+    Invalidate();
     return this;
 }
 
@@ -288,6 +296,7 @@ ElementPtr Element::SetPadding(float pPadding)
     mPadding.right = 1.0f - pPadding;
     mPadding.top = pPadding;
     mPadding.bottom = 1.0f - pPadding;
+    Invalidate();
     return this;
 }
 
@@ -297,6 +306,7 @@ ElementPtr Element::SetPadding(float pX,float pY)
     mPadding.right = 1.0f - pX;
     mPadding.top = pY;
     mPadding.bottom = 1.0f - pY;
+    Invalidate();
     return this;
 }
 
@@ -306,12 +316,14 @@ ElementPtr Element::SetPadding(float pLeft,float pRight,float pTop,float pBottom
     mPadding.right = pRight;
     mPadding.top = pTop;
     mPadding.bottom = pBottom;
+    Invalidate();
     return this;
 }
 
 ElementPtr Element::SetPadding(const Rectangle& pPadding)
 {
     mPadding = pPadding;
+    Invalidate();
     return this;
 }
 
@@ -437,6 +449,7 @@ ElementPtr Element::Attach(ElementPtr pElement)
     VERBOSE_MESSAGE("Attaching " + pElement->GetID() + " to " + mID);
     mChildren.push_back(pElement);
     pElement->mParent = this;
+    Invalidate();
     return this;
 }
 
@@ -444,9 +457,64 @@ ElementPtr Element::Remove(ElementPtr pElement)
 {
     pElement->mParent = nullptr;
     mChildren.remove(pElement);
+    Invalidate();
+    return this;
+}
+
+ElementPtr Element::Invalidate()
+{
+    mDirty = true;
+    // Once a parent knows it has a dirty child, so do all of its parents.
+    for( ElementPtr p = mParent ; p != nullptr && p->mChildDirty == false ; p = p->mParent )
+    {
+        p->mChildDirty = true;
+    }
     return this;
 }
 
+void Element::ClearDirty()
+{
+    if( mDirty || mChildDirty )
+    {
+        mDirty = false;
+        mChildDirty = false;
+        for( auto& e : mChildren )
+        {
+            e->ClearDirty();
+        }
+    }
+}
+
+void Element::SubmitDamage(Graphics* pGraphics)
+{
+    assert(pGraphics);
+    if( mDirty )
+    {
+        if( mDrawnRectangle.GetIsEmpty() == false )
+        {
+            pGraphics->AddDamage(mDrawnRectangle);
+        }
+
+        if( mVisible )
+        {
+            pGraphics->AddDamage(mContentRectangle);
+            mDrawnRectangle = mContentRectangle;
+        }
+        else
+        {
+            mDrawnRectangle = Rectangle();
+        }
+    }
+
+    if( mDirty || mChildDirty )
+    {
+        for( auto& e : mChildren )
+        {
+            e->SubmitDamage(pGraphics);
+        }
+    }
+}
+
 void Element::Layout(const Rectangle& pParentRect)
 {
     if( mAutoGrid && mChildren.size() > 0 )
@@ -463,7 +531,13 @@ void Element::Layout(const Rectangle& pParentRect)
         }
     }
 
+    const Rectangle oldContentRectangle = mContentRectangle;
     CalculateContentRectangle(pParentRect);
+    if( mContentRectangle != oldContentRectangle )
+    {// It has moved, so where it was and where it is now need redrawing.
+        Invalidate();
+    }
+
     for( auto& e : mChildren )
     {
         e->Layout(mContentRectangle);
@@ -500,26 +574,54 @@ void Element::Draw(Graphics* pGraphics)
     }
 
     mAlreadyDrawing = true;
-    if( mVisible )
+    // Skip elements that are not in the area being redrawn, their children are inside them so they are skipped too.
+    if( mVisible && pGraphics->GetIsInRedrawRegion(mContentRectangle) )
     {
-        // I do not like the logic here.
-        bool propagateToChildren = OnDraw(pGraphics,mContentRectangle) == false;
-        if( mOnDrawCB && mOnDrawCB(this,pGraphics,mContentRectangle) == false )
-        {
-            propagateToChildren = true;
-        }
-
-        if( propagateToChildren )
+        if( mCached )
         {
-            for( auto& e : mChildren )
+            switch( pGraphics->LayerBegin(mLayer,mContentRectangle,GetIsDirty()) )
             {
-                e->Draw(pGraphics);
+            case Graphics::LayerState::RENDER:
+                DrawContent(pGraphics);
+                pGraphics->LayerEnd();
+                pGraphics->LayerDraw(mLayer,mContentRectangle);
+                break;
+
+            case Graphics::LayerState::UP_TO_DATE:
+                pGraphics->LayerDraw(mLayer,mContentRectangle);
+                break;
+
+            case Graphics::LayerState::UNAVAILABLE:
+                DrawContent(pGraphics);
+                break;
             }
         }
+        else
+        {
+            DrawContent(pGraphics);
+        }
     }
     mAlreadyDrawing = false;
 }
 
+void Element::DrawContent(Graphics* pGraphics)
+{
+    // I do not like the logic here.
+    bool propagateToChildren = OnDraw(pGraphics,mContentRectangle) == false;
+    if( mOnDrawCB && mOnDrawCB(this,pGraphics,mContentRectangle) == false )
+    {
+        propagateToChildren = true;
+    }
+
+    if( propagateToChildren )
+    {
+        for( auto& e : mChildren )
+        {
+            e->Draw(pGraphics);
+        }
+    }
+}
+
 bool Element::CursorEvent(float pX,float pY,bool pTouched,bool pMoving)
 {
     if( mContentRectangle.ContainsPoint(pX,pY) )
@@ -585,7 +687,7 @@ bool Element::OnDraw(Graphics* pGraphics,const Rectangle& pContentRect)
         const uint32_t font = GetFont();
         if( font != 0 )
         {
-            pGraphics->FontPrint(font,mContentRectangle,mStyle.mAlignment,mStyle.mForeground,mText);
+            pGraphics->TextPrint(mTextRun,font,mContentRectangle,mStyle.mAlignment,mStyle.mForeground,mText);
         }
         else
         {
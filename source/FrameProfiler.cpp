@@ -0,0 +1,104 @@
+#include "FrameProfiler.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace eui{
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+void FrameProfiler::SetEnabled(bool pEnabled,size_t pHistory)
+{
+	if( pEnabled && !mEnabled )
+	{
+		for( auto& phase : mPhases )
+		{
+			phase.times.assign(std::max(pHistory,(size_t)1),0.0f);
+			phase.next = 0;
+			phase.count = 0;
+		}
+		mFrame.started = false;
+		ClearFrame();
+	}
+	mEnabled = pEnabled;
+}
+
+FramePhaseStatistics FrameProfiler::GetStatistics(FramePhase pPhase)const
+{
+	FramePhaseStatistics stats;
+	const History& history = mPhases[(size_t)pPhase];
+	if( history.count == 0 )
+	{
+		return stats;
+	}
+
+	// The ring is full or starts at zero, so the first count entries are the times kept.
+	std::vector<double> sorted(history.times.begin(),history.times.begin() + history.count);
+	std::sort(sorted.begin(),sorted.end());
+
+	double sum = 0.0;
+	for( double t : sorted )
+	{
+		sum += t;
+	}
+
+	stats.samples = (uint32_t)history.count;
+	stats.last = history.times[(history.next + history.times.size() - 1) % history.times.size()];
+	stats.min = sorted.front();
+	stats.mean = sum / sorted.size();
+	stats.p95 = GetPercentile(sorted,95.0);
+	stats.p99 = GetPercentile(sorted,99.0);
+	stats.max = sorted.back();
+	return stats;
+}
+
+const char* FrameProfiler::GetPhaseName(FramePhase pPhase)
+{
+	switch( pPhase )
+	{
+	case FramePhase::APP_UPDATE:		return "app update";
+	case FramePhase::LAYOUT:			return "layout";
+	case FramePhase::ELEMENT_UPDATE:	return "element update";
+	case FramePhase::DRAW:				return "draw";
+	case FramePhase::SWAP:				return "swap";
+	case FramePhase::GPU:				return "gpu";
+	case FramePhase::FRAME:				return "frame";
+	case FramePhase::COUNT:				break;
+	}
+	return "unknown";
+}
+
+double FrameProfiler::GetPercentile(const std::vector<double>& pSorted,double pPercent)
+{
+	const size_t rank = (size_t)std::ceil(pPercent * pSorted.size() / 100.0);
+	return pSorted[std::clamp(rank,(size_t)1,pSorted.size()) - 1];
+}
+
+void FrameProfiler::NextFrame(Clock::time_point pNow)
+{
+	if( mFrame.started )
+	{
+		for( size_t n = 0 ; n < (size_t)FramePhase::COUNT ; n++ )
+		{
+			if( mFrame.ran[n] )
+			{
+				mPhases[n].Add(mFrame.time[n]);
+			}
+		}
+		mPhases[(size_t)FramePhase::FRAME].Add(std::chrono::duration<double,std::milli>(pNow - mFrame.frameStart).count());
+	}
+
+	mFrame.started = true;
+	mFrame.frameStart = pNow;
+	ClearFrame();
+}
+
+void FrameProfiler::ClearFrame()
+{
+	for( size_t n = 0 ; n < (size_t)FramePhase::COUNT ; n++ )
+	{
+		mFrame.time[n] = 0.0;
+		mFrame.ran[n] = false;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+}//namespace eui{
@@ -2,84 +2,190 @@
 #include "Diagnostics.h"
 #include "FreeTypeFont.h"
 
+#include <cstddef>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
 /**
- * @brief Because this is a very simple font system I have a limited number of characters I can render. This allows me to use the ones I expect to be most useful.
+ * @brief Decodes the next character from UTF-8, returns the replacement character for bytes that are not valid UTF-8.
  */
-static std::array<int,256>GlyphIndex;
-static bool BuildGlyphIndex = true;
-
-inline int GetGlyphIndex(FT_UInt pCharacter)
+inline FT_UInt GetNextCharacter(const char*& rText,const char* pEnd)
 {
-	if( pCharacter < GlyphIndex.size() )
+	const uint8_t c = (uint8_t)*rText++;
+	if( c < 0x80 )
+	{
+		return c;
+	}
+
+	int extra;
+	FT_UInt character;
+	if( (c&0xe0) == 0xc0 )
+	{
+		extra = 1;
+		character = c&0x1f;
+	}
+	else if( (c&0xf0) == 0xe0 )
+	{
+		extra = 2;
+		character = c&0x0f;
+	}
+	else if( (c&0xf8) == 0xf0 )
+	{
+		extra = 3;
+		character = c&0x07;
+	}
+	else
+	{// A continuation byte with no start, or not UTF-8 at all.
+		return eui::FreeTypeFont::REPLACEMENT_CHARACTER;
+	}
+
+	for( ; extra > 0 ; extra-- )
 	{
-		return GlyphIndex[pCharacter];
+		if( rText == pEnd || ((uint8_t)*rText&0xc0) != 0x80 )
+		{// Cut short, the byte that is not a continuation is the start of the next character.
+			return eui::FreeTypeFont::REPLACEMENT_CHARACTER;
+		}
+		character = (character << 6) | ((uint8_t)*rText++&0x3f);
 	}
-	return -1;
+	return character;
 }
 
-inline FT_UInt GetNextGlyph(const char *& pText)
-{
-	if( pText == 0 )
-		return 0;
+namespace eui{
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Each block has its size in front of it, FreeType does not pass the size when freeing.
+static constexpr size_t BLOCK_HEADER = alignof(std::max_align_t);
 
-	const FT_UInt c1 = *pText;
-	pText++;
+static void* FreeTypeAlloc(FT_Memory pMemory,long pSize)
+{
+	uint8_t* block = (uint8_t*)malloc(BLOCK_HEADER + pSize);
+	if( block == nullptr )
+	{
+		return nullptr;
+	}
+	*(size_t*)block = (size_t)pSize;
+	((FreeTypeMemory*)pMemory->user)->bytes += pSize;
+	return block + BLOCK_HEADER;
+}
 
-	if( (c1&0x80) == 0 )
+static void FreeTypeFree(FT_Memory pMemory,void* pBlock)
+{
+	if( pBlock )
 	{
-		return c1;
+		uint8_t* block = (uint8_t*)pBlock - BLOCK_HEADER;
+		((FreeTypeMemory*)pMemory->user)->bytes -= *(size_t*)block;
+		free(block);
 	}
+}
 
-	const FT_UInt c2 = *pText;
-	pText++;
+static void* FreeTypeRealloc(FT_Memory pMemory,long pCurrentSize,long pNewSize,void* pBlock)
+{
+	uint8_t* block = (uint8_t*)realloc((uint8_t*)pBlock - BLOCK_HEADER,BLOCK_HEADER + pNewSize);
+	if( block == nullptr )
+	{
+		return nullptr;
+	}
+	*(size_t*)block = (size_t)pNewSize;
+	((FreeTypeMemory*)pMemory->user)->bytes += pNewSize - pCurrentSize;
+	return block + BLOCK_HEADER;
+}
 
-	return ((c1&0x3f) << 6) | (c2&0x3f);
+FreeTypeMemory::FreeTypeMemory()
+{
+	record.user = this;
+	record.alloc = FreeTypeAlloc;
+	record.free = FreeTypeFree;
+	record.realloc = FreeTypeRealloc;
 }
 
-namespace eui{
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////
-FreeTypeFont::FreeTypeFont(const std::string mID,FT_Face pFontFace,int pPixelHeight) :
-	mID(pFontFace->family_name),
-	mFontName(pFontFace->family_name),
-	mFace(pFontFace)
+FreeTypeFace::FreeTypeFace(FT_Library pFreetype,FreeTypeMemory& rMemory,const std::string& pFileName) :
+	mFileName(pFileName),
+	mMemory(rMemory)
 {
-	if( BuildGlyphIndex )
+	const int file = open(pFileName.c_str(),O_RDONLY);
+	struct stat info;
+	if( file < 0 || fstat(file,&info) != 0 || info.st_size <= 0 )
 	{
-		BuildGlyphIndex = false;
-		// First set all to -1 (not used)
-		for( auto& i : GlyphIndex )
+		if( file >= 0 )
 		{
-			i = -1;
+			close(file);
 		}
+		THROW_MEANINGFUL_EXCEPTION("Failed to open true type font " + pFileName);
+	}
 
-		// Now set up the indices for the ones we use. has be be 96 characters as that is how many glyphs we have.
-		const char AllowedCharacters[] = "0123456789ABCDEFGHIJKLMNOPQRSTUZWXYZabcdefghijklmnopqrstuvwxyz@!\"#$%&'()*+,-./:;<>=?[]\\^{}|~`¬£";
+	mFileBytes = (size_t)info.st_size;
+	mFile = mmap(nullptr,mFileBytes,PROT_READ,MAP_PRIVATE,file,0);
+	close(file);// The mapping keeps the file.
+	if( mFile == MAP_FAILED )
+	{
+		mFile = nullptr;
+		THROW_MEANINGFUL_EXCEPTION("Failed to map true type font " + pFileName);
+	}
 
-		size_t n = 0;
+	// FreeType reads a table here and a glyph there, reading ahead would pull in pages that are never looked at.
+	madvise(mFile,mFileBytes,MADV_RANDOM);
 
-		const char* ptr = AllowedCharacters;
+	const size_t before = mMemory.bytes;
+	if( FT_New_Memory_Face(pFreetype,(const FT_Byte*)mFile,(FT_Long)mFileBytes,0,&mFace) != 0 )
+	{
+		munmap(mFile,mFileBytes);
+		THROW_MEANINGFUL_EXCEPTION("Failed to load true type font " + pFileName);
+	}
+	mFaceBytes = mMemory.bytes - before;
+	VERBOSE_MESSAGE("Font face " << mFileName << " mapped, file " << mFileBytes << " bytes, face " << mFaceBytes << " bytes");
+}
 
-		FT_UInt glyph = 0;
-		while( (glyph = GetNextGlyph(ptr)) != 0 )
-		{
-			assert( n < 96 );
-			assert( glyph < GlyphIndex.size() );
-			GlyphIndex[glyph] = n;
-			n++;
-		}
+FreeTypeFace::~FreeTypeFace()
+{
+	VERBOSE_MESSAGE("Closing font face " << mFileName);
+	FT_Done_Face(mFace);
+	munmap(mFile,mFileBytes);
+}
 
-//		std::clog << "sizeof(AllowedCharacters) == " << sizeof(AllowedCharacters) << "\n";
-//		assert( sizeof(AllowedCharacters) == 96 );
-/*		for( size_t n = 0 ; n < sizeof(AllowedCharacters) ; n++ )
+size_t FreeTypeFace::GetResidentFileBytes()const
+{
+	const size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+	std::vector<unsigned char> resident((mFileBytes + pageSize - 1) / pageSize);
+	if( mincore(mFile,mFileBytes,resident.data()) != 0 )
+	{
+		return 0;
+	}
+
+	size_t bytes = 0;
+	for( unsigned char page : resident )
+	{
+		if( page & 1 )
 		{
-			const char letter = AllowedCharacters[n];
-			const int index = letter+128;
-			std::clog << letter << " : " << index << " -> " << n << "\n";
-			GlyphIndex[index] = n;
+			bytes += pageSize;
 		}
-		*/
 	}
+	return std::min(bytes,mFileBytes);
+}
 
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+FreeTypeFont::FreeTypeFont(const std::string pID,std::shared_ptr<FreeTypeFace> pFace,int pPixelHeight,bool pDistanceField) :
+	mID(pID),
+	mFontName(pFace->mFace->family_name),
+	mFaceFile(pFace),
+	mFace(pFace->mFace),
+	mBaselineHeight(0),
+	mSpaceAdvance(0),
+	mIsDistanceField(pDistanceField),
+	mFileBytes(pFace->mFileBytes),
+	mFaceBytes(pFace->mFaceBytes),
+	mPixelHeight(pPixelHeight)
+{
+	mLatin1.fill(nullptr);
+
+	// The face is shared, each size of it has its own FT_Size.
+	const size_t before = mFaceFile->mMemory.bytes;
+	if( FT_New_Size(mFace,&mSize) != 0 )
+	{
+		THROW_MEANINGFUL_EXCEPTION("Failed to make a size of true type font " + mFontName);
+	}
+	FT_Activate_Size(mSize);
 
 	if( FT_Set_Pixel_Sizes(mFace,0,pPixelHeight) == 0 )
 	{
@@ -89,18 +195,46 @@ FreeTypeFont::FreeTypeFont(const std::string mID,FT_Face pFontFace,int pPixelHei
 	{
 		VERBOSE_MESSAGE("Failed to set pixel size " << pPixelHeight << " for true type font " << mFontName);
 	}
+	mSizeBytes = mFaceFile->mMemory.bytes - before;
+}
+
+FreeTypeFont::FreeTypeFont(const std::string pID,std::shared_ptr<FreeTypeFont> pDistanceField,int pPixelHeight) :
+	mID(pID),
+	mFontName(pDistanceField->mFontName),
+	mFace(nullptr),
+	mBaselineHeight(pDistanceField->mBaselineHeight),
+	mSpaceAdvance(pDistanceField->mSpaceAdvance),
+	mDistanceField(pDistanceField),
+	mScale((float)pPixelHeight / DISTANCE_FIELD_SIZE),
+	mIsDistanceField(false),
+	mPixelHeight(pPixelHeight)
+{
+	mLatin1.fill(nullptr);
+	VERBOSE_MESSAGE("Distance field font " << mFontName << " at " << pPixelHeight << " pixels, scale " << mScale);
 }
 
 FreeTypeFont::~FreeTypeFont()
 {
 	VERBOSE_MESSAGE("Deleting font:"<<mID<<" face:"<<mFace);
-	FT_Done_Face(mFace);	
+	CancelBatches();
+	if( mSize )
+	{// The face goes with mFaceFile, when no other font uses it.
+		FT_Done_Size(mSize);
+	}
 }
 
 bool FreeTypeFont::GetGlyph(FT_UInt pChar,FreeTypeFont::Glyph& rGlyph,std::vector<uint8_t>& rPixels)
 {
-	assert(mFace);
+	if( mFace == nullptr )
+	{// Released, only what is in the cache can be drawn.
+		return false;
+	}
+	FT_Activate_Size(mSize);
+	return RenderGlyph(mFace,mFontName,mIsDistanceField,pChar,rGlyph,rPixels);
+}
 
+bool FreeTypeFont::RenderGlyph(FT_Face pFace,const std::string& pFontName,bool pDistanceField,FT_UInt pChar,FreeTypeFont::Glyph& rGlyph,std::vector<uint8_t>& rPixels)
+{
 	// Copied from original example source by Kevin Boone. http://kevinboone.me/fbtextdemo.html?i=1
 
 	// Note that TT fonts have no built-in padding. 
@@ -124,28 +258,28 @@ bool FreeTypeFont::GetGlyph(FT_UInt pChar,FreeTypeFont::Glyph& rGlyph,std::vecto
 	// Get a FreeType glyph index for the character. If there is no
 	//  glyph in the face for the character, this function returns
 	//  zero.  
-	FT_UInt gi = FT_Get_Char_Index (mFace, pChar);
+	FT_UInt gi = FT_Get_Char_Index (pFace, pChar);
 	if( gi == 0 )
 	{// Character not found, so default to space.
-		VERBOSE_MESSAGE("Font: "<< mFontName << " Failed find glyph for character index " << (int)pChar);
+		VERBOSE_MESSAGE("Font: "<< pFontName << " Failed find glyph for character index " << (int)pChar);
 		return false;
 	}
 
 	// Loading the glyph makes metrics data available
-	if( FT_Load_Glyph (mFace, gi, FT_LOAD_DEFAULT ) != 0 )
+	if( FT_Load_Glyph (pFace, gi, FT_LOAD_DEFAULT ) != 0 )
 	{
-		VERBOSE_MESSAGE("Font: "<< mFontName << " Failed to load glyph for character index " << (int)pChar);
+		VERBOSE_MESSAGE("Font: "<< pFontName << " Failed to load glyph for character index " << (int)pChar);
 		return false;
 	}
 
 	// Rendering a loaded glyph creates the bitmap
-	if( FT_Render_Glyph(mFace->glyph, FT_RENDER_MODE_NORMAL) != 0 )
+	if( FT_Render_Glyph(pFace->glyph, FT_RENDER_MODE_NORMAL) != 0 )
 	{
-		VERBOSE_MESSAGE("Font: "<< mFontName << " Failed to render glyph for character index " << (int)pChar);
+		VERBOSE_MESSAGE("Font: "<< pFontName << " Failed to render glyph for character index " << (int)pChar);
 		return false;
 	}
 
-	assert(mFace->glyph);
+	assert(pFace->glyph);
 
 	// Now we have the metrics, let's work out the x and y offset
 	//  of the glyph from the specified x and y. Because there is
@@ -156,30 +290,29 @@ bool FreeTypeFont::GetGlyph(FT_UInt pChar,FreeTypeFont::Glyph& rGlyph,std::vecto
 	// bbox.yMax is the height of a bounding box that will enclose
 	//  any glyph in the face, starting from the glyph baseline.
 	// Code changed, was casing it to render in the Y center of the font not on the base line. Will add it as an option in the future. Richard.
-	int bbox_ymax = 0;//mFace->bbox.yMax / 64;
-	mBaselineHeight = std::max(mBaselineHeight,(int)mFace->bbox.yMax / 64);
+	int bbox_ymax = 0;//pFace->bbox.yMax / 64;
 
 	// glyph_width is the pixel width of this specific glyph
-	int glyph_width = mFace->glyph->metrics.width / 64;
+	int glyph_width = pFace->glyph->metrics.width / 64;
 
 	// So now we have (x_off,y_off), the location at which to
 	//   start drawing the glyph bitmap.
 
 	// Build the new glyph.
-	rGlyph.width = mFace->glyph->bitmap.width;
-	rGlyph.height = mFace->glyph->bitmap.rows;
-	rGlyph.pitch = mFace->glyph->bitmap.pitch;
+	rGlyph.width = pFace->glyph->bitmap.width;
+	rGlyph.height = pFace->glyph->bitmap.rows;
+	rGlyph.page = NO_PAGE;
 
 	// Advance is the amount of x spacing, in pixels, allocated
 	//   to this glyph
-	rGlyph.advance = mFace->glyph->metrics.horiAdvance / 64;
+	rGlyph.advance = pFace->glyph->metrics.horiAdvance / 64;
 
 
 	// horiBearingX is the height of the top of the glyph from
 	//   the baseline. So we work out the y offset -- the distance
 	//   we must push down the glyph from the top of the bounding
 	//   box -- from the height and the Y bearing.
-	rGlyph.y_off = bbox_ymax - mFace->glyph->metrics.horiBearingY / 64;
+	rGlyph.y_off = bbox_ymax - pFace->glyph->metrics.horiBearingY / 64;
 
 	// Work out where to draw the left-most row of pixels --
 	//   the x offset -- by halving the space between the 
@@ -187,206 +320,739 @@ bool FreeTypeFont::GetGlyph(FT_UInt pChar,FreeTypeFont::Glyph& rGlyph,std::vecto
 	rGlyph.x_off = (rGlyph.advance - glyph_width) / 2;
 
 	// It's an alpha only texture
-	const size_t expectedSize = mFace->glyph->bitmap.rows * mFace->glyph->bitmap.pitch;
+	const size_t expectedSize = rGlyph.width * rGlyph.height;
+	rPixels.resize(expectedSize);
 	// Some have no pixels, and so we just stop here.
 	if(expectedSize == 0)
 	{
-		VERBOSE_MESSAGE("Font character " << pChar << " has no pixels " << mFace->glyph->bitmap.rows << " " << mFace->glyph->bitmap.pitch );
+		VERBOSE_MESSAGE("Font character " << pChar << " has no pixels " << pFace->glyph->bitmap.rows << " " << pFace->glyph->bitmap.pitch );
 		return true;
 	}
 
-	assert(mFace->glyph->bitmap.buffer);
+	assert(pFace->glyph->bitmap.buffer);
 
-	if( mFace->glyph->bitmap.pitch == (int)mFace->glyph->bitmap.width )
+	if( pFace->glyph->bitmap.pitch == rGlyph.width )
 	{// Quick path. Normally taken.
-		rPixels.resize(expectedSize);
-		memcpy(rPixels.data(),mFace->glyph->bitmap.buffer,expectedSize);
+		memcpy(rPixels.data(),pFace->glyph->bitmap.buffer,expectedSize);
 	}
 	else
 	{
-		rPixels.reserve(expectedSize);
-		const uint8_t* src = mFace->glyph->bitmap.buffer;
-		for (int i = 0; i < (int)mFace->glyph->bitmap.rows; i++ , src += mFace->glyph->bitmap.pitch )
+		const uint8_t* src = pFace->glyph->bitmap.buffer;
+		uint8_t* dst = rPixels.data();
+		for (int i = 0; i < rGlyph.height; i++ , src += pFace->glyph->bitmap.pitch, dst += rGlyph.width )
 		{
-			for (int j = 0; j < (int)mFace->glyph->bitmap.width; j++ )
-			{
-				rPixels.push_back(src[j]);
-			}
+			memcpy(dst,src,rGlyph.width);
 		}
 	}
 
-	if( expectedSize != rPixels.size() )
+	if( pDistanceField )
 	{
-		THROW_MEANINGFUL_EXCEPTION("Font: " + mFontName + " Error, we read more pixels for free type font than expected for the glyph " + std::to_string(pChar) );
+		BuildDistanceField(rGlyph,rPixels);
 	}
 
 	return true;
 }
 
-void FreeTypeFont::BuildTexture(
-			int pMaximumAllowedGlyph,
-			std::function<uint32_t(int pWidth,int pHeight)> pCreateTexture,
-			std::function<void(uint32_t pTexture,int pX,int pY,int pWidth,int pHeight,const uint8_t* pPixels)> pFillTexture)
+/**
+ * @brief One dimensional squared euclidean distance transform, from Distance Transforms of Sampled Functions by Felzenszwalb and Huttenlocher.
+ * pIn has zero where there is something to measure to and a huge number where there is not. rOut gets the squared distance to the nearest.
+ */
+static void DistanceTransform(const float* pIn,int pCount,float* rOut,int* rParabolas,float* rBounds)
 {
+	const float HUGE_DISTANCE = 1e20f;
+	int k = 0;
+	rParabolas[0] = 0;
+	rBounds[0] = -HUGE_DISTANCE;
+	rBounds[1] = HUGE_DISTANCE;
+	for( int q = 1 ; q < pCount ; q++ )
+	{
+		// Drop the parabolas this one is lower than, the first bound is minus infinity so it always stops.
+		float s = ((pIn[q] + (q*q)) - (pIn[rParabolas[k]] + (rParabolas[k]*rParabolas[k]))) / (2*q - 2*rParabolas[k]);
+		while( s <= rBounds[k] )
+		{
+			k--;
+			s = ((pIn[q] + (q*q)) - (pIn[rParabolas[k]] + (rParabolas[k]*rParabolas[k]))) / (2*q - 2*rParabolas[k]);
+		}
+		k++;
+		rParabolas[k] = q;
+		rBounds[k] = s;
+		rBounds[k+1] = HUGE_DISTANCE;
+	}
 
-	int maxX = 0,maxY = 0;
-	mBaselineHeight = 0;
+	k = 0;
+	for( int q = 0 ; q < pCount ; q++ )
+	{
+		while( rBounds[k+1] < q )
+		{
+			k++;
+		}
+		const int v = rParabolas[k];
+		rOut[q] = ((q - v) * (q - v)) + pIn[v];
+	}
+}
+
+/**
+ * @brief Two dimensional squared distance transform of rGrid, in place. Columns then rows.
+ */
+static void DistanceTransform(std::vector<float>& rGrid,int pWidth,int pHeight)
+{
+	const int longest = std::max(pWidth,pHeight);
+	std::vector<float> in(longest),out(longest),bounds(longest + 1);
+	std::vector<int> parabolas(longest);
+
+	for( int x = 0 ; x < pWidth ; x++ )
+	{
+		for( int y = 0 ; y < pHeight ; y++ )
+		{
+			in[y] = rGrid[(y * pWidth) + x];
+		}
+		DistanceTransform(in.data(),pHeight,out.data(),parabolas.data(),bounds.data());
+		for( int y = 0 ; y < pHeight ; y++ )
+		{
+			rGrid[(y * pWidth) + x] = out[y];
+		}
+	}
+
+	for( int y = 0 ; y < pHeight ; y++ )
+	{
+		float* row = rGrid.data() + (y * pWidth);
+		DistanceTransform(row,pWidth,out.data(),parabolas.data(),bounds.data());
+		std::copy(out.begin(),out.begin() + pWidth,row);
+	}
+}
+
+void FreeTypeFont::BuildDistanceField(FreeTypeFont::Glyph& rGlyph,std::vector<uint8_t>& rPixels)
+{
+	const int spread = DISTANCE_FIELD_SPREAD;
+	const int width = rGlyph.width + (spread*2);
+	const int height = rGlyph.height + (spread*2);
+	const float HUGE_DISTANCE = 1e20f;
+
+	// The distance from each pixel to the nearest pixel inside the glyph, and to the nearest outside.
+	std::vector<float> toInside(width * height,HUGE_DISTANCE);
+	std::vector<float> toOutside(width * height,0.0f);
+	for( int y = 0 ; y < rGlyph.height ; y++ )
+	{
+		for( int x = 0 ; x < rGlyph.width ; x++ )
+		{
+			if( rPixels[(y * rGlyph.width) + x] >= 128 )
+			{
+				const int n = ((y + spread) * width) + x + spread;
+				toInside[n] = 0.0f;
+				toOutside[n] = HUGE_DISTANCE;
+			}
+		}
+	}
+	DistanceTransform(toInside,width,height);
+	DistanceTransform(toOutside,width,height);
+
+	// The edge is half way between an inside and an outside pixel. 128 is on the edge, higher is inside.
+	rPixels.resize(width * height);
+	for( size_t n = 0 ; n < rPixels.size() ; n++ )
+	{
+		const float distance = toOutside[n] > 0.0f ? std::sqrt(toOutside[n]) - 0.5f : 0.5f - std::sqrt(toInside[n]);
+		const float value = 127.5f + (distance * 127.5f / spread);
+		rPixels[n] = (uint8_t)std::clamp(value + 0.5f,0.0f,255.0f);
+	}
+
+	rGlyph.width = width;
+	rGlyph.height = height;
+	rGlyph.x_off -= spread;
+	rGlyph.y_off -= spread;
+}
+
+void FreeTypeFont::InitialiseCache(int pMaximumAllowedGlyph,int pMaxPages,CreateTexture pCreateTexture,FillTexture pFillTexture)
+{
+	mCreateTexture = pCreateTexture;
+	mFillTexture = pFillTexture;
+	mMaxPages = (size_t)std::max(pMaxPages,1);
+	mMaximumAllowedGlyph = pMaximumAllowedGlyph;
+	mBaselineHeight = (int)mFace->bbox.yMax / 64;
 
 	FreeTypeFont::Glyph spaceGlyph;
-	std::vector<uint8_t> spacePixels;
-	GetGlyph(' ',spaceGlyph,spacePixels);
+	GetGlyph(' ',spaceGlyph,mPixels);
 	mSpaceAdvance = spaceGlyph.advance;
 
-	std::array<std::vector<uint8_t>,96>glyphsPixels;
-	for( FT_UInt c = 0 ; c < 256 ; c++ )// Cheap and quick font ASCII renderer. I'm not geeting into unicode. It's a nightmare to make fast in GL on a resource constrained system!
+	const int lineHeight = (int)((mFace->size->metrics.ascender - mFace->size->metrics.descender) / 64);
+	VERBOSE_MESSAGE("Font line height is " << lineHeight << " mBaselineHeight = " << mBaselineHeight);
+	if( lineHeight > pMaximumAllowedGlyph )
+	{
+		THROW_MEANINGFUL_EXCEPTION("Font: " + mFontName + " requires a very large texture as it's glyphs are very big, line height == " + std::to_string(lineHeight) + ". This creation has been halted. Please reduce size of font!");
+	}
+
+	// Room for eight rows of glyphs a page, most scripts need less than a page at the sizes used on a display.
+	const int rowHeight = lineHeight + (PADDING*2) + (mIsDistanceField ? DISTANCE_FIELD_SPREAD*2 : 0);
+	mPageSize = 128;
+	while( mPageSize < rowHeight * 8 && mPageSize < 2048 )
+	{
+		mPageSize <<= 1;
+	}
+	VERBOSE_MESSAGE("Glyph cache page size is " << mPageSize << "x" << mPageSize << " with up to " << mMaxPages << " pages");
+
+	AddPage();
+}
+
+void FreeTypeFont::BuildQuads(const std::string_view& pText,float pX,float pY,VertXY::Buffer& rVertices,VertXY::Buffer& rUVs,std::vector<uint32_t>& rTextures)
+{
+	// Distance field fonts use the glyphs of the font that has the face, scaled to their size.
+	FreeTypeFont& glyphs = mDistanceField ? *mDistanceField : *this;
+	const float scale = mScale;
+	glyphs.mUseCount++;
+	if( glyphs.mBatches.size() > 0 )
+	{
+		glyphs.CollectBatches();
+	}
+
+	const char* text = pText.data();
+	const char* end = text + pText.size();
+	while( text < end )
+	{
+		const Glyph& g = glyphs.FindGlyph(GetNextCharacter(text,end));
+		if( g.page != NO_PAGE )
+		{
+			rVertices.BuildQuad(pX + (g.x_off * scale),pY + (g.y_off * scale),g.width * scale,g.height * scale);
+
+			rUVs.AddUVRect(
+					g.uv[0].x,
+					g.uv[0].y,
+					g.uv[1].x,
+					g.uv[1].y);
+
+			rTextures.push_back(glyphs.mPages[g.page].texture);
+		}
+		pX += g.advance * scale;
+	}
+}
+
+Rectangle FreeTypeFont::GetRect(const std::string_view& pText)
+{
+	FreeTypeFont& glyphs = mDistanceField ? *mDistanceField : *this;
+	const float scale = mScale;
+	glyphs.mUseCount++;
+	if( glyphs.mBatches.size() > 0 )
 	{
-		const int index = GetGlyphIndex(c);
-		if( index >= 0 )
+		glyphs.CollectBatches();
+	}
+
+	// Distance field glyphs have the spread around them, that is not part of the text.
+	const float inset = mDistanceField ? DISTANCE_FIELD_SPREAD : 0;
+
+	Rectangle r = {0,0,0,0};
+
+	const char* text = pText.data();
+	const char* end = text + pText.size();
+	float x = 0;
+	while( text < end )
+	{
+		const Glyph& g = glyphs.FindGlyph(GetNextCharacter(text,end));
+		if( g.page != NO_PAGE )
 		{
-			assert( (size_t)index < mGlyphs.size() );
-			assert( (size_t)index < glyphsPixels.size() );
+			const float px = x + ((g.x_off + inset) * scale);
+			const float py = (g.y_off + inset) * scale;
+
+			r.AddPoint(px,py);
+			r.AddPoint(px + ((g.width - (inset*2)) * scale),py + ((g.height - (inset*2)) * scale));
+		}
+		x += g.advance * scale;
+	}
+	return r;
+}
+
+GlyphCacheStatistics FreeTypeFont::GetStatistics()const
+{
+	if( mDistanceField )
+	{
+		return mDistanceField->GetStatistics();
+	}
+
+	GlyphCacheStatistics stats;
+	stats.glyphs = (uint32_t)mGlyphs.size();
+	stats.pages = (uint32_t)mPages.size();
+	stats.maxPages = (uint32_t)mMaxPages;
+	stats.pageSize = mPageSize;
+	stats.hits = mCounts.hits;
+	stats.misses = mCounts.misses;
+	stats.evictions = mCounts.evictions;
+	stats.pageEvictions = mCounts.pageEvictions;
+	stats.prerendered = mCounts.prerendered;
+	return stats;
+}
 
-			auto& g = mGlyphs.at(index);
-			auto& p = glyphsPixels.at(index);
-			if( GetGlyph(c,g,p) )
+FontFaceStatistics FreeTypeFont::GetFaceStatistics()const
+{
+	if( mDistanceField )
+	{
+		return mDistanceField->GetFaceStatistics();
+	}
+
+	FontFaceStatistics stats;
+	stats.fileBytes = mFileBytes;
+	stats.faceBytes = mFaceBytes;
+	stats.sizeBytes = mSizeBytes;
+	if( mFaceFile )
+	{// Had every font opened the file itself each would have its own face, sharing it splits the cost between them.
+		stats.residentFileBytes = mFaceFile->GetResidentFileBytes();
+		stats.sizes = (uint32_t)mFaceFile.use_count();
+		stats.bytesSaved = mFaceBytes - (mFaceBytes / stats.sizes);
+	}
+	else
+	{
+		stats.released = true;
+		stats.bytesSaved = mFaceBytes + mSizeBytes;
+	}
+	return stats;
+}
+
+void FreeTypeFont::ReleaseFace(const std::string_view& pKeep)
+{
+	if( mDistanceField )
+	{
+		mDistanceField->ReleaseFace(pKeep);
+		return;
+	}
+
+	if( mFace == nullptr )
+	{
+		return;
+	}
+
+	// Take what the workers have, the face can not go until they are done with it.
+	for( auto& batch : mBatches )
+	{
+		batch->Wait();
+	}
+	CollectBatches();
+
+	mUseCount++;
+	const uint64_t evictions = mCounts.evictions;
+	const char* text = pKeep.data();
+	const char* end = text + pKeep.size();
+	while( text < end )
+	{
+		FindGlyph(GetNextCharacter(text,end));
+	}
+	if( mCounts.evictions != evictions )
+	{
+		VERBOSE_MESSAGE("Font: " << mFontName << " the characters to keep do not all fit in the glyph cache, some will not be drawn");
+	}
+
+	FT_Done_Size(mSize);
+	mSize = nullptr;
+	mFace = nullptr;
+	mFaceFile.reset();
+	VERBOSE_MESSAGE("Font: " << mFontName << " released its face, " << mGlyphs.size() << " glyphs kept");
+}
+
+FreeTypeFont::Glyph* FreeTypeFont::GetCached(FT_UInt pChar)
+{
+	if( pChar < mLatin1.size() )
+	{
+		return mLatin1[pChar];
+	}
+
+	auto cached = mGlyphs.find(pChar);
+	return cached != mGlyphs.end() ? &cached->second : nullptr;
+}
+
+const FreeTypeFont::Glyph& FreeTypeFont::FindGlyph(FT_UInt pChar)
+{
+	Glyph* found = GetCached(pChar);
+	if( found != nullptr )
+	{
+		mCounts.hits++;
+		if( found->page != NO_PAGE )
+		{
+			mPages[found->page].lastUsed = mUseCount;
+		}
+		return *found;
+	}
+
+	if( mBatches.size() > 0 && WaitForBatch(pChar) )
+	{// The workers had it, it is in the cache now.
+		return FindGlyph(pChar);
+	}
+	mCounts.misses++;
+
+	Glyph glyph = {};
+	const bool inFace = GetGlyph(pChar,glyph,mPixels);
+	return AddGlyph(pChar,glyph,inFace,mPixels);
+}
+
+const FreeTypeFont::Glyph& FreeTypeFont::AddGlyph(FT_UInt pChar,Glyph pGlyph,bool pFound,const std::vector<uint8_t>& pPixels)
+{
+	if( pFound == false )
+	{// Not in the face, leave a gap the size of a space.
+		pGlyph = {};
+		pGlyph.advance = mSpaceAdvance;
+		pGlyph.page = NO_PAGE;
+	}
+	else if( pGlyph.width > mMaximumAllowedGlyph || pGlyph.height > mMaximumAllowedGlyph )
+	{
+		VERBOSE_MESSAGE("Font: " << mFontName << " glyph for character " << pChar << " is " << pGlyph.width << "x" << pGlyph.height << " which is too big, it will not be drawn");
+	}
+	else if( pGlyph.width > 0 && pGlyph.height > 0 )
+	{
+		int x,y;
+		if( AddToPage(pGlyph.width,pGlyph.height,pGlyph.page,x,y) )
+		{
+			Page& page = mPages[pGlyph.page];
+			mFillTexture(page.texture,x,y,pGlyph.width,pGlyph.height,pPixels.data());
+			page.glyphs++;
+			page.lastUsed = mUseCount;
+
+			pGlyph.uv[0].x = (float)x / mPageSize;
+			pGlyph.uv[0].y = (float)y / mPageSize;
+			pGlyph.uv[1].x = (float)(x + pGlyph.width) / mPageSize;
+			pGlyph.uv[1].y = (float)(y + pGlyph.height) / mPageSize;
+		}
+		else
+		{
+			VERBOSE_MESSAGE("Font: " << mFontName << " glyph for character " << pChar << " is " << pGlyph.width << "x" << pGlyph.height << " which does not fit in a page, it will not be drawn");
+		}
+	}
+
+	Glyph& added = mGlyphs[pChar];
+	added = pGlyph;
+	if( pChar < mLatin1.size() )
+	{
+		mLatin1[pChar] = &added;
+	}
+	return added;
+}
+
+void FreeTypeFont::Prerender(GlyphRasterizer& rRasterizer,const std::string_view& pCharacters)
+{
+	if( mDistanceField )
+	{// The sizes share the glyphs, once the first size has asked for them the rest find them cached or on their way.
+		mDistanceField->Prerender(rRasterizer,pCharacters);
+		return;
+	}
+
+	if( mFace == nullptr )
+	{
+		return;
+	}
+
+	std::vector<FT_UInt> characters;
+	const char* text = pCharacters.data();
+	const char* end = text + pCharacters.size();
+	while( text < end )
+	{
+		const FT_UInt c = GetNextCharacter(text,end);
+		if( GetCached(c) == nullptr && GetIsBatched(c) == false && std::find(characters.begin(),characters.end(),c) == characters.end() )
+		{
+			characters.push_back(c);
+		}
+	}
+
+	// Split between the workers, so one font loads on all of them and not just one.
+	const size_t workers = rRasterizer.GetWorkers();
+	const size_t perBatch = std::max((characters.size() + workers - 1) / workers,(size_t)16);
+	for( size_t first = 0 ; first < characters.size() ; first += perBatch )
+	{
+		auto batch = std::make_shared<GlyphBatch>();
+		batch->fontName = mFontName;
+		batch->file = mFaceFile->GetFile();
+		batch->fileBytes = mFaceFile->mFileBytes;
+		batch->pixelHeight = mPixelHeight;
+		batch->distanceField = mIsDistanceField;
+		batch->characters.assign(characters.begin() + first,characters.begin() + std::min(first + perBatch,characters.size()));
+		rRasterizer.Add(batch);
+		mBatches.push_back(batch);
+	}
+}
+
+bool FreeTypeFont::GetIsBatched(FT_UInt pChar)const
+{
+	for( const auto& batch : mBatches )
+	{
+		if( std::find(batch->characters.begin(),batch->characters.end(),pChar) != batch->characters.end() )
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+bool FreeTypeFont::WaitForBatch(FT_UInt pChar)
+{
+	for( const auto& batch : mBatches )
+	{
+		if( std::find(batch->characters.begin(),batch->characters.end(),pChar) != batch->characters.end() )
+		{
+			batch->Wait();
+			CollectBatches();
+			return true;
+		}
+	}
+	return false;
+}
+
+void FreeTypeFont::CollectBatches()
+{
+	for( auto batch = mBatches.begin() ; batch != mBatches.end() ; )
+	{
+		if( (*batch)->GetDone() )
+		{
+			for( const auto& rendered : (*batch)->rendered )
 			{
-				if( p.size() > 0 )
+				if( GetCached(rendered.character) == nullptr )
 				{
-					maxX = std::max(maxX,g.width);
-					maxY = std::max(maxY,g.height);
-				}
-				else
-				{
-					VERBOSE_MESSAGE("Character " << c << " is empty, will just move the cursor " << g.advance << " pixels");
+					AddGlyph(rendered.character,rendered.glyph,rendered.found,rendered.pixels);
+					mCounts.prerendered++;
 				}
 			}
+			batch = mBatches.erase(batch);
+		}
+		else
+		{
+			++batch;
 		}
 	}
-	VERBOSE_MESSAGE("Font max glyph size requirement for cache is " << maxX << " " << maxY << " mBaselineHeight = " << mBaselineHeight);
-	if( maxX > pMaximumAllowedGlyph || maxY > pMaximumAllowedGlyph )
+}
+
+void FreeTypeFont::CancelBatches()
+{
+	for( auto& batch : mBatches )
+	{
+		batch->cancelled = true;
+	}
+
+	// The workers read the mapped file, it must not go until they are done with it.
+	for( auto& batch : mBatches )
 	{
-		THROW_MEANINGFUL_EXCEPTION("Font: " + mFontName + " requires a very large texture as it's maximum size glyph is very big, maxX == " + std::to_string(maxX) + " maxY == " + std::to_string(maxY) + ". This creation has been halted. Please reduce size of font!");
+		batch->Wait();
 	}
+	mBatches.clear();
+}
 
-	auto nextPow2 = [](int v)
+/**
+ * @brief Bottom left skyline packing. Finds where the rectangle sits lowest on the page, if that is a tie the one that wastes the least width.
+ */
+static bool AddToSkyline(std::vector<FreeTypeFont::Page::Skyline>& rSkyline,int pPageSize,int pWidth,int pHeight,int& rX,int& rY)
+{
+	size_t best = rSkyline.size();
+	int bestY = 0,bestWidth = 0;
+	for( size_t n = 0 ; n < rSkyline.size() && rSkyline[n].x + pWidth <= pPageSize ; n++ )
 	{
-		int pow2 = 1;
-		while( pow2 < v )
+		// It rests on the highest part of the skyline under it. The skyline covers the page, so this stays inside it.
+		int y = 0;
+		for( size_t i = n , covered = 0 ; (int)covered < pWidth ; covered += rSkyline[i].width , i++ )
 		{
-			pow2 <<= 1;
+			y = std::max(y,rSkyline[i].y);
 		}
-		return pow2;
-	};
 
-	// Work out a texture size that will fit. Need 96 slots. 32 -> 127
-	const float width = nextPow2(maxX * 12);
-	const float height = nextPow2(maxY * 8);
-	VERBOSE_MESSAGE("Texture size needed is << " << width << "x" << height);
+		if( y + pHeight <= pPageSize && (best == rSkyline.size() || y < bestY || (y == bestY && rSkyline[n].width < bestWidth)) )
+		{
+			best = n;
+			bestY = y;
+			bestWidth = rSkyline[n].width;
+		}
+	}
 
-	mTexture = pCreateTexture(width,height);
-	assert(mTexture);
+	if( best == rSkyline.size() )
+	{
+		return false;
+	}
 
-	// Now get filling. Could have a lot of wasted space, but I am not getting into complicated packing algos at load time. Take it offline. :)
-	const float cellWidth = width / 12;
-	const float cellHeight = height / 8;
+	rX = rSkyline[best].x;
+	rY = bestY;
+
+	// The new part replaces the ones it covers and cuts short the one it ends part way across.
+	const int right = rX + pWidth;
+	size_t last = best;
+	while( last < rSkyline.size() && rSkyline[last].x + rSkyline[last].width <= right )
+	{
+		last++;
+	}
+	if( last < rSkyline.size() && rSkyline[last].x < right )
+	{
+		rSkyline[last].width -= right - rSkyline[last].x;
+		rSkyline[last].x = right;
+	}
+	rSkyline.erase(rSkyline.begin() + best,rSkyline.begin() + last);
+	rSkyline.insert(rSkyline.begin() + best,{rX,bestY + pHeight,pWidth});
 
-	int y = 0;
-	int x = 0;
-	for( FT_UInt c = 0 ; c < 256 ; c++ )
+	// Join neighbours at the same height to keep the list short.
+	for( size_t n = 0 ; n + 1 < rSkyline.size() ; )
 	{
-		const int index = GetGlyphIndex(c);
-		if( index >= 0 )
+		if( rSkyline[n].y == rSkyline[n+1].y )
 		{
-			auto& g = mGlyphs.at(index);
-			auto& p = glyphsPixels.at(index);
-			const float cx = (x * cellWidth) + (cellWidth/2) - (g.width / 2);
-			const float cy = (y * cellHeight) + (cellHeight/2) - (g.height / 2);
-			if( p.size() > 0 )
-			{
-				pFillTexture(
-					mTexture,
-					cx,
-					cy,
-					g.width,
-					g.height,
-					p.data()
-					);
-
-				g.uv[0].x = cx / width;
-				g.uv[0].y = cy / height;
-				g.uv[1].x = (cx + g.width)  / width;
-				g.uv[1].y = (cy + g.height) / height;
-			}
-			else
+			rSkyline[n].width += rSkyline[n+1].width;
+			rSkyline.erase(rSkyline.begin() + n + 1);
+		}
+		else
+		{
+			n++;
+		}
+	}
+	return true;
+}
+
+bool FreeTypeFont::AddToPage(int pWidth,int pHeight,uint32_t& rPage,int& rX,int& rY)
+{
+	const int width = pWidth + (PADDING*2);
+	const int height = pHeight + (PADDING*2);
+	if( width > mPageSize || height > mPageSize )
+	{
+		return false;
+	}
+
+	for(;;)
+	{
+		for( uint32_t page = 0 ; page < mPages.size() ; page++ )
+		{
+			if( AddToSkyline(mPages[page].skyline,mPageSize,width,height,rX,rY) )
 			{
-				g.uv[0].x = 0;
-				g.uv[0].y = 0;
-				g.uv[1].x = 0;
-				g.uv[1].y = 0;
+				rPage = page;
+				rX += PADDING;
+				rY += PADDING;
+				return true;
 			}
+		}
+
+		if( mPages.size() < mMaxPages )
+		{
+			AddPage();
+			continue;
+		}
 
-			// Advance to the next free cell.
-			x++;
-			if( x == 12 )
+		// Empty the page used least recently. Not one used by the text being built, its glyphs are in the quads made so far.
+		uint32_t oldest = NO_PAGE;
+		for( uint32_t page = 0 ; page < mPages.size() ; page++ )
+		{
+			if( mPages[page].lastUsed != mUseCount && (oldest == NO_PAGE || mPages[page].lastUsed < mPages[oldest].lastUsed) )
 			{
-				x = 0;
-				y++;
+				oldest = page;
 			}
 		}
-	}	
+
+		if( oldest != NO_PAGE )
+		{
+			EvictPage(oldest);
+		}
+		else
+		{
+			VERBOSE_MESSAGE("Font: " << mFontName << " text uses more glyphs than the pages hold, going over the maximum of " << mMaxPages << " pages");
+			AddPage();
+		}
+	}
 }
 
-void FreeTypeFont::BuildQuads(const char* pText,float pX,float pY,VertXY::Buffer& pVertices,VertXY::Buffer& pUVs)const
+void FreeTypeFont::EvictPage(uint32_t pPage)
 {
-	FT_UInt glyph = 0;
-	while( (glyph = GetNextGlyph(pText)) != 0 )
+	Page& page = mPages[pPage];
+	VERBOSE_MESSAGE("Font: " << mFontName << " emptying glyph cache page " << pPage << " of " << page.glyphs << " glyphs");
+
+	for( auto glyph = mGlyphs.begin() ; glyph != mGlyphs.end() ; )
 	{
-		const size_t index = GetGlyphIndex(glyph);
-		if( index < mGlyphs.size() )
+		if( glyph->second.page == pPage )
+		{
+			if( glyph->first < mLatin1.size() )
+			{
+				mLatin1[glyph->first] = nullptr;
+			}
+			glyph = mGlyphs.erase(glyph);
+		}
+		else
 		{
-			auto&g = mGlyphs.at(index);
+			++glyph;
+		}
+	}
 
-			pVertices.BuildQuad(pX + g.x_off,pY + g.y_off,g.width,g.height);
+	// The old pixels are cleared, filtering would pick up the edges of them around the new glyphs.
+	const std::vector<uint8_t> empty(mPageSize * mPageSize,0);
+	mFillTexture(page.texture,0,0,mPageSize,mPageSize,empty.data());
 
-			pUVs.AddUVRect(
-					g.uv[0].x,
-					g.uv[0].y,
-					g.uv[1].x,
-					g.uv[1].y);
+	mCounts.evictions += page.glyphs;
+	mCounts.pageEvictions++;
+	page.skyline.assign(1,{0,0,mPageSize});
+	page.glyphs = 0;
+	mGeneration++;
+}
 
-			pX += g.advance;
+void FreeTypeFont::AddPage()
+{
+	Page page;
+	page.texture = mCreateTexture(mPageSize,mPageSize);
+	assert(page.texture);
+	page.skyline.push_back({0,0,mPageSize});
+	mPages.push_back(page);
+	VERBOSE_MESSAGE("Font: " << mFontName << " glyph cache page " << mPages.size() - 1 << " created, texture " << page.texture);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+GlyphRasterizer::GlyphRasterizer(WorkerPool& rPool) :
+	mPool(rPool),
+	mFreetype(rPool.GetWorkers(),nullptr)
+{
+}
+
+GlyphRasterizer::~GlyphRasterizer()
+{
+	mBatches.Wait();
+	for( FT_Library freetype : mFreetype )
+	{
+		if( freetype )
+		{
+			FT_Done_FreeType(freetype);
 		}
 	}
 }
 
-Rectangle FreeTypeFont::GetRect(const std::string_view& pText)const
+void GlyphRasterizer::Add(std::shared_ptr<FreeTypeFont::GlyphBatch> pBatch)
 {
-	Rectangle r = {0,0,0,0};
-
-	const char* text = pText.data();
-	FT_UInt glyph = 0;
-	float x = 0;
-	while( (glyph = GetNextGlyph(text)) != 0 )
+	mPool.Add(mBatches,[this,pBatch](size_t pWorker)
 	{
-		const size_t index = GetGlyphIndex(glyph);
-		if( index < mGlyphs.size() )
+		Render(pWorker,*pBatch);
+
 		{
-			auto &g = mGlyphs.at(index);
+			std::lock_guard<std::mutex> lock(pBatch->mutex);
+			pBatch->done = true;
+		}
+		pBatch->finished.notify_all();
+	});
+}
 
-			const float px = x + g.x_off;
-			const float py = g.y_off;
+void GlyphRasterizer::Render(size_t pWorker,FreeTypeFont::GlyphBatch& rBatch)
+{
+	if( rBatch.cancelled )
+	{
+		return;
+	}
 
-			r.AddPoint(px,py);
-			r.AddPoint(px + g.width,py + g.height);
+	FT_Library& freetype = mFreetype[pWorker];
+	if( freetype == nullptr && FT_Init_FreeType(&freetype) != 0 )
+	{// The batch still finishes, with nothing rendered, and the font renders the glyphs itself.
+		VERBOSE_MESSAGE("Glyph rasterizer worker failed to init free type font library");
+		freetype = nullptr;
+		return;
+	}
 
-			x += g.advance;
-		}
-		else
+	FT_Face face;
+	if( FT_New_Memory_Face(freetype,rBatch.file,(FT_Long)rBatch.fileBytes,0,&face) != 0 )
+	{
+		VERBOSE_MESSAGE("Glyph rasterizer failed to open the face of " << rBatch.fontName);
+		return;
+	}
+	FT_Set_Pixel_Sizes(face,0,rBatch.pixelHeight);
+
+	rBatch.rendered.reserve(rBatch.characters.size());
+	for( FT_UInt c : rBatch.characters )
+	{
+		if( rBatch.cancelled )
 		{
-			x += mSpaceAdvance;
-		}			
+			break;
+		}
+
+		FreeTypeFont::GlyphBatch::Rendered rendered;
+		rendered.character = c;
+		rendered.glyph = {};
+		rendered.found = FreeTypeFont::RenderGlyph(face,rBatch.fontName,rBatch.distanceField,c,rendered.glyph,rendered.pixels);
+		rBatch.rendered.push_back(std::move(rendered));
 	}
-	return r;
+
+	FT_Done_Face(face);
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////
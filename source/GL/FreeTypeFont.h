@@ -3,20 +3,91 @@
 
 #include <freetype2/ft2build.h> //sudo apt install libfreetype6-dev
 #include FT_FREETYPE_H
+#include FT_MODULE_H
+#include FT_SIZES_H
+
+#include "../WorkerPool.h"
 
 #include <vector>
 #include <string>
 #include <functional>
+#include <unordered_map>
+#include <array>
+#include <string_view>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <atomic>
 #include <stdint.h>
 
 namespace eui{
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * @brief Everything FreeType allocates goes through this so we know what a face or a size costs.
+ * Pass record to FT_New_Library, it must live until FT_Done_Library.
+ */
+struct FreeTypeMemory
+{
+	FreeTypeMemory();
+
+	FT_MemoryRec_ record;
+	size_t bytes = 0;	//!< Allocated by FreeType now.
+};
+
+/**
+ * @brief A font file mapped into memory and the one FreeType face opened from it.
+ * Every size loaded from the file shares the face, each with its own FT_Size, so the file is opened and its tables read once.
+ * It is held by the fonts that use it and goes with the last of them.
+ */
+struct FreeTypeFace
+{
+	/**
+	 * @brief Maps the file and opens the face, throws if either fails.
+	 */
+	FreeTypeFace(FT_Library pFreetype,FreeTypeMemory& rMemory,const std::string& pFileName);
+	~FreeTypeFace();
+
+	/**
+	 * @brief How much of the file is in memory. FreeType only reads the tables and glyphs it needs, so this is often a fraction of it.
+	 */
+	size_t GetResidentFileBytes()const;
+
+	const std::string mFileName;
+	FreeTypeMemory& mMemory;
+	FT_Face mFace = nullptr;
+	size_t mFileBytes = 0;
+	size_t mFaceBytes = 0;	//!< What FreeType allocated to open the face, the sizes are counted by their fonts.
+
+	const uint8_t* GetFile()const{return (const uint8_t*)mFile;}
+
+private:
+	void* mFile = nullptr;	//!< The mapping, FreeType reads the font straight from it.
+};
+
+struct GlyphRasterizer;
+
 /**
  * @brief Optional freetype font library support. 
  * Rendering is done in the graphics code, this class is just a container with platform independent font specific code..
+ * Glyphs are rendered the first time they are used, any character in the face, and packed into texture pages with a skyline packer.
+ * When the pages are full and there can be no more, the page used least recently is emptied for the new glyphs.
+ * Distance field fonts are made in two parts. One font holds the face and the glyph cache, and its glyphs are signed distance fields.
+ * The fonts for each size point at it, and scale its glyphs, so every size of a face shares one face and one cache.
+ * Bitmap fonts share the FreeTypeFace of their file with the other sizes, and can let go of it once their glyphs are cached, see ReleaseFace.
  */
 struct FreeTypeFont
 {
+	static constexpr int PADDING = 1;						//!< Empty pixels around each glyph so filtering does not pick up the neighbours.
+	static constexpr uint32_t NO_PAGE = 0xffffffff;			//!< The page of glyphs with no pixels, like space.
+	static constexpr FT_UInt REPLACEMENT_CHARACTER = 0xfffd;//!< Drawn in place of UTF-8 that is not valid.
+	static constexpr int DISTANCE_FIELD_SIZE = 48;			//!< The pixel size distance field glyphs are made at.
+	static constexpr int DISTANCE_FIELD_SPREAD = 8;			//!< How far, in pixels at DISTANCE_FIELD_SIZE, the distance field goes past the edges.
+
+	using CreateTexture = std::function<uint32_t(int pWidth,int pHeight)>;
+	using FillTexture = std::function<void(uint32_t pTexture,int pX,int pY,int pWidth,int pHeight,const uint8_t* pPixels)>;
+
 	/**
 	 * @brief An entry into the glyph cache
 	 */
@@ -24,45 +95,243 @@ struct FreeTypeFont
 	{
 		int width;
 		int height;
-		int pitch;
 		int advance;
 		int x_off,y_off;	//!< offset from current x and y that the quad is rendered.
+		uint32_t page;		//!< Which page the pixels are in, NO_PAGE if it has none.
 		struct
 		{// Where, in 16bit UV's, the glyph is.
 			float x,y;
 		}uv[2];
 	};
 
-	FreeTypeFont(const std::string pID,FT_Face pFontFace,int pPixelHeight);
+	/**
+	 * @brief A texture the glyphs are packed into.
+	 */
+	struct Page
+	{
+		struct Skyline
+		{
+			int x,y,width;	//!< The top of the glyphs packed so far is at y from x to x + width.
+		};
+
+		uint32_t texture = 0;
+		std::vector<Skyline> skyline;	//!< Left to right, covers the width of the page.
+		uint32_t glyphs = 0;
+		uint32_t lastUsed = 0;			//!< The value of mUseCount when one of its glyphs was last used.
+	};
+
+	/**
+	 * @brief Characters of a font rendered by a GlyphRasterizer worker, the font adds them to its cache when they are done.
+	 */
+	struct GlyphBatch
+	{
+		struct Rendered
+		{
+			FT_UInt character;
+			bool found;					//!< False if the face does not have it.
+			Glyph glyph;
+			std::vector<uint8_t> pixels;
+		};
+
+		std::string fontName;
+		const uint8_t* file;		//!< The font's mapped file, the font waits for its batches before it lets go of it.
+		size_t fileBytes;
+		int pixelHeight;
+		bool distanceField;
+		std::vector<FT_UInt> characters;
+		std::vector<Rendered> rendered;
+
+		std::atomic<bool> cancelled{false};
+		bool done = false;
+		std::mutex mutex;
+		std::condition_variable finished;
+
+		bool GetDone(){std::lock_guard<std::mutex> lock(mutex);return done;}
+		void Wait(){std::unique_lock<std::mutex> lock(mutex);finished.wait(lock,[this](){return done;});}
+	};
+
+	/**
+	 * @brief pDistanceField is true for the font that holds the face and glyphs of a distance field font, see above.
+	 */
+	FreeTypeFont(const std::string pID,std::shared_ptr<FreeTypeFace> pFace,int pPixelHeight,bool pDistanceField = false);
+
+	/**
+	 * @brief Makes a font that draws the glyphs of a distance field font at pPixelHeight.
+	 */
+	FreeTypeFont(const std::string pID,std::shared_ptr<FreeTypeFont> pDistanceField,int pPixelHeight);
 	~FreeTypeFont();
 
 	/**
-	 * @brief Get the Glyph object of an ASCII character. All that is needed to render as well as build the texture.
+	 * @brief Works out the size of the pages and makes the first one. pMaxPages is how many the cache can grow to before it starts emptying them.
+	 * Throws if the font is bigger than pMaximumAllowedGlyph.
 	 */
-	bool GetGlyph(FT_UInt pChar,FreeTypeFont::Glyph& rGlyph,std::vector<uint8_t>& rPixels);
+	void InitialiseCache(int pMaximumAllowedGlyph,int pMaxPages,CreateTexture pCreateTexture,FillTexture pFillTexture);
 
 	/**
-	 * @brief Builds our texture object.
+	 * @brief Writes a quad for each glyph with pixels, and the texture of the page it is in to rTextures.
+	 * Glyphs not in the cache are rendered and added to it.
 	 */
-	void BuildTexture(
-			int pMaximumAllowedGlyph,
-			std::function<uint32_t(int pWidth,int pHeight)> pCreateTexture,
-			std::function<void(uint32_t pTexture,int pX,int pY,int pWidth,int pHeight,const uint8_t* pPixels)> pFillTexture);
+	void BuildQuads(const std::string_view& pText,float pX,float pY,VertXY::Buffer& rVertices,VertXY::Buffer& rUVs,std::vector<uint32_t>& rTextures);
 
-	void BuildQuads(const char* pText,float pX,float pY,VertXY::Buffer& pVertices,VertXY::Buffer& pUVs)const;
+	Rectangle GetRect(const std::string_view& pText);
 
-	Rectangle GetRect(const std::string_view& pText)const;
+	/**
+	 * @brief Changes each time a page is emptied, quads kept from before then may point at the wrong glyphs and need building again.
+	 */
+	uint32_t GetGeneration()const{return mDistanceField ? mDistanceField->mGeneration : mGeneration;}
 
+	GlyphCacheStatistics GetStatistics()const;
+	FontFaceStatistics GetFaceStatistics()const;
+
+	/**
+	 * @brief Has the rasterizer's workers render the characters so they are ready when the font is first drawn.
+	 * They are added to the cache the next time the font is used, if a character is wanted before its batch is done the font waits for it.
+	 */
+	void Prerender(GlyphRasterizer& rRasterizer,const std::string_view& pCharacters);
+
+	/**
+	 * @brief Renders the glyph with FreeType from whichever face, and thread, it is given. Returns false if the face does not have the character.
+	 */
+	static bool RenderGlyph(FT_Face pFace,const std::string& pFontName,bool pDistanceField,FT_UInt pChar,FreeTypeFont::Glyph& rGlyph,std::vector<uint8_t>& rPixels);
+
+	/**
+	 * @brief Renders the characters of pKeep into the cache then lets go of the font's size, and the face when no other font uses it.
+	 * After this only the characters in the cache can be drawn, the rest are drawn as a space. A distance field font releases the face all its sizes share.
+	 */
+	void ReleaseFace(const std::string_view& pKeep);
 
 	const std::string mID;						//<! Is the face name + size, used when loading so we load it just once.
 	const std::string mFontName; 				//<! Helps with debugging.
 	
-	FT_Face mFace;								//<! The font we are rending from.
-	uint32_t mTexture;							//<! This is the texture that the glyphs are in so we can render using GL and quads.
-	std::array<FreeTypeFont::Glyph,96>mGlyphs;	//<! Meta data needed to render the characters.
+	std::shared_ptr<FreeTypeFace> mFaceFile;	//<! The file and face, shared with the other sizes loaded from the file.
+	FT_Face mFace;								//<! The font we are rending from, null once released.
+	FT_Size mSize = nullptr;					//<! This font's size of the face, made active before the face is used.
+	std::vector<Page> mPages;					//<! The textures the glyphs are in so we can render using GL and quads.
 	int mBaselineHeight;						//<! This is the number of pixels above baseline the higest character is. Used for centering a font in the y.
-	int mSpaceAdvance;							//<! How much to advance by for a non rerendered character.
+	int mSpaceAdvance;							//<! How much to advance by for a character that is not in the face.
+
+	std::shared_ptr<FreeTypeFont> mDistanceField;	//<! For fonts drawn from a distance field, the font with the face and glyphs.
+	float mScale = 1.0f;							//<! From the glyphs of mDistanceField to this font's size.
+
+	/**
+	 * @brief Outline and shadow, only drawn by distance field fonts. A colour with an alpha of zero turns the effect off.
+	 */
+	struct
+	{
+		float outlineWidth = 0.0f;		//!< In pixels, up to about DISTANCE_FIELD_SPREAD scaled to the font's size.
+		Colour outlineColour = 0;
+		float shadowX = 0.0f;			//!< The shadow is the text, and its outline, moved by this many pixels.
+		float shadowY = 0.0f;
+		float shadowSoftness = 0.0f;	//!< How many pixels the edge of the shadow is blurred over.
+		Colour shadowColour = 0;
+	}mEffects;
+
+private:
+	std::unordered_map<FT_UInt,Glyph> mGlyphs;	//<! Meta data needed to render the characters that are in the cache.
+	std::array<Glyph*,256> mLatin1;				//<! The first 256 characters of mGlyphs, they are most of what is drawn so skip the hashing.
+	std::vector<uint8_t> mPixels;				//<! Work buffer for rendering a glyph.
+	CreateTexture mCreateTexture;
+	FillTexture mFillTexture;
+	int mPageSize = 0;
+	size_t mMaxPages = 0;
+	int mMaximumAllowedGlyph = 0;
+	const bool mIsDistanceField;				//<! True if this font's glyphs are distance fields.
+	size_t mFileBytes = 0;						//<! Kept from the face so they can be reported after it is released.
+	size_t mFaceBytes = 0;
+	size_t mSizeBytes = 0;						//<! What FreeType allocated for mSize.
+	const int mPixelHeight;
+	std::vector<std::shared_ptr<GlyphBatch>> mBatches;	//<! Being rendered by the workers, in the order they were added.
+	uint32_t mUseCount = 0;						//<! Goes up each time some text is built or measured, used to find the page used least recently.
+	uint32_t mGeneration = 0;
+
+	struct
+	{
+		uint64_t hits = 0;
+		uint64_t misses = 0;
+		uint64_t evictions = 0;
+		uint64_t pageEvictions = 0;
+		uint64_t prerendered = 0;
+	}mCounts;
+
+	/**
+	 * @brief Returns the glyph of the character, rendering it into a page if it is not in the cache.
+	 */
+	const Glyph& FindGlyph(FT_UInt pChar);
+
+	/**
+	 * @brief Returns the glyph if it is in the cache, else null.
+	 */
+	Glyph* GetCached(FT_UInt pChar);
+
+	/**
+	 * @brief Packs the glyph into a page, sends its pixels to the texture and adds it to the cache. pFound is false if the face does not have the character.
+	 */
+	const Glyph& AddGlyph(FT_UInt pChar,Glyph pGlyph,bool pFound,const std::vector<uint8_t>& pPixels);
+
+	/**
+	 * @brief Adds the glyphs of the batches the workers have finished to the cache.
+	 */
+	void CollectBatches();
+
+	/**
+	 * @brief If the character is in a batch waits for the batch and collects, returns false if it is not in one.
+	 */
+	bool WaitForBatch(FT_UInt pChar);
+	bool GetIsBatched(FT_UInt pChar)const;
+
+	/**
+	 * @brief Tells the workers to stop on the font's batches and waits for them, they read the font's mapped file.
+	 */
+	void CancelBatches();
+
+	/**
+	 * @brief Renders the glyph with this font's size of the face, rPixels is set to its pixels. Returns false if the face does not have the character.
+	 */
+	bool GetGlyph(FT_UInt pChar,FreeTypeFont::Glyph& rGlyph,std::vector<uint8_t>& rPixels);
+
+	/**
+	 * @brief Turns the glyph's pixels into a signed distance field, it grows by DISTANCE_FIELD_SPREAD all round.
+	 */
+	static void BuildDistanceField(FreeTypeFont::Glyph& rGlyph,std::vector<uint8_t>& rPixels);
+
+	/**
+	 * @brief Finds room in the pages for a glyph, making a page or emptying one if need be. Returns false if it can never fit.
+	 */
+	bool AddToPage(int pWidth,int pHeight,uint32_t& rPage,int& rX,int& rY);
+
+	/**
+	 * @brief Empties the page, its glyphs are removed from the cache.
+	 */
+	void EvictPage(uint32_t pPage);
+	void AddPage();
+};
+
+/**
+ * @brief Renders glyphs on the worker pool, so loading fonts is spread over the cores rather than holding up the first frame.
+ * FreeType libraries can not be used by two threads at once, so each worker has its own FT_Library and opens its own face on
+ * the font's mapped file. Only the rendering happens on the workers, the font packs the glyphs and sends them to the texture.
+ */
+struct GlyphRasterizer
+{
+	/**
+	 * @brief rPool must outlive the rasterizer.
+	 */
+	GlyphRasterizer(WorkerPool& rPool);
+
+	/**
+	 * @brief Waits for the batches added, they are quick if cancelled, then frees the workers' FreeType libraries.
+	 */
+	~GlyphRasterizer();
+
+	void Add(std::shared_ptr<FreeTypeFont::GlyphBatch> pBatch);
+	size_t GetWorkers()const{return mPool.GetWorkers();}
+
+private:
+	WorkerPool& mPool;
+	WorkerPool::Group mBatches;
+	std::vector<FT_Library> mFreetype;	//!< One for each worker, made by the worker the first time it renders.
 
+	void Render(size_t pWorker,FreeTypeFont::GlyphBatch& rBatch);
 };
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////
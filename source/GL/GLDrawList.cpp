@@ -0,0 +1,137 @@
+#include "GLDrawList.h"
+#include "Diagnostics.h"
+
+namespace eui{
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+GLDrawList::Vertex* GLDrawList::Add(GLShaderPtr pShader,uint32_t pTexture,Graphics::Topology pTopology,size_t pNumVertices)
+{
+	assert(pShader);
+	assert(GetHasSpace(pNumVertices));
+
+	const uint16_t base = (uint16_t)mVertices.Used();
+	GLenum primitive = GL_TRIANGLES;
+	size_t numIndices = 0;
+	uint16_t* indices = nullptr;
+
+	switch( pTopology )
+	{
+	case Graphics::Topology::TRIANGLES:
+		numIndices = pNumVertices;
+		indices = mIndices.Next(numIndices);
+		for( size_t n = 0 ; n < pNumVertices ; n++ )
+		{
+			indices[n] = base + n;
+		}
+		break;
+
+	case Graphics::Topology::TRIANGLE_FAN:
+		assert(pNumVertices >= 3);
+		numIndices = (pNumVertices - 2) * 3;
+		indices = mIndices.Next(numIndices);
+		for( size_t n = 1 ; n < pNumVertices - 1 ; n++, indices += 3 )
+		{
+			indices[0] = base;
+			indices[1] = base + n;
+			indices[2] = base + n + 1;
+		}
+		break;
+
+	case Graphics::Topology::TRIANGLE_STRIP:
+		assert(pNumVertices >= 3);
+		numIndices = (pNumVertices - 2) * 3;
+		indices = mIndices.Next(numIndices);
+		for( size_t n = 0 ; n < pNumVertices - 2 ; n++, indices += 3 )
+		{// Every other triangle in a strip is flipped by GL to keep the winding the same, so do the same.
+			if( n&1 )
+			{
+				indices[0] = base + n + 1;
+				indices[1] = base + n;
+			}
+			else
+			{
+				indices[0] = base + n;
+				indices[1] = base + n + 1;
+			}
+			indices[2] = base + n + 2;
+		}
+		break;
+
+	case Graphics::Topology::LINES:
+		primitive = GL_LINES;
+		numIndices = pNumVertices;
+		indices = mIndices.Next(numIndices);
+		for( size_t n = 0 ; n < pNumVertices ; n++ )
+		{
+			indices[n] = base + n;
+		}
+		break;
+
+	case Graphics::Topology::LINE_LOOP:
+		assert(pNumVertices >= 2);
+		primitive = GL_LINES;
+		numIndices = pNumVertices * 2;
+		indices = mIndices.Next(numIndices);
+		for( size_t n = 0 ; n < pNumVertices ; n++, indices += 2 )
+		{
+			indices[0] = base + n;
+			indices[1] = base + ((n + 1) % pNumVertices);
+		}
+		break;
+	}
+
+	// Can we merge with the last one?
+	if( mCommands.size() > 0 &&
+		mCommands.back().shader == pShader &&
+		mCommands.back().texture == pTexture &&
+		mCommands.back().primitive == primitive &&
+		mCommands.back().shapes == false )
+	{
+		mCommands.back().numIndices += numIndices;
+	}
+	else
+	{
+		mCommands.push_back({pShader,pTexture,primitive,false,mIndices.Used() - numIndices,numIndices});
+	}
+
+	return mVertices.Next(pNumVertices);
+}
+
+GLDrawList::ShapeVertex* GLDrawList::AddShape(GLShaderPtr pShader,uint32_t pTexture)
+{
+	assert(pShader);
+	assert(GetHasShapeSpace());
+
+	const uint16_t base = (uint16_t)mShapeVertices.Used();
+	uint16_t* indices = mIndices.Next(6);
+	indices[0] = base;
+	indices[1] = base + 1;
+	indices[2] = base + 2;
+	indices[3] = base;
+	indices[4] = base + 2;
+	indices[5] = base + 3;
+
+	if( mCommands.size() > 0 &&
+		mCommands.back().shader == pShader &&
+		mCommands.back().texture == pTexture &&
+		mCommands.back().shapes == true )
+	{
+		mCommands.back().numIndices += 6;
+	}
+	else
+	{
+		mCommands.push_back({pShader,pTexture,GL_TRIANGLES,true,mIndices.Used() - 6,6});
+	}
+
+	return mShapeVertices.Next(4);
+}
+
+void GLDrawList::Restart()
+{
+	mVertices.Restart();
+	mShapeVertices.Restart();
+	mIndices.Restart();
+	mCommands.clear();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+}//namespace eui{
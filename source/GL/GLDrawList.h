@@ -0,0 +1,103 @@
+#ifndef GLDrawList_H__
+#define GLDrawList_H__
+
+#include "GLIncludes.h"
+#include "Graphics.h"
+
+#include <vector>
+
+namespace eui{
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * @brief Records the primitives drawn between BeginFrame and EndFrame so they can be sent to GL in as few draw calls as possible.
+ * Consecutive primitives that share a shader, texture and GL primitive type are merged into one command.
+ * The order things are drawn in is never changed, so alpha blending still works as the UI code expects.
+ */
+struct GLDrawList
+{
+	static const size_t MAX_VERTICES = 0xffff;	//!< Indices are 16 bit, GLES 2.0 does not do 32 bit indices without an extension.
+
+	/**
+	 * @brief Every primitive is converted to this, so that runs of them can be drawn in one go.
+	 */
+	struct Vertex
+	{
+		float x,y;
+		float u,v;
+		uint32_t rgba;	//!< Bytes are in the order R,G,B,A in memory, which is what GL wants. Use ToVertexColour.
+	};
+
+	/**
+	 * @brief Used by the signed distance field shader, each shape is one quad and the fragment shader works out what is inside it.
+	 */
+	struct ShapeVertex
+	{
+		float x,y;
+		float localX,localY;		//!< Position relative to the centre of the shape, in pixels, along the shape's own axis.
+		float halfWidth,halfHeight;	//!< Of the shape, not the quad. The quad is a little bigger to make room for the anti aliasing.
+		float radius;				//!< Of the corners in pixels.
+		float thickness;			//!< Of the boarder in pixels, zero for none.
+		float style;				//!< The BoarderStyle of the boarder.
+		uint32_t fill;				//!< Use ToVertexColour.
+		uint32_t boarder;			//!< Use ToVertexColour.
+	};
+
+	/**
+	 * @brief A run of indices that can be drawn with one call to glDrawElements.
+	 */
+	struct Command
+	{
+		GLShaderPtr shader;
+		uint32_t texture;
+		GLenum primitive;	//!< GL_TRIANGLES or GL_LINES, everything else is converted to one of these.
+		bool shapes;		//!< The indices are for mShapeVertices and not mVertices.
+		size_t firstIndex;
+		size_t numIndices;
+	};
+
+	/**
+	 * @brief Returns true if there is nothing waiting to be drawn.
+	 */
+	bool GetIsEmpty()const{return mCommands.size() == 0;}
+
+	/**
+	 * @brief Returns true if the number of vertices passed can be added without going over the 16 bit index limit.
+	 */
+	bool GetHasSpace(size_t pNumVertices)const{return mVertices.Used() + pNumVertices <= MAX_VERTICES;}
+	bool GetHasShapeSpace()const{return mShapeVertices.Used() + 4 <= MAX_VERTICES;}
+
+	/**
+	 * @brief Adds the indices for the primitive and returns the memory for the caller to write the vertices into.
+	 * If the shader, texture and GL primitive type match the last command the two are merged.
+	 */
+	Vertex* Add(GLShaderPtr pShader,uint32_t pTexture,Graphics::Topology pTopology,size_t pNumVertices);
+
+	/**
+	 * @brief Adds the indices for one quad and returns the memory for the caller to write the four corners into.
+	 * The corners go clockwise, top left first. pTexture is a GL texture, for shaders that read one, such as the distance field text.
+	 */
+	ShapeVertex* AddShape(GLShaderPtr pShader,uint32_t pTexture = 0);
+
+	/**
+	 * @brief Throws away all that has been recorded, keeps the memory.
+	 */
+	void Restart();
+
+	/**
+	 * @brief Converts our ARGB colour into the byte order the vertex stream needs.
+	 */
+	static constexpr uint32_t ToVertexColour(Colour pColour)
+	{
+		return (GetAlpha(pColour)<<24) | (GetBlue(pColour)<<16) | (GetGreen(pColour)<<8) | (GetRed(pColour)<<0);
+	}
+
+	ScratchBuffer<Vertex,4096,4096,MAX_VERTICES> mVertices;
+	ScratchBuffer<ShapeVertex,256,256,MAX_VERTICES> mShapeVertices;
+	ScratchBuffer<uint16_t,8192,8192,MAX_VERTICES*3> mIndices;
+	std::vector<Command> mCommands;
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+}//namespace eui{
+
+#endif //#ifndef GLDrawList_H__
@@ -7,12 +7,14 @@
 
 namespace eui{
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////
-GLShader::GLShader(const std::string& pName,const char* pVertex, const char* pFragment) :
+GLShader::GLShader(GLState& pState,const std::string& pName,const char* pVertex, const char* pFragment) :
+	mState(pState),
 	mName(pName),
 	mEnableStreamUV(strstr(pVertex," a_uv0;")),
-	mEnableStreamColour(strstr(pVertex," a_col;"))
+	mEnableStreamColour(strstr(pVertex," a_col;")),
+	mEnableStreamShape(strstr(pVertex," a_shape;"))
 {
-	VERBOSE_SHADER_MESSAGE("Creating " << mName << " mEnableStreamUV " << mEnableStreamUV << " mEnableStreamColour" << mEnableStreamColour);
+	VERBOSE_SHADER_MESSAGE("Creating " << mName << " mEnableStreamUV " << mEnableStreamUV << " mEnableStreamColour" << mEnableStreamColour << " mEnableStreamShape " << mEnableStreamShape);
 
 	mVertexShader = LoadShader(GL_VERTEX_SHADER,pVertex);
 
@@ -34,6 +36,9 @@ GLShader::GLShader(const std::string& pName,const char* pVertex, const char* pFr
 	BindAttribLocation((int)StreamIndex::VERTEX, "a_xyz");
 	BindAttribLocation((int)StreamIndex::TEXCOORD, "a_uv0");
 	BindAttribLocation((int)StreamIndex::COLOUR, "a_col");
+	BindAttribLocation((int)StreamIndex::SHAPE, "a_shape");
+	BindAttribLocation((int)StreamIndex::COLOUR2, "a_col2");
+	BindAttribLocation((int)StreamIndex::STYLE, "a_style");
 
 	glLinkProgram(mShader); // creates OpenGL program executables
 	CHECK_OGL_ERRORS();
@@ -72,7 +77,7 @@ GLShader::GLShader(const std::string& pName,const char* pVertex, const char* pFr
 	mUniforms.textureTrans = GetUniformLocation("u_textTrans");
 
 
-	glUseProgram(0);
+	mState.UseProgram(0);
 #ifdef VERBOSE_SHADER_BUILD
 	gCurrentShaderName = "";
 #endif
@@ -123,32 +128,20 @@ void GLShader::Enable(const float projInvcam[4][4],const float pTransform[4][4],
 #endif
 
 	assert(mShader);
-    glUseProgram(mShader);
+	mState.UseProgram(mShader);
     CHECK_OGL_ERRORS();
 
-    glUniformMatrix4fv(mUniforms.proj_cam, 1, false,(const float*)projInvcam);
+	mState.SetUniformMatrix(mUniforms.proj_cam,mUniformValues.proj_cam,projInvcam);
     CHECK_OGL_ERRORS();
 
 	SetTransform(pTransform);
 	SetTextureTransform(pTextureTransform);
 
-	if( mEnableStreamUV )
-	{
-		glEnableVertexAttribArray((int)StreamIndex::TEXCOORD);
-	}
-	else
-	{
-		glDisableVertexAttribArray((int)StreamIndex::TEXCOORD);
-	}
-
-	if( mEnableStreamColour )
-	{
-		glEnableVertexAttribArray((int)StreamIndex::COLOUR);
-	}
-	else
-	{
-		glDisableVertexAttribArray((int)StreamIndex::COLOUR);
-	}
+	mState.SetVertexAttribArray((int)StreamIndex::TEXCOORD,mEnableStreamUV);
+	mState.SetVertexAttribArray((int)StreamIndex::COLOUR,mEnableStreamColour);
+	mState.SetVertexAttribArray((int)StreamIndex::SHAPE,mEnableStreamShape);
+	mState.SetVertexAttribArray((int)StreamIndex::COLOUR2,mEnableStreamShape);
+	mState.SetVertexAttribArray((int)StreamIndex::STYLE,mEnableStreamShape);
 
     CHECK_OGL_ERRORS();
 }
@@ -156,7 +149,7 @@ void GLShader::Enable(const float projInvcam[4][4],const float pTransform[4][4],
 void GLShader::SetTransform(const float pTransform[4][4])
 {
 	assert(mUniforms.trans >= 0 );
-	glUniformMatrix4fv(mUniforms.trans, 1, false,(const GLfloat*)pTransform);
+	mState.SetUniformMatrix(mUniforms.trans,mUniformValues.trans,pTransform);
 	CHECK_OGL_ERRORS();
 }
 
@@ -173,25 +166,42 @@ void GLShader::SetGlobalColour(const Colour pColour)
 
 void GLShader::SetGlobalColour(float pRed,float pGreen,float pBlue,float pAlpha)
 {
+	const float colour[4] = {pRed,pGreen,pBlue,pAlpha};
+	if( mUniformValues.global_colourSet && memcmp(mUniformValues.global_colour,colour,sizeof(colour)) == 0 )
+	{
+		mState.Skipped();
+		return;
+	}
+
 	glUniform4f(mUniforms.global_colour,pRed,pGreen,pBlue,pAlpha);
+	memcpy(mUniformValues.global_colour,colour,sizeof(colour));
+	mUniformValues.global_colourSet = true;
+	mState.UniformIssued();
 }
 
 void GLShader::SetTexture(GLint pTexture)
 {
 	assert(pTexture);
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D,pTexture);
-	glUniform1i(mUniforms.tex0,0);
+	mState.BindTexture(pTexture);
+
+	// Always texture unit zero, so the sampler only needs setting the once.
+	if( mUniformValues.tex0Set )
+	{
+		mState.Skipped();
+	}
+	else
+	{
+		glUniform1i(mUniforms.tex0,0);
+		mUniformValues.tex0Set = true;
+		mState.UniformIssued();
+	}
 	CHECK_OGL_ERRORS();
 }
 
 void GLShader::SetTextureTransform(const float pTransform[4][4])
 {
-	if(mUniforms.textureTrans >= 0 )
-	{
-		glUniformMatrix4fv(mUniforms.textureTrans, 1, false,(const GLfloat*)pTransform);
-		CHECK_OGL_ERRORS();
-	}
+	mState.SetUniformMatrix(mUniforms.textureTrans,mUniformValues.textureTrans,pTransform);
+	CHECK_OGL_ERRORS();
 }
 
 int GLShader::LoadShader(int type, const char* shaderCode)
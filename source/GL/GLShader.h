@@ -3,6 +3,7 @@
 
 #include "GLIncludes.h"
 #include "Graphics.h"
+#include "GLState.h"
 
 #include <string>
 #include <memory>
@@ -14,12 +15,15 @@ enum struct StreamIndex
 	VERTEX				= 0,		//!< Vertex positional data.
 	TEXCOORD			= 1,		//!< Texture coordinate information.
 	COLOUR				= 2,		//!< Colour type is in the format RGBA.
+	SHAPE				= 3,		//!< Half width, half height, corner radius and boarder thickness of a shape.
+	COLOUR2				= 4,		//!< Second colour, RGBA. The boarder colour of a shape.
+	STYLE				= 5,		//!< The boarder style of a shape.
 };
 
 
 struct GLShader
 {
-	GLShader(const std::string& pName,const char* pVertex, const char* pFragment);
+	GLShader(GLState& pState,const std::string& pName,const char* pVertex, const char* pFragment);
 	~GLShader();
 
 	int GetUniformLocation(const char* pName);
@@ -34,9 +38,11 @@ struct GLShader
 	bool GetUsesTexture()const{return mUniforms.tex0 > -1;}
 	bool GetUsesTransform()const{return mUniforms.trans > -1;}
 
+	GLState& mState;			//!< Shared by all the shaders, so calls that would not change anything are skipped.
 	const std::string mName;	//!< Mainly to help debugging.
 	const bool mEnableStreamUV;
 	const bool mEnableStreamColour;
+	const bool mEnableStreamShape;	//!< Also enables COLOUR2 and STYLE, they are only used for shapes.
 
 	GLint mShader = 0;
 	GLint mVertexShader = 0;
@@ -50,6 +56,19 @@ struct GLShader
 		GLint textureTrans;
 	}mUniforms;
 
+	/**
+	 * @brief The values last sent to GL for our uniforms, they are kept by the program so only need sending when they change.
+	 */
+	struct
+	{
+		GLState::UniformMatrix proj_cam;
+		GLState::UniformMatrix trans;
+		GLState::UniformMatrix textureTrans;
+		bool global_colourSet = false;
+		float global_colour[4];
+		bool tex0Set = false;
+	}mUniformValues;
+
 	int LoadShader(int type, const char* shaderCode);
 };
 
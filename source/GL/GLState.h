@@ -0,0 +1,157 @@
+#ifndef GLState_H__
+#define GLState_H__
+
+#include "GLIncludes.h"
+#include "Graphics.h"
+
+#include <cstring>
+#include <cassert>
+
+namespace eui{
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * @brief Remembers the GL state we have set so calls that would not change anything are not made.
+ * All program, texture and vertex attribute array changes go through here, anything that changes them behind
+ * its back has to call Invalidate. Only texture unit zero is used so that is the only one tracked.
+ */
+struct GLState
+{
+	static constexpr GLuint UNKNOWN = 0xffffffff;
+	static constexpr size_t MAX_ATTRIBUTES = 8;
+
+	/**
+	 * @brief A matrix uniform and the value last sent to GL for it. Each shader has its own as uniforms belong to the program.
+	 */
+	struct UniformMatrix
+	{
+		bool set = false;
+		float value[4][4];
+	};
+
+	/**
+	 * @brief Forgets what we know, the next calls are always made. Used when someone else may have used the context, for example GTK.
+	 */
+	void Invalidate()
+	{
+		mProgram = UNKNOWN;
+		mTexture = UNKNOWN;
+		mActiveTextureSet = false;
+		mAttributesKnown = 0;
+	}
+
+	void UseProgram(GLuint pProgram)
+	{
+		if( mProgram == pProgram )
+		{
+			Skipped();
+			return;
+		}
+		glUseProgram(pProgram);
+		mProgram = pProgram;
+		Issued();
+		mCurrent.programs++;
+	}
+
+	void BindTexture(GLuint pTexture)
+	{
+		if( mActiveTextureSet == false )
+		{
+			glActiveTexture(GL_TEXTURE0);
+			mActiveTextureSet = true;
+			Issued();
+		}
+
+		if( mTexture == pTexture )
+		{
+			Skipped();
+			return;
+		}
+		glBindTexture(GL_TEXTURE_2D,pTexture);
+		mTexture = pTexture;
+		Issued();
+		mCurrent.textures++;
+	}
+
+	/**
+	 * @brief GL unbinds a texture that is deleted while bound, so we have to do the same.
+	 */
+	void TextureDeleted(GLuint pTexture)
+	{
+		if( mTexture == pTexture )
+		{
+			mTexture = 0;
+		}
+	}
+
+	void SetVertexAttribArray(GLuint pIndex,bool pEnabled)
+	{
+		assert(pIndex < MAX_ATTRIBUTES);
+		const uint32_t bit = 1 << pIndex;
+		if( (mAttributesKnown&bit) && ((mAttributesEnabled&bit) != 0) == pEnabled )
+		{
+			Skipped();
+			return;
+		}
+
+		if( pEnabled )
+		{
+			glEnableVertexAttribArray(pIndex);
+			mAttributesEnabled |= bit;
+		}
+		else
+		{
+			glDisableVertexAttribArray(pIndex);
+			mAttributesEnabled &= ~bit;
+		}
+		mAttributesKnown |= bit;
+		Issued();
+	}
+
+	void SetUniformMatrix(GLint pLocation,UniformMatrix& rCache,const float pMatrix[4][4])
+	{
+		if( pLocation < 0 )
+		{
+			return;
+		}
+
+		if( rCache.set && std::memcmp(rCache.value,pMatrix,sizeof(rCache.value)) == 0 )
+		{
+			Skipped();
+			return;
+		}
+		glUniformMatrix4fv(pLocation,1,false,(const GLfloat*)pMatrix);
+		std::memcpy(rCache.value,pMatrix,sizeof(rCache.value));
+		rCache.set = true;
+		UniformIssued();
+	}
+
+	/**
+	 * @brief Call at the end of the frame, the counts for the frame just drawn are then returned by GetLastFrame.
+	 */
+	void EndFrame()
+	{
+		mLastFrame = mCurrent;
+		mCurrent = GLStateStatistics();
+	}
+
+	const GLStateStatistics& GetLastFrame()const{return mLastFrame;}
+
+	void Issued(){mCurrent.issued++;}
+	void Skipped(){mCurrent.skipped++;}
+	void UniformIssued(){mCurrent.issued++;mCurrent.uniforms++;}
+
+private:
+	GLuint mProgram = UNKNOWN;
+	GLuint mTexture = UNKNOWN;
+	bool mActiveTextureSet = false;
+	uint32_t mAttributesKnown = 0;		//!< A bit per attribute, set when we know if it is enabled.
+	uint32_t mAttributesEnabled = 0;
+
+	GLStateStatistics mCurrent;
+	GLStateStatistics mLastFrame;
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+}//namespace eui{
+
+#endif //#ifndef GLState_H__
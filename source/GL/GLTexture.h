@@ -49,11 +49,16 @@ constexpr GLint TextureFormatToGLFormat(TextureFormat pFormat)
 struct GLTexture
 {
 	GLTexture() = delete; // Forces user to use references.
-	GLTexture(TextureFormat pFormat,int pWidth,int pHeight):mFormat(pFormat),mWidth(pWidth),mHeight(pHeight){}
+	GLTexture(GLuint pGLTexture,TextureFormat pFormat,int pWidth,int pHeight):mGLTexture(pGLTexture),mFormat(pFormat),mWidth(pWidth),mHeight(pHeight){}
 
+	const GLuint mGLTexture;	//!< The GL texture, for images in the texture atlas the page they are in.
 	const TextureFormat mFormat;
 	const int mWidth;
 	const int mHeight;
+
+	uint32_t mAtlasImage = 0;	//!< If the image is in the texture atlas, it's ID there. Zero if not.
+	bool mPlaceholder = false;	//!< Shares the GL texture of the diagnostics texture while TextureLoadAsync loads the image, so must not delete it.
+	float mU0 = 0.0f,mV0 = 0.0f,mU1 = 1.0f,mV1 = 1.0f;	//!< The part of the GL texture that is ours, all of it unless in the texture atlas.
 };
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,181 @@
+#ifndef GLTimerQueries_H__
+#define GLTimerQueries_H__
+
+#include "GLIncludes.h"
+#include "Diagnostics.h"
+
+#include <string>
+
+#ifdef PLATFORM_GLES
+	#include "EGL/egl.h"
+#endif
+
+#ifndef GL_GPU_DISJOINT_EXT
+	#define GL_GPU_DISJOINT_EXT 0x8FBB
+#endif
+
+namespace eui{
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * @brief Measures how long the GPU takes to draw each frame with timer queries.
+ * GL works on the frame long after the draw calls return, so the results are read a few frames later. A small ring of
+ * queries is kept, if they are all still waiting for GL the frame is not timed rather than stalling to get a result.
+ * The functions are looked up at run time as GLES only has them with EXT_disjoint_timer_query.
+ */
+struct GLTimerQueries
+{
+	static constexpr size_t MAX_PENDING = 4;
+
+	~GLTimerQueries()
+	{
+		if( mSupported )
+		{
+			mDeleteQueries(MAX_PENDING,mQueries);
+		}
+	}
+
+	/**
+	 * @brief Looks for the extension and makes the queries, needs the context to be current.
+	 */
+	void Initialise()
+	{
+		const char* extensions = (const char*)glGetString(GL_EXTENSIONS);
+		if( extensions == nullptr )
+		{
+			return;
+		}
+		const std::string all = " " + std::string(extensions) + " ";
+
+#ifdef PLATFORM_GLES
+		if( all.find(" GL_EXT_disjoint_timer_query ") == std::string::npos )
+		{
+			VERBOSE_MESSAGE("No GL_EXT_disjoint_timer_query, the GPU time of frames can not be measured");
+			return;
+		}
+		mGenQueries = (PFNGLGENQUERIESPROC)eglGetProcAddress("glGenQueriesEXT");
+		mDeleteQueries = (PFNGLDELETEQUERIESPROC)eglGetProcAddress("glDeleteQueriesEXT");
+		mBeginQuery = (PFNGLBEGINQUERYPROC)eglGetProcAddress("glBeginQueryEXT");
+		mEndQuery = (PFNGLENDQUERYPROC)eglGetProcAddress("glEndQueryEXT");
+		mGetQueryObjectiv = (PFNGLGETQUERYOBJECTIVPROC)eglGetProcAddress("glGetQueryObjectivEXT");
+		mGetQueryObjectui64v = (PFNGLGETQUERYOBJECTUI64VPROC)eglGetProcAddress("glGetQueryObjectui64vEXT");
+		mCanBeDisjoint = true;
+#else
+		if( all.find(" GL_ARB_timer_query ") == std::string::npos )
+		{
+			VERBOSE_MESSAGE("No GL_ARB_timer_query, the GPU time of frames can not be measured");
+			return;
+		}
+		mGenQueries = (PFNGLGENQUERIESPROC)glXGetProcAddress((const GLubyte*)"glGenQueries");
+		mDeleteQueries = (PFNGLDELETEQUERIESPROC)glXGetProcAddress((const GLubyte*)"glDeleteQueries");
+		mBeginQuery = (PFNGLBEGINQUERYPROC)glXGetProcAddress((const GLubyte*)"glBeginQuery");
+		mEndQuery = (PFNGLENDQUERYPROC)glXGetProcAddress((const GLubyte*)"glEndQuery");
+		mGetQueryObjectiv = (PFNGLGETQUERYOBJECTIVPROC)glXGetProcAddress((const GLubyte*)"glGetQueryObjectiv");
+		mGetQueryObjectui64v = (PFNGLGETQUERYOBJECTUI64VPROC)glXGetProcAddress((const GLubyte*)"glGetQueryObjectui64v");
+#endif
+
+		if( !mGenQueries || !mDeleteQueries || !mBeginQuery || !mEndQuery || !mGetQueryObjectiv || !mGetQueryObjectui64v )
+		{
+			VERBOSE_MESSAGE("Timer query functions missing, the GPU time of frames can not be measured");
+			return;
+		}
+
+		mGenQueries(MAX_PENDING,mQueries);
+		mSupported = true;
+		VERBOSE_MESSAGE("GPU frame timing available");
+	}
+
+	bool GetSupported()const{return mSupported;}
+
+	/**
+	 * @brief Starts timing the frame, if there is a free query.
+	 */
+	void BeginFrame()
+	{
+		if( mSupported && mPending < MAX_PENDING )
+		{
+			if( mCanBeDisjoint )
+			{// Reading it clears it, so anything that happened before this frame is not counted against it.
+				GLint disjoint;
+				glGetIntegerv(GL_GPU_DISJOINT_EXT,&disjoint);
+			}
+			mBeginQuery(GL_TIME_ELAPSED,mQueries[(mFirst + mPending) % MAX_PENDING]);
+			mActive = true;
+		}
+	}
+
+	void EndFrame()
+	{
+		if( mActive )
+		{
+			mEndQuery(GL_TIME_ELAPSED);
+			mPending++;
+			mActive = false;
+		}
+	}
+
+	/**
+	 * @brief Takes the oldest result if GL has it, returns false if it does not.
+	 */
+	bool GetResult(double& rMilliseconds)
+	{
+		if( mPending > 0 )
+		{
+			const GLuint query = mQueries[mFirst];
+			GLint available = 0;
+			mGetQueryObjectiv(query,GL_QUERY_RESULT_AVAILABLE,&available);
+			if( !available )
+			{
+				return false;
+			}
+
+			GLuint64 nanoseconds = 0;
+			mGetQueryObjectui64v(query,GL_QUERY_RESULT,&nanoseconds);
+			mFirst = (mFirst + 1) % MAX_PENDING;
+			mPending--;
+
+			GLint disjoint = 0;
+			if( mCanBeDisjoint )
+			{// The GPU's clock was upset, for example by a power change, the results waiting can not be trusted.
+				glGetIntegerv(GL_GPU_DISJOINT_EXT,&disjoint);
+			}
+			if( disjoint )
+			{
+				Clear();
+				return false;
+			}
+
+			rMilliseconds = nanoseconds / 1000000.0;
+			return true;
+		}
+		return false;
+	}
+
+	/**
+	 * @brief Forgets the frames waiting for results, used when timing is turned off.
+	 */
+	void Clear()
+	{
+		mFirst = 0;
+		mPending = 0;
+	}
+
+private:
+	bool mSupported = false;
+	bool mCanBeDisjoint = false;
+	bool mActive = false;
+	GLuint mQueries[MAX_PENDING];
+	size_t mFirst = 0;		//!< The oldest query waiting for its result.
+	size_t mPending = 0;	//!< How many are waiting.
+
+	PFNGLGENQUERIESPROC mGenQueries = nullptr;
+	PFNGLDELETEQUERIESPROC mDeleteQueries = nullptr;
+	PFNGLBEGINQUERYPROC mBeginQuery = nullptr;
+	PFNGLENDQUERYPROC mEndQuery = nullptr;
+	PFNGLGETQUERYOBJECTIVPROC mGetQueryObjectiv = nullptr;
+	PFNGLGETQUERYOBJECTUI64VPROC mGetQueryObjectui64v = nullptr;
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+}//namespace eui{
+
+#endif //#ifndef GLTimerQueries_H__
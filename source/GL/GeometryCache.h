@@ -0,0 +1,125 @@
+#ifndef GeometryCache_H__
+#define GeometryCache_H__
+
+#include "GraphicsTypes.h"
+#include "Rectangle.h"
+
+#include <vector>
+#include <unordered_map>
+#include <cstring>
+
+namespace eui{
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * @brief Keeps the points built for rounded rectangles so that widgets that do not change reuse them frame after frame.
+ * Entries that have not been used for a while are thrown away in BeginFrame.
+ */
+struct GeometryCache
+{
+	static constexpr size_t MAX_ENTRIES = 512;	//!< Once over this, entries not used in the last frame are removed.
+	static constexpr uint32_t MAX_AGE = 60;		//!< Entries not used for this many frames are removed, even when under MAX_ENTRIES.
+
+	enum Shape
+	{
+		SHAPE_ROUNDED_RECTANGLE,
+		SHAPE_ROUNDED_RECTANGLE_UVS,
+		SHAPE_ROUNDED_BOARDER
+	};
+
+	struct Key
+	{
+		Shape shape;
+		float left,top,right,bottom;
+		float radius;
+		float thickness;
+
+		bool operator == (const Key& pOther)const
+		{
+			return shape == pOther.shape &&
+					left == pOther.left && top == pOther.top && right == pOther.right && bottom == pOther.bottom &&
+					radius == pOther.radius && thickness == pOther.thickness;
+		}
+	};
+
+	struct KeyHash
+	{
+		size_t operator()(const Key& pKey)const
+		{
+			const float values[] = {pKey.left,pKey.top,pKey.right,pKey.bottom,pKey.radius,pKey.thickness};
+			size_t hash = (size_t)pKey.shape;
+			for( float v : values )
+			{
+				uint32_t bits;
+				std::memcpy(&bits,&v,sizeof(bits));
+				hash = (hash * 0x9E3779B97F4A7C15ull) ^ bits;
+			}
+			return hash;
+		}
+	};
+
+	struct Entry
+	{
+		std::vector<VertXY> points;
+		uint32_t lastUsed = 0;
+	};
+
+	static Key MakeKey(Shape pShape,const Rectangle& pRect,float pRadius,float pThickness = 0.0f)
+	{
+		return {pShape,pRect.left,pRect.top,pRect.right,pRect.bottom,pRadius,pThickness};
+	}
+
+	/**
+	 * @brief Returns the points for the key, if they are not in the cache pBuild is called to fill them in.
+	 * pBuild is passed a std::vector<VertXY>& to write the points into.
+	 */
+	template <class BUILD> const std::vector<VertXY>& Get(const Key& pKey,BUILD pBuild)
+	{
+		Entry& entry = mEntries[pKey];
+		if( entry.points.size() == 0 )
+		{
+			mMisses++;
+			pBuild(entry.points);
+		}
+		else
+		{
+			mHits++;
+		}
+		entry.lastUsed = mFrameNumber;
+		return entry.points;
+	}
+
+	/**
+	 * @brief Throws away the entries that are no longer being used.
+	 */
+	void BeginFrame(uint32_t pFrameNumber)
+	{
+		mFrameNumber = pFrameNumber;
+		const uint32_t maxAge = mEntries.size() > MAX_ENTRIES ? 1 : MAX_AGE;
+		for( auto e = mEntries.begin() ; e != mEntries.end() ; )
+		{
+			if( mFrameNumber - e->second.lastUsed > maxAge )
+			{
+				e = mEntries.erase(e);
+			}
+			else
+			{
+				++e;
+			}
+		}
+	}
+
+	size_t GetSize()const{return mEntries.size();}
+	uint32_t GetHits()const{return mHits;}
+	uint32_t GetMisses()const{return mMisses;}
+
+private:
+	std::unordered_map<Key,Entry,KeyHash> mEntries;
+	uint32_t mFrameNumber = 0;
+	uint32_t mHits = 0;
+	uint32_t mMisses = 0;
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+}//namespace eui{
+
+#endif //#ifndef GeometryCache_H__
@@ -3,32 +3,34 @@
 #include "GLDiagnostics.h"
 #include "GLShader.h"
 #include "GLTexture.h"
+#include "GLDrawList.h"
+#include "GLState.h"
+#include "GLTimerQueries.h"
+#include "GeometryCache.h"
+#include "TextureAtlas.h"
 #include "FreeTypeFont.h"
-#include "../TinyPNG.h"
-#include "../TinyTGA.h"
+#include "../ImageLoader.h"
+#include "../PixelKernels.h"
 
 #include <math.h>
+#include <string.h>
+#include <algorithm>
+#include <limits>
 #include <fstream>
 #include <iostream>
 
 
 namespace eui{
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////
-struct IMAGE_LOADER
-{
-	IMAGE_LOADER():png(false)
-	{
-
-	}
-	tinypng::Loader png;
-	tinytga::Loader tga;
-	std::vector<uint8_t> pixelBuffer;
-	std::vector<uint8_t> fileBuffer;
-};
-
 Graphics::Graphics()
 {
 	mImageLoader = std::make_unique<IMAGE_LOADER>();
+	mDrawList = std::make_unique<GLDrawList>();
+	mGLState = std::make_unique<GLState>();
+	mTextureAtlas = std::make_unique<TextureAtlas>();
+	mGeometryCache = std::make_unique<GeometryCache>();
+	mTimerQueries = std::make_unique<GLTimerQueries>();
+	InitRoundedRect();// Does not need GL, done here so the rounded rectangle functions work before InitialiseGL.
 }
 
 Graphics::~Graphics()
@@ -38,14 +40,17 @@ Graphics::~Graphics()
 	VERBOSE_MESSAGE("On exit the following scratch memory buffers reached the sizes of...");
 	VERBOSE_MESSAGE("    mWorkBuffers.vertices " << mWorkBuffers.vertices.MemoryUsed() << " bytes");
 	VERBOSE_MESSAGE("    mWorkBuffers.uvs " << mWorkBuffers.uvs.MemoryUsed() << " bytes");
+	VERBOSE_MESSAGE("    mDrawList->mVertices " << mDrawList->mVertices.MemoryUsed() << " bytes");
+	VERBOSE_MESSAGE("    mDrawList->mIndices " << mDrawList->mIndices.MemoryUsed() << " bytes");
+	VERBOSE_MESSAGE("Rounded rectangle cache hits " << mGeometryCache->GetHits() << " misses " << mGeometryCache->GetMisses());
 
-	glBindTexture(GL_TEXTURE_2D,0);
+	mGLState->BindTexture(0);
 	CHECK_OGL_ERRORS();
 
 	// Kill shaders.
 	VERBOSE_MESSAGE("Deleting shaders");
 
-	glUseProgram(0);
+	mGLState->UseProgram(0);
 	CHECK_OGL_ERRORS();
 
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER,0);
@@ -53,392 +58,119 @@ Graphics::~Graphics()
 	delete mShaders.ColourOnly;
 	delete mShaders.TextureColour;
 	delete mShaders.TextureAlphaOnly;
-	delete mShaders.RectangleBorder;
+	delete mShaders.Shape;
+	delete mShaders.TextDistanceField;
+	delete mShaders.TextureLayer;
+
+	// Layer textures are deleted with the rest below.
+	mLayers.layers.ForEach([](uint32_t pHandle,const LayerData::Layer& pLayer)
+	{
+		glDeleteFramebuffers(1,&pLayer.framebuffer);
+	});
+	mLayers.layers.Clear();
 
-	// delete all free type fonts.
-	mFreeTypeFonts.clear();
+	// delete all free type fonts, the distance field faces last as the sizes share them.
+	mFreeTypeFonts.Clear();
+	mDistanceFieldFaces.clear();
+	mGlyphRasterizer.reset();
 	if( mFreetype != nullptr )
 	{
-		if( FT_Done_FreeType(mFreetype) == FT_Err_Ok )
+		// Made with FT_New_Library, so FT_Done_FreeType would try to free our memory functions.
+		if( FT_Done_Library(mFreetype) == FT_Err_Ok )
 		{
 			mFreetype = nullptr;
+			mFreetypeMemory.reset();
 			VERBOSE_MESSAGE("Freetype font library deleted");
 		}
 	}
 
-	// delete all textures.
-	for( auto& t : mTextures )
-	{
-		glDeleteTextures(1,&t.first);
-		CHECK_OGL_ERRORS();
-	}
-
-	VERBOSE_MESSAGE("All done");
-}
-
-
-Rectangle Graphics::GetDisplayRect()const
-{
-    return Rectangle(0,0,GetDisplayWidth(),GetDisplayHeight());
-}
-
-int32_t Graphics::GetDisplayWidth()const
-{
-    return mReported.Width;
-}
-
-int32_t Graphics::GetDisplayHeight()const
-{
-    return mReported.Height;
-}
-
-void Graphics::GetRoundedRectanglePoints(const Rectangle& pRect,VertXY::Buffer& rBuffer,float pRadius)
-{
-	VertXY* verts = rBuffer.Restart(mRoundedRect.NUM_VERTICES);
-
-	float A = 0.0f;// This starts the circle at the top, so the first corner is the right top one.
-	const float AD = mRoundedRect.ANGLE_INC;
-
-	const float size = std::min(pRect.GetWidth()*pRadius,pRect.GetHeight()*pRadius);
-	for( int n = 0 ; n < mRoundedRect.NUM_POINTS_PER_CORNER ; n++, verts++, A += AD )
-	{
-		const float sA = sin(A);
-		const float cA = cos(A);
-
-		const float x = (1.0f - sA) * size;
-		const float y = (1.0f - cA) * size;
-
-		verts->x = pRect.right - x;
-		verts->y = pRect.top +   y;
-	}
-	A -= AD;
-
-	for( int n = 0 ; n < mRoundedRect.NUM_POINTS_PER_CORNER ; n++ , verts++, A += AD )
-	{
-		const float sA = sin(A);
-		const float cA = cos(A);
-
-		const float x = (1.0f - sA) * size;
-		const float y = (cA + 1.0f) * size;
-
-		verts->x = pRect.right -  x;
-		verts->y = pRect.bottom - y;
-	}
-	A -= AD;
-
-	for( int n = 0 ; n < mRoundedRect.NUM_POINTS_PER_CORNER ; n++ , verts++, A += AD )
-	{
-		const float sA = sin(A);
-		const float cA = cos(A);
-
-		const float x = (sA + 1.0f) * size;
-		const float y = (cA + 1.0f) * size;
-
-		verts->x = pRect.left +   x;
-		verts->y = pRect.bottom - y;
-	}
-	A -= AD;
-
-	for( int n = 0 ; n < mRoundedRect.NUM_POINTS_PER_CORNER ; n++ , verts++, A += AD )
-	{
-		const float sA = sin(A);
-		const float cA = cos(A);
-
-		const float x = (sA + 1.0f) * size;
-		const float y = (1.0f - cA) * size;
-
-		verts->x = pRect.left + x;
-		verts->y = pRect.top +  y;
-	}
-}
-
-void Graphics::GetRoundedRectangleBoarderPoints(const Rectangle& pRect,VertXY::Buffer& rBuffer,float pRadius,float pThickness)
-{
-	VertXY* verts = rBuffer.Restart(mRoundedRect.NUM_BOARDER_VERTICES);
-	VertXY* first = verts;
-
-	const float outerSize = std::min(pRect.GetWidth()*pRadius,pRect.GetHeight()*pRadius);
-
-	float A = 0.0f;// This starts the circle at the top, so the first corner is the right top one.
-	const float AD = GetRadian() / ((float)(mRoundedRect.NUM_POINTS_PER_CORNER-1) * mRoundedRect.NUM_QUADRANTS);
-
-	for( int n = 0 ; n < mRoundedRect.NUM_POINTS_PER_CORNER ; n++, verts += 2, A += AD )
-	{
-		const float sA = sin(A);
-		const float cA = cos(A);
-
-		const float x = (1.0f - sA) * outerSize;
-		const float y = (1.0f - cA) * outerSize;
-
-		verts[1].x = pRect.right - x;
-		verts[1].y = pRect.top +   y;
-
-		verts[0].x = verts[1].x - (sA * pThickness);
-		verts[0].y = verts[1].y + (cA * pThickness);
-	}
-	A -= AD;
-
-	for( int n = 0 ; n < mRoundedRect.NUM_POINTS_PER_CORNER ; n++ , verts += 2, A += AD )
-	{
-		const float sA = sin(A);
-		const float cA = cos(A);
-
-		const float x = (1.0f - sA) * outerSize;
-		const float y = (cA + 1.0f) * outerSize;
-
-		verts[1].x = pRect.right -  x;
-		verts[1].y = pRect.bottom - y;
-
-		verts[0].x = verts[1].x - (sA * pThickness);
-		verts[0].y = verts[1].y + (cA * pThickness);
-
-	}
-	A -= AD;
-
-	for( int n = 0 ; n < mRoundedRect.NUM_POINTS_PER_CORNER ; n++ , verts += 2, A += AD )
-	{
-		const float sA = sin(A);
-		const float cA = cos(A);
-
-		const float x = (sA + 1.0f) * outerSize;
-		const float y = (cA + 1.0f) * outerSize;
-
-		verts[1].x = pRect.left +   x;
-		verts[1].y = pRect.bottom - y;
-
-		verts[0].x = verts[1].x - (sA * pThickness);
-		verts[0].y = verts[1].y + (cA * pThickness);
-	}
-	A -= AD;
-
-	for( int n = 0 ; n < mRoundedRect.NUM_POINTS_PER_CORNER ; n++ , verts += 2, A += AD )
-	{
-		const float sA = sin(A);
-		const float cA = cos(A);
-
-		const float x = (sA + 1.0f) * outerSize;
-		const float y = (1.0f - cA) * outerSize;
-
-		verts[1].x = pRect.left + x;
-		verts[1].y = pRect.top +  y;
-
-		verts[0].x = verts[1].x - (sA * pThickness);
-		verts[0].y = verts[1].y + (cA * pThickness);
-	}
-
-	verts[0] = first[0];
-	verts[1] = first[1];
-}
-
-void Graphics::GetDisplayRotatedXY(float &x,float &y)const
-{
-	//GetDisplayWidth(),GetDisplayHeight()
-	if( mDisplayRotation == Graphics::ROTATE_FRAME_BUFFER_90 )
-	{
-		std::swap(x,y);
-		y = GetDisplayHeight() - y;
-	}
-	else if( mDisplayRotation == Graphics::ROTATE_FRAME_BUFFER_180 )
-	{
-		x = GetDisplayWidth() - x;
-		y = GetDisplayHeight() - y;
-	}
-	else if( mDisplayRotation == Graphics::ROTATE_FRAME_BUFFER_270 )
-	{
-		std::swap(x,y);
-		x = GetDisplayWidth() - x;
-	}
-	else// what ever the HW is with no rotation.
-	{
-	}
-
-}
-
-void Graphics::SetDisplayRotation(DisplayRotation pDisplayRotation)
-{
-	// They want portrait, if hardware display is landscape, rotate 90, else don't.
-	if( pDisplayRotation == ROTATE_FRAME_PORTRAIT )
-	{
-		mDisplayRotation = ROTATE_FRAME_BUFFER_0;// Assume is portrait by default.
-		if( mPhysical.Width > mPhysical.Height )
-		{
-			mDisplayRotation = ROTATE_FRAME_BUFFER_90;// hardware is landscape
-		}
-	}
-	else if( pDisplayRotation == ROTATE_FRAME_LANDSCAPE )
-	{
-		mDisplayRotation = ROTATE_FRAME_BUFFER_0; // Assume is landscape by default.
-		if( mPhysical.Width < mPhysical.Height )
-		{
-			mDisplayRotation = ROTATE_FRAME_BUFFER_90;// hardware is portrait
-		}
-	}
-	else
-	{
-		// Ok, they are forcing rotation.
-		mDisplayRotation = pDisplayRotation;
-	}
-
-	if( GetIsPortrait() )
-	{
-		mReported.Width = mPhysical.Height;
-		mReported.Height = mPhysical.Width;
-	}
-	else
-	{
-		mReported.Width = mPhysical.Width;
-		mReported.Height = mPhysical.Height;
-	}
-
-    SetProjection2D();
-
-}
-
-uint32_t Graphics::FontLoad(const std::string& pFontName,int pPixelHeight)
-{
-	VERBOSE_MESSAGE("Loading font -> " << pFontName);
-
-	// Check it's not already loaded at this size.
-	// "slow" search but you should not be loading fonts every frame or loading that many!
-	const std::string id = pFontName + ":" + std::to_string(pPixelHeight);
-	for(auto &f : mFreeTypeFonts )
+	// Images still loading are not wanted now, the workers skip them.
+	for( auto& load : mTextureLoads.pending )
 	{
-		if( f.second->mID == id )
-		{
-			return f.first;
-		}
+		load.job->cancelled = true;
 	}
+	mImageDecoder.reset();
 
-	FT_Face loadedFace;
-	if( FT_New_Face(mFreetype,pFontName.c_str(),0,&loadedFace) != 0 )
+	// delete all textures. Images in the texture atlas share the GL texture of their page, so are skipped, as are placeholders.
+	mTextures.ForEach([](uint32_t pHandle,const GLTexture& pTexture)
 	{
-		std::cerr << "Failed to load true type font " << pFontName << "\n";
-		THROW_MEANINGFUL_EXCEPTION("Failed to load true type font " + pFontName);
-	}
-
-	const uint32_t fontID = mNextFreeTypeFontsId++;
-
-	mFreeTypeFonts[fontID] = std::make_unique<FreeTypeFont>(id,loadedFace,pPixelHeight);
-	auto& font = mFreeTypeFonts.at(fontID);
-
-	font->BuildTexture(
-		mMaximumAllowedGlyph,
-		[this](int pWidth,int pHeight)
+		if( pTexture.mAtlasImage == 0 && pTexture.mPlaceholder == false )
 		{
-			// Because the glyph rending to texture does not fill the whole texture the GL texture will not be created.
-			// Do I have to make a big memory buffer, fill it with zero, then free the memory.
-			auto zeroMemory = std::make_unique<uint8_t[]>(pWidth * pHeight);
-			memset(zeroMemory.get(),0,pWidth * pHeight);
-
-			return TextureCreate(pWidth,pHeight,zeroMemory.get(),TextureFormat::FORMAT_ALPHA);			
-		},
-		[this](uint32_t pTexture,int pX,int pY,int pWidth,int pHeight,const uint8_t* pPixels)
-		{
-			TextureFill(pTexture,pX,pY,pWidth,pHeight,pPixels,TextureFormat::FORMAT_ALPHA);
+			glDeleteTextures(1,&pTexture.mGLTexture);
+			CHECK_OGL_ERRORS();
 		}
-	);
+	});
+	mTextures.Clear();
 
-	VERBOSE_MESSAGE("Free type font loaded: " << fontID << " with internal ID of " << id << " Using texture " << font->mTexture);
-	return fontID;
+	VERBOSE_MESSAGE("All done");
 }
 
 
-void Graphics::FontDelete(const uint32_t pFont)
-{
-	// Make sure it's in our list before we try to delete.
-	auto found = mFreeTypeFonts.find(pFont);
-	if( found != mFreeTypeFonts.end() )
-	{
-		mFreeTypeFonts.erase(pFont);
-	}
-	else
-	{
-		VERBOSE_MESSAGE("Tried to delete font that is not loaded." << pFont);
-	}
-}
 
 void Graphics::FontPrint(const uint32_t pID,float pX,float pY,Colour pColour,const std::string_view& pText)
 {
-	auto& font = mFreeTypeFonts.at(pID);
+	FreeTypeFont& font = mFreeTypeFonts.Get(pID);
 	
 	mWorkBuffers.vertices.Restart();
 	mWorkBuffers.uvs.Restart();
+	mWorkBuffers.glyphTextures.clear();
 
-	// Get where the uvs will be written too.
-	const char* ptr = pText.data();
-
-	font->BuildQuads(ptr,pX,pY,mWorkBuffers.vertices,mWorkBuffers.uvs);
-
-	assert(font->mTexture);
-	EnableShader(mShaders.TextureAlphaOnly);
-
-	mShaders.CurrentShader->SetTexture(font->mTexture);
-	mShaders.CurrentShader->SetGlobalColour(pColour);
-
-	// how many?
-	const int numVerts = mWorkBuffers.vertices.Used();
+	font.BuildQuads(pText,pX,pY,mWorkBuffers.vertices,mWorkBuffers.uvs,mWorkBuffers.glyphTextures);
 
-	glVertexAttribPointer(
-				(GLuint)StreamIndex::TEXCOORD,
-				2,
-				GL_FLOAT,
-				GL_TRUE,
-				8,mWorkBuffers.uvs.Data());
-
-	VertexPtr(2,GL_FLOAT,mWorkBuffers.vertices.Data());
-	glDrawArrays(GL_TRIANGLES,0,numVerts);
-	CHECK_OGL_ERRORS();
+	DrawGlyphs(font,mWorkBuffers.glyphTextures.data(),mWorkBuffers.vertices.Data(),mWorkBuffers.uvs.Data(),mWorkBuffers.vertices.Used(),pColour);
 }
 
-void Graphics::FontPrintf(const uint32_t pID,float pX,float pY,Colour pColour,const char* pFmt,...)
+void Graphics::TextDraw(const TextRunData::TextRun& pRun,Colour pColour)
 {
-	char buf[1024];
-	va_list args;
-	va_start(args, pFmt);
-	vsnprintf(buf, sizeof(buf), pFmt, args);
-	va_end(args);
-	FontPrint(pID,pX,pY,pColour, buf);
+	DrawGlyphs(mFreeTypeFonts.Get(pRun.font),pRun.textures.data(),pRun.vertices.data(),pRun.uvs.data(),pRun.vertices.size(),pColour);
 }
 
-void Graphics::FontPrint(const uint32_t pID,const Rectangle& pRect,const Alignment pAlignment,Colour pColour,const std::string_view& pText)
+void Graphics::DrawGlyphs(const FreeTypeFont& pFont,const uint32_t* pTextures,const VertXY* pVerts,const VertXY* pUVs,size_t pNumVerts,Colour pColour)
 {
-	// First we need to get the rect of the text to be rendered.
-	const Rectangle fontRect = FontGetRect(pID,pText);
-
-	const Alignment AX = GET_X_ALIGNMENT(pAlignment);
-	const Alignment AY = GET_Y_ALIGNMENT(pAlignment);
-
-	float X = pRect.left - fontRect.left;
-	if( AX == ALIGN_CENTER )
-	{
-		X += (pRect.GetWidth() * 0.5f) - (fontRect.GetWidth() * 0.5f);
-	}
-	else if( AX == ALIGN_MAX_EDGE )
-	{
-		X += pRect.GetWidth() - fontRect.GetWidth();
+	if( pFont.mDistanceField )
+	{// The shadow goes under the text, it is the same quads moved and softened.
+		const float scale = 2.0f * FreeTypeFont::DISTANCE_FIELD_SPREAD * pFont.mScale;
+		const auto& effects = pFont.mEffects;
+		const float outline = GetAlpha(effects.outlineColour) > 0 ? std::min(effects.outlineWidth,FreeTypeFont::DISTANCE_FIELD_SPREAD * pFont.mScale) : 0.0f;
+		if( GetAlpha(effects.shadowColour) > 0 )
+		{
+			AddDistanceFieldGlyphs(pTextures,pVerts,pUVs,pNumVerts,effects.shadowX,effects.shadowY,scale,outline,1.0f + effects.shadowSoftness,effects.shadowColour,effects.shadowColour);
+		}
+		AddDistanceFieldGlyphs(pTextures,pVerts,pUVs,pNumVerts,0.0f,0.0f,scale,outline,1.0f,pColour,effects.outlineColour);
+		return;
 	}
 
-	float Y = pRect.top - fontRect.top;
-	if( AY == ALIGN_CENTER )
-	{
-		Y += (pRect.GetHeight() * 0.5f) - (fontRect.GetHeight() * 0.5f);
-	}
-	else if( AY == ALIGN_MAX_EDGE )
+	// Glyphs that are next to each other in the same page go in one primitive, that is all of them unless the cache has grown.
+	const size_t numGlyphs = pNumVerts / 6;
+	size_t first = 0;
+	for( size_t n = 1 ; n <= numGlyphs ; n++ )
 	{
-		Y += pRect.GetHeight() - fontRect.GetHeight();
+		if( n == numGlyphs || pTextures[n] != pTextures[first] )
+		{
+			assert(pTextures[first]);
+			AddPrimitive(Topology::TRIANGLES,mShaders.TextureAlphaOnly,pTextures[first],pVerts + (first * 6),pUVs + (first * 6),(n - first) * 6,pColour);
+			first = n;
+		}
 	}
-
-	FontPrint(pID,X,Y,pColour,pText);
-}
-
-Rectangle Graphics::FontGetRect(const uint32_t pID,const std::string_view& pText)const
-{
-	auto& font = mFreeTypeFonts.at(pID);
-	return font->GetRect(pText);
 }
 
 void Graphics::DrawRectangle(const Rectangle& pRect,Colour pColour,Colour pBorder,float pRadius,float pThickness,uint32_t pTexture,BoarderStyle pBoarderStyle)
 {
+	if( mShapeRendering == ShapeRendering::SIGNED_DISTANCE_FIELD && pTexture == 0 )
+	{// The fill and the boarder are one quad.
+		const float thickness = pBorder != COLOUR_NONE ? pThickness : 0.0f;
+		if( pColour != COLOUR_NONE || thickness > 0.0f )
+		{
+			AddShape(
+				pRect.GetCenterX(),pRect.GetCenterY(),
+				1.0f,0.0f,
+				pRect.GetWidth() * 0.5f,pRect.GetHeight() * 0.5f,
+				pRect.GetMinSize() * pRadius,
+				thickness,
+				pColour,pBorder,pBoarderStyle);
+		}
+		return;
+	}
 
 	if( pTexture )
 	{
@@ -448,55 +180,24 @@ void Graphics::DrawRectangle(const Rectangle& pRect,Colour pColour,Colour pBorde
 		}
 		else
 		{
-			EnableShader(mShaders.TextureColour);
-			mShaders.CurrentShader->SetGlobalColour(pColour);
-			mShaders.CurrentShader->SetTexture(pTexture);
 			SetTextureTransformIdentity();
 
-			GetRoundedRectanglePoints(pRect,mWorkBuffers.vertices,pRadius);
-			const Rectangle uv = {0,0,1,1};
-			GetRoundedRectanglePoints(uv,mWorkBuffers.uvs,pRadius);
-
-			VertexPtr(2,GL_FLOAT,mWorkBuffers.vertices.Data());
-
-			glVertexAttribPointer(
-				(GLuint)StreamIndex::TEXCOORD,
-				2,
-				GL_FLOAT,
-				GL_FALSE,
-				0,mWorkBuffers.uvs.Data());
-
-			glDrawArrays(GL_TRIANGLE_FAN,0,mWorkBuffers.vertices.Used());
-			CHECK_OGL_ERRORS();
-
+			const std::vector<VertXY>& points = GetRoundedRectangleCached(pRect,pRadius);
+			const std::vector<VertXY>& uvs = GetRoundedRectangleUVsCached(pRect,pRadius);
+			AddPrimitive(Topology::TRIANGLE_FAN,mShaders.TextureColour,pTexture,points.data(),uvs.data(),points.size(),pColour);
 		}
 	}
 	else if( pColour != COLOUR_NONE )
 	{
 		if( pRadius )
 		{
-			GetRoundedRectanglePoints(pRect,mWorkBuffers.vertices,pRadius);
-
-			const int numPoints = mWorkBuffers.vertices.Used();
-			const VertXY* points = mWorkBuffers.vertices.Data();
-
-			EnableShader(mShaders.ColourOnly);
-			mShaders.CurrentShader->SetGlobalColour(pColour);
-
-			VertexPtr(2,GL_FLOAT,points);
-			glDrawArrays(GL_TRIANGLE_FAN,0,numPoints);
-			CHECK_OGL_ERRORS();
+			const std::vector<VertXY>& points = GetRoundedRectangleCached(pRect,pRadius);
+			AddPrimitive(Topology::TRIANGLE_FAN,mShaders.ColourOnly,0,points.data(),nullptr,points.size(),pColour);
 		}
 		else
 		{
-			float quad[8];    
-			pRect.GetQuad(quad);
-
-			EnableShader(mShaders.ColourOnly);
-			mShaders.CurrentShader->SetGlobalColour(pColour);
-			VertexPtr(2,GL_FLOAT,quad);
-			glDrawArrays(GL_TRIANGLE_FAN,0,4);
-			CHECK_OGL_ERRORS();
+			const VertXY quad[4] = {{pRect.left,pRect.top},{pRect.right,pRect.top},{pRect.right,pRect.bottom},{pRect.left,pRect.bottom}};
+			AddPrimitive(Topology::TRIANGLE_FAN,mShaders.ColourOnly,0,quad,nullptr,4,pColour);
 		}
 	}
 
@@ -505,152 +206,135 @@ void Graphics::DrawRectangle(const Rectangle& pRect,Colour pColour,Colour pBorde
 	{
 		if( pRadius )
 		{
-			GLenum primType = GL_LINE_LOOP;
-			if( pThickness == 1 )
-			{
-				GetRoundedRectanglePoints(pRect,mWorkBuffers.vertices,pRadius);
-			}
-			else
-			{
-				GetRoundedRectangleBoarderPoints(pRect,mWorkBuffers.vertices,pRadius,pThickness);
-				primType = GL_TRIANGLE_STRIP;
-			}
-
-			const int numPoints = mWorkBuffers.vertices.Used();
-			const VertXY* points = mWorkBuffers.vertices.Data();
+			const Topology topology = pThickness == 1 ? Topology::LINE_LOOP : Topology::TRIANGLE_STRIP;
+			const std::vector<VertXY>& points = pThickness == 1 ? GetRoundedRectangleCached(pRect,pRadius) : GetRoundedRectangleBoarderCached(pRect,pRadius,pThickness);
 
-			EnableShader(mShaders.RectangleBorder);
-			mShaders.CurrentShader->SetGlobalColour(pBorder);
-			VertexPtr(2,GL_FLOAT,points);
-
-			const void* colours = mRoundedRect.BoarderWhite.data();
+			// The colours have to match the number of points used for the corners.
+			const auto& level = mRoundedRect.GetLevel(std::min(pRect.GetWidth()*pRadius,pRect.GetHeight()*pRadius));
+			const Colour* colours = level.BoarderWhite.data();
 			switch (pBoarderStyle)
 			{
 			case BS_SOLID:
 				break;
 			
 			case BS_RAISED:
-				colours = mRoundedRect.BoarderRaised.data();
+				colours = level.BoarderRaised.data();
 				break;
 
 			case BS_DEPRESSED:
-				colours = mRoundedRect.BoarderDepressed.data();
+				colours = level.BoarderDepressed.data();
 				break;
 			}
 
-			glVertexAttribPointer(
-						(GLuint)StreamIndex::COLOUR,
-						4,
-						GL_UNSIGNED_BYTE,
-						GL_TRUE,
-						0,colours);
-			CHECK_OGL_ERRORS();
-
-			glDrawArrays(primType,0,numPoints);
-			CHECK_OGL_ERRORS();
-
+			AddPrimitive(topology,mShaders.ColourOnly,0,points.data(),nullptr,points.size(),pBorder,colours);
 		}
 		else
 		{
-			float quad[8];    
-			pRect.GetQuad(quad);
-
-			EnableShader(mShaders.ColourOnly);
-			mShaders.CurrentShader->SetGlobalColour(pColour);
-			VertexPtr(2,GL_FLOAT,quad);
-
 			if( pThickness == 1 )
 			{
-				mShaders.CurrentShader->SetGlobalColour(pBorder);
-				glDrawArrays(GL_LINE_LOOP,0,4);
-				CHECK_OGL_ERRORS();
+				const VertXY quad[4] = {{pRect.left,pRect.top},{pRect.right,pRect.top},{pRect.right,pRect.bottom},{pRect.left,pRect.bottom}};
+				AddPrimitive(Topology::LINE_LOOP,mShaders.ColourOnly,0,quad,nullptr,4,pBorder);
 			}
 			else
-			{
-
+			{// Four sides, the corners are mitred so the light and dark colours of the style meet on the diagonal.
+				const float t = std::min(pThickness,pRect.GetMinSize() * 0.5f);
+				const VertXY outer[4] = {{pRect.left,pRect.top},{pRect.right,pRect.top},{pRect.right,pRect.bottom},{pRect.left,pRect.bottom}};
+				const VertXY inner[4] = {{pRect.left+t,pRect.top+t},{pRect.right-t,pRect.top+t},{pRect.right-t,pRect.bottom-t},{pRect.left+t,pRect.bottom-t}};
+
+				Colour light[2] = {COLOUR_WHITE,COLOUR_WHITE};	// Outer, inner.
+				Colour dark[2] = {COLOUR_WHITE,COLOUR_WHITE};
+				if( pBoarderStyle == BS_RAISED )
+				{
+					light[0] = COLOUR_WHITE;	light[1] = COLOUR_LIGHT_GREY;
+					dark[0] = COLOUR_DARK_GREY;	dark[1] = COLOUR_BLACK;
+				}
+				else if( pBoarderStyle == BS_DEPRESSED )
+				{
+					light[0] = COLOUR_DARK_GREY;	light[1] = COLOUR_BLACK;
+					dark[0] = COLOUR_WHITE;		dark[1] = COLOUR_LIGHT_GREY;
+				}
+
+				VertXY points[24];
+				Colour colours[24];
+				for( int side = 0 ; side < 4 ; side++ )
+				{// Top, right, bottom then left. Top and left are the light ones.
+					const int a = side;
+					const int b = (side + 1) % 4;
+					const VertXY quad[4] = {outer[a],outer[b],inner[b],inner[a]};
+					const Colour* c = (side == 0 || side == 3) ? light : dark;
+					const int order[6] = {0,1,2,0,2,3};
+					for( int n = 0 ; n < 6 ; n++ )
+					{
+						points[side*6 + n] = quad[order[n]];
+						colours[side*6 + n] = c[order[n] < 2 ? 0 : 1];
+					}
+				}
+				AddPrimitive(Topology::TRIANGLES,mShaders.ColourOnly,0,points,nullptr,24,pBorder,colours);
 			}
 		}
 	}
 
 	if( false )
 	{
-		float quad[8];    
-		pRect.GetQuad(quad);
-
-		EnableShader(mShaders.ColourOnly);
-		mShaders.CurrentShader->SetGlobalColour(MakeColour(255,0,255));
-		VertexPtr(2,GL_FLOAT,quad);
-		glDrawArrays(GL_LINE_LOOP,0,4);
-		CHECK_OGL_ERRORS();
+		const VertXY quad[4] = {{pRect.left,pRect.top},{pRect.right,pRect.top},{pRect.right,pRect.bottom},{pRect.left,pRect.bottom}};
+		AddPrimitive(Topology::LINE_LOOP,mShaders.ColourOnly,0,quad,nullptr,4,MakeColour(255,0,255));
 	}
 }
 
-void Graphics::DrawTick(const Rectangle& pRect,Colour pColour,float pThickness)
+const std::vector<VertXY>& Graphics::GetRoundedRectangleCached(const Rectangle& pRect,float pRadius)
+{
+	return mGeometryCache->Get(GeometryCache::MakeKey(GeometryCache::SHAPE_ROUNDED_RECTANGLE,pRect,pRadius),[&](std::vector<VertXY>& rPoints)
+	{
+		GetRoundedRectanglePoints(pRect,mWorkBuffers.vertices,pRadius);
+		rPoints.assign(mWorkBuffers.vertices.Data(),mWorkBuffers.vertices.Data() + mWorkBuffers.vertices.Used());
+	});
+}
+
+const std::vector<VertXY>& Graphics::GetRoundedRectangleUVsCached(const Rectangle& pRect,float pRadius)
+{
+	return mGeometryCache->Get(GeometryCache::MakeKey(GeometryCache::SHAPE_ROUNDED_RECTANGLE_UVS,pRect,pRadius),[&](std::vector<VertXY>& rUVs)
+	{
+		// Worked out from the points so the number of them, which depends on the size of the corners, matches.
+		const std::vector<VertXY>& points = GetRoundedRectangleCached(pRect,pRadius);
+		const float scaleU = 1.0f / pRect.GetWidth();
+		const float scaleV = 1.0f / pRect.GetHeight();
+		rUVs.resize(points.size());
+		for( size_t n = 0 ; n < points.size() ; n++ )
+		{
+			rUVs[n].x = (points[n].x - pRect.left) * scaleU;
+			rUVs[n].y = (points[n].y - pRect.top) * scaleV;
+		}
+	});
+}
+
+const std::vector<VertXY>& Graphics::GetRoundedRectangleBoarderCached(const Rectangle& pRect,float pRadius,float pThickness)
 {
-	Rectangle r = pRect.GetScaled(0.6f);
-	const float step = r.GetMinSize() * 0.25;
-
-	DrawLine(
-		r.left,
-		r.GetCenterY(),
-		r.left + step,
-		r.GetCenterY() + step,
-		pColour,
-		pThickness
-	);
-
-	DrawLine(
-		r.left + step,
-		r.GetCenterY() + step,
-		r.right,
-		r.top,
-		pColour,
-		pThickness
-	);
+	return mGeometryCache->Get(GeometryCache::MakeKey(GeometryCache::SHAPE_ROUNDED_BOARDER,pRect,pRadius,pThickness),[&](std::vector<VertXY>& rPoints)
+	{
+		GetRoundedRectangleBoarderPoints(pRect,mWorkBuffers.vertices,pRadius,pThickness);
+		rPoints.assign(mWorkBuffers.vertices.Data(),mWorkBuffers.vertices.Data() + mWorkBuffers.vertices.Used());
+	});
 }
 
 void Graphics::DrawTexture(const Rectangle& pRect,uint32_t pTexture,Colour pColour)
 {
-	const float uv[8] = {0,0,1,0,1,1,0,1};
-	float quad[8];
-	
-	pRect.GetQuad(quad);
+	const VertXY uv[4] = {{0,0},{1,0},{1,1},{0,1}};
+	const VertXY quad[4] = {{pRect.left,pRect.top},{pRect.right,pRect.top},{pRect.right,pRect.bottom},{pRect.left,pRect.bottom}};
 
 	if( pColour == COLOUR_NONE )
 	{
 		pColour = COLOUR_WHITE;
 	}
 
-	EnableShader(mShaders.TextureColour);
-
-	mShaders.CurrentShader->SetGlobalColour(pColour);
-	mShaders.CurrentShader->SetTexture(pTexture);
-
-	glVertexAttribPointer(
-				(GLuint)StreamIndex::TEXCOORD,
-				2,
-				GL_FLOAT,
-				GL_FALSE,
-				0,uv);
-	CHECK_OGL_ERRORS();
-
-	VertexPtr(2,GL_FLOAT,quad);
-	glDrawArrays(GL_TRIANGLE_FAN,0,4);
-	CHECK_OGL_ERRORS();	
+	AddPrimitive(Topology::TRIANGLE_FAN,mShaders.TextureColour,pTexture,quad,uv,4,pColour);
 }
 
 void Graphics::DrawLine(float pFromX,float pFromY,float pToX,float pToY,Colour pColour,float pWidth)
 {
 	if( pWidth < 2 )
 	{
-		const float quad[4] = {pFromX,pFromY,pToX,pToY};
-
-		EnableShader(mShaders.ColourOnly);
-		mShaders.CurrentShader->SetGlobalColour(pColour);
-
-		VertexPtr(2,GL_FLOAT,quad);
-		glDrawArrays(GL_LINES,0,2);
-		CHECK_OGL_ERRORS();
+		const VertXY line[2] = {{pFromX,pFromY},{pToX,pToY}};
+		AddPrimitive(Topology::LINES,mShaders.ColourOnly,0,line,nullptr,2,pColour);
 	}
 	else
 	{
@@ -704,93 +388,44 @@ void Graphics::DrawLine(float pFromX,float pFromY,float pToX,float pToY,Colour p
 			p[5].y = pToY - pWidth;			
 		}
 
-		EnableShader(mShaders.ColourOnly);
-		mShaders.CurrentShader->SetGlobalColour(pColour);
-
-		VertexPtr(2,GL_FLOAT,p);
-		glDrawArrays(GL_TRIANGLE_FAN,0,6);
-		CHECK_OGL_ERRORS();
+		AddPrimitive(Topology::TRIANGLE_FAN,mShaders.ColourOnly,0,p,nullptr,6,pColour);
 	}
 }
 
 void Graphics::DrawRoundedLine(float pFromX,float pFromY,float pToX,float pToY,Colour pColour,float pWidth)
 {
-//	VertXY* verts = rBuffer.Restart(mRoundedRect.NUM_VERTICES);
-//
-//	float A = 0.0f;// This starts the circle at the top, so the first corner is the right top one.
-//	const float AD = mRoundedRect.ANGLE_INC;
-//
-//	const float size = pWidth;
-//	for( int n = 0 ; n < mRoundedRect.NUM_POINTS_PER_CORNER ; n++, verts++, A += AD )
-//	{
-//		const float sA = sin(A);
-//		const float cA = cos(A);
-//
-//		const float x = (1.0f - sA) * size;
-//		const float y = (1.0f - cA) * size;
-//
-//		verts->x = pRect.right - x;
-//		verts->y = pRect.top +   y;
-//	}
-//	A -= AD;
-//
-}
-
-uint32_t Graphics::TextureLoad(const std::string& pFilename,bool pFiltered,bool pGenerateMipmaps)
-{
-    std::ifstream InputFile(pFilename,std::ifstream::binary);
-    if( !InputFile )
-    {
-		VERBOSE_MESSAGE("Failed to load PNG " << pFilename);
-		return TextureGetDiagnostics();
-	}
-
-	InputFile.seekg (0, InputFile.end);
-	const size_t fileSize = InputFile.tellg();
-	InputFile.seekg (0, InputFile.beg);
-
-	mImageLoader->fileBuffer.resize(fileSize);
-	std::vector<uint8_t> buffer(fileSize);
-
-	InputFile.read((char*)mImageLoader->fileBuffer.data(),fileSize);
-	if( !InputFile )
-	{
-		VERBOSE_MESSAGE("Failed to load PNG, could read all the data for file ");
-		return TextureGetDiagnostics();
-	}
-
-
-    if( mImageLoader->png.LoadFromMemory(mImageLoader->fileBuffer) )
-    {
-		if( mImageLoader->png.GetHasAlpha() )
-        {
-            mImageLoader->png.GetRGBA(mImageLoader->pixelBuffer);
-            return TextureCreate(mImageLoader->png.GetWidth(),mImageLoader->png.GetHeight(),mImageLoader->pixelBuffer.data(),TextureFormat::FORMAT_RGBA,pFiltered,pGenerateMipmaps);
-        }
-        else
-        {
-            mImageLoader->png.GetRGB(mImageLoader->pixelBuffer);
-            return TextureCreate(mImageLoader->png.GetWidth(),mImageLoader->png.GetHeight(),mImageLoader->pixelBuffer.data(),TextureFormat::FORMAT_RGB,pFiltered,pGenerateMipmaps);
-        }
-    }
-	else if( mImageLoader->tga.LoadFromMemory(mImageLoader->fileBuffer) )
-	{ 
-		if( mImageLoader->tga.GetHasAlpha() )
-        {
-            mImageLoader->tga.GetRGBA(mImageLoader->pixelBuffer);
-            return TextureCreate(mImageLoader->tga.GetWidth(),mImageLoader->tga.GetHeight(),mImageLoader->pixelBuffer.data(),TextureFormat::FORMAT_RGBA,pFiltered,pGenerateMipmaps);
-        }
-        else
-        {
-            mImageLoader->tga.GetRGB(mImageLoader->pixelBuffer);
-            return TextureCreate(mImageLoader->tga.GetWidth(),mImageLoader->tga.GetHeight(),mImageLoader->pixelBuffer.data(),TextureFormat::FORMAT_RGB,pFiltered,pGenerateMipmaps);
-        }
-	}
-
-	return TextureGetDiagnostics();
+	// Work out the line's own axis, the shape is built along it and then rotated into place.
+	const float dx = pToX - pFromX;
+	const float dy = pToY - pFromY;
+	const float length = std::sqrt((dx*dx) + (dy*dy));
+	const float axisX = length > 0.0f ? dx / length : 1.0f;
+	const float axisY = length > 0.0f ? dy / length : 0.0f;
+	const float halfWidth = (length + pWidth) * 0.5f;
+	const float halfHeight = pWidth * 0.5f;
+	const float centreX = (pFromX + pToX) * 0.5f;
+	const float centreY = (pFromY + pToY) * 0.5f;
+
+	if( mShapeRendering == ShapeRendering::SIGNED_DISTANCE_FIELD )
+	{
+		AddShape(centreX,centreY,axisX,axisY,halfWidth,halfHeight,halfHeight,0.0f,pColour,COLOUR_NONE,BS_SOLID);
+		return;
+	}
+
+	// A rounded rectangle with the radius half the width is a capsule.
+	// The uvs work buffer is not used for this, so the rotated points go in there.
+	GetRoundedRectanglePoints(Rectangle(-halfWidth,-halfHeight,halfWidth,halfHeight),mWorkBuffers.vertices,0.5f);
+	const size_t count = mWorkBuffers.vertices.Used();
+	const VertXY* local = mWorkBuffers.vertices.Data();
+	VertXY* verts = mWorkBuffers.uvs.Restart(count);
+	for( size_t n = 0 ; n < count ; n++ )
+	{
+		verts[n].x = centreX + (local[n].x * axisX) - (local[n].y * axisY);
+		verts[n].y = centreY + (local[n].x * axisY) + (local[n].y * axisX);
+	}
+	AddPrimitive(Topology::TRIANGLE_FAN,mShaders.ColourOnly,0,verts,nullptr,count,pColour);
 }
 
-uint32_t Graphics::TextureCreate(int pWidth,int pHeight,const uint8_t* pPixels,TextureFormat pFormat,bool pFiltered,bool pGenerateMipmaps)
+uint32_t Graphics::TextureCreate(int pWidth,int pHeight,const uint8_t* pPixels,TextureFormat pFormat,bool pFiltered,bool pGenerateMipmaps,bool pUseAtlas)
 {
 	const GLint format = TextureFormatToGLFormat(pFormat);
 	if( format == GL_INVALID_ENUM )
@@ -798,6 +433,38 @@ uint32_t Graphics::TextureCreate(int pWidth,int pHeight,const uint8_t* pPixels,T
 		THROW_MEANINGFUL_EXCEPTION("TextureCreate passed an unknown texture format, I can not continue.");
 	}
 
+	if( pUseAtlas && pGenerateMipmaps == false && TextureAtlas::GetWillFit(pWidth,pHeight) )
+	{
+		const uint32_t atlasImage = mTextureAtlas->Add(pWidth,pHeight,pFiltered,[this](bool pPageFiltered)
+		{
+			const uint32_t page = TextureCreate(TextureAtlas::PAGE_SIZE,TextureAtlas::PAGE_SIZE,nullptr,TextureFormat::FORMAT_RGBA,pPageFiltered,false);
+
+			// TextureCreate only sets the filtering when it is given pixels, pages are filled an image at a time.
+			const GLint filter = pPageFiltered ? GL_LINEAR : GL_NEAREST;
+			mGLState->BindTexture(mTextures.Get(page).mGLTexture);
+			glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_MIN_FILTER,filter);
+			glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_MAG_FILTER,filter);
+			CHECK_OGL_ERRORS();
+			return page;
+		});
+
+		// The image gets a handle like any other texture, but uses the page's GL texture.
+		const TextureAtlas::Image& image = mTextureAtlas->GetImage(atlasImage);
+		auto texture = std::make_unique<GLTexture>(mTextures.Get(mTextureAtlas->GetPageTexture(image)).mGLTexture,pFormat,pWidth,pHeight);
+		texture->mAtlasImage = atlasImage;
+		texture->mU0 = image.u0;
+		texture->mV0 = image.v0;
+		texture->mU1 = image.u1;
+		texture->mV1 = image.v1;
+		const uint32_t handle = mTextures.Add(std::move(texture));
+
+		if( pPixels != nullptr )
+		{
+			TextureFill(handle,0,0,pWidth,pHeight,pPixels,pFormat);
+		}
+		return handle;
+	}
+
 	GLuint newTexture;
 	glGenTextures(1,&newTexture);
 	CHECK_OGL_ERRORS();
@@ -806,14 +473,9 @@ uint32_t Graphics::TextureCreate(int pWidth,int pHeight,const uint8_t* pPixels,T
 		THROW_MEANINGFUL_EXCEPTION("Failed to create texture, glGenTextures returned zero");
 	}
 
-	if( mTextures.find(newTexture) != mTextures.end() )
-	{
-		THROW_MEANINGFUL_EXCEPTION("Bug found in GLES code, glGenTextures returned an index that we already know about.");
-	}
-
-	mTextures[newTexture] = std::make_unique<GLTexture>(pFormat,pWidth,pHeight);
+	const uint32_t handle = mTextures.Add(std::make_unique<GLTexture>(newTexture,pFormat,pWidth,pHeight));
 
-	glBindTexture(GL_TEXTURE_2D,newTexture);
+	mGLState->BindTexture(newTexture);
 	CHECK_OGL_ERRORS();
 
 	glTexImage2D(
@@ -828,6 +490,10 @@ uint32_t Graphics::TextureCreate(int pWidth,int pHeight,const uint8_t* pPixels,T
 		pPixels);
 
 	CHECK_OGL_ERRORS();
+	if( pPixels != nullptr )
+	{
+		CountTextureUpload(pWidth,pHeight,pFormat);
+	}
 
 	// Unlike GLES 1.1 this is called after texture creation, in GLES 1.1 you say that you want glTexImage2D to make the mips.
 	// Don't call if we don't yet have pixels. Will be called when you fill the texture.
@@ -878,19 +544,27 @@ uint32_t Graphics::TextureCreate(int pWidth,int pHeight,const uint8_t* pPixels,T
 	CHECK_OGL_ERRORS();
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-
-	glBindTexture(GL_TEXTURE_2D,0);//Because we had to change it to setup the texture! Stupid GL!
 	CHECK_OGL_ERRORS();
 
-	VERBOSE_MESSAGE("Texture " << newTexture << " created, " << pWidth << "x" << pHeight << " Format = " << TextureFormatToString(pFormat) << " Mipmaps = " << (pGenerateMipmaps?"true":"false") << " Filtered = " << (pFiltered?"true":"false"));
+	VERBOSE_MESSAGE("Texture " << handle << " GL texture " << newTexture << " created, " << pWidth << "x" << pHeight << " Format = " << TextureFormatToString(pFormat) << " Mipmaps = " << (pGenerateMipmaps?"true":"false") << " Filtered = " << (pFiltered?"true":"false"));
 
 
-	return newTexture;
+	return handle;
 }
 
 void Graphics::TextureFill(uint32_t pTexture,int pX,int pY,int pWidth,int pHeight,const uint8_t* pPixels,TextureFormat pFormat,bool pGenerateMips)
 {
-	glBindTexture(GL_TEXTURE_2D,pTexture);
+	// Anything already drawn with this texture has to see the old pixels.
+	FlushDrawList();
+
+	const GLTexture& texture = mTextures.Get(pTexture);
+	if( texture.mAtlasImage )
+	{
+		TextureAtlasFill(texture,pX,pY,pWidth,pHeight,pPixels,pFormat);
+		return;
+	}
+
+	mGLState->BindTexture(texture.mGLTexture);
 
 	const GLint format = TextureFormatToGLFormat(pFormat);
 	if( format == GL_INVALID_ENUM )
@@ -904,13 +578,12 @@ void Graphics::TextureFill(uint32_t pTexture,int pX,int pY,int pWidth,int pHeigh
 		pWidth,pHeight,
 		format,GL_UNSIGNED_BYTE,
 		pPixels);
+	CountTextureUpload(pWidth,pHeight,pFormat);
 
 	if( pGenerateMips )
 	{
 		glGenerateMipmap(GL_TEXTURE_2D);
 	}
-
-	glBindTexture(GL_TEXTURE_2D,0);//Because we had to change it to setup the texture! Stupid GL!
 }
 
 void Graphics::TextureDelete(uint32_t pTexture)
@@ -920,26 +593,129 @@ void Graphics::TextureDelete(uint32_t pTexture)
 		THROW_MEANINGFUL_EXCEPTION("An attempt was made to delete the debug texture, do not do this!");
 	}
 
-	if( mTextures.find(pTexture) != mTextures.end() )
+	const GLTexture* texture = mTextures.Find(pTexture);
+	if( texture == nullptr )
+	{
+		VERBOSE_MESSAGE("Tried to delete texture that does not exist, or has already been deleted. " << pTexture);
+		return;
+	}
+
+	FlushDrawList();
+	TextureLoadForget(pTexture);
+	if( texture->mPlaceholder )
+	{
+		mTextures.Remove(pTexture);
+	}
+	else if( texture->mAtlasImage )
+	{
+		const uint32_t emptyPage = mTextureAtlas->Remove(texture->mAtlasImage);
+		mTextures.Remove(pTexture);
+		if( emptyPage )
+		{
+			TextureDelete(emptyPage);
+		}
+	}
+	else
 	{
-		glDeleteTextures(1,(GLuint*)&pTexture);
-		mTextures.erase(pTexture);
+		const GLuint glTexture = texture->mGLTexture;
+		glDeleteTextures(1,&glTexture);
+		mGLState->TextureDeleted(glTexture);
+		mTextures.Remove(pTexture);
 	}
 }
 
+uint32_t Graphics::TextureCreatePlaceholder()
+{
+	const GLTexture& diagnostics = mTextures.Get(mDiagnostics.texture);
+	auto texture = std::make_unique<GLTexture>(diagnostics.mGLTexture,diagnostics.mFormat,diagnostics.mWidth,diagnostics.mHeight);
+	texture->mPlaceholder = true;
+	return mTextures.Add(std::move(texture));
+}
+
+void Graphics::TextureReplacePlaceholder(uint32_t pPlaceholder,uint32_t pTexture)
+{
+	mTextures.Move(pTexture,pPlaceholder);
+}
+
 int Graphics::TextureGetWidth(uint32_t pTexture)const
 {
-	return mTextures.at(pTexture)->mWidth;
+	return mTextures.Get(pTexture).mWidth;
 }
 
 int Graphics::TextureGetHeight(uint32_t pTexture)const
 {
-	return mTextures.at(pTexture)->mHeight;
+	return mTextures.Get(pTexture).mHeight;
 }
 
-void Graphics::InitialiseGL(int pWidth,int pHeight)
+TextureAtlasStatistics Graphics::GetTextureAtlasStatistics()const
 {
-	mPhysical.Width = pWidth;
+	return mTextureAtlas->GetStatistics();
+}
+
+void Graphics::TextureAtlasFill(const GLTexture& pTexture,int pX,int pY,int pWidth,int pHeight,const uint8_t* pPixels,TextureFormat pFormat)
+{
+	const TextureAtlas::Image& image = mTextureAtlas->GetImage(pTexture.mAtlasImage);
+	if( pX < 0 || pY < 0 || pWidth <= 0 || pHeight <= 0 || pX + pWidth > image.width || pY + pHeight > image.height )
+	{
+		THROW_MEANINGFUL_EXCEPTION("TextureFill passed an area outside of the atlas image");
+	}
+
+	// Where the area touches the edge of the image the edge pixels are also written into the padding, so filtering never picks up the image next to it.
+	const int left = pX == 0 ? TextureAtlas::PADDING : 0;
+	const int top = pY == 0 ? TextureAtlas::PADDING : 0;
+	const int right = pX + pWidth == image.width ? TextureAtlas::PADDING : 0;
+	const int bottom = pY + pHeight == image.height ? TextureAtlas::PADDING : 0;
+	const int width = left + pWidth + right;
+	const int height = top + pHeight + bottom;
+
+	// The pages are all RGBA, alpha only images become black with alpha as that is what GL gives when sampling them.
+	const int bytesPerPixel = pFormat == TextureFormat::FORMAT_RGBA ? 4 : (pFormat == TextureFormat::FORMAT_RGB ? 3 : 1);
+	uint8_t* rgba = mWorkBuffers.scratchRam.Restart(width * height * 4);
+	uint8_t* dst = rgba;
+	for( int y = 0 ; y < height ; y++, dst += width * 4 )
+	{
+		const uint8_t* row = pPixels + (std::clamp(y - top,0,pHeight - 1) * pWidth * bytesPerPixel);
+		uint8_t* inside = dst + (left * 4);
+		switch( pFormat )
+		{
+		case TextureFormat::FORMAT_RGBA:
+			memcpy(inside,row,pWidth * 4);
+			break;
+
+		case TextureFormat::FORMAT_RGB:
+			pixels::ExpandRGBToRGBA(inside,row,pWidth);
+			break;
+
+		case TextureFormat::FORMAT_ALPHA:
+			for( int x = 0 ; x < pWidth ; x++ )
+			{
+				inside[(x * 4) + 0] = 0;
+				inside[(x * 4) + 1] = 0;
+				inside[(x * 4) + 2] = 0;
+				inside[(x * 4) + 3] = row[x];
+			}
+			break;
+		}
+
+		for( int x = 0 ; x < left ; x++ )
+		{
+			memcpy(dst + (x * 4),inside,4);
+		}
+		for( int x = 0 ; x < right ; x++ )
+		{
+			memcpy(inside + ((pWidth + x) * 4),inside + ((pWidth - 1) * 4),4);
+		}
+	}
+
+	mGLState->BindTexture(pTexture.mGLTexture);
+	glTexSubImage2D(GL_TEXTURE_2D,0,image.x + pX - left,image.y + pY - top,width,height,GL_RGBA,GL_UNSIGNED_BYTE,rgba);
+	CHECK_OGL_ERRORS();
+	CountTextureUpload(width,height,TextureFormat::FORMAT_RGBA);
+}
+
+void Graphics::InitialiseGL(int pWidth,int pHeight)
+{
+	mPhysical.Width = pWidth;
 	mPhysical.Height = pHeight;
 
 	SetDisplayRotation(ROTATE_FRAME_LANDSCAPE);
@@ -950,7 +726,7 @@ void Graphics::InitialiseGL(int pWidth,int pHeight)
 	BuildShaders();
 	BuildDebugTexture();
 	InitFreeTypeFont();
-	InitRoundedRect();
+	mTimerQueries->Initialise();
 
 	VERBOSE_MESSAGE("GLES Ready");
 }
@@ -959,6 +735,42 @@ void Graphics::BeginFrame()
 {
 	mDiagnostics.frameNumber++;
 
+	mDrawList->Restart();
+	mBatching.current = DrawListStatistics();
+	mGeometryCache->BeginFrame(mDiagnostics.frameNumber);
+
+	// The first frame is not timed, it has one off work in it and some drivers, llvmpipe for one, give nonsense for the first query.
+	if( mGPUTiming && mDiagnostics.frameNumber > 1 )
+	{
+		mTimerQueries->BeginFrame();
+	}
+	else
+	{
+		mTimerQueries->Clear();
+	}
+
+	// Elements do not know about us when they are deleted, so layers that stop being drawn are deleted after a while.
+	mLayers.current = LayerStatistics();
+	std::vector<uint32_t> oldLayers;
+	mLayers.layers.ForEach([this,&oldLayers](uint32_t pHandle,const LayerData::Layer& pLayer)
+	{
+		if( mDiagnostics.frameNumber - pLayer.lastUsed > LayerData::MAX_AGE )
+		{
+			oldLayers.push_back(pHandle);
+		}
+	});
+	for( uint32_t layer : oldLayers )
+	{
+		LayerDelete(layer);
+		mLayers.current.evictions++;
+	}
+
+	// The budget may have been lowered.
+	while( mLayers.bytes > mLayers.budget && LayerEvict() ){}
+
+	TextRunsAgeOut();
+	TextureLoadsUpload();
+
 	const float Identity[4][4] ={{1,0,0,0},{0,1,0,0},{0,0,1,0},{0,0,0,1}};
 
 	// Force identity transform matrix.
@@ -968,198 +780,308 @@ void Graphics::BeginFrame()
 	mMatrices.textureTransformIsIdentity = true;
 	memcpy(mMatrices.textureTransform,Identity,sizeof(float) * 4 * 4);
 
+	// The context may have been used by someone else since the last frame, GTK does, so forget the state we think GL is in.
+	// Uniforms are kept by the programs, no one else uses ours, so they do not need sending again.
+	mGLState->Invalidate();
+	mGLState->SetVertexAttribArray((int)StreamIndex::VERTEX,true);
+
 	// Reset some items so that we have a working render setup to begin the frame with.
 	// This is done so that I don't have to have a load of if statements to deal with first frame. Also makes life simpler for the more minimal applications.
+	mShaders.CurrentShader = nullptr;
 	EnableShader(mShaders.ColourOnly);
+
+	BuildRedrawRegions();
+	SetRedrawRegion(0);
 }
 
 void Graphics::EndFrame()
 {
-	glFlush();// This makes sure the display is fully up to date before we allow them to interact with any kind of UI. This is the specified use of this function.
-}
+	FlushDrawList();
+	mTimerQueries->EndFrame();
+	mBatching.lastFrame = mBatching.current;
+	mGLState->EndFrame();
 
-void Graphics::SetRenderingDefaults()
-{
-	glViewport(0, 0, (GLsizei)mPhysical.Width, (GLsizei)mPhysical.Height);
-	glDepthRangef(0.0f,1.0f);
-	glPixelStorei(GL_UNPACK_ALIGNMENT,1);
+	const GLStateStatistics& state = mGLState->GetLastFrame();
+	mDiagnostics.current.shaderChanges = state.programs;
+	mDiagnostics.current.textureBinds = state.textures;
+	mDiagnostics.current.uniformUploads = state.uniforms;
+	FinishFrameStatistics(mDrawList->mVertices.GrowCount() + mDrawList->mShapeVertices.GrowCount() + mDrawList->mIndices.GrowCount());
 
-	// Always cull, because why not. :) Make code paths simple.
-	glEnable(GL_CULL_FACE);
-	glFrontFace(GL_CW);
-	glCullFace(GL_BACK);
+	mLayers.current.layers = (uint32_t)mLayers.layers.GetSize();
+	mLayers.current.bytes = mLayers.bytes;
+	mLayers.current.budget = mLayers.budget;
+	mLayers.lastFrame = mLayers.current;
 
-	// I have alpha blend on all the time. Makes life easy. No point in complicating the code for speed, going for simple implementation not fastest!
-	glBlendFunc(GL_SRC_ALPHA,GL_ONE_MINUS_SRC_ALPHA);
-	glEnable(GL_BLEND);
-
-	glEnableVertexAttribArray((int)StreamIndex::VERTEX);//Always on
-
-    SetProjection2D();
-	SetTransformIdentity();
+	glDisable(GL_SCISSOR_TEST);
+	mRedraw.bufferAge = 0;// The platform code has to tell us again for the next frame.
 
-	CHECK_OGL_ERRORS();
+	glFlush();// This makes sure the display is fully up to date before we allow them to interact with any kind of UI. This is the specified use of this function.
 }
 
-void Graphics::BuildDebugTexture()
+void Graphics::SetRedrawRegion(size_t pIndex)
 {
-	VERBOSE_MESSAGE("Creating mDiagnostics.texture");
-	uint8_t pixels[16*16*4];
-	uint8_t* dst = pixels;
-	for( int y = 0 ; y < 16 ; y++ )
+	assert(pIndex < mRedraw.regions.size());
+	FlushDrawList();// What has been drawn so far is for the last region.
+
+	mRedraw.currentRegion = pIndex;
+	if( mRedraw.statistics.fullRedraw )
 	{
-		for( int x = 0 ; x < 16 ; x++ )
-		{
-			if( (x&1) == (y&1) )
-			{
-				dst[0] = 255;dst[1] = 0;dst[2] = 255;dst[3] = 255;
-			}
-			else
-			{
-				dst[0] = 0;dst[1] = 255;dst[2] = 0;dst[3] = 255;
-			}
-			dst+=4;
-		}
+		glDisable(GL_SCISSOR_TEST);
+	}
+	else
+	{
+		const Rectangle r = GetWindowRect(mRedraw.regions[pIndex]);
+		glScissor((GLint)r.left,(GLint)r.top,(GLsizei)r.GetWidth(),(GLsizei)r.GetHeight());
+		glEnable(GL_SCISSOR_TEST);
 	}
-	// Put some dots in so I know which way is up and if it's flipped.
-	pixels[(16*4) + (7*4) + 0] = 0xff;
-	pixels[(16*4) + (7*4) + 1] = 0x0;
-	pixels[(16*4) + (7*4) + 2] = 0x0;
-	pixels[(16*4) + (8*4) + 0] = 0xff;
-	pixels[(16*4) + (8*4) + 1] = 0x0;
-	pixels[(16*4) + (8*4) + 2] = 0x0;
-
-	pixels[(16*4*7) + (14*4) + 0] = 0x00;
-	pixels[(16*4*7) + (14*4) + 1] = 0x0;
-	pixels[(16*4*7) + (14*4) + 2] = 0xff;
-	pixels[(16*4*8) + (14*4) + 0] = 0x00;
-	pixels[(16*4*8) + (14*4) + 1] = 0x0;
-	pixels[(16*4*8) + (14*4) + 2] = 0xff;
-
-	mDiagnostics.texture = TextureCreate(16,16,pixels,TextureFormat::FORMAT_RGBA);
 }
 
-void Graphics::InitFreeTypeFont()
+Graphics::LayerState Graphics::LayerBegin(uint32_t& rLayer,const Rectangle& pRect,bool pContentChanged)
 {
-	if( FT_Init_FreeType(&mFreetype) == 0 )
+	if( mLayers.rendering != 0 )
+	{// A layer inside a layer is drawn into the outer one, that way there is only one to render again when it changes.
+		return LayerState::UNAVAILABLE;
+	}
+
+	const Rectangle rect = GetLayerRect(pRect);
+	const int width = (int)rect.GetWidth();
+	const int height = (int)rect.GetHeight();
+	if( width <= 0 || height <= 0 )
+	{
+		return LayerState::UNAVAILABLE;
+	}
+
+	LayerData::Layer* layer = mLayers.layers.Find(rLayer);
+	if( layer && (layer->width != width || layer->height != height) )
 	{
-		VERBOSE_MESSAGE("Freetype font library created");
+		LayerDelete(rLayer);
+		layer = nullptr;
+	}
+
+	if( layer == nullptr )
+	{
+		rLayer = LayerCreate(width,height);
+		if( rLayer == 0 )
+		{
+			mLayers.current.unavailable++;
+			return LayerState::UNAVAILABLE;
+		}
+		layer = &mLayers.layers.Get(rLayer);
+		mLayers.current.misses++;
+	}
+	else if( (pContentChanged == false && layer->renderedFrame >= mTextureLoads.loadedFrame) || layer->renderedFrame == mDiagnostics.frameNumber )
+	{// When there is more than one redraw region the content is only rendered for the first. Loaded images may be in content that has not changed.
+		layer->lastUsed = mDiagnostics.frameNumber;
+		mLayers.current.hits++;
+		return LayerState::UP_TO_DATE;
 	}
 	else
 	{
-		THROW_MEANINGFUL_EXCEPTION("Failed to init free type font library");
+		mLayers.current.rerenders++;
 	}
+
+	layer->lastUsed = mDiagnostics.frameNumber;
+	layer->renderedFrame = mDiagnostics.frameNumber;
+
+	FlushDrawList();// What has been drawn so far goes to the display.
+
+	// Remember what we are about to change, the framebuffer is not always zero, GTK gives us one of its own.
+	glGetIntegerv(GL_FRAMEBUFFER_BINDING,&mLayers.saved.framebuffer);
+	glGetIntegerv(GL_VIEWPORT,mLayers.saved.viewport);
+	glGetFloatv(GL_COLOR_CLEAR_VALUE,mLayers.saved.clearColour);
+	memcpy(mLayers.saved.projection,mMatrices.projection,sizeof(mMatrices.projection));
+
+	// The projection of the display without rotation, with the viewport moved so the rectangle lands on the texture.
+	// Everything is then rasterised exactly as it would be on the display, so the layer looks the same as drawing directly.
+	// Like the display the texture ends up with the bottom row first.
+	const Rectangle display = GetDisplayRect();
+	glBindFramebuffer(GL_FRAMEBUFFER,layer->framebuffer);
+	glViewport(-(GLint)rect.left,(GLint)(rect.bottom - display.GetHeight()),(GLsizei)display.GetWidth(),(GLsizei)display.GetHeight());
+	glDisable(GL_SCISSOR_TEST);
+	glClearColor(0.0f,0.0f,0.0f,0.0f);
+	glClear(GL_COLOR_BUFFER_BIT);
+
+	// The alpha is accumulated so the layer ends up with premultiplied alpha, it is then blended as if it had been drawn directly.
+	glBlendFuncSeparate(GL_SRC_ALPHA,GL_ONE_MINUS_SRC_ALPHA,GL_ONE,GL_ONE_MINUS_SRC_ALPHA);
+
+	memset(mMatrices.projection,0,sizeof(mMatrices.projection));
+	mMatrices.projection[0][0] = 2.0f / display.GetWidth();
+	mMatrices.projection[1][1] = -2.0f / display.GetHeight();
+	mMatrices.projection[3][0] = -1.0f;
+	mMatrices.projection[3][1] = 1.0f;
+	mMatrices.projection[3][3] = 1.0f;
+	ReloadShader();
+	CHECK_OGL_ERRORS();
+
+	mLayers.rendering = rLayer;
+	return LayerState::RENDER;
 }
 
-void Graphics::InitRoundedRect()
+void Graphics::LayerEnd()
 {
-	auto PUSH_LIGHT = [this]()
-	{
-		mRoundedRect.BoarderWhite.push_back(eui::COLOUR_WHITE);
-		mRoundedRect.BoarderWhite.push_back(eui::COLOUR_WHITE);
+	assert(mLayers.rendering != 0);
+	FlushDrawList();
+	mLayers.rendering = 0;
 
-		mRoundedRect.BoarderRaised.push_back(eui::COLOUR_WHITE);
-		mRoundedRect.BoarderRaised.push_back(eui::COLOUR_LIGHT_GREY);
+	glBindFramebuffer(GL_FRAMEBUFFER,(GLuint)mLayers.saved.framebuffer);
+	glViewport(mLayers.saved.viewport[0],mLayers.saved.viewport[1],mLayers.saved.viewport[2],mLayers.saved.viewport[3]);
+	glClearColor(mLayers.saved.clearColour[0],mLayers.saved.clearColour[1],mLayers.saved.clearColour[2],mLayers.saved.clearColour[3]);
+	glBlendFunc(GL_SRC_ALPHA,GL_ONE_MINUS_SRC_ALPHA);
+	memcpy(mMatrices.projection,mLayers.saved.projection,sizeof(mMatrices.projection));
+	ReloadShader();
+	CHECK_OGL_ERRORS();
 
-		mRoundedRect.BoarderDepressed.push_back(eui::COLOUR_DARK_GREY);
-		mRoundedRect.BoarderDepressed.push_back(eui::COLOUR_BLACK);
-	};
+	SetRedrawRegion(mRedraw.currentRegion);// Puts the scissor back.
+}
 
-	auto PUSH_DARK = [this]()
+void Graphics::LayerDraw(uint32_t pLayer,const Rectangle& pRect)
+{
+	const LayerData::Layer* layer = mLayers.layers.Find(pLayer);
+	if( layer == nullptr )
 	{
-		mRoundedRect.BoarderWhite.push_back(eui::COLOUR_WHITE);
-		mRoundedRect.BoarderWhite.push_back(eui::COLOUR_WHITE);
-
-		mRoundedRect.BoarderRaised.push_back(eui::COLOUR_DARK_GREY);
-		mRoundedRect.BoarderRaised.push_back(eui::COLOUR_BLACK);
+		return;
+	}
 
-		mRoundedRect.BoarderDepressed.push_back(eui::COLOUR_WHITE);
-		mRoundedRect.BoarderDepressed.push_back(eui::COLOUR_LIGHT_GREY);		
-	};
+	const Rectangle rect = GetLayerRect(pRect);
+	const VertXY quad[4] = {{rect.left,rect.top},{rect.right,rect.top},{rect.right,rect.bottom},{rect.left,rect.bottom}};
+	const VertXY uvs[4] = {{0.0f,1.0f},{1.0f,1.0f},{1.0f,0.0f},{0.0f,0.0f}};// The texture is bottom row first.
 
+	SetTextureTransformIdentity();
+	AddPrimitive(Topology::TRIANGLE_FAN,mShaders.TextureLayer,layer->texture,quad,uvs,4,COLOUR_WHITE);
+}
 
-// Top right
-	for( int n = 0 ; n < mRoundedRect.NUM_POINTS_PER_CORNER/2 ; n++ )
+uint32_t Graphics::LayerCreate(int pWidth,int pHeight)
+{
+	const uint32_t bytes = (uint32_t)(pWidth * pHeight * 4);
+	if( bytes > mLayers.budget )
 	{
-		PUSH_LIGHT();
+		return 0;
 	}
-	for( int n = 0 ; n < mRoundedRect.NUM_POINTS_PER_CORNER/2 ; n++ )
+
+	while( mLayers.bytes + bytes > mLayers.budget )
 	{
-		PUSH_DARK();
+		if( LayerEvict() == false )
+		{
+			return 0;
+		}
 	}
-// Bottom right
-	for( int n = 0 ; n < mRoundedRect.NUM_POINTS_PER_CORNER ; n++ )
+
+	auto layer = std::make_unique<LayerData::Layer>();
+	layer->width = pWidth;
+	layer->height = pHeight;
+	layer->bytes = bytes;
+	layer->texture = TextureCreate(pWidth,pHeight,nullptr,TextureFormat::FORMAT_RGBA);
+
+	// Pixel for pixel copy of what would have been drawn, so no filtering.
+	const GLuint texture = mTextures.Get(layer->texture).mGLTexture;
+	mGLState->BindTexture(texture);
+	glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_MIN_FILTER,GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_MAG_FILTER,GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_WRAP_S,GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_WRAP_T,GL_CLAMP_TO_EDGE);
+
+	GLint previous;
+	glGetIntegerv(GL_FRAMEBUFFER_BINDING,&previous);
+
+	GLuint framebuffer;
+	glGenFramebuffers(1,&framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER,framebuffer);
+	glFramebufferTexture2D(GL_FRAMEBUFFER,GL_COLOR_ATTACHMENT0,GL_TEXTURE_2D,texture,0);
+	const GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	glBindFramebuffer(GL_FRAMEBUFFER,(GLuint)previous);
+	CHECK_OGL_ERRORS();
+
+	if( status != GL_FRAMEBUFFER_COMPLETE )
 	{
-		PUSH_DARK();
+		VERBOSE_MESSAGE("Layer framebuffer of " << pWidth << "x" << pHeight << " is not complete, status " << status);
+		glDeleteFramebuffers(1,&framebuffer);
+		TextureDelete(layer->texture);
+		return 0;
 	}
-// Bottom left
-	for( int n = 0 ; n < mRoundedRect.NUM_POINTS_PER_CORNER/2 ; n++ )
+
+	layer->framebuffer = framebuffer;
+	mLayers.bytes += bytes;
+	return mLayers.layers.Add(std::move(layer));
+}
+
+bool Graphics::LayerEvict()
+{
+	uint32_t oldest = 0;
+	uint32_t oldestFrame = mDiagnostics.frameNumber;
+	mLayers.layers.ForEach([&oldest,&oldestFrame](uint32_t pHandle,const LayerData::Layer& pLayer)
 	{
-		PUSH_DARK();
-	}
+		if( pLayer.lastUsed < oldestFrame )
+		{
+			oldest = pHandle;
+			oldestFrame = pLayer.lastUsed;
+		}
+	});
 
-	for( int n = 0 ; n < mRoundedRect.NUM_POINTS_PER_CORNER/2 ; n++ )
+	if( oldest == 0 )
 	{
-		PUSH_LIGHT();
+		return false;
 	}
-// Top left
-	for( int n = 0 ; n < mRoundedRect.NUM_POINTS_PER_CORNER ; n++ )
+	LayerDelete(oldest);
+	mLayers.current.evictions++;
+	return true;
+}
+
+void Graphics::LayerDelete(uint32_t pLayer)
+{
+	const LayerData::Layer* layer = mLayers.layers.Find(pLayer);
+	if( layer )
 	{
-		PUSH_LIGHT();
+		glDeleteFramebuffers(1,&layer->framebuffer);
+		TextureDelete(layer->texture);
+		mLayers.bytes -= layer->bytes;
+		mLayers.layers.Remove(pLayer);
 	}
+}
 
-	PUSH_LIGHT();
-	PUSH_LIGHT();
-	PUSH_LIGHT();
+Rectangle Graphics::GetLayerRect(const Rectangle& pRect)
+{
+	return Rectangle(std::floor(pRect.left),std::floor(pRect.top),std::ceil(pRect.right),std::ceil(pRect.bottom));
 }
 
-void Graphics::SetProjection2D()
+void Graphics::ReloadShader()
 {
-	// Setup 2D frustum
-	memset(mMatrices.projection,0,sizeof(mMatrices.projection));
-	mMatrices.projection[3][3] = 1;
+	GLShaderPtr shader = mShaders.CurrentShader;
+	mShaders.CurrentShader = nullptr;
+	EnableShader(shader);
+}
 
-	if( mDisplayRotation == ROTATE_FRAME_BUFFER_90 )
-	{
-		mMatrices.projection[0][1] = -2.0f / (float)mPhysical.Height;
-		mMatrices.projection[1][0] = -2.0f / (float)mPhysical.Width;
-				
-		mMatrices.projection[3][0] = 1;
-		mMatrices.projection[3][1] = 1;
-	}
-	else if( mDisplayRotation == ROTATE_FRAME_BUFFER_180 )
-	{
-		mMatrices.projection[0][0] = -2.0f / (float)mPhysical.Width;
-		mMatrices.projection[1][1] = 2.0f / (float)mPhysical.Height;
-				
-		mMatrices.projection[3][0] = 1;
-		mMatrices.projection[3][1] = -1;
-	}
-	else if( mDisplayRotation == ROTATE_FRAME_BUFFER_270 )
-	{
-		mMatrices.projection[0][1] = 2.0f / (float)mPhysical.Height;
-		mMatrices.projection[1][0] = 2.0f / (float)mPhysical.Width;
-				
-		mMatrices.projection[3][0] = -1;
-		mMatrices.projection[3][1] = -1;
-	}
-	else// what ever the HW is with no rotation.
-	{
-		mMatrices.projection[0][0] = 2.0f / (float)mPhysical.Width;
-		mMatrices.projection[1][1] = -2.0f / (float)mPhysical.Height;
-		mMatrices.projection[3][0] = -1;
-		mMatrices.projection[3][1] = 1;
-	}
+void Graphics::SetRenderingDefaults()
+{
+	glViewport(0, 0, (GLsizei)mPhysical.Width, (GLsizei)mPhysical.Height);
+	glDepthRangef(0.0f,1.0f);
+	glPixelStorei(GL_UNPACK_ALIGNMENT,1);
+
+	// Always cull, because why not. :) Make code paths simple.
+	glEnable(GL_CULL_FACE);
+	glFrontFace(GL_CW);
+	glCullFace(GL_BACK);
+
+	// I have alpha blend on all the time. Makes life easy. No point in complicating the code for speed, going for simple implementation not fastest!
+	glBlendFunc(GL_SRC_ALPHA,GL_ONE_MINUS_SRC_ALPHA);
+	glEnable(GL_BLEND);
+
+	mGLState->SetVertexAttribArray((int)StreamIndex::VERTEX,true);//Always on
+
+    SetProjection2D();
+	SetTransformIdentity();
 
 	// No Depth buffer in 2D
 	glDisable(GL_DEPTH_TEST);
 	glDepthFunc(GL_ALWAYS);
-	glDepthMask(false);    
+	glDepthMask(false);
+
+	CHECK_OGL_ERRORS();
 }
 
 void Graphics::SetTransform(const float pTransform[4][4])
 {
 	assert(mShaders.CurrentShader);
+	FlushDrawList();
 	memcpy(mMatrices.transform,pTransform,sizeof(float) * 4 * 4);
 	mShaders.CurrentShader->SetTransform(mMatrices.transform);
 	mMatrices.transformIsIdentity = false;
@@ -1169,6 +1091,7 @@ void Graphics::SetTransformIdentity()
 {
 	if( mMatrices.transformIsIdentity == false )
 	{
+		FlushDrawList();
 		const float Identity[4][4] = 
 		{
 			{1,0,0,0},
@@ -1188,6 +1111,7 @@ void Graphics::SetTransformIdentity()
 void Graphics::SetTextureTransform(const float pTransform[4][4])
 {
 	assert(mShaders.CurrentShader);
+	FlushDrawList();
 	memcpy(mMatrices.textureTransform,pTransform,sizeof(float) * 4 * 4);
 	mShaders.CurrentShader->SetTextureTransform(mMatrices.textureTransform);
 	mMatrices.textureTransformIsIdentity = false;
@@ -1198,6 +1122,7 @@ void Graphics::SetTextureTransformIdentity()
 	assert(mShaders.CurrentShader);
 	if( mMatrices.textureTransformIsIdentity == false )
 	{
+		FlushDrawList();
 		const float Identity[4][4] = 
 		{
 			{1,0,0,0},
@@ -1213,83 +1138,157 @@ void Graphics::SetTextureTransformIdentity()
 
 void Graphics::BuildShaders()
 {
-	const char *ColourOnly_PS = R"(
+	// All the shaders take the colour per vertex so that primitives of different colours can be drawn in one batch.
+	const char* Batch_VS = R"(
+		uniform mat4 u_proj_cam;
+		uniform mat4 u_trans;
+		uniform mat4 u_textTrans;
+		attribute vec4 a_xyz;
+		attribute vec4 a_uv0;
+		attribute vec4 a_col;
 		varying vec4 v_col;
+		varying vec2 v_tex0;
 		void main(void)
 		{
-			gl_FragColor = v_col;
+			v_col = a_col;
+			v_tex0 = (a_uv0 * u_textTrans).xy;
+			gl_Position = u_proj_cam * (u_trans * a_xyz);
 		}
 	)";
 
-	const char *TextureColour_PS = R"(
+	const char *ColourOnly_PS = R"(
 		varying vec4 v_col;
-		varying vec2 v_tex0;
-		uniform sampler2D u_tex0;
 		void main(void)
 		{
-			gl_FragColor = v_col * texture2D(u_tex0,v_tex0);
+			gl_FragColor = v_col;
 		}
 	)";
 
-	const char* ColourOnly_VS = R"(
-		uniform mat4 u_proj_cam;
-		uniform mat4 u_trans;
-		uniform vec4 u_global_colour;
-		attribute vec4 a_xyz;
+	const char *TextureColour_PS = R"(
 		varying vec4 v_col;
+		varying vec2 v_tex0;
+		uniform sampler2D u_tex0;
 		void main(void)
 		{
-			v_col = u_global_colour;
-			gl_Position = u_proj_cam * (u_trans * a_xyz);
+			gl_FragColor = v_col * texture2D(u_tex0,v_tex0);
 		}
 	)";
 
-	const char* TextureColour_VS = R"(
-		uniform mat4 u_proj_cam;
-		uniform mat4 u_trans;
-		uniform mat4 u_textTrans;
-		uniform vec4 u_global_colour;
-		attribute vec4 a_xyz;
-		attribute vec4 a_uv0;
+	const char *TextureAlphaOnly_PS = R"(
 		varying vec4 v_col;
 		varying vec2 v_tex0;
+		uniform sampler2D u_tex0;
 		void main(void)
 		{
-			v_col = u_global_colour;
-			v_tex0 = (a_uv0 * u_textTrans).xy;
-			gl_Position = u_proj_cam * (u_trans * a_xyz);
+			gl_FragColor = vec4(v_col.rgb,v_col.a * texture2D(u_tex0,v_tex0).a);
 		}
 	)";
 
-	const char *TextureAlphaOnly_PS = R"(
+	mShaders.ColourOnly = new GLShader(*mGLState,"ColourOnly",Batch_VS,ColourOnly_PS);
+	mShaders.TextureColour = new GLShader(*mGLState,"TextureColour",Batch_VS,TextureColour_PS);
+	mShaders.TextureAlphaOnly = new GLShader(*mGLState,"TextureAlphaOnly",Batch_VS,TextureAlphaOnly_PS);
+
+	// Layers have premultiplied alpha, taking it out again means they blend like everything else and so batch with it.
+	const char *TextureLayer_PS = R"(
 		varying vec4 v_col;
 		varying vec2 v_tex0;
 		uniform sampler2D u_tex0;
 		void main(void)
 		{
-			gl_FragColor = vec4(v_col.rgb,texture2D(u_tex0,v_tex0).a);
+			vec4 texel = texture2D(u_tex0,v_tex0);
+			gl_FragColor = v_col * vec4(texel.rgb / max(texel.a,0.001),texel.a);
 		}
 	)";
 
-	const char* RectangleBorder_VS = R"(
+	mShaders.TextureLayer = new GLShader(*mGLState,"TextureLayer",Batch_VS,TextureLayer_PS);
+
+	// The signed distance field shapes. The texture coordinate stream is used for the position within the shape, in pixels.
+	const char* Shape_VS = R"(
 		uniform mat4 u_proj_cam;
 		uniform mat4 u_trans;
-		uniform vec4 u_global_colour;
 		attribute vec4 a_xyz;
+		attribute vec4 a_uv0;
 		attribute vec4 a_col;
-		varying vec4 v_col;
+		attribute vec4 a_shape;
+		attribute vec4 a_col2;
+		attribute float a_style;
+		varying vec2 v_local;
+		varying vec4 v_shape;
+		varying vec4 v_fill;
+		varying vec4 v_boarder;
+		varying float v_style;
 		void main(void)
 		{
-			v_col = a_col * u_global_colour;
+			v_local = a_uv0.xy;
+			v_shape = a_shape;
+			v_fill = a_col;
+			v_boarder = a_col2;
+			v_style = a_style;
 			gl_Position = u_proj_cam * (u_trans * a_xyz);
 		}
 	)";
 
-	mShaders.ColourOnly = new GLShader("ColourOnly",ColourOnly_VS,ColourOnly_PS);
-	mShaders.TextureColour = new GLShader("TextureColour",TextureColour_VS,TextureColour_PS);
-	mShaders.TextureAlphaOnly = new GLShader("TextureAlphaOnly",TextureColour_VS,TextureAlphaOnly_PS);
-	mShaders.RectangleBorder = new GLShader("RectangleBorder",RectangleBorder_VS,ColourOnly_PS);
+	// v_shape is half width, half height, radius and boarder thickness. v_style is 0 solid, 1 raised and 2 depressed.
+	// The colours for raised and depressed match the ones used for the tessellated boarders.
+	const char *Shape_PS = R"(
+		varying vec2 v_local;
+		varying vec4 v_shape;
+		varying vec4 v_fill;
+		varying vec4 v_boarder;
+		varying float v_style;
+		void main(void)
+		{
+			vec2 q = abs(v_local) - v_shape.xy + v_shape.z;
+			float d = min(max(q.x,q.y),0.0) + length(max(q,0.0)) - v_shape.z;
 
+			float shape = clamp(0.5 - d,0.0,1.0);
+			float fill = clamp(0.5 - (d + v_shape.w),0.0,1.0);
+			float boarder = shape - fill;
+
+			vec4 boarderColour = v_boarder;
+			if( v_style > 0.5 )
+			{
+				vec2 nearTopLeft = v_shape.xy + v_local;
+				vec2 nearBottomRight = v_shape.xy - v_local;
+				float light = step(min(nearTopLeft.x,nearTopLeft.y),min(nearBottomRight.x,nearBottomRight.y));
+				if( v_style > 1.5 )
+				{
+					light = 1.0 - light;
+				}
+				float across = clamp(-d / max(v_shape.w,1.0),0.0,1.0);
+				vec3 lightShade = mix(vec3(1.0),vec3(0.784),across);
+				vec3 darkShade = mix(vec3(0.392),vec3(0.0),across);
+				boarderColour.rgb *= mix(darkShade,lightShade,light);
+			}
+
+			float alpha = (v_fill.a * fill) + (boarderColour.a * boarder);
+			vec3 rgb = (v_fill.rgb * v_fill.a * fill) + (boarderColour.rgb * boarderColour.a * boarder);
+			gl_FragColor = vec4(rgb / max(alpha,0.001),alpha);
+		}
+	)";
+
+	mShaders.Shape = new GLShader(*mGLState,"Shape",Shape_VS,Shape_PS);
+
+	// Text drawn from a distance field uses the shape vertices, v_local is the UV of the glyph and v_shape is the
+	// scale from the texture to pixels, the outline width and the softness of the edge. v_boarder is the outline colour.
+	const char *TextDistanceField_PS = R"(
+		varying vec2 v_local;
+		varying vec4 v_shape;
+		varying vec4 v_fill;
+		varying vec4 v_boarder;
+		varying float v_style;
+		uniform sampler2D u_tex0;
+		void main(void)
+		{
+			float d = (texture2D(u_tex0,v_local).a - 0.5) * v_shape.x;
+			float outer = clamp((d + v_shape.y) / v_shape.z + 0.5,0.0,1.0);
+			float inner = clamp(d / v_shape.z + 0.5,0.0,1.0);
+			vec4 colour = mix(v_boarder,v_fill,inner);
+			gl_FragColor = vec4(colour.rgb,colour.a * outer);
+		}
+	)";
+
+	mShaders.TextDistanceField = new GLShader(*mGLState,"TextDistanceField",Shape_VS,TextDistanceField_PS);
 }
 
 void Graphics::EnableShader(GLShaderPtr pShader)
@@ -1302,21 +1301,210 @@ void Graphics::EnableShader(GLShaderPtr pShader)
 	}
 }
 
-void Graphics::VertexPtr(int pNum_coord, uint32_t pType,const void* pPointer)
+const GLStateStatistics& Graphics::GetGLStateStatistics()const
+{
+	return mGLState->GetLastFrame();
+}
+
+bool Graphics::GetGPUFrameTime(double& rMilliseconds)
+{
+	return mGPUTiming && mTimerQueries->GetResult(rMilliseconds);
+}
+
+void Graphics::SetBatching(bool pEnabled)
+{
+	FlushDrawList();
+	mBatching.enabled = pEnabled;
+}
+
+void Graphics::AddPrimitive(Topology pTopology,GLShaderPtr pShader,uint32_t pTexture,const VertXY* pPoints,const VertXY* pUVs,size_t pCount,Colour pColour,const Colour* pColours)
+{
+	assert(pShader);
+	assert(pPoints);
+	if( pCount == 0 )
+	{
+		return;
+	}
+
+	if( pCount > GLDrawList::MAX_VERTICES )
+	{
+		THROW_MEANINGFUL_EXCEPTION("AddPrimitive passed too many points, " + std::to_string(pCount) + " the maximum is " + std::to_string(GLDrawList::MAX_VERTICES));
+	}
+
+	// With batching off, each primitive gets it's own draw call.
+	if( mDrawList->GetHasSpace(pCount) == false || (mBatching.enabled == false && mDrawList->GetIsEmpty() == false) )
+	{
+		FlushDrawList();
+	}
+
+	mBatching.current.primitives++;
+	mBatching.current.vertices += pCount;
+
+	// The draw list works with GL textures. Atlas images are drawn with the page they are in, their UVs are moved into their part of it.
+	float u0 = 0.0f,v0 = 0.0f,uScale = 1.0f,vScale = 1.0f;
+	if( pTexture )
+	{
+		const GLTexture& texture = mTextures.Get(pTexture);
+		pTexture = texture.mGLTexture;
+		u0 = texture.mU0;
+		v0 = texture.mV0;
+		uScale = texture.mU1 - texture.mU0;
+		vScale = texture.mV1 - texture.mV0;
+	}
+
+	GLDrawList::Vertex* verts = mDrawList->Add(pShader,pTexture,pTopology,pCount);
+	const uint32_t colour = GLDrawList::ToVertexColour(pColour);
+	for( size_t n = 0 ; n < pCount ; n++, verts++ )
+	{
+		verts->x = pPoints[n].x;
+		verts->y = pPoints[n].y;
+		if( pUVs )
+		{
+			verts->u = u0 + (pUVs[n].x * uScale);
+			verts->v = v0 + (pUVs[n].y * vScale);
+		}
+		else
+		{
+			verts->u = 0.0f;
+			verts->v = 0.0f;
+		}
+		verts->rgba = pColours ? GLDrawList::ToVertexColour(ModulateColour(pColours[n],pColour)) : colour;
+	}
+}
+
+void Graphics::AddShape(float pCentreX,float pCentreY,float pAxisX,float pAxisY,float pHalfWidth,float pHalfHeight,float pRadius,float pThickness,Colour pFill,Colour pBorder,BoarderStyle pBoarderStyle)
+{
+	if( mDrawList->GetHasShapeSpace() == false || (mBatching.enabled == false && mDrawList->GetIsEmpty() == false) )
+	{
+		FlushDrawList();
+	}
+
+	mBatching.current.primitives++;
+	mBatching.current.vertices += 4;
+
+	// The quad is a pixel bigger all round than the shape so the anti aliased edge is not cut off.
+	const float quadHalfWidth = pHalfWidth + 1.0f;
+	const float quadHalfHeight = pHalfHeight + 1.0f;
+	const VertXY corners[4] = {{-quadHalfWidth,-quadHalfHeight},{quadHalfWidth,-quadHalfHeight},{quadHalfWidth,quadHalfHeight},{-quadHalfWidth,quadHalfHeight}};
+	const float radius = std::min(pRadius,std::min(pHalfWidth,pHalfHeight));
+	const float style = pBoarderStyle == BS_RAISED ? 1.0f : (pBoarderStyle == BS_DEPRESSED ? 2.0f : 0.0f);
+	const uint32_t fill = GLDrawList::ToVertexColour(pFill);
+	const uint32_t boarder = GLDrawList::ToVertexColour(pBorder);
+
+	GLDrawList::ShapeVertex* verts = mDrawList->AddShape(mShaders.Shape);
+	for( int n = 0 ; n < 4 ; n++, verts++ )
+	{
+		verts->x = pCentreX + (corners[n].x * pAxisX) - (corners[n].y * pAxisY);
+		verts->y = pCentreY + (corners[n].x * pAxisY) + (corners[n].y * pAxisX);
+		verts->localX = corners[n].x;
+		verts->localY = corners[n].y;
+		verts->halfWidth = pHalfWidth;
+		verts->halfHeight = pHalfHeight;
+		verts->radius = radius;
+		verts->thickness = pThickness;
+		verts->style = style;
+		verts->fill = fill;
+		verts->boarder = boarder;
+	}
+}
+
+void Graphics::AddDistanceFieldGlyphs(const uint32_t* pTextures,const VertXY* pVerts,const VertXY* pUVs,size_t pNumVerts,float pOffsetX,float pOffsetY,float pScale,float pOutline,float pSoftness,Colour pColour,Colour pOutlineColour)
+{
+	const uint32_t fill = GLDrawList::ToVertexColour(pColour);
+	const uint32_t outline = GLDrawList::ToVertexColour(pOutlineColour);
+
+	// The glyphs are six vertices, two triangles, the shapes want the four corners clockwise from the top left.
+	static const int corners[4] = {0,1,2,5};
+	for( size_t glyph = 0 ; glyph < pNumVerts ; glyph += 6 )
+	{
+		if( mDrawList->GetHasShapeSpace() == false || (mBatching.enabled == false && mDrawList->GetIsEmpty() == false) )
+		{
+			FlushDrawList();
+		}
+
+		mBatching.current.primitives++;
+		mBatching.current.vertices += 4;
+
+		GLDrawList::ShapeVertex* verts = mDrawList->AddShape(mShaders.TextDistanceField,mTextures.Get(pTextures[glyph / 6]).mGLTexture);
+		for( int n = 0 ; n < 4 ; n++, verts++ )
+		{
+			const size_t v = glyph + corners[n];
+			verts->x = pVerts[v].x + pOffsetX;
+			verts->y = pVerts[v].y + pOffsetY;
+			verts->localX = pUVs[v].x;
+			verts->localY = pUVs[v].y;
+			verts->halfWidth = pScale;
+			verts->halfHeight = pOutline;
+			verts->radius = pSoftness;
+			verts->thickness = 0.0f;
+			verts->style = 0.0f;
+			verts->fill = fill;
+			verts->boarder = outline;
+		}
+	}
+}
+
+void Graphics::FlushDrawList()
 {
-	if(pNum_coord < 2 || pNum_coord > 3)
+	if( mDrawList->GetIsEmpty() )
 	{
-		THROW_MEANINGFUL_EXCEPTION("VertexPtr passed invalid value for pNum_coord, must be 2 or 3 got " + std::to_string(pNum_coord));
+		return;
 	}
 
-	glVertexAttribPointer(
-				(GLuint)StreamIndex::VERTEX,
-				pNum_coord,
-				pType,
-				pType == GL_BYTE,
-				0,pPointer);
-	CHECK_OGL_ERRORS();
+	// The commands share two sets of vertices, one for primitives and one for shapes, so the stream pointers only change when going from one to the other.
+	const GLDrawList::Vertex* verts = mDrawList->mVertices.Data();
+	const GLDrawList::ShapeVertex* shapes = mDrawList->mShapeVertices.Data();
+	const uint16_t* indices = mDrawList->mIndices.Data();
+
+	for( size_t n = 0 ; n < mDrawList->mCommands.size() ; n++ )
+	{
+		const auto& cmd = mDrawList->mCommands[n];
+		if( n == 0 || cmd.shapes != mDrawList->mCommands[n-1].shapes )
+		{
+			if( cmd.shapes )
+			{
+				const GLsizei stride = sizeof(GLDrawList::ShapeVertex);
+				glVertexAttribPointer((GLuint)StreamIndex::VERTEX,2,GL_FLOAT,GL_FALSE,stride,&shapes->x);
+				glVertexAttribPointer((GLuint)StreamIndex::TEXCOORD,2,GL_FLOAT,GL_FALSE,stride,&shapes->localX);
+				glVertexAttribPointer((GLuint)StreamIndex::COLOUR,4,GL_UNSIGNED_BYTE,GL_TRUE,stride,&shapes->fill);
+				glVertexAttribPointer((GLuint)StreamIndex::SHAPE,4,GL_FLOAT,GL_FALSE,stride,&shapes->halfWidth);
+				glVertexAttribPointer((GLuint)StreamIndex::COLOUR2,4,GL_UNSIGNED_BYTE,GL_TRUE,stride,&shapes->boarder);
+				glVertexAttribPointer((GLuint)StreamIndex::STYLE,1,GL_FLOAT,GL_FALSE,stride,&shapes->style);
+			}
+			else
+			{
+				glVertexAttribPointer((GLuint)StreamIndex::VERTEX,2,GL_FLOAT,GL_FALSE,sizeof(GLDrawList::Vertex),&verts->x);
+				glVertexAttribPointer((GLuint)StreamIndex::TEXCOORD,2,GL_FLOAT,GL_FALSE,sizeof(GLDrawList::Vertex),&verts->u);
+				glVertexAttribPointer((GLuint)StreamIndex::COLOUR,4,GL_UNSIGNED_BYTE,GL_TRUE,sizeof(GLDrawList::Vertex),&verts->rgba);
+			}
+			CHECK_OGL_ERRORS();
+		}
+
+		EnableShader(cmd.shader);
+		if( cmd.texture )
+		{
+			mShaders.CurrentShader->SetTexture(cmd.texture);
+		}
+
+		glDrawElements(cmd.primitive,cmd.numIndices,GL_UNSIGNED_SHORT,indices + cmd.firstIndex);
+		CHECK_OGL_ERRORS();
+		mBatching.current.drawCalls++;
+		mDiagnostics.current.indices += (uint32_t)cmd.numIndices;
+		if( cmd.shapes )
+		{
+			mDiagnostics.current.shapeDrawCalls++;
+		}
+		else if( cmd.primitive == GL_LINES )
+		{
+			mDiagnostics.current.lineDrawCalls++;
+		}
+		else
+		{
+			mDiagnostics.current.triangleDrawCalls++;
+		}
+	}
 
+	mDrawList->Restart();
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////    
@@ -20,6 +20,7 @@
 #include <gbm.h>	// sudo apt install libgbm-dev // This is used to get the egl stuff going. DRM is used to do the page flip to the display. Goes.. DRM -> GDM -> GLES (I think)
 #include <drm_fourcc.h>
 #include "EGL/egl.h" // sudo apt install libegl-dev
+#include "EGL/eglext.h"
 //#include "GLES2/gl2.h" // sudo apt install libgles2-mesa-dev
 
 #define EGL_NO_X11
@@ -66,6 +67,17 @@ private:
 	struct gbm_surface *mNativeWindow = nullptr;
 	uint32_t mUpdateFrequency = 0;
 
+	/**
+	 * @brief The EGL extensions used to only redraw and present what has changed, if the driver has them.
+	 */
+	struct
+	{
+		bool bufferAge = false;											//!< EGL_EXT_buffer_age or EGL_KHR_partial_update
+		PFNEGLSWAPBUFFERSWITHDAMAGEKHRPROC swapBuffersWithDamage = nullptr;	//!< EGL_KHR_swap_buffers_with_damage or the EXT version.
+		PFNEGLSETDAMAGEREGIONKHRPROC setDamageRegion = nullptr;			//!< EGL_KHR_partial_update
+		std::vector<EGLint> rects;										//!< Work buffer for the rectangles passed to EGL.
+	}mEGLDamage;
+
 	/**
 	 * @brief Information about the mouse driver
 	 */
@@ -92,6 +104,7 @@ private:
 	int FindMouseDevice();
 
 	void FindEGLConfiguration();
+	void FindEGLDamageExtensions();
 	void UpdateCurrentBuffer();
 	void ProcessEvents();
 	void SwapBuffers();
@@ -203,6 +216,18 @@ PlatformInterface_DRM::PlatformInterface_DRM(Application* pApplication):
 	InitialiseDisplay();
 	mGraphics = new Graphics();
 	mGraphics->InitialiseGL(GetWidth(), GetHeight());
+	if( mEGLDamage.setDamageRegion )
+	{
+		mGraphics->SetOnRedrawRegions([this](const std::vector<Rectangle>& pWindowRegions)
+		{
+			mEGLDamage.rects.clear();
+			for( const auto& r : pWindowRegions )
+			{
+				mEGLDamage.rects.insert(mEGLDamage.rects.end(),{(EGLint)r.left,(EGLint)r.top,(EGLint)r.GetWidth(),(EGLint)r.GetHeight()});
+			}
+			mEGLDamage.setDamageRegion(mDisplay,mSurface,mEGLDamage.rects.data(),(EGLint)pWindowRegions.size());
+		});
+	}
 	mUsersApplication->OnOpen(mGraphics);
 
 }
@@ -234,10 +259,26 @@ void PlatformInterface_DRM::MainLoop()
 		assert(mGraphics);
 
 		const auto loopTime = std::chrono::system_clock::now() + std::chrono::milliseconds(mUsersApplication->GetUpdateInterval());
-		
-		mUsersApplication->OnFrame(mGraphics,mGraphics->GetDisplayRect());
 
-		SwapBuffers();
+		if( mEGLDamage.bufferAge )
+		{// Tell graphics what is in the back buffer so it only has to redraw what has changed since.
+			EGLint age = 0;
+			if( eglQuerySurface(mDisplay,mSurface,EGL_BUFFER_AGE_EXT,&age) == EGL_FALSE )
+			{
+				age = 0;
+			}
+			mGraphics->SetBufferAge((uint32_t)age);
+		}
+
+		// Only swap when something was drawn, when nothing has changed the last frame is still on the display.
+		const uint32_t frame = mGraphics->GetFrameNumber();
+		mUsersApplication->OnFrame(mGraphics,mGraphics->GetDisplayRect());
+		if( mGraphics->GetFrameNumber() != frame )
+		{
+			mUsersApplication->GetProfiler().Begin(FramePhase::SWAP);
+			SwapBuffers();
+			mUsersApplication->GetProfiler().End(FramePhase::SWAP);
+		}
 
 		// We call this as much as possible, if we call based on update rate, message response starts to behave badly.
 		do
@@ -422,6 +463,39 @@ void PlatformInterface_DRM::InitialiseDisplay()
 
 	eglMakeCurrent(mDisplay, mSurface, mSurface, mContext );
 	CHECK_OGL_ERRORS();
+
+	FindEGLDamageExtensions();
+}
+
+void PlatformInterface_DRM::FindEGLDamageExtensions()
+{
+	const char* extensions = eglQueryString(mDisplay,EGL_EXTENSIONS);
+	const std::string all = " " + std::string(extensions ? extensions : "") + " ";
+	auto HasExtension = [&all](const char* pName)
+	{
+		return all.find(" " + std::string(pName) + " ") != std::string::npos;
+	};
+
+	// Partial update also gives us the buffer age, and the same enum is used to query it.
+	mEGLDamage.bufferAge = HasExtension("EGL_EXT_buffer_age") || HasExtension("EGL_KHR_partial_update");
+
+	if( HasExtension("EGL_KHR_partial_update") )
+	{
+		mEGLDamage.setDamageRegion = (PFNEGLSETDAMAGEREGIONKHRPROC)eglGetProcAddress("eglSetDamageRegionKHR");
+	}
+
+	if( HasExtension("EGL_KHR_swap_buffers_with_damage") )
+	{
+		mEGLDamage.swapBuffersWithDamage = (PFNEGLSWAPBUFFERSWITHDAMAGEKHRPROC)eglGetProcAddress("eglSwapBuffersWithDamageKHR");
+	}
+	else if( HasExtension("EGL_EXT_swap_buffers_with_damage") )
+	{
+		mEGLDamage.swapBuffersWithDamage = (PFNEGLSWAPBUFFERSWITHDAMAGEKHRPROC)eglGetProcAddress("eglSwapBuffersWithDamageEXT");
+	}
+
+	VERBOSE_MESSAGE("EGL buffer age " << (mEGLDamage.bufferAge?"yes":"no") <<
+					", partial update " << (mEGLDamage.setDamageRegion?"yes":"no") <<
+					", swap with damage " << (mEGLDamage.swapBuffersWithDamage?"yes":"no"));
 }
 
 void PlatformInterface_DRM::FindEGLConfiguration()
@@ -538,7 +612,21 @@ static void page_flip_handler(int fd, unsigned int frame, unsigned int sec, unsi
 
 void PlatformInterface_DRM::SwapBuffers()
 {
-	eglSwapBuffers(mDisplay,mSurface);
+	// If we know what changed tell EGL, so it does not have to present what has not.
+	const std::vector<Rectangle>& damage = mGraphics->GetFrameDamage();
+	if( mEGLDamage.swapBuffersWithDamage && damage.size() > 0 )
+	{
+		mEGLDamage.rects.clear();
+		for( const auto& r : damage )
+		{
+			mEGLDamage.rects.insert(mEGLDamage.rects.end(),{(EGLint)r.left,(EGLint)r.top,(EGLint)r.GetWidth(),(EGLint)r.GetHeight()});
+		}
+		mEGLDamage.swapBuffersWithDamage(mDisplay,mSurface,mEGLDamage.rects.data(),(EGLint)damage.size());
+	}
+	else
+	{
+		eglSwapBuffers(mDisplay,mSurface);
+	}
 
 	UpdateCurrentBuffer();
 
@@ -145,7 +145,12 @@ void PlatformInterface_GTK4::MainLoop()
 		assert(mUsersApplication);
 		assert(mGL);
 		
-		gtk_widget_queue_draw(mGL);
+		// GTK does the drawing when it is ready, so only ask it to when there is something to draw.
+		// OnFrame, and so the app's OnUpdate, only runs when GTK draws. Apps with an update interval are drawn at it so they are still ticked.
+		if( mGraphics && (mUsersApplication->GetUpdateInterval() > 0 || mUsersApplication->GetFrameWanted(mGraphics,mGraphics->GetDisplayRect())) )
+		{
+			gtk_widget_queue_draw(mGL);
+		}
 
 		const auto loopTime = std::chrono::system_clock::now() + std::chrono::milliseconds(mUsersApplication->GetUpdateInterval());
 		// We call this as much as possible, if we call based on update rate, message response starts to behave badly.
@@ -171,6 +176,13 @@ gboolean PlatformInterface_GTK4::Signal_Render(GtkGLArea *area, GdkGLContext *co
 {
 	assert(mUsersApplication);
 	assert(mGraphics);
+	// GTK can ask for a render at any time, for example when the window is resized, and the GL area does not keep
+	// what was drawn before. So the whole tree is drawn, OnFrame lays it out first for the size the display is now.
+	Element* root = mUsersApplication->GetRootElement();
+	if( root )
+	{
+		root->Invalidate();
+	}
 	mUsersApplication->OnFrame(mGraphics,mGraphics->GetDisplayRect());
 	return TRUE;
 }
@@ -0,0 +1,334 @@
+#include "GLDiagnostics.h"
+#include "GLIncludes.h"
+#include "Graphics.h"
+#include "Application.h"
+#include "Element.h"
+
+#include <assert.h>
+
+#include <chrono>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+
+// For running with no display, for example timing frames on a build server or capturing frames for comparison.
+// Uses an EGL pbuffer, on the Mesa surfaceless platform if it is there, so works with the llvmpipe software driver.
+// sudo apt install libegl-dev libgles2-mesa-dev
+//
+// Set by environment variables, as Application::MainLoop has no arguments.
+//     EDGEUI_HEADLESS_FRAMES       The number of frames to run, 100 by default. The application can still exit sooner.
+//     EDGEUI_HEADLESS_FRAME_TIME   Milliseconds the application's clock moves on each frame. Defaults to the update interval, or 16 if that is zero.
+//     EDGEUI_HEADLESS_DUMP         A folder to write each frame drawn to, as frame_00001.ppm and so on.
+//     EDGEUI_HEADLESS_REPORT       A file to write the time of every frame to, as CSV. A summary is always written to stdout.
+// Frames are run back to back, the real time is never waited for.
+
+#include "EGL/egl.h" // sudo apt install libegl-dev
+#include "EGL/eglext.h"
+
+namespace eui{
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+class PlatformInterface_Headless
+{
+public:
+	PlatformInterface_Headless(Application* pApplication);
+	~PlatformInterface_Headless();
+
+	void MainLoop();
+
+private:
+	Application* mUsersApplication = nullptr;
+	Graphics* mGraphics = nullptr;
+
+	EGLDisplay mDisplay = EGL_NO_DISPLAY;		//!<GL display
+	EGLSurface mSurface = EGL_NO_SURFACE;		//!<GL rendering surface, a pbuffer.
+	EGLContext mContext = EGL_NO_CONTEXT;		//!<GL rendering context
+
+	struct
+	{
+		uint32_t frames = 100;
+		uint32_t frameTime = 16;
+		std::string dumpFolder;
+		std::string reportFile;
+	}mSettings;
+
+	/**
+	 * @brief What was measured for a frame, in milliseconds.
+	 */
+	struct FrameTiming
+	{
+		bool drawn;			//!< False if nothing had changed, so nothing was drawn.
+		double cpu;			//!< OnFrame, the update, layout and the GL calls.
+		double finish;		//!< glFinish, waiting for GL to complete the frame.
+	};
+	std::vector<FrameTiming> mTimings;
+
+	void InitialiseDisplay();
+	void DumpFrame(uint32_t pFrame);
+	void Report()const;
+};
+
+/**
+ * @brief Returns the environment variable as a number, or pDefault if it is not set.
+ */
+static uint32_t GetEnvironmentNumber(const char* pName,uint32_t pDefault)
+{
+	const char* value = getenv(pName);
+	if( value == nullptr || value[0] == 0 )
+	{
+		return pDefault;
+	}
+	return (uint32_t)std::stoul(value);
+}
+
+PlatformInterface_Headless::PlatformInterface_Headless(Application* pApplication):
+	mUsersApplication(pApplication)
+{
+	const uint32_t interval = mUsersApplication->GetUpdateInterval();
+	mSettings.frames = GetEnvironmentNumber("EDGEUI_HEADLESS_FRAMES",mSettings.frames);
+	mSettings.frameTime = GetEnvironmentNumber("EDGEUI_HEADLESS_FRAME_TIME",interval > 0 ? interval : mSettings.frameTime);
+	const char* dump = getenv("EDGEUI_HEADLESS_DUMP");
+	mSettings.dumpFolder = dump ? dump : "";
+	const char* report = getenv("EDGEUI_HEADLESS_REPORT");
+	mSettings.reportFile = report ? report : "";
+
+	InitialiseDisplay();
+
+	mUsersApplication->SetFixedClockStep(mSettings.frameTime);
+	mUsersApplication->GetProfiler().SetEnabled(true,mSettings.frames);
+	mGraphics = new Graphics();
+	mGraphics->InitialiseGL(mUsersApplication->GetEmulatedWidth(),mUsersApplication->GetEmulatedHeight());
+	mUsersApplication->OnOpen(mGraphics);
+}
+
+PlatformInterface_Headless::~PlatformInterface_Headless()
+{
+	delete mGraphics;
+
+	if( mDisplay != EGL_NO_DISPLAY )
+	{
+		eglMakeCurrent(mDisplay,EGL_NO_SURFACE,EGL_NO_SURFACE,EGL_NO_CONTEXT);
+		if( mContext != EGL_NO_CONTEXT )
+		{
+			eglDestroyContext(mDisplay,mContext);
+		}
+		if( mSurface != EGL_NO_SURFACE )
+		{
+			eglDestroySurface(mDisplay,mSurface);
+		}
+		eglTerminate(mDisplay);
+	}
+}
+
+void PlatformInterface_Headless::InitialiseDisplay()
+{
+	VERBOSE_MESSAGE("Calling Headless InitialiseDisplay");
+
+	// The surfaceless platform needs no display server or device, if it is not there try the default display.
+	const char* clientExtensions = eglQueryString(EGL_NO_DISPLAY,EGL_EXTENSIONS);
+	const std::string all = " " + std::string(clientExtensions ? clientExtensions : "") + " ";
+	if( all.find(" EGL_MESA_platform_surfaceless ") != std::string::npos )
+	{
+		auto getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+		if( getPlatformDisplay )
+		{
+			mDisplay = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA,EGL_DEFAULT_DISPLAY,nullptr);
+		}
+	}
+
+	if( mDisplay == EGL_NO_DISPLAY )
+	{
+		VERBOSE_MESSAGE("No surfaceless EGL platform, using the default display");
+		mDisplay = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+	}
+
+	if( mDisplay == EGL_NO_DISPLAY )
+	{
+		THROW_MEANINGFUL_EXCEPTION("Couldn\'t open an EGL display");
+	}
+
+	EGLint majorVersion,minorVersion;
+	if( !eglInitialize(mDisplay,&majorVersion,&minorVersion) )
+	{
+		THROW_MEANINGFUL_EXCEPTION("eglInitialize() failed");
+	}
+	VERBOSE_MESSAGE("EGL version " << majorVersion << "." << minorVersion);
+	eglBindAPI(EGL_OPENGL_ES_API);
+
+	const EGLint attributes[] =
+	{
+		EGL_SURFACE_TYPE,EGL_PBUFFER_BIT,
+		EGL_RENDERABLE_TYPE,EGL_OPENGL_ES2_BIT,
+		EGL_RED_SIZE,8,
+		EGL_GREEN_SIZE,8,
+		EGL_BLUE_SIZE,8,
+		EGL_ALPHA_SIZE,8,
+		EGL_NONE
+	};
+	EGLConfig config;
+	EGLint numConfigs = 0;
+	if( !eglChooseConfig(mDisplay,attributes,&config,1,&numConfigs) || numConfigs == 0 )
+	{
+		THROW_MEANINGFUL_EXCEPTION("No EGL config with pbuffer support");
+	}
+
+	const EGLint contextAttributes[] = {EGL_CONTEXT_CLIENT_VERSION,2,EGL_NONE};
+	mContext = eglCreateContext(mDisplay,config,EGL_NO_CONTEXT,contextAttributes);
+	if( mContext == EGL_NO_CONTEXT )
+	{
+		THROW_MEANINGFUL_EXCEPTION("Failed to get a rendering context");
+	}
+
+	const EGLint surfaceAttributes[] = {EGL_WIDTH,mUsersApplication->GetEmulatedWidth(),EGL_HEIGHT,mUsersApplication->GetEmulatedHeight(),EGL_NONE};
+	mSurface = eglCreatePbufferSurface(mDisplay,config,surfaceAttributes);
+	if( mSurface == EGL_NO_SURFACE )
+	{
+		THROW_MEANINGFUL_EXCEPTION("Failed to create the pbuffer surface");
+	}
+
+	eglMakeCurrent(mDisplay,mSurface,mSurface,mContext);
+	VERBOSE_MESSAGE("Headless display ready, renderer " << (const char*)glGetString(GL_RENDERER));
+}
+
+void PlatformInterface_Headless::MainLoop()
+{
+	mTimings.reserve(mSettings.frames);
+	for( uint32_t frame = 1 ; frame <= mSettings.frames && mUsersApplication->GetKeepGoing() ; frame++ )
+	{
+		assert(mUsersApplication);
+		assert(mGraphics);
+
+		// The pbuffer is never swapped, so it still has the last frame in it and only what changed has to be drawn.
+		mGraphics->SetBufferAge(1);
+
+		FrameTiming timing;
+		const auto start = std::chrono::steady_clock::now();
+		const uint32_t framesDrawn = mGraphics->GetFrameNumber();
+		mUsersApplication->OnFrame(mGraphics,mGraphics->GetDisplayRect());
+		timing.drawn = mGraphics->GetFrameNumber() != framesDrawn;
+		const auto drawn = std::chrono::steady_clock::now();
+		mUsersApplication->GetProfiler().Begin(FramePhase::SWAP);
+		glFinish();
+		mUsersApplication->GetProfiler().End(FramePhase::SWAP);
+		const auto finished = std::chrono::steady_clock::now();
+
+		timing.cpu = std::chrono::duration<double,std::milli>(drawn - start).count();
+		timing.finish = std::chrono::duration<double,std::milli>(finished - drawn).count();
+		mTimings.push_back(timing);
+
+		if( timing.drawn && mSettings.dumpFolder.size() > 0 )
+		{
+			DumpFrame(frame);
+		}
+	}
+
+	// The profiler adds a frame's times when the next starts, the last frame and its swap would be missing from the report.
+	mUsersApplication->GetProfiler().EndFrame();
+	mUsersApplication->OnClose();
+	Report();
+}
+
+void PlatformInterface_Headless::DumpFrame(uint32_t pFrame)
+{
+	const int width = mUsersApplication->GetEmulatedWidth();
+	const int height = mUsersApplication->GetEmulatedHeight();
+	std::vector<uint8_t> pixels(width * height * 4);
+	glReadPixels(0,0,width,height,GL_RGBA,GL_UNSIGNED_BYTE,pixels.data());
+	CHECK_OGL_ERRORS();
+
+	std::ostringstream name;
+	name << mSettings.dumpFolder << "/frame_" << std::setw(5) << std::setfill('0') << pFrame << ".ppm";
+	std::ofstream file(name.str(),std::ios::binary);
+	if( !file )
+	{
+		THROW_MEANINGFUL_EXCEPTION("Failed to open " + name.str() + " to dump the frame to");
+	}
+
+	// GL has the bottom row first, images have the top first.
+	file << "P6\n" << width << " " << height << "\n255\n";
+	for( int y = height - 1 ; y >= 0 ; y-- )
+	{
+		const uint8_t* src = pixels.data() + (y * width * 4);
+		for( int x = 0 ; x < width ; x++, src += 4 )
+		{
+			file.write((const char*)src,3);
+		}
+	}
+}
+
+void PlatformInterface_Headless::Report()const
+{
+	if( mSettings.reportFile.size() > 0 )
+	{
+		std::ofstream file(mSettings.reportFile);
+		file << "frame,drawn,cpu_ms,finish_ms\n";
+		for( size_t n = 0 ; n < mTimings.size() ; n++ )
+		{
+			file << (n + 1) << "," << (mTimings[n].drawn ? 1 : 0) << "," << mTimings[n].cpu << "," << mTimings[n].finish << "\n";
+		}
+	}
+
+	// The summary is only of the frames that were drawn, the others did next to nothing.
+	std::vector<double> cpu,total;
+	for( const auto& t : mTimings )
+	{
+		if( t.drawn )
+		{
+			cpu.push_back(t.cpu);
+			total.push_back(t.cpu + t.finish);
+		}
+	}
+
+	std::cout << "Headless run of " << mTimings.size() << " frames, " << cpu.size() << " drawn, " << mSettings.frameTime << "ms a frame on the application clock\n";
+	if( cpu.size() == 0 )
+	{
+		return;
+	}
+
+	auto Summary = [](const char* pName,std::vector<double> pTimes)
+	{
+		std::sort(pTimes.begin(),pTimes.end());
+		double sum = 0.0;
+		for( double t : pTimes )
+		{
+			sum += t;
+		}
+		std::cout << std::fixed << std::setprecision(3) << "    " << pName <<
+			" mean " << (sum / pTimes.size()) <<
+			" min " << pTimes.front() <<
+			" p50 " << FrameProfiler::GetPercentile(pTimes,50.0) <<
+			" p95 " << FrameProfiler::GetPercentile(pTimes,95.0) <<
+			" p99 " << FrameProfiler::GetPercentile(pTimes,99.0) <<
+			" max " << pTimes.back() << " ms\n";
+	};
+	Summary("cpu  ",cpu);
+	Summary("total",total);
+
+	// Where the time went, from the application's profiler. The swap is the glFinish.
+	const FrameProfiler& profiler = mUsersApplication->GetProfiler();
+	for( size_t n = 0 ; n < (size_t)FramePhase::COUNT ; n++ )
+	{
+		const FramePhaseStatistics stats = profiler.GetStatistics((FramePhase)n);
+		if( stats.samples > 0 )
+		{
+			std::cout << "    " << std::left << std::setw(15) << FrameProfiler::GetPhaseName((FramePhase)n) << std::right <<
+				" mean " << stats.mean <<
+				" min " << stats.min <<
+				" p95 " << stats.p95 <<
+				" p99 " << stats.p99 <<
+				" max " << stats.max << " ms over " << stats.samples << " frames\n";
+		}
+	}
+}
+
+void Application::MainLoop(Application* pApplication)
+{
+	PlatformInterface_Headless platform(pApplication);
+	platform.MainLoop();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+}//namespace eui{
@@ -199,6 +199,10 @@ void PlatformInterface_X11::ProcessEvents()
 		{
 		case Expose:
 			mWindowReady = true;
+			if( root )
+			{// What was on the window may have been lost, so it all has to be drawn again.
+				root->Invalidate();
+			}
 			break;
 
 		case ClientMessage:
@@ -261,9 +265,15 @@ void PlatformInterface_X11::MainLoop()
 		
 		const auto loopTime = std::chrono::system_clock::now() + std::chrono::milliseconds(mUsersApplication->GetUpdateInterval());
 		
+		// Only swap when something was drawn, when nothing has changed the last frame is still on the display.
+		const uint32_t frame = mGraphics->GetFrameNumber();
 		mUsersApplication->OnFrame(mGraphics,mGraphics->GetDisplayRect());
-
-		SwapBuffers();
+		if( mGraphics->GetFrameNumber() != frame )
+		{
+			mUsersApplication->GetProfiler().Begin(FramePhase::SWAP);
+			SwapBuffers();
+			mUsersApplication->GetProfiler().End(FramePhase::SWAP);
+		}
 
 		// We call this as much as possible, if we call based on update rate, message response starts to behave badly.
 		do
@@ -0,0 +1,241 @@
+#ifndef TextureAtlas_H__
+#define TextureAtlas_H__
+
+#include "Graphics.h"
+#include "Diagnostics.h"
+
+#include <vector>
+#include <cassert>
+
+namespace eui{
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * @brief Packs small images into shared texture pages so that screens full of icons do not need a texture bind per icon.
+ * Images are placed on shelves, rows as high as the first image put on them. Each image has a pixel of padding
+ * all round that the caller fills with copies of the edge pixels, so filtering does not pick up the neighbours.
+ * This only does the packing, the textures for the pages are made by the caller.
+ * Images are given an ID, starting from one, that is kept in the GLTexture of the image.
+ */
+struct TextureAtlas
+{
+	static constexpr int PAGE_SIZE = 1024;				//!< Pages are square.
+	static constexpr int MAX_IMAGE_SIZE = 256;			//!< Images bigger than this in either direction get their own texture.
+	static constexpr int PADDING = 1;					//!< Pixels around each image.
+
+	struct Image
+	{
+		bool inUse = false;
+		size_t page = 0;
+		size_t shelf = 0;
+		int x = 0,y = 0;				//!< Of the top left of the image in the page, not including the padding.
+		int width = 0,height = 0;		//!< Not including the padding.
+		float u0,v0,u1,v1;				//!< The sub rectangle in the page.
+	};
+
+	struct Shelf
+	{
+		int y;
+		int height;
+		int nextX;						//!< Where the next image goes, images are only added to the end.
+		uint32_t images;				//!< When this gets back to zero the shelf can be reused from the start.
+	};
+
+	struct Page
+	{
+		uint32_t texture = 0;			//!< The texture handle for the page. Zero once the page has been emptied and its texture deleted.
+		bool filtered = false;
+		std::vector<Shelf> shelves;
+		int nextShelfY = 0;
+		uint32_t images = 0;
+		uint32_t usedPixels = 0;		//!< Including the padding.
+	};
+
+	static bool GetWillFit(int pWidth,int pHeight){return pWidth > 0 && pHeight > 0 && pWidth <= MAX_IMAGE_SIZE && pHeight <= MAX_IMAGE_SIZE;}
+
+	/**
+	 * @brief Finds space for an image and returns its ID.
+	 * If no page has room pCreatePage is called, it is passed the filtered flag and returns the texture handle for the new page.
+	 */
+	template <class CREATE_PAGE> uint32_t Add(int pWidth,int pHeight,bool pFiltered,CREATE_PAGE pCreatePage)
+	{
+		assert(GetWillFit(pWidth,pHeight));
+		const int width = pWidth + (PADDING*2);
+		const int height = pHeight + (PADDING*2);
+
+		size_t page,shelf;
+		if( FindShelf(width,height,pFiltered,page,shelf) == false )
+		{// Need a new page, reuse an empty slot if there is one.
+			for( page = 0 ; page < mPages.size() && mPages[page].texture != 0 ; page++ ){}
+			if( page == mPages.size() )
+			{
+				mPages.emplace_back();
+			}
+			mPages[page] = Page();
+			mPages[page].texture = pCreatePage(pFiltered);
+			mPages[page].filtered = pFiltered;
+			VERBOSE_MESSAGE("Texture atlas page " << page << " created, texture " << mPages[page].texture);
+
+			if( FindShelf(width,height,pFiltered,page,shelf) == false )
+			{
+				THROW_MEANINGFUL_EXCEPTION("Texture atlas failed to fit an image onto a new page, this is a bug");
+			}
+		}
+
+		Page& p = mPages[page];
+		Shelf& s = p.shelves[shelf];
+
+		Image image;
+		image.inUse = true;
+		image.page = page;
+		image.shelf = shelf;
+		image.x = s.nextX + PADDING;
+		image.y = s.y + PADDING;
+		image.width = pWidth;
+		image.height = pHeight;
+		image.u0 = (float)image.x / PAGE_SIZE;
+		image.v0 = (float)image.y / PAGE_SIZE;
+		image.u1 = (float)(image.x + pWidth) / PAGE_SIZE;
+		image.v1 = (float)(image.y + pHeight) / PAGE_SIZE;
+
+		s.nextX += width;
+		s.images++;
+		p.images++;
+		p.usedPixels += width * height;
+
+		size_t index;
+		if( mFreeImages.size() > 0 )
+		{
+			index = mFreeImages.back();
+			mFreeImages.pop_back();
+			mImages[index] = image;
+		}
+		else
+		{
+			index = mImages.size();
+			mImages.push_back(image);
+		}
+		return (uint32_t)index + 1;
+	}
+
+	/**
+	 * @brief Frees the space used by the image. If that leaves its page empty the page's texture is returned so the caller
+	 * can delete it, otherwise zero is returned.
+	 */
+	uint32_t Remove(uint32_t pID)
+	{
+		Image& image = GetImage(pID);
+		Page& p = mPages[image.page];
+		Shelf& s = p.shelves[image.shelf];
+
+		image.inUse = false;
+		mFreeImages.push_back(pID - 1);
+
+		p.usedPixels -= (image.width + (PADDING*2)) * (image.height + (PADDING*2));
+		if( --s.images == 0 )
+		{
+			s.nextX = 0;
+		}
+
+		if( --p.images == 0 )
+		{
+			const uint32_t texture = p.texture;
+			p = Page();
+			VERBOSE_MESSAGE("Texture atlas page " << image.page << " is empty, texture " << texture << " can be deleted");
+			return texture;
+		}
+		return 0;
+	}
+
+	/**
+	 * @brief Will throw an exception if the ID is not an image we know about.
+	 */
+	Image& GetImage(uint32_t pID)
+	{
+		const size_t index = pID - 1;// Zero wraps around to a huge number, so fails the size check.
+		if( index >= mImages.size() || mImages[index].inUse == false )
+		{
+			THROW_MEANINGFUL_EXCEPTION("Texture atlas image " + std::to_string(pID) + " is not valid");
+		}
+		return mImages[index];
+	}
+
+	uint32_t GetPageTexture(const Image& pImage)const{return mPages[pImage.page].texture;}
+
+	TextureAtlasStatistics GetStatistics()const
+	{
+		TextureAtlasStatistics stats;
+		for( const auto& p : mPages )
+		{
+			if( p.texture )
+			{
+				stats.pages++;
+				stats.images += p.images;
+				stats.pageOccupancy.push_back(100.0f * p.usedPixels / (PAGE_SIZE * PAGE_SIZE));
+				stats.usedPixels += p.usedPixels;
+			}
+		}
+		stats.percentage = stats.pages > 0 ? 100.0f * stats.usedPixels / (stats.pages * PAGE_SIZE * PAGE_SIZE) : 0.0f;
+		return stats;
+	}
+
+private:
+	std::vector<Page> mPages;
+	std::vector<Image> mImages;
+	std::vector<size_t> mFreeImages;
+
+	/**
+	 * @brief Looks for the shelf that wastes the least height, makes a new one if none fit and there is room on a page.
+	 */
+	bool FindShelf(int pWidth,int pHeight,bool pFiltered,size_t& rPage,size_t& rShelf)
+	{
+		int bestWaste = PAGE_SIZE;
+		bool found = false;
+		for( size_t page = 0 ; page < mPages.size() ; page++ )
+		{
+			const Page& p = mPages[page];
+			if( p.texture == 0 || p.filtered != pFiltered )
+			{
+				continue;
+			}
+
+			for( size_t shelf = 0 ; shelf < p.shelves.size() ; shelf++ )
+			{
+				const Shelf& s = p.shelves[shelf];
+				const int waste = s.height - pHeight;
+				if( waste >= 0 && waste < bestWaste && s.nextX + pWidth <= PAGE_SIZE )
+				{
+					bestWaste = waste;
+					rPage = page;
+					rShelf = shelf;
+					found = true;
+				}
+			}
+		}
+
+		// Don't put small images on a shelf much taller than them, start a new shelf if there is room.
+		if( found && bestWaste <= pHeight / 2 )
+		{
+			return true;
+		}
+
+		for( size_t page = 0 ; page < mPages.size() ; page++ )
+		{
+			Page& p = mPages[page];
+			if( p.texture != 0 && p.filtered == pFiltered && p.nextShelfY + pHeight <= PAGE_SIZE )
+			{
+				p.shelves.push_back({p.nextShelfY,pHeight,0,0});
+				p.nextShelfY += pHeight;
+				rPage = page;
+				rShelf = p.shelves.size() - 1;
+				return true;
+			}
+		}
+
+		return found;
+	}
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+}//namespace eui{
+
+#endif //#ifndef TextureAtlas_H__
@@ -0,0 +1,1071 @@
+#include "Graphics.h"
+#include "ImageLoader.h"
+#include "GL/FreeTypeFont.h"
+
+#include <math.h>
+#include <algorithm>
+#include <limits>
+#include <fstream>
+#include <iostream>
+#include <cstdarg>
+#include <cstring>
+#include <cerrno>
+
+#include <sys/stat.h>
+
+// The parts of Graphics that are the same whatever renderer is used, the renderers are in Graphics_GL.cpp and Graphics_Software.cpp.
+namespace eui{
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+Rectangle Graphics::GetDisplayRect()const
+{
+    return Rectangle(0,0,GetDisplayWidth(),GetDisplayHeight());
+}
+
+int32_t Graphics::GetDisplayWidth()const
+{
+    return mReported.Width;
+}
+
+int32_t Graphics::GetDisplayHeight()const
+{
+    return mReported.Height;
+}
+
+void Graphics::GetDisplayRotatedXY(float &x,float &y)const
+{
+	//GetDisplayWidth(),GetDisplayHeight()
+	if( mDisplayRotation == Graphics::ROTATE_FRAME_BUFFER_90 )
+	{
+		std::swap(x,y);
+		y = GetDisplayHeight() - y;
+	}
+	else if( mDisplayRotation == Graphics::ROTATE_FRAME_BUFFER_180 )
+	{
+		x = GetDisplayWidth() - x;
+		y = GetDisplayHeight() - y;
+	}
+	else if( mDisplayRotation == Graphics::ROTATE_FRAME_BUFFER_270 )
+	{
+		std::swap(x,y);
+		x = GetDisplayWidth() - x;
+	}
+	else// what ever the HW is with no rotation.
+	{
+	}
+
+}
+
+void Graphics::SetDisplayRotation(DisplayRotation pDisplayRotation)
+{
+	// They want portrait, if hardware display is landscape, rotate 90, else don't.
+	if( pDisplayRotation == ROTATE_FRAME_PORTRAIT )
+	{
+		mDisplayRotation = ROTATE_FRAME_BUFFER_0;// Assume is portrait by default.
+		if( mPhysical.Width > mPhysical.Height )
+		{
+			mDisplayRotation = ROTATE_FRAME_BUFFER_90;// hardware is landscape
+		}
+	}
+	else if( pDisplayRotation == ROTATE_FRAME_LANDSCAPE )
+	{
+		mDisplayRotation = ROTATE_FRAME_BUFFER_0; // Assume is landscape by default.
+		if( mPhysical.Width < mPhysical.Height )
+		{
+			mDisplayRotation = ROTATE_FRAME_BUFFER_90;// hardware is portrait
+		}
+	}
+	else
+	{
+		// Ok, they are forcing rotation.
+		mDisplayRotation = pDisplayRotation;
+	}
+
+	if( GetIsPortrait() )
+	{
+		mReported.Width = mPhysical.Height;
+		mReported.Height = mPhysical.Width;
+	}
+	else
+	{
+		mReported.Width = mPhysical.Width;
+		mReported.Height = mPhysical.Height;
+	}
+
+	FlushDrawList();
+    SetProjection2D();
+
+}
+
+void Graphics::GetRoundedRectanglePoints(const Rectangle& pRect,VertXY::Buffer& rBuffer,float pRadius)
+{
+	const float size = std::min(pRect.GetWidth()*pRadius,pRect.GetHeight()*pRadius);
+	const auto& level = mRoundedRect.GetLevel(size);
+
+	VertXY* verts = rBuffer.Restart(level.numVertices);
+	const auto* unit = level.UnitCircle.data();// This starts the circle at the top, so the first corner is the right top one.
+	for( int n = 0 ; n < level.pointsPerCorner ; n++, verts++, unit++ )
+	{
+		const float x = (1.0f - unit->s) * size;
+		const float y = (1.0f - unit->c) * size;
+
+		verts->x = pRect.right - x;
+		verts->y = pRect.top +   y;
+	}
+
+	for( int n = 0 ; n < level.pointsPerCorner ; n++ , verts++, unit++ )
+	{
+		const float x = (1.0f - unit->s) * size;
+		const float y = (unit->c + 1.0f) * size;
+
+		verts->x = pRect.right -  x;
+		verts->y = pRect.bottom - y;
+	}
+
+	for( int n = 0 ; n < level.pointsPerCorner ; n++ , verts++, unit++ )
+	{
+		const float x = (unit->s + 1.0f) * size;
+		const float y = (unit->c + 1.0f) * size;
+
+		verts->x = pRect.left +   x;
+		verts->y = pRect.bottom - y;
+	}
+
+	for( int n = 0 ; n < level.pointsPerCorner ; n++ , verts++, unit++ )
+	{
+		const float x = (unit->s + 1.0f) * size;
+		const float y = (1.0f - unit->c) * size;
+
+		verts->x = pRect.left + x;
+		verts->y = pRect.top +  y;
+	}
+}
+
+void Graphics::GetRoundedRectangleBoarderPoints(const Rectangle& pRect,VertXY::Buffer& rBuffer,float pRadius,float pThickness)
+{
+	const float outerSize = std::min(pRect.GetWidth()*pRadius,pRect.GetHeight()*pRadius);
+	const auto& level = mRoundedRect.GetLevel(outerSize);
+
+	VertXY* verts = rBuffer.Restart(level.numBoarderVertices);
+	VertXY* first = verts;
+	const auto* unit = level.UnitCircle.data();// This starts the circle at the top, so the first corner is the right top one.
+
+	for( int n = 0 ; n < level.pointsPerCorner ; n++, verts += 2, unit++ )
+	{
+		const float x = (1.0f - unit->s) * outerSize;
+		const float y = (1.0f - unit->c) * outerSize;
+
+		verts[1].x = pRect.right - x;
+		verts[1].y = pRect.top +   y;
+
+		verts[0].x = verts[1].x - (unit->s * pThickness);
+		verts[0].y = verts[1].y + (unit->c * pThickness);
+	}
+
+	for( int n = 0 ; n < level.pointsPerCorner ; n++ , verts += 2, unit++ )
+	{
+		const float x = (1.0f - unit->s) * outerSize;
+		const float y = (unit->c + 1.0f) * outerSize;
+
+		verts[1].x = pRect.right -  x;
+		verts[1].y = pRect.bottom - y;
+
+		verts[0].x = verts[1].x - (unit->s * pThickness);
+		verts[0].y = verts[1].y + (unit->c * pThickness);
+	}
+
+	for( int n = 0 ; n < level.pointsPerCorner ; n++ , verts += 2, unit++ )
+	{
+		const float x = (unit->s + 1.0f) * outerSize;
+		const float y = (unit->c + 1.0f) * outerSize;
+
+		verts[1].x = pRect.left +   x;
+		verts[1].y = pRect.bottom - y;
+
+		verts[0].x = verts[1].x - (unit->s * pThickness);
+		verts[0].y = verts[1].y + (unit->c * pThickness);
+	}
+
+	for( int n = 0 ; n < level.pointsPerCorner ; n++ , verts += 2, unit++ )
+	{
+		const float x = (unit->s + 1.0f) * outerSize;
+		const float y = (1.0f - unit->c) * outerSize;
+
+		verts[1].x = pRect.left + x;
+		verts[1].y = pRect.top +  y;
+
+		verts[0].x = verts[1].x - (unit->s * pThickness);
+		verts[0].y = verts[1].y + (unit->c * pThickness);
+	}
+
+	verts[0] = first[0];
+	verts[1] = first[1];
+}
+
+uint32_t Graphics::FontLoad(const std::string& pFontName,int pPixelHeight)
+{
+	VERBOSE_MESSAGE("Loading font -> " << pFontName);
+
+	// Check it's not already loaded at this size.
+	// "slow" search but you should not be loading fonts every frame or loading that many!
+	const std::string id = pFontName + ":" + std::to_string(pPixelHeight);
+	uint32_t loaded = 0;
+	mFreeTypeFonts.ForEach([&loaded,&id](uint32_t pHandle,const FreeTypeFont& pFont)
+	{
+		if( pFont.mID == id )
+		{
+			loaded = pHandle;
+		}
+	});
+
+	if( loaded )
+	{
+		return loaded;
+	}
+
+	// Every size of a file shares the one face, it is only opened if no font has it open.
+	auto LoadFace = [this,&pFontName]()
+	{
+		auto found = mFontFaces.find(pFontName);
+		if( found != mFontFaces.end() )
+		{
+			std::shared_ptr<FreeTypeFace> face = found->second.lock();
+			if( face )
+			{
+				VERBOSE_MESSAGE("Sharing the face of " << pFontName << " saves " << face->mFaceBytes << " bytes");
+				return face;
+			}
+		}
+
+		auto face = std::make_shared<FreeTypeFace>(mFreetype,*mFreetypeMemory,pFontName);
+		mFontFaces[pFontName] = face;
+		return face;
+	};
+
+	// Distance fields are drawn scaled, so their pages are filtered.
+	auto InitialiseCache = [this](FreeTypeFont& rFont,bool pFiltered)
+	{
+		rFont.InitialiseCache(
+			mMaximumAllowedGlyph,
+			mGlyphCachePages,
+			[this,pFiltered](int pWidth,int pHeight)
+			{
+				// Because the glyph rending to texture does not fill the whole texture the GL texture will not be created.
+				// Do I have to make a big memory buffer, fill it with zero, then free the memory.
+				auto zeroMemory = std::make_unique<uint8_t[]>(pWidth * pHeight);
+				memset(zeroMemory.get(),0,pWidth * pHeight);
+
+				return TextureCreate(pWidth,pHeight,zeroMemory.get(),TextureFormat::FORMAT_ALPHA,pFiltered);
+			},
+			[this](uint32_t pTexture,int pX,int pY,int pWidth,int pHeight,const uint8_t* pPixels)
+			{
+				TextureFill(pTexture,pX,pY,pWidth,pHeight,pPixels,TextureFormat::FORMAT_ALPHA);
+			}
+		);
+	};
+
+	// The common characters are rendered on the workers while the application gets on with loading.
+	auto Prerender = [this](FreeTypeFont& rFont)
+	{
+		if( mPrerenderCharacters.size() > 0 )
+		{
+			if( !mGlyphRasterizer )
+			{
+				mGlyphRasterizer = std::make_unique<GlyphRasterizer>(GetWorkerPool());
+			}
+			rFont.Prerender(*mGlyphRasterizer,mPrerenderCharacters);
+		}
+	};
+
+#ifdef PLATFORM_SOFTWARE
+	const bool distanceField = false;// No shaders, the glyphs can only be copied.
+#else
+	const bool distanceField = mFontRendering == FontRendering::SIGNED_DISTANCE_FIELD && pPixelHeight >= mDistanceFieldMinimumSize;
+#endif
+
+	if( distanceField )
+	{
+		std::shared_ptr<FreeTypeFont> face;
+		auto found = mDistanceFieldFaces.find(pFontName);
+		if( found != mDistanceFieldFaces.end() )
+		{
+			face = found->second;
+		}
+		else
+		{
+			face = std::make_shared<FreeTypeFont>(pFontName,LoadFace(),FreeTypeFont::DISTANCE_FIELD_SIZE,true);
+			InitialiseCache(*face,true);
+			mDistanceFieldFaces[pFontName] = face;
+			VERBOSE_MESSAGE("Distance field face loaded: " << pFontName << " Using texture " << face->mPages[0].texture);
+		}
+
+		const uint32_t fontID = mFreeTypeFonts.Add(std::make_unique<FreeTypeFont>(id,face,pPixelHeight));
+		Prerender(mFreeTypeFonts.Get(fontID));
+		VERBOSE_MESSAGE("Free type font loaded: " << fontID << " with internal ID of " << id << " drawn from a distance field");
+		return fontID;
+	}
+
+	const uint32_t fontID = mFreeTypeFonts.Add(std::make_unique<FreeTypeFont>(id,LoadFace(),pPixelHeight));
+	FreeTypeFont& font = mFreeTypeFonts.Get(fontID);
+	InitialiseCache(font,false);
+	Prerender(font);
+
+	VERBOSE_MESSAGE("Free type font loaded: " << fontID << " with internal ID of " << id << " Using texture " << font.mPages[0].texture);
+	return fontID;
+}
+
+void Graphics::FontDelete(const uint32_t pFont)
+{
+	// Make sure it's in our list before we try to delete.
+	const FreeTypeFont* font = mFreeTypeFonts.Find(pFont);
+	if( font != nullptr )
+	{
+		for( const auto& page : font->mPages )
+		{
+			TextureDelete(page.texture);
+		}
+
+		// The face of a distance field font goes with its last size, the other reference is ours in mDistanceFieldFaces.
+		if( font->mDistanceField && font->mDistanceField.use_count() == 2 )
+		{
+			for( const auto& page : font->mDistanceField->mPages )
+			{
+				TextureDelete(page.texture);
+			}
+			for( auto face = mDistanceFieldFaces.begin() ; face != mDistanceFieldFaces.end() ; ++face )
+			{
+				if( face->second == font->mDistanceField )
+				{
+					mDistanceFieldFaces.erase(face);
+					break;
+				}
+			}
+		}
+		mFreeTypeFonts.Remove(pFont);
+	}
+	else
+	{
+		VERBOSE_MESSAGE("Tried to delete font that is not loaded." << pFont);
+	}
+}
+
+void Graphics::FontPrintf(const uint32_t pID,float pX,float pY,Colour pColour,const char* pFmt,...)
+{
+	char buf[1024];
+	va_list args;
+	va_start(args, pFmt);
+	vsnprintf(buf, sizeof(buf), pFmt, args);
+	va_end(args);
+	FontPrint(pID,pX,pY,pColour, buf);
+}
+
+void Graphics::FontPrint(const uint32_t pID,const Rectangle& pRect,const Alignment pAlignment,Colour pColour,const std::string_view& pText)
+{
+	// First we need to get the rect of the text to be rendered.
+	const Rectangle fontRect = FontGetRect(pID,pText);
+
+	float X,Y;
+	GetAlignedTextPosition(pRect,fontRect,pAlignment,X,Y);
+	FontPrint(pID,X,Y,pColour,pText);
+}
+
+Rectangle Graphics::FontGetRect(const uint32_t pID,const std::string_view& pText)
+{
+	return mFreeTypeFonts.Get(pID).GetRect(pText);
+}
+
+GlyphCacheStatistics Graphics::FontGetStatistics(const uint32_t pFont)const
+{
+	return mFreeTypeFonts.Get(pFont).GetStatistics();
+}
+
+void Graphics::FontReleaseFace(const uint32_t pFont,const std::string_view& pKeep)
+{
+	mFreeTypeFonts.Get(pFont).ReleaseFace(pKeep);
+}
+
+FontFaceStatistics Graphics::FontGetFaceStatistics(const uint32_t pFont)const
+{
+	return mFreeTypeFonts.Get(pFont).GetFaceStatistics();
+}
+
+void Graphics::FontSetOutline(const uint32_t pFont,float pWidth,Colour pColour)
+{
+	FreeTypeFont& font = mFreeTypeFonts.Get(pFont);
+	font.mEffects.outlineWidth = pWidth;
+	font.mEffects.outlineColour = pColour;
+}
+
+void Graphics::FontSetShadow(const uint32_t pFont,float pOffsetX,float pOffsetY,float pSoftness,Colour pColour)
+{
+	FreeTypeFont& font = mFreeTypeFonts.Get(pFont);
+	font.mEffects.shadowX = pOffsetX;
+	font.mEffects.shadowY = pOffsetY;
+	font.mEffects.shadowSoftness = pSoftness;
+	font.mEffects.shadowColour = pColour;
+}
+
+void Graphics::TextPrint(uint32_t& rText,const uint32_t pFont,const Rectangle& pRect,const Alignment pAlignment,Colour pColour,const std::string_view& pText)
+{
+	TextRunData::TextRun* run = mTextRuns.runs.Find(rText);
+	if( run == nullptr )
+	{
+		rText = mTextRuns.runs.Add(std::make_unique<TextRunData::TextRun>());
+		run = &mTextRuns.runs.Get(rText);
+	}
+	run->lastUsed = mDiagnostics.frameNumber;
+
+	// A new run has a font of zero so is always built. A font deleted and loaded again gets a new handle, and if glyphs have been
+	// thrown out of the font's cache to make room the generation changes, the quads may point at the wrong glyphs.
+	FreeTypeFont& font = mFreeTypeFonts.Get(pFont);
+	if( run->font != pFont || run->generation != font.GetGeneration() || run->rect != pRect || run->alignment != pAlignment || run->text != pText )
+	{
+		const Rectangle fontRect = font.GetRect(pText);
+
+		float X,Y;
+		GetAlignedTextPosition(pRect,fontRect,pAlignment,X,Y);
+
+		mWorkBuffers.vertices.Restart();
+		mWorkBuffers.uvs.Restart();
+		mWorkBuffers.glyphTextures.clear();
+		font.BuildQuads(pText,X,Y,mWorkBuffers.vertices,mWorkBuffers.uvs,mWorkBuffers.glyphTextures);
+
+		run->font = pFont;
+		run->rect = pRect;
+		run->alignment = pAlignment;
+		run->text = pText;
+		run->bounds.Set(X + fontRect.left,Y + fontRect.top,X + fontRect.right,Y + fontRect.bottom);
+		run->vertices.assign(mWorkBuffers.vertices.Data(),mWorkBuffers.vertices.Data() + mWorkBuffers.vertices.Used());
+		run->uvs.assign(mWorkBuffers.uvs.Data(),mWorkBuffers.uvs.Data() + mWorkBuffers.uvs.Used());
+		run->textures = mWorkBuffers.glyphTextures;
+		run->generation = font.GetGeneration();
+	}
+
+	TextDraw(*run,pColour);
+}
+
+void Graphics::TextDelete(uint32_t pText)
+{
+	mTextRuns.runs.Remove(pText);
+}
+
+Rectangle Graphics::TextGetRect(uint32_t pText)const
+{
+	const TextRunData::TextRun* run = mTextRuns.runs.Find(pText);
+	if( run != nullptr )
+	{
+		return run->bounds;
+	}
+	return Rectangle(0,0,0,0);
+}
+
+void Graphics::GetAlignedTextPosition(const Rectangle& pRect,const Rectangle& pTextRect,const Alignment pAlignment,float& rX,float& rY)
+{
+	const Alignment AX = GET_X_ALIGNMENT(pAlignment);
+	const Alignment AY = GET_Y_ALIGNMENT(pAlignment);
+
+	rX = pRect.left - pTextRect.left;
+	if( AX == ALIGN_CENTER )
+	{
+		rX += (pRect.GetWidth() * 0.5f) - (pTextRect.GetWidth() * 0.5f);
+	}
+	else if( AX == ALIGN_MAX_EDGE )
+	{
+		rX += pRect.GetWidth() - pTextRect.GetWidth();
+	}
+
+	rY = pRect.top - pTextRect.top;
+	if( AY == ALIGN_CENTER )
+	{
+		rY += (pRect.GetHeight() * 0.5f) - (pTextRect.GetHeight() * 0.5f);
+	}
+	else if( AY == ALIGN_MAX_EDGE )
+	{
+		rY += pRect.GetHeight() - pTextRect.GetHeight();
+	}
+}
+
+void Graphics::TextRunsAgeOut()
+{
+	// Elements do not know about us when they are deleted, so text runs that stop being drawn are deleted after a while.
+	std::vector<uint32_t> oldRuns;
+	mTextRuns.runs.ForEach([this,&oldRuns](uint32_t pHandle,const TextRunData::TextRun& pRun)
+	{
+		if( mDiagnostics.frameNumber - pRun.lastUsed > TextRunData::MAX_AGE )
+		{
+			oldRuns.push_back(pHandle);
+		}
+	});
+	for( uint32_t run : oldRuns )
+	{
+		mTextRuns.runs.Remove(run);
+	}
+}
+
+void Graphics::DrawTick(const Rectangle& pRect,Colour pColour,float pThickness)
+{
+	Rectangle r = pRect.GetScaled(0.6f);
+	const float step = r.GetMinSize() * 0.25;
+
+	DrawLine(
+		r.left,
+		r.GetCenterY(),
+		r.left + step,
+		r.GetCenterY() + step,
+		pColour,
+		pThickness
+	);
+
+	DrawLine(
+		r.left + step,
+		r.GetCenterY() + step,
+		r.right,
+		r.top,
+		pColour,
+		pThickness
+	);
+}
+
+uint32_t Graphics::TextureLoad(const std::string& pFilename,bool pFiltered,bool pGenerateMipmaps,bool pUseAtlas)
+{
+	int width,height;
+	bool hasAlpha;
+	const uint8_t* pixels;
+	if( mImageLoader->Load(pFilename,mTextureCache.get(),width,height,hasAlpha,pixels) )
+	{
+		const uint32_t texture = TextureCreate(width,height,pixels,hasAlpha?TextureFormat::FORMAT_RGBA:TextureFormat::FORMAT_RGB,pFiltered,pGenerateMipmaps,pUseAtlas);
+		mImageLoader->cached.Close();
+		return texture;
+	}
+
+	VERBOSE_MESSAGE("Failed to load image " << pFilename);
+	return TextureGetDiagnostics();
+}
+
+uint32_t Graphics::TextureLoadAsync(const std::string& pFilename,bool pFiltered,bool pGenerateMipmaps,bool pUseAtlas)
+{
+	if( mImageDecoder == nullptr )
+	{
+		mImageDecoder = std::make_unique<ImageDecoder>(GetWorkerPool());
+	}
+
+	TextureLoadData::Load load;
+	load.texture = TextureCreatePlaceholder();
+	load.filtered = pFiltered;
+	load.generateMipmaps = pGenerateMipmaps;
+	load.useAtlas = pUseAtlas;
+	load.job = std::make_shared<ImageDecodeJob>();
+	load.job->filename = pFilename;
+	load.job->cache = mTextureCache;
+	mImageDecoder->Add(load.job);
+	mTextureLoads.pending.push_back(load);
+
+	VERBOSE_MESSAGE("Texture " << load.texture << " loading " << pFilename);
+	return load.texture;
+}
+
+Graphics::TextureState Graphics::TextureGetState(uint32_t pTexture)const
+{
+	if( mTextures.Find(pTexture) == nullptr )
+	{
+		THROW_MEANINGFUL_EXCEPTION("TextureGetState passed a texture that does not exist, " + std::to_string(pTexture));
+	}
+
+	for( const auto& load : mTextureLoads.pending )
+	{
+		if( load.texture == pTexture )
+		{
+			return TextureState::PENDING;
+		}
+	}
+	return mTextureLoads.failed.count(pTexture) ? TextureState::FAILED : TextureState::READY;
+}
+
+bool Graphics::TextureGetLoadsWaiting()const
+{
+	for( const auto& load : mTextureLoads.pending )
+	{
+		if( load.job->done )
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+void Graphics::TextureLoadsUpload()
+{
+	size_t bytes = 0;
+	for( auto load = mTextureLoads.pending.begin() ; load != mTextureLoads.pending.end() && (bytes == 0 || bytes < mTextureLoads.uploadBudget) ; )
+	{
+		if( load->job->done == false )
+		{
+			load++;
+			continue;
+		}
+
+		const ImageDecodeJob& job = *load->job;
+		if( job.decoded )
+		{// Made as a new texture then moved to the handle given out, so the placeholder goes and the handle stays the same.
+			const uint32_t texture = TextureCreate(job.width,job.height,job.pixels,job.hasAlpha?TextureFormat::FORMAT_RGBA:TextureFormat::FORMAT_RGB,load->filtered,load->generateMipmaps,load->useAtlas);
+			TextureReplacePlaceholder(load->texture,texture);
+			bytes += (size_t)job.width * job.height * (job.hasAlpha ? 4 : 3);
+			VERBOSE_MESSAGE("Texture " << load->texture << " loaded " << job.filename);
+		}
+		else
+		{
+			mTextureLoads.failed.insert(load->texture);
+		}
+		mTextureLoads.loadedFrame = mDiagnostics.frameNumber;
+		load = mTextureLoads.pending.erase(load);
+	}
+}
+
+WorkerPool& Graphics::GetWorkerPool()
+{
+	if( mWorkerPool == nullptr )
+	{
+		mWorkerPool = std::make_unique<WorkerPool>();
+	}
+	return *mWorkerPool;
+}
+
+bool Graphics::SetTextureCache(const std::string& pDirectory)
+{
+	if( pDirectory.size() == 0 )
+	{// Jobs already queued keep the cache they were given.
+		mTextureCache.reset();
+		return true;
+	}
+
+	if( mkdir(pDirectory.c_str(),0755) != 0 && errno != EEXIST )
+	{
+		VERBOSE_MESSAGE("Failed to make texture cache directory " << pDirectory << ", " << strerror(errno));
+		return false;
+	}
+
+	mTextureCache = std::make_shared<TextureCache>(pDirectory);
+	VERBOSE_MESSAGE("Texture cache is " << pDirectory);
+	return true;
+}
+
+TextureCacheStatistics Graphics::GetTextureCacheStatistics()const
+{
+	TextureCacheStatistics stats;
+	if( mTextureCache )
+	{
+		stats.hits = mTextureCache->hits;
+		stats.misses = mTextureCache->misses;
+		stats.stale = mTextureCache->stale;
+		stats.writes = mTextureCache->writes;
+		stats.failedWrites = mTextureCache->failedWrites;
+	}
+	return stats;
+}
+
+void Graphics::TextureLoadForget(uint32_t pTexture)
+{
+	for( auto load = mTextureLoads.pending.begin() ; load != mTextureLoads.pending.end() ; load++ )
+	{
+		if( load->texture == pTexture )
+		{
+			load->job->cancelled = true;
+			mTextureLoads.pending.erase(load);
+			break;
+		}
+	}
+	mTextureLoads.failed.erase(pTexture);
+}
+
+void Graphics::AddDamage(const Rectangle& pRect)
+{
+	// Snap out to whole pixels, plus one for anti aliased edges, and clip to the display.
+	const Rectangle damage = Rectangle(
+								std::floor(pRect.left) - 1.0f,
+								std::floor(pRect.top) - 1.0f,
+								std::ceil(pRect.right) + 1.0f,
+								std::ceil(pRect.bottom) + 1.0f).GetIntersection(GetDisplayRect());
+
+	if( damage.GetIsEmpty() == false )
+	{
+		mRedraw.damage.push_back(damage);
+	}
+}
+
+bool Graphics::GetIsInRedrawRegion(const Rectangle& pRect)const
+{
+	// All of a layer is rendered, even the parts outside of the region, as it is used again in later frames.
+	if( mRedraw.statistics.fullRedraw || mLayers.rendering != 0 )
+	{
+		return true;
+	}
+	// Grown by a pixel for anti aliased edges that go just outside of the rectangle.
+	return mRedraw.regions[mRedraw.currentRegion].GetOverlaps(pRect.GetShrunk(-1.0f,-1.0f));
+}
+
+/**
+ * @brief Merges the regions so that none overlap, so no pixel is drawn twice, and there are no more than pMaxRegions.
+ * When there are too many the two that waste the least area when merged are merged.
+ */
+static void MergeRegions(std::vector<Rectangle>& rRegions,size_t pMaxRegions)
+{
+	for(;;)
+	{
+		bool merged = true;
+		while( merged )
+		{
+			merged = false;
+			for( size_t a = 0 ; a < rRegions.size() ; a++ )
+			{
+				for( size_t b = a + 1 ; b < rRegions.size() ; )
+				{
+					if( rRegions[a].GetOverlaps(rRegions[b]) )
+					{
+						rRegions[a] = rRegions[a].GetUnion(rRegions[b]);
+						rRegions.erase(rRegions.begin() + b);
+						merged = true;
+					}
+					else
+					{
+						b++;
+					}
+				}
+			}
+		}
+
+		if( rRegions.size() <= pMaxRegions )
+		{
+			return;
+		}
+
+		size_t bestA = 0,bestB = 1;
+		float bestWaste = std::numeric_limits<float>::max();
+		for( size_t a = 0 ; a < rRegions.size() ; a++ )
+		{
+			for( size_t b = a + 1 ; b < rRegions.size() ; b++ )
+			{
+				const float waste = rRegions[a].GetUnion(rRegions[b]).GetArea() - rRegions[a].GetArea() - rRegions[b].GetArea();
+				if( waste < bestWaste )
+				{
+					bestWaste = waste;
+					bestA = a;
+					bestB = b;
+				}
+			}
+		}
+		rRegions[bestA] = rRegions[bestA].GetUnion(rRegions[bestB]);
+		rRegions.erase(rRegions.begin() + bestB);
+	}
+}
+
+void Graphics::BuildRedrawRegions()
+{
+	const Rectangle display = GetDisplayRect();
+
+	if( mRedraw.damage.size() > mRedraw.MAX_DAMAGE )
+	{// So much has changed that working out the regions would cost more than it saves.
+		Rectangle all = mRedraw.damage[0];
+		for( const auto& d : mRedraw.damage )
+		{
+			all = all.GetUnion(d);
+		}
+		mRedraw.damage.assign(1,all);
+	}
+	MergeRegions(mRedraw.damage,mRedraw.MAX_REGIONS);
+
+	// The back buffer holds what was drawn bufferAge frames ago, so what has changed since then has to be redrawn too.
+	bool fullRedraw = mRedraw.enabled == false ||
+						mRedraw.damage.size() == 0 ||
+						mRedraw.bufferAge == 0 ||
+						mRedraw.bufferAge - 1 > mRedraw.historyCount;
+
+	mRedraw.regions.clear();
+	if( fullRedraw == false )
+	{
+		mRedraw.regions = mRedraw.damage;
+		for( uint32_t n = 0 ; n < mRedraw.bufferAge - 1 ; n++ )
+		{
+			mRedraw.regions.insert(mRedraw.regions.end(),mRedraw.history[n].begin(),mRedraw.history[n].end());
+		}
+		MergeRegions(mRedraw.regions,mRedraw.MAX_REGIONS);
+	}
+
+	float pixels = 0.0f;
+	for( const auto& r : mRedraw.regions )
+	{
+		pixels += r.GetArea();
+	}
+
+	if( fullRedraw || pixels >= display.GetArea() )
+	{
+		fullRedraw = true;
+		pixels = display.GetArea();
+		mRedraw.regions.assign(1,display);
+	}
+
+	mRedraw.frameDamage.clear();
+	for( const auto& d : mRedraw.damage )
+	{
+		mRedraw.frameDamage.push_back(GetWindowRect(d));
+	}
+
+	// Remember what changed this frame for when the buffer age is more than one. The oldest entry's memory is reused.
+	std::rotate(std::begin(mRedraw.history),std::end(mRedraw.history) - 1,std::end(mRedraw.history));
+	if( mRedraw.damage.size() > 0 )
+	{
+		mRedraw.history[0] = mRedraw.damage;
+	}
+	else
+	{
+		mRedraw.history[0].assign(1,display);
+	}
+	mRedraw.historyCount = std::min(mRedraw.historyCount + 1,mRedraw.MAX_HISTORY);
+	mRedraw.damage.clear();
+
+	mRedraw.statistics.regions = (uint32_t)mRedraw.regions.size();
+	mRedraw.statistics.pixels = (uint32_t)pixels;
+	mRedraw.statistics.percentage = pixels * 100.0f / display.GetArea();
+	mRedraw.statistics.fullRedraw = fullRedraw;
+
+	if( fullRedraw == false && mRedraw.onRedrawRegions )
+	{
+		mRedraw.windowRegions.clear();
+		for( const auto& r : mRedraw.regions )
+		{
+			mRedraw.windowRegions.push_back(GetWindowRect(r));
+		}
+		mRedraw.onRedrawRegions(mRedraw.windowRegions);
+	}
+}
+
+Rectangle Graphics::GetWindowRect(const Rectangle& pRect)const
+{
+	// Use the projection so that the display rotation is taken into account.
+	auto ToWindow = [this](float pX,float pY,float& rX,float& rY)
+	{
+		const float x = (pX * mMatrices.projection[0][0]) + (pY * mMatrices.projection[1][0]) + mMatrices.projection[3][0];
+		const float y = (pX * mMatrices.projection[0][1]) + (pY * mMatrices.projection[1][1]) + mMatrices.projection[3][1];
+		rX = (x + 1.0f) * 0.5f * (float)mPhysical.Width;
+		rY = (y + 1.0f) * 0.5f * (float)mPhysical.Height;
+	};
+
+	float x1,y1,x2,y2;
+	ToWindow(pRect.left,pRect.top,x1,y1);
+	ToWindow(pRect.right,pRect.bottom,x2,y2);
+
+	// left / top are the smallest x / y, so top is really the bottom of the rectangle as GL has the origin at the bottom left.
+	return Rectangle(
+			std::floor(std::min(x1,x2)),
+			std::floor(std::min(y1,y2)),
+			std::ceil(std::max(x1,x2)),
+			std::ceil(std::max(y1,y2))).GetIntersection(Rectangle(0.0f,0.0f,(float)mPhysical.Width,(float)mPhysical.Height));
+}
+
+void Graphics::CountTextureUpload(int pWidth,int pHeight,TextureFormat pFormat)
+{
+	const int bytesPerPixel = pFormat == TextureFormat::FORMAT_RGBA ? 4 : (pFormat == TextureFormat::FORMAT_RGB ? 3 : 1);
+	mDiagnostics.current.textureUploads++;
+	mDiagnostics.current.textureUploadBytes += (uint64_t)pWidth * pHeight * bytesPerPixel;
+}
+
+void Graphics::FinishFrameStatistics(size_t pScratchGrowCount)
+{
+	const size_t growCount = pScratchGrowCount + mWorkBuffers.scratchRam.GrowCount() + mWorkBuffers.vertices.GrowCount() + mWorkBuffers.uvs.GrowCount();
+
+	FrameStatistics& frame = mDiagnostics.current;
+	frame.frameNumber = mDiagnostics.frameNumber;
+	frame.vertices = mBatching.current.vertices;
+	frame.scratchGrowths = (uint32_t)(growCount - mDiagnostics.scratchGrowths);
+	mDiagnostics.scratchGrowths = growCount;
+
+	mDiagnostics.lastFrame = frame;
+	mDiagnostics.current = FrameStatistics();
+}
+
+void Graphics::BuildDebugTexture()
+{
+	VERBOSE_MESSAGE("Creating mDiagnostics.texture");
+	uint8_t pixels[16*16*4];
+	uint8_t* dst = pixels;
+	for( int y = 0 ; y < 16 ; y++ )
+	{
+		for( int x = 0 ; x < 16 ; x++ )
+		{
+			if( (x&1) == (y&1) )
+			{
+				dst[0] = 255;dst[1] = 0;dst[2] = 255;dst[3] = 255;
+			}
+			else
+			{
+				dst[0] = 0;dst[1] = 255;dst[2] = 0;dst[3] = 255;
+			}
+			dst+=4;
+		}
+	}
+	// Put some dots in so I know which way is up and if it's flipped.
+	pixels[(16*4) + (7*4) + 0] = 0xff;
+	pixels[(16*4) + (7*4) + 1] = 0x0;
+	pixels[(16*4) + (7*4) + 2] = 0x0;
+	pixels[(16*4) + (8*4) + 0] = 0xff;
+	pixels[(16*4) + (8*4) + 1] = 0x0;
+	pixels[(16*4) + (8*4) + 2] = 0x0;
+
+	pixels[(16*4*7) + (14*4) + 0] = 0x00;
+	pixels[(16*4*7) + (14*4) + 1] = 0x0;
+	pixels[(16*4*7) + (14*4) + 2] = 0xff;
+	pixels[(16*4*8) + (14*4) + 0] = 0x00;
+	pixels[(16*4*8) + (14*4) + 1] = 0x0;
+	pixels[(16*4*8) + (14*4) + 2] = 0xff;
+
+	mDiagnostics.texture = TextureCreate(16,16,pixels,TextureFormat::FORMAT_RGBA);
+}
+
+void Graphics::InitFreeTypeFont()
+{
+	// Made with our own memory functions, so what each face costs can be counted.
+	mFreetypeMemory = std::make_unique<FreeTypeMemory>();
+	if( FT_New_Library(&mFreetypeMemory->record,&mFreetype) == 0 )
+	{
+		FT_Add_Default_Modules(mFreetype);
+		FT_Set_Default_Properties(mFreetype);
+		VERBOSE_MESSAGE("Freetype font library created");
+	}
+	else
+	{
+		THROW_MEANINGFUL_EXCEPTION("Failed to init free type font library");
+	}
+}
+
+void Graphics::InitRoundedRect()
+{
+	// The most a straight edge between two points on a circle is away from the circle is r * (1 - cos(step/2)),
+	// so for each radius find the fewest points that keep within the allowed error.
+	for( int radius = 0 ; radius <= mRoundedRect.MAX_TABLE_RADIUS ; radius++ )
+	{
+		int points = mRoundedRect.MIN_POINTS_PER_CORNER;
+		if( radius > mRoundedRect.MAX_ERROR )
+		{
+			const float step = 2.0f * acos(1.0f - (mRoundedRect.MAX_ERROR / (float)radius));
+			points = (int)ceil((GetRadian() / mRoundedRect.NUM_QUADRANTS) / step) + 1;
+		}
+		mRoundedRect.PointsPerCornerForRadius[radius] = (uint8_t)std::clamp(points,mRoundedRect.MIN_POINTS_PER_CORNER,mRoundedRect.MAX_POINTS_PER_CORNER);
+	}
+
+	for( int pointsPerCorner = mRoundedRect.MIN_POINTS_PER_CORNER ; pointsPerCorner <= mRoundedRect.MAX_POINTS_PER_CORNER ; pointsPerCorner++ )
+	{
+		auto& level = mRoundedRect.Levels[pointsPerCorner];
+		level.pointsPerCorner = pointsPerCorner;
+		level.numVertices = pointsPerCorner * mRoundedRect.NUM_QUADRANTS;
+		level.numBoarderVertices = (pointsPerCorner * mRoundedRect.NUM_QUADRANTS * 2) + 2;
+
+		// Each corner starts on the angle the last one finished on, so the points where the corners meet are the same.
+		const float angleInc = GetRadian() / ((float)(pointsPerCorner-1) * mRoundedRect.NUM_QUADRANTS);
+		for( int q = 0 ; q < mRoundedRect.NUM_QUADRANTS ; q++ )
+		{
+			for( int n = 0 ; n < pointsPerCorner ; n++ )
+			{
+				const float A = (float)((q * (pointsPerCorner - 1)) + n) * angleInc;
+				level.UnitCircle.push_back({(float)sin(A),(float)cos(A)});
+			}
+		}
+
+		auto PUSH_LIGHT = [&level]()
+		{
+			level.BoarderWhite.push_back(eui::COLOUR_WHITE);
+			level.BoarderWhite.push_back(eui::COLOUR_WHITE);
+
+			level.BoarderRaised.push_back(eui::COLOUR_WHITE);
+			level.BoarderRaised.push_back(eui::COLOUR_LIGHT_GREY);
+
+			level.BoarderDepressed.push_back(eui::COLOUR_DARK_GREY);
+			level.BoarderDepressed.push_back(eui::COLOUR_BLACK);
+		};
+
+		auto PUSH_DARK = [&level]()
+		{
+			level.BoarderWhite.push_back(eui::COLOUR_WHITE);
+			level.BoarderWhite.push_back(eui::COLOUR_WHITE);
+
+			level.BoarderRaised.push_back(eui::COLOUR_DARK_GREY);
+			level.BoarderRaised.push_back(eui::COLOUR_BLACK);
+
+			level.BoarderDepressed.push_back(eui::COLOUR_WHITE);
+			level.BoarderDepressed.push_back(eui::COLOUR_LIGHT_GREY);		
+		};
+
+	// Top right
+		for( int n = 0 ; n < pointsPerCorner/2 ; n++ )
+		{
+			PUSH_LIGHT();
+		}
+		for( int n = 0 ; n < pointsPerCorner/2 ; n++ )
+		{
+			PUSH_DARK();
+		}
+	// Bottom right
+		for( int n = 0 ; n < pointsPerCorner ; n++ )
+		{
+			PUSH_DARK();
+		}
+	// Bottom left
+		for( int n = 0 ; n < pointsPerCorner/2 ; n++ )
+		{
+			PUSH_DARK();
+		}
+
+		for( int n = 0 ; n < pointsPerCorner/2 ; n++ )
+		{
+			PUSH_LIGHT();
+		}
+	// Top left
+		for( int n = 0 ; n < pointsPerCorner ; n++ )
+		{
+			PUSH_LIGHT();
+		}
+
+		PUSH_LIGHT();
+		PUSH_LIGHT();
+		PUSH_LIGHT();
+	}
+}
+
+void Graphics::SetProjection2D()
+{
+	// Setup 2D frustum
+	memset(mMatrices.projection,0,sizeof(mMatrices.projection));
+	mMatrices.projection[3][3] = 1;
+
+	if( mDisplayRotation == ROTATE_FRAME_BUFFER_90 )
+	{
+		mMatrices.projection[0][1] = -2.0f / (float)mPhysical.Height;
+		mMatrices.projection[1][0] = -2.0f / (float)mPhysical.Width;
+				
+		mMatrices.projection[3][0] = 1;
+		mMatrices.projection[3][1] = 1;
+	}
+	else if( mDisplayRotation == ROTATE_FRAME_BUFFER_180 )
+	{
+		mMatrices.projection[0][0] = -2.0f / (float)mPhysical.Width;
+		mMatrices.projection[1][1] = 2.0f / (float)mPhysical.Height;
+				
+		mMatrices.projection[3][0] = 1;
+		mMatrices.projection[3][1] = -1;
+	}
+	else if( mDisplayRotation == ROTATE_FRAME_BUFFER_270 )
+	{
+		mMatrices.projection[0][1] = 2.0f / (float)mPhysical.Height;
+		mMatrices.projection[1][0] = 2.0f / (float)mPhysical.Width;
+				
+		mMatrices.projection[3][0] = -1;
+		mMatrices.projection[3][1] = -1;
+	}
+	else// what ever the HW is with no rotation.
+	{
+		mMatrices.projection[0][0] = 2.0f / (float)mPhysical.Width;
+		mMatrices.projection[1][1] = -2.0f / (float)mPhysical.Height;
+		mMatrices.projection[3][0] = -1;
+		mMatrices.projection[3][1] = 1;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+}//namespace eui{
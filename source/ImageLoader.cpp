@@ -0,0 +1,118 @@
+#include "ImageLoader.h"
+#include "Diagnostics.h"
+
+#include <iostream>
+
+#include <sys/mman.h>
+
+namespace eui{
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool IMAGE_LOADER::ReadFile(const std::string& pFilename)
+{
+	// Read once from start to end, so the kernel can read ahead and free the pages behind sooner.
+	if( file.Open(pFilename,MADV_SEQUENTIAL) == false )
+	{
+		VERBOSE_MESSAGE("Failed to open image " << pFilename);
+		return false;
+	}
+	return true;
+}
+
+bool IMAGE_LOADER::Decode(int& rWidth,int& rHeight,bool& rHasAlpha)
+{
+	bool decoded = false;
+	if( png.ReadHeaderFromMemory(file.GetData(),file.GetSize()) )
+	{// Decoded straight into the pixels we upload, rather than into the loader and then copied out.
+		rWidth = png.GetWidth();
+		rHeight = png.GetHeight();
+		rHasAlpha = png.GetHasAlpha();
+		pixelBuffer.resize((size_t)rWidth * rHeight * (rHasAlpha ? 4 : 3));
+		decoded = png.DecodeFromMemory(file.GetData(),file.GetSize(),pixelBuffer.data(),rHasAlpha);
+	}
+	else if( tga.LoadFromMemory(file.GetData(),file.GetSize()) )
+	{
+		rWidth = tga.GetWidth();
+		rHeight = tga.GetHeight();
+		rHasAlpha = tga.GetHasAlpha();
+		decoded = rHasAlpha ? tga.GetRGBA(pixelBuffer) : tga.GetRGB(pixelBuffer);
+	}
+	file.Close();
+	return decoded;
+}
+
+bool IMAGE_LOADER::Load(const std::string& pFilename,TextureCache* pCache,int& rWidth,int& rHeight,bool& rHasAlpha,const uint8_t*& rPixels)
+{
+	cached.Close();
+
+	TextureCache::Source source;
+	if( pCache && pCache->Find(pFilename,source,cached,rWidth,rHeight,rHasAlpha,rPixels) )
+	{
+		return true;
+	}
+
+	if( ReadFile(pFilename) == false || Decode(rWidth,rHeight,rHasAlpha) == false )
+	{
+		return false;
+	}
+
+	rPixels = pixelBuffer.data();
+	if( pCache )
+	{
+		pCache->Store(source,rWidth,rHeight,rHasAlpha,rPixels);
+	}
+	return true;
+}
+
+ImageDecoder::ImageDecoder(WorkerPool& rPool) :
+	mPool(rPool),
+	mLoaders(rPool.GetWorkers())
+{
+}
+
+ImageDecoder::~ImageDecoder()
+{
+	mJobs.Wait();
+}
+
+void ImageDecoder::Add(std::shared_ptr<ImageDecodeJob> pJob)
+{
+	mPool.Add(mJobs,[this,pJob](size_t pWorker)
+	{
+		Decode(pWorker,*pJob);
+		pJob->done = true;
+	});
+}
+
+void ImageDecoder::Decode(size_t pWorker,ImageDecodeJob& rJob)
+{
+	if( rJob.cancelled )
+	{
+		return;
+	}
+
+	std::unique_ptr<IMAGE_LOADER>& loader = mLoaders[pWorker];
+	if( !loader )
+	{
+		loader = std::make_unique<IMAGE_LOADER>();
+	}
+
+	rJob.decoded = loader->Load(rJob.filename,rJob.cache.get(),rJob.width,rJob.height,rJob.hasAlpha,rJob.pixels);
+	if( rJob.decoded == false )
+	{
+		VERBOSE_MESSAGE("Failed to load image " << rJob.filename);
+		return;
+	}
+
+	// Handed over, the loader makes a new buffer for the next image. Neither moves the pixels so rJob.pixels stays good.
+	if( rJob.pixels == loader->pixelBuffer.data() )
+	{
+		rJob.decodedPixels.swap(loader->pixelBuffer);
+	}
+	else
+	{
+		rJob.cached = std::move(loader->cached);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+}//namespace eui{
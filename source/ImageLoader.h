@@ -0,0 +1,99 @@
+#ifndef IMAGE_LOADER_H__
+#define IMAGE_LOADER_H__
+
+#include "TinyPNG.h"
+#include "TinyTGA.h"
+#include "MappedFile.h"
+#include "TextureCache.h"
+#include "WorkerPool.h"
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <atomic>
+#include <stdint.h>
+
+namespace eui{
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * @brief The image decoders and the buffers they use, kept between loads so the memory is reused. Used by TextureLoad.
+ */
+struct IMAGE_LOADER
+{
+	IMAGE_LOADER():png(false)
+	{
+
+	}
+	tinypng::Loader png;
+	tinytga::Loader tga;
+	std::vector<uint8_t> pixelBuffer;
+	MappedFile file;	//!< The decoders read the image straight from the mapping, there is no copy of the file.
+	MappedFile cached;	//!< The texture cache entry of the last image Load found there.
+
+	/**
+	 * @brief Maps the file for Decode, returns false if it could not.
+	 */
+	bool ReadFile(const std::string& pFilename);
+
+	/**
+	 * @brief Decodes the PNG or TGA mapped by ReadFile into pixelBuffer, RGBA if rHasAlpha is set else RGB.
+	 * The file is unmapped once done with. Returns false if it is neither or could not be decoded.
+	 */
+	bool Decode(int& rWidth,int& rHeight,bool& rHasAlpha);
+
+	/**
+	 * @brief Gets the pixels of the image from pCache, or ReadFile and Decode then puts them in pCache. pCache can be null.
+	 * rPixels points into cached or pixelBuffer, RGBA if rHasAlpha is set else RGB. Returns false if the image could not be loaded.
+	 */
+	bool Load(const std::string& pFilename,TextureCache* pCache,int& rWidth,int& rHeight,bool& rHasAlpha,const uint8_t*& rPixels);
+};
+
+/**
+ * @brief An image for TextureLoadAsync, read and decoded by an ImageDecoder worker.
+ */
+struct ImageDecodeJob
+{
+	std::string filename;
+	std::shared_ptr<TextureCache> cache;	//!< Null if the texture cache is off.
+	std::atomic<bool> cancelled{false};	//!< Set when the texture is deleted before it is loaded, the worker skips it.
+	std::atomic<bool> done{false};		//!< Set by the worker once the results below are written.
+
+	bool decoded = false;				//!< False if the file could not be read or decoded.
+	int width = 0;
+	int height = 0;
+	bool hasAlpha = false;
+	const uint8_t* pixels = nullptr;	//!< RGBA if hasAlpha else RGB, points into decodedPixels or cached.
+	std::vector<uint8_t> decodedPixels;
+	MappedFile cached;					//!< The texture cache entry when the pixels came from the cache.
+};
+
+/**
+ * @brief Reads and decodes images on the worker pool, so loading lots of images does not stall the UI.
+ * Each worker has its own IMAGE_LOADER, the decoders keep state so can not be shared. The pixels are uploaded by the GL thread.
+ */
+struct ImageDecoder
+{
+	/**
+	 * @brief rPool must outlive the decoder.
+	 */
+	ImageDecoder(WorkerPool& rPool);
+
+	/**
+	 * @brief Waits for the jobs added, they are quick if cancelled.
+	 */
+	~ImageDecoder();
+
+	void Add(std::shared_ptr<ImageDecodeJob> pJob);
+
+private:
+	WorkerPool& mPool;
+	WorkerPool::Group mJobs;
+	std::vector<std::unique_ptr<IMAGE_LOADER>> mLoaders;	//!< One for each worker, made by the worker the first time it decodes.
+
+	void Decode(size_t pWorker,ImageDecodeJob& rJob);
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+}//namespace eui{
+
+#endif //#ifndef IMAGE_LOADER_H__
@@ -0,0 +1,57 @@
+#include "MappedFile.h"
+#include "Diagnostics.h"
+
+#include <iostream>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace eui{
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+bool MappedFile::Open(const std::string& pFilename,int pAdvice)
+{
+	Close();
+
+	const int file = open(pFilename.c_str(),O_RDONLY);
+	if( file < 0 )
+	{
+		VERBOSE_MESSAGE("Failed to open " << pFilename);
+		return false;
+	}
+
+	struct stat info;
+	if( fstat(file,&info) != 0 || info.st_size <= 0 )
+	{
+		VERBOSE_MESSAGE("Failed to map " << pFilename << ", it is empty or not a file");
+		close(file);
+		return false;
+	}
+
+	void* data = mmap(nullptr,(size_t)info.st_size,PROT_READ,MAP_PRIVATE,file,0);
+	close(file);// The mapping keeps the file.
+	if( data == MAP_FAILED )
+	{
+		VERBOSE_MESSAGE("Failed to map " << pFilename);
+		return false;
+	}
+
+	madvise(data,(size_t)info.st_size,pAdvice);
+	mData = (const uint8_t*)data;
+	mSize = (size_t)info.st_size;
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if( mData )
+	{
+		munmap((void*)mData,mSize);
+		mData = nullptr;
+		mSize = 0;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+}//namespace eui{
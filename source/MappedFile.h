@@ -0,0 +1,56 @@
+#ifndef MAPPED_FILE_H__
+#define MAPPED_FILE_H__
+
+#include <string>
+#include <utility>
+#include <stdint.h>
+#include <stddef.h>
+
+namespace eui{
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * @brief A file mapped read only into memory, so it can be read with no copy and no allocation.
+ * The pages are read from the file as they are touched. Unmapped when closed, when another file is opened or when destroyed.
+ */
+struct MappedFile
+{
+	MappedFile() = default;
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+	~MappedFile(){Close();}
+
+	/**
+	 * @brief Moving hands the mapping over, the data does not move so pointers into it stay good.
+	 */
+	MappedFile(MappedFile&& pOther){*this = std::move(pOther);}
+	MappedFile& operator=(MappedFile&& pOther)
+	{
+		if( this != &pOther )
+		{
+			Close();
+			std::swap(mData,pOther.mData);
+			std::swap(mSize,pOther.mSize);
+		}
+		return *this;
+	}
+
+	/**
+	 * @brief Maps pFilename, returns false if it could not be opened or mapped or is empty.
+	 * pAdvice is passed to madvise, MADV_SEQUENTIAL for files read once from start to end so the kernel reads ahead and drops the pages behind.
+	 */
+	bool Open(const std::string& pFilename,int pAdvice);
+
+	void Close();
+
+	const uint8_t* GetData()const{return mData;}
+	size_t GetSize()const{return mSize;}
+
+private:
+	const uint8_t* mData = nullptr;
+	size_t mSize = 0;
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+}//namespace eui{
+
+#endif //#ifndef MAPPED_FILE_H__
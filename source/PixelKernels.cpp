@@ -0,0 +1,706 @@
+#include "PixelKernels.h"
+
+#include <cstring>
+#include <cstdlib>
+
+#if defined(__SSE2__)
+	#include <emmintrin.h>
+	#if defined(__GNUC__)
+		// AVX2 is not turned on for the whole build, the functions that use it say so and are only called if the CPU has it.
+		#include <immintrin.h>
+		#define PIXELS_HAVE_AVX2
+		#define PIXELS_AVX2 __attribute__((target("avx2")))
+	#endif
+#elif defined(__ARM_NEON)
+	#include <arm_neon.h>
+#endif
+
+namespace eui{
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+namespace pixels{
+
+static Instructions GetBestInstructions()
+{
+#if defined(PIXELS_HAVE_AVX2)
+	__builtin_cpu_init();
+	if( __builtin_cpu_supports("avx2") )
+	{
+		return Instructions::AVX2;
+	}
+#endif
+#if defined(__SSE2__)
+	return Instructions::SSE2;
+#elif defined(__ARM_NEON)
+	return Instructions::NEON;
+#else
+	return Instructions::SCALAR;
+#endif
+}
+
+static Instructions gInstructions = GetBestInstructions();
+
+Instructions GetInstructions()
+{
+	return gInstructions;
+}
+
+bool SetInstructions(Instructions pInstructions)
+{
+	bool available = pInstructions == Instructions::SCALAR;
+#if defined(__SSE2__)
+	available |= pInstructions == Instructions::SSE2;
+#endif
+#if defined(PIXELS_HAVE_AVX2)
+	available |= pInstructions == Instructions::AVX2 && __builtin_cpu_supports("avx2");
+#endif
+#if defined(__ARM_NEON)
+	available |= pInstructions == Instructions::NEON;
+#endif
+
+	if( available )
+	{
+		gInstructions = pInstructions;
+	}
+	return available;
+}
+
+const char* GetInstructionsName(Instructions pInstructions)
+{
+	switch( pInstructions )
+	{
+	case Instructions::SCALAR:	return "scalar";
+	case Instructions::SSE2:	return "sse2";
+	case Instructions::AVX2:	return "avx2";
+	case Instructions::NEON:	return "neon";
+	}
+	return "unknown";
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+// The SIMD versions, they return how many bytes or pixels they did and the plain C++ does the rest.
+// The PNG filters Sub, Average and Paeth depend on the pixel before, so can only be done a pixel at a time, four bytes at once.
+// That is only worth it for three and four byte pixels, the common RGB and RGBA.
+
+// Three byte pixels are put together in a register, going through memory with memcpy stalls as the load waits for the partial stores.
+template<size_t BYTES> static inline uint32_t ReadPixel(const uint8_t* pPixel)
+{
+	uint32_t v;
+	if( BYTES == 4 )
+	{
+		memcpy(&v,pPixel,4);
+	}
+	else
+	{
+		uint16_t low;
+		memcpy(&low,pPixel,2);
+		v = low | ((uint32_t)pPixel[2] << 16);
+	}
+	return v;
+}
+
+template<size_t BYTES> static inline void WritePixel(uint8_t* rPixel,uint32_t pValue)
+{
+	if( BYTES == 4 )
+	{
+		memcpy(rPixel,&pValue,4);
+	}
+	else
+	{
+		const uint16_t low = (uint16_t)pValue;
+		memcpy(rPixel,&low,2);
+		rPixel[2] = (uint8_t)(pValue >> 16);
+	}
+}
+
+#if defined(__SSE2__)
+template<size_t BYTES> static inline __m128i LoadPixel(const uint8_t* pPixel)
+{
+	const uint32_t v = ReadPixel<BYTES>(pPixel);
+	return _mm_cvtsi32_si128((int)v);
+}
+
+template<size_t BYTES> static inline void StorePixel(uint8_t* rPixel,__m128i pValue)
+{
+	const uint32_t v = (uint32_t)_mm_cvtsi128_si32(pValue);
+	WritePixel<BYTES>(rPixel,v);
+}
+
+static inline __m128i Select(__m128i pMask,__m128i pTrue,__m128i pFalse)
+{
+	return _mm_or_si128(_mm_and_si128(pMask,pTrue),_mm_andnot_si128(pMask,pFalse));
+}
+
+static inline __m128i Abs16(__m128i pValue)
+{
+	return _mm_max_epi16(pValue,_mm_sub_epi16(_mm_setzero_si128(),pValue));
+}
+
+template<size_t PIXEL_BYTES> static size_t UnfilterPixels_SSE2(uint8_t pFilter,uint8_t* rRow,const uint8_t* pPrevious,size_t pRowBytes)
+{
+	size_t n = 0;
+	const __m128i zero = _mm_setzero_si128();
+	__m128i a = zero;
+	switch( pFilter )
+	{
+	case 1:
+		for( ; n + PIXEL_BYTES <= pRowBytes ; n += PIXEL_BYTES )
+		{
+			a = _mm_add_epi8(a,LoadPixel<PIXEL_BYTES>(rRow + n));
+			StorePixel<PIXEL_BYTES>(rRow + n,a);
+		}
+		break;
+
+	case 3:
+		for( ; n + PIXEL_BYTES <= pRowBytes ; n += PIXEL_BYTES )
+		{
+			// _mm_avg_epu8 rounds up and PNG rounds down, so take off the bit it added.
+			const __m128i b = LoadPixel<PIXEL_BYTES>(pPrevious + n);
+			const __m128i average = _mm_sub_epi8(_mm_avg_epu8(a,b),_mm_and_si128(_mm_xor_si128(a,b),_mm_set1_epi8(1)));
+			a = _mm_add_epi8(LoadPixel<PIXEL_BYTES>(rRow + n),average);
+			StorePixel<PIXEL_BYTES>(rRow + n,a);
+		}
+		break;
+
+	case 4:
+		{// In 16 bits so the differences can go negative.
+			__m128i c = zero;
+			for( ; n + PIXEL_BYTES <= pRowBytes ; n += PIXEL_BYTES )
+			{
+				const __m128i b = _mm_unpacklo_epi8(LoadPixel<PIXEL_BYTES>(pPrevious + n),zero);
+				const __m128i x = _mm_unpacklo_epi8(LoadPixel<PIXEL_BYTES>(rRow + n),zero);
+				const __m128i pa = Abs16(_mm_sub_epi16(b,c));
+				const __m128i pb = Abs16(_mm_sub_epi16(a,c));
+				const __m128i pc = Abs16(_mm_add_epi16(_mm_sub_epi16(b,c),_mm_sub_epi16(a,c)));
+				const __m128i bOrC = Select(_mm_cmpgt_epi16(pb,pc),c,b);
+				const __m128i predictor = Select(_mm_cmpgt_epi16(pa,_mm_min_epi16(pb,pc)),bOrC,a);
+				a = _mm_and_si128(_mm_add_epi16(x,predictor),_mm_set1_epi16(0xff));
+				c = b;
+				StorePixel<PIXEL_BYTES>(rRow + n,_mm_packus_epi16(a,a));
+			}
+		}
+		break;
+	}
+	return n;
+}
+
+static size_t UnfilterRow_SSE2(uint8_t pFilter,uint8_t* rRow,const uint8_t* pPrevious,size_t pRowBytes,size_t pPixelBytes)
+{
+	size_t n = 0;
+	if( pFilter == 2 )
+	{
+		for( ; n + 16 <= pRowBytes ; n += 16 )
+		{
+			const __m128i x = _mm_loadu_si128((const __m128i*)(rRow + n));
+			const __m128i b = _mm_loadu_si128((const __m128i*)(pPrevious + n));
+			_mm_storeu_si128((__m128i*)(rRow + n),_mm_add_epi8(x,b));
+		}
+		return n;
+	}
+
+	switch( pPixelBytes )
+	{
+	case 3:	return UnfilterPixels_SSE2<3>(pFilter,rRow,pPrevious,pRowBytes);
+	case 4:	return UnfilterPixels_SSE2<4>(pFilter,rRow,pPrevious,pRowBytes);
+	}
+	return 0;
+}
+
+static size_t SwapRedBlue4_SSE2(uint8_t* rDest,const uint8_t* pSource,size_t pCount)
+{
+	const __m128i greenAlpha = _mm_set1_epi32((int)0xff00ff00);
+	const __m128i low = _mm_set1_epi32(0x000000ff);
+	size_t n = 0;
+	for( ; n + 4 <= pCount ; n += 4 )
+	{
+		const __m128i p = _mm_loadu_si128((const __m128i*)(pSource + n * 4));
+		const __m128i redBlue = _mm_or_si128(_mm_and_si128(_mm_srli_epi32(p,16),low),_mm_slli_epi32(_mm_and_si128(p,low),16));
+		_mm_storeu_si128((__m128i*)(rDest + n * 4),_mm_or_si128(_mm_and_si128(p,greenAlpha),redBlue));
+	}
+	return n;
+}
+
+static inline __m128i PackRGB565_SSE2(__m128i pColours)
+{
+	const __m128i v = _mm_or_si128(_mm_or_si128(
+							_mm_and_si128(_mm_srli_epi32(pColours,8),_mm_set1_epi32(0xf800)),
+							_mm_and_si128(_mm_srli_epi32(pColours,5),_mm_set1_epi32(0x07e0))),
+							_mm_and_si128(_mm_srli_epi32(pColours,3),_mm_set1_epi32(0x001f)));
+	// _mm_packs_epi32 saturates as signed, sign extending first gets the 16 bits through unchanged.
+	return _mm_srai_epi32(_mm_slli_epi32(v,16),16);
+}
+
+static size_t PackRGB565_SSE2(uint16_t* rDest,const uint32_t* pSource,size_t pCount)
+{
+	size_t n = 0;
+	for( ; n + 8 <= pCount ; n += 8 )
+	{
+		const __m128i lo = PackRGB565_SSE2(_mm_loadu_si128((const __m128i*)(pSource + n)));
+		const __m128i hi = PackRGB565_SSE2(_mm_loadu_si128((const __m128i*)(pSource + n + 4)));
+		_mm_storeu_si128((__m128i*)(rDest + n),_mm_packs_epi32(lo,hi));
+	}
+	return n;
+}
+#endif //#if defined(__SSE2__)
+
+#if defined(PIXELS_HAVE_AVX2)
+// The byte shuffles work in each 128 bit half, so three byte pixels are loaded as two sets of four, twelve bytes apart.
+PIXELS_AVX2 static inline __m256i LoadRGBx8(const uint8_t* pSource)
+{
+	return _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)pSource)),_mm_loadu_si128((const __m128i*)(pSource + 12)),1);
+}
+
+PIXELS_AVX2 static size_t UnfilterRow_AVX2(uint8_t pFilter,uint8_t* rRow,const uint8_t* pPrevious,size_t pRowBytes,size_t pPixelBytes)
+{
+	if( pFilter != 2 )
+	{// The others go a pixel at a time, wider registers do not help.
+		return UnfilterRow_SSE2(pFilter,rRow,pPrevious,pRowBytes,pPixelBytes);
+	}
+
+	size_t n = 0;
+	for( ; n + 32 <= pRowBytes ; n += 32 )
+	{
+		const __m256i x = _mm256_loadu_si256((const __m256i*)(rRow + n));
+		const __m256i b = _mm256_loadu_si256((const __m256i*)(pPrevious + n));
+		_mm256_storeu_si256((__m256i*)(rRow + n),_mm256_add_epi8(x,b));
+	}
+	return n;
+}
+
+PIXELS_AVX2 static size_t SwapRedBlue3_AVX2(uint8_t* rDest,const uint8_t* pSource,size_t pCount)
+{
+	// The last four bytes of each half are put back as they were, the next store writes over them.
+	const __m256i shuffle = _mm256_setr_epi8(2,1,0,5,4,3,8,7,6,11,10,9,12,13,14,15,2,1,0,5,4,3,8,7,6,11,10,9,12,13,14,15);
+	size_t n = 0;
+	for( ; n + 10 <= pCount ; n += 8 )// Reads and writes two pixels past the eight.
+	{
+		const __m256i p = _mm256_shuffle_epi8(LoadRGBx8(pSource + n * 3),shuffle);
+		_mm_storeu_si128((__m128i*)(rDest + n * 3),_mm256_castsi256_si128(p));
+		_mm_storeu_si128((__m128i*)(rDest + n * 3 + 12),_mm256_extracti128_si256(p,1));
+	}
+	return n;
+}
+
+PIXELS_AVX2 static size_t SwapRedBlue4_AVX2(uint8_t* rDest,const uint8_t* pSource,size_t pCount)
+{
+	const __m256i shuffle = _mm256_setr_epi8(2,1,0,3,6,5,4,7,10,9,8,11,14,13,12,15,2,1,0,3,6,5,4,7,10,9,8,11,14,13,12,15);
+	size_t n = 0;
+	for( ; n + 8 <= pCount ; n += 8 )
+	{
+		const __m256i p = _mm256_loadu_si256((const __m256i*)(pSource + n * 4));
+		_mm256_storeu_si256((__m256i*)(rDest + n * 4),_mm256_shuffle_epi8(p,shuffle));
+	}
+	return n;
+}
+
+template<bool SWAP_RED_BLUE> PIXELS_AVX2 static size_t ExpandToRGBA_AVX2(uint8_t* rDest,const uint8_t* pSource,size_t pCount)
+{
+	const __m256i shuffle = SWAP_RED_BLUE ?
+		_mm256_setr_epi8(2,1,0,-1,5,4,3,-1,8,7,6,-1,11,10,9,-1,2,1,0,-1,5,4,3,-1,8,7,6,-1,11,10,9,-1) :
+		_mm256_setr_epi8(0,1,2,-1,3,4,5,-1,6,7,8,-1,9,10,11,-1,0,1,2,-1,3,4,5,-1,6,7,8,-1,9,10,11,-1);
+	const __m256i alpha = _mm256_set1_epi32((int)0xff000000);
+	size_t n = 0;
+	for( ; n + 10 <= pCount ; n += 8 )// Reads two pixels past the eight.
+	{
+		const __m256i p = _mm256_shuffle_epi8(LoadRGBx8(pSource + n * 3),shuffle);
+		_mm256_storeu_si256((__m256i*)(rDest + n * 4),_mm256_or_si256(p,alpha));
+	}
+	return n;
+}
+
+PIXELS_AVX2 static inline __m256i PackRGB565_AVX2(__m256i pColours)
+{
+	const __m256i v = _mm256_or_si256(_mm256_or_si256(
+							_mm256_and_si256(_mm256_srli_epi32(pColours,8),_mm256_set1_epi32(0xf800)),
+							_mm256_and_si256(_mm256_srli_epi32(pColours,5),_mm256_set1_epi32(0x07e0))),
+							_mm256_and_si256(_mm256_srli_epi32(pColours,3),_mm256_set1_epi32(0x001f)));
+	return _mm256_srai_epi32(_mm256_slli_epi32(v,16),16);
+}
+
+PIXELS_AVX2 static size_t PackRGB565_AVX2(uint16_t* rDest,const uint32_t* pSource,size_t pCount)
+{
+	size_t n = 0;
+	for( ; n + 16 <= pCount ; n += 16 )
+	{
+		const __m256i lo = PackRGB565_AVX2(_mm256_loadu_si256((const __m256i*)(pSource + n)));
+		const __m256i hi = PackRGB565_AVX2(_mm256_loadu_si256((const __m256i*)(pSource + n + 8)));
+		// The pack works in each half, the permute puts the four sets of four back in order.
+		_mm256_storeu_si256((__m256i*)(rDest + n),_mm256_permute4x64_epi64(_mm256_packs_epi32(lo,hi),0xd8));
+	}
+	return n;
+}
+#endif //#if defined(PIXELS_HAVE_AVX2)
+
+#if defined(__ARM_NEON)
+template<size_t BYTES> static inline uint8x8_t LoadPixel(const uint8_t* pPixel)
+{
+	const uint32_t v = ReadPixel<BYTES>(pPixel);
+	return vreinterpret_u8_u32(vdup_n_u32(v));
+}
+
+template<size_t BYTES> static inline void StorePixel(uint8_t* rPixel,uint8x8_t pValue)
+{
+	const uint32_t v = vget_lane_u32(vreinterpret_u32_u8(pValue),0);
+	WritePixel<BYTES>(rPixel,v);
+}
+
+template<size_t PIXEL_BYTES> static size_t UnfilterPixels_NEON(uint8_t pFilter,uint8_t* rRow,const uint8_t* pPrevious,size_t pRowBytes)
+{
+	size_t n = 0;
+	uint8x8_t a = vdup_n_u8(0);
+	switch( pFilter )
+	{
+	case 1:
+		for( ; n + PIXEL_BYTES <= pRowBytes ; n += PIXEL_BYTES )
+		{
+			a = vadd_u8(a,LoadPixel<PIXEL_BYTES>(rRow + n));
+			StorePixel<PIXEL_BYTES>(rRow + n,a);
+		}
+		break;
+
+	case 3:
+		for( ; n + PIXEL_BYTES <= pRowBytes ; n += PIXEL_BYTES )
+		{
+			a = vadd_u8(LoadPixel<PIXEL_BYTES>(rRow + n),vhadd_u8(a,LoadPixel<PIXEL_BYTES>(pPrevious + n)));
+			StorePixel<PIXEL_BYTES>(rRow + n,a);
+		}
+		break;
+
+	case 4:
+		{
+			uint8x8_t c = vdup_n_u8(0);
+			for( ; n + PIXEL_BYTES <= pRowBytes ; n += PIXEL_BYTES )
+			{
+				const uint8x8_t b = LoadPixel<PIXEL_BYTES>(pPrevious + n);
+				const uint16x8_t pa = vabdl_u8(b,c);
+				const uint16x8_t pb = vabdl_u8(a,c);
+				const uint16x8_t pc = vabdq_u16(vaddl_u8(a,b),vaddl_u8(c,c));
+				const uint8x8_t bOrC = vbsl_u8(vmovn_u16(vcgtq_u16(pb,pc)),c,b);
+				const uint8x8_t predictor = vbsl_u8(vmovn_u16(vcgtq_u16(pa,vminq_u16(pb,pc))),bOrC,a);
+				a = vadd_u8(LoadPixel<PIXEL_BYTES>(rRow + n),predictor);
+				c = b;
+				StorePixel<PIXEL_BYTES>(rRow + n,a);
+			}
+		}
+		break;
+	}
+	return n;
+}
+
+static size_t UnfilterRow_NEON(uint8_t pFilter,uint8_t* rRow,const uint8_t* pPrevious,size_t pRowBytes,size_t pPixelBytes)
+{
+	size_t n = 0;
+	if( pFilter == 2 )
+	{
+		for( ; n + 16 <= pRowBytes ; n += 16 )
+		{
+			vst1q_u8(rRow + n,vaddq_u8(vld1q_u8(rRow + n),vld1q_u8(pPrevious + n)));
+		}
+		return n;
+	}
+
+	switch( pPixelBytes )
+	{
+	case 3:	return UnfilterPixels_NEON<3>(pFilter,rRow,pPrevious,pRowBytes);
+	case 4:	return UnfilterPixels_NEON<4>(pFilter,rRow,pPrevious,pRowBytes);
+	}
+	return 0;
+}
+
+static size_t SwapRedBlue3_NEON(uint8_t* rDest,const uint8_t* pSource,size_t pCount)
+{
+	size_t n = 0;
+	for( ; n + 16 <= pCount ; n += 16 )
+	{
+		const uint8x16x3_t p = vld3q_u8(pSource + n * 3);
+		const uint8x16x3_t swapped = {{p.val[2],p.val[1],p.val[0]}};
+		vst3q_u8(rDest + n * 3,swapped);
+	}
+	return n;
+}
+
+static size_t SwapRedBlue4_NEON(uint8_t* rDest,const uint8_t* pSource,size_t pCount)
+{
+	size_t n = 0;
+	for( ; n + 16 <= pCount ; n += 16 )
+	{
+		const uint8x16x4_t p = vld4q_u8(pSource + n * 4);
+		const uint8x16x4_t swapped = {{p.val[2],p.val[1],p.val[0],p.val[3]}};
+		vst4q_u8(rDest + n * 4,swapped);
+	}
+	return n;
+}
+
+template<bool SWAP_RED_BLUE> static size_t ExpandToRGBA_NEON(uint8_t* rDest,const uint8_t* pSource,size_t pCount)
+{
+	size_t n = 0;
+	for( ; n + 16 <= pCount ; n += 16 )
+	{
+		const uint8x16x3_t p = vld3q_u8(pSource + n * 3);
+		const uint8x16x4_t rgba = {{p.val[SWAP_RED_BLUE ? 2 : 0],p.val[1],p.val[SWAP_RED_BLUE ? 0 : 2],vdupq_n_u8(255)}};
+		vst4q_u8(rDest + n * 4,rgba);
+	}
+	return n;
+}
+
+static size_t PackRGB565_NEON(uint16_t* rDest,const uint32_t* pSource,size_t pCount)
+{
+	// Colour is blue, green, red then alpha in memory.
+	auto Pack = [](uint8x8_t pRed,uint8x8_t pGreen,uint8x8_t pBlue)
+	{
+		uint16x8_t v = vshll_n_u8(pRed,8);
+		v = vsriq_n_u16(v,vshll_n_u8(pGreen,8),5);
+		return vsriq_n_u16(v,vshll_n_u8(pBlue,8),11);
+	};
+
+	size_t n = 0;
+	for( ; n + 16 <= pCount ; n += 16 )
+	{
+		const uint8x16x4_t p = vld4q_u8((const uint8_t*)(pSource + n));
+		vst1q_u16(rDest + n,Pack(vget_low_u8(p.val[2]),vget_low_u8(p.val[1]),vget_low_u8(p.val[0])));
+		vst1q_u16(rDest + n + 8,Pack(vget_high_u8(p.val[2]),vget_high_u8(p.val[1]),vget_high_u8(p.val[0])));
+	}
+	return n;
+}
+#endif //#if defined(__ARM_NEON)
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+// The kernels, the SIMD version for the instructions being used goes first then the plain C++ finishes off.
+// x	the byte being filtered;
+// a	the byte corresponding to x in the pixel immediately before the pixel containing x (or the byte immediately before x, when the bit depth is less than 8);
+// b	the byte corresponding to x in the previous scanline;
+// c	the byte corresponding to b in the pixel immediately before the pixel containing b (or the byte immediately before b, when the bit depth is less than 8).
+
+// Type	Name	Filter Function	Reconstruction Function
+// 0	None	Filt(x) = Orig(x)	Recon(x) = Filt(x)
+// 1	Sub	Filt(x) = Orig(x) - Orig(a)	Recon(x) = Filt(x) + Recon(a)
+// 2	Up	Filt(x) = Orig(x) - Orig(b)	Recon(x) = Filt(x) + Recon(b)
+// 3	Average	Filt(x) = Orig(x) - floor((Orig(a) + Orig(b)) / 2)	Recon(x) = Filt(x) + floor((Recon(a) + Recon(b)) / 2)
+// 4	Paeth	Filt(x) = Orig(x) - PaethPredictor(Orig(a), Orig(b), Orig(c))	Recon(x) = Filt(x) + PaethPredictor(Recon(a), Recon(b), Recon(c))
+
+static inline uint8_t PaethPredictor(int a,int b,int c)
+{
+	const int p = a + b - c;
+	const int pa = std::abs(p - a);
+	const int pb = std::abs(p - b);
+	const int pc = std::abs(p - c);
+
+	if( pa <= pb && pa <= pc )
+	{
+		return (uint8_t)a;
+	}
+	else if( pb <= pc )
+	{
+		return (uint8_t)b;
+	}
+	return (uint8_t)c;
+}
+
+bool UnfilterRow(uint8_t pFilter,uint8_t* rRow,const uint8_t* pPrevious,size_t pRowBytes,size_t pPixelBytes)
+{
+	if( pFilter > 4 )
+	{
+		return false;
+	}
+
+	size_t x = 0;
+	switch( gInstructions )
+	{
+#if defined(__SSE2__)
+	case Instructions::SSE2:
+		x = UnfilterRow_SSE2(pFilter,rRow,pPrevious,pRowBytes,pPixelBytes);
+		break;
+#endif
+#if defined(PIXELS_HAVE_AVX2)
+	case Instructions::AVX2:
+		x = UnfilterRow_AVX2(pFilter,rRow,pPrevious,pRowBytes,pPixelBytes);
+		break;
+#endif
+#if defined(__ARM_NEON)
+	case Instructions::NEON:
+		x = UnfilterRow_NEON(pFilter,rRow,pPrevious,pRowBytes,pPixelBytes);
+		break;
+#endif
+	default:
+		break;
+	}
+
+	switch( pFilter )
+	{
+	case 0:
+		// No nothing
+		break;
+
+	case 1:
+		// Add the previous value onto the current one.
+		for( ; x < pRowBytes ; x++ )
+		{
+			rRow[x] += rRow[x - pPixelBytes];
+		}
+		break;
+
+	case 2:
+		// Add the previous rows value onto the current one.
+		for( ; x < pRowBytes ; x++ )
+		{
+			rRow[x] += pPrevious[x];
+		}
+		break;
+
+	case 3://Average
+		for( ; x < pRowBytes ; x++ )
+		{
+			rRow[x] += (uint8_t)(((int)rRow[x - pPixelBytes] + (int)pPrevious[x]) / 2);
+		}
+		break;
+
+	case 4://paeth
+		for( ; x < pRowBytes ; x++ )
+		{
+			rRow[x] += PaethPredictor(rRow[x - pPixelBytes],pPrevious[x],pPrevious[x - pPixelBytes]);
+		}
+		break;
+	}
+	return true;
+}
+
+void SwapRedBlue3(uint8_t* rDest,const uint8_t* pSource,size_t pCount)
+{
+	size_t n = 0;
+	switch( gInstructions )
+	{
+#if defined(PIXELS_HAVE_AVX2)
+	case Instructions::AVX2:
+		n = SwapRedBlue3_AVX2(rDest,pSource,pCount);
+		break;
+#endif
+#if defined(__ARM_NEON)
+	case Instructions::NEON:
+		n = SwapRedBlue3_NEON(rDest,pSource,pCount);
+		break;
+#endif
+	default:// SSE2 has no byte shuffle.
+		break;
+	}
+
+	for( ; n < pCount ; n++ )
+	{
+		const uint8_t* src = pSource + n * 3;
+		uint8_t* dst = rDest + n * 3;
+		const uint8_t first = src[0];
+		dst[0] = src[2];
+		dst[1] = src[1];
+		dst[2] = first;
+	}
+}
+
+void SwapRedBlue4(uint8_t* rDest,const uint8_t* pSource,size_t pCount)
+{
+	size_t n = 0;
+	switch( gInstructions )
+	{
+#if defined(__SSE2__)
+	case Instructions::SSE2:
+		n = SwapRedBlue4_SSE2(rDest,pSource,pCount);
+		break;
+#endif
+#if defined(PIXELS_HAVE_AVX2)
+	case Instructions::AVX2:
+		n = SwapRedBlue4_AVX2(rDest,pSource,pCount);
+		break;
+#endif
+#if defined(__ARM_NEON)
+	case Instructions::NEON:
+		n = SwapRedBlue4_NEON(rDest,pSource,pCount);
+		break;
+#endif
+	default:
+		break;
+	}
+
+	for( ; n < pCount ; n++ )
+	{
+		const uint8_t* src = pSource + n * 4;
+		uint8_t* dst = rDest + n * 4;
+		const uint8_t first = src[0];
+		dst[0] = src[2];
+		dst[1] = src[1];
+		dst[2] = first;
+		dst[3] = src[3];
+	}
+}
+
+template<bool SWAP_RED_BLUE> static void ExpandToRGBA(uint8_t* rDest,const uint8_t* pSource,size_t pCount)
+{
+	size_t n = 0;
+	switch( gInstructions )
+	{
+#if defined(PIXELS_HAVE_AVX2)
+	case Instructions::AVX2:
+		n = ExpandToRGBA_AVX2<SWAP_RED_BLUE>(rDest,pSource,pCount);
+		break;
+#endif
+#if defined(__ARM_NEON)
+	case Instructions::NEON:
+		n = ExpandToRGBA_NEON<SWAP_RED_BLUE>(rDest,pSource,pCount);
+		break;
+#endif
+	default:// SSE2 has no byte shuffle.
+		break;
+	}
+
+	for( ; n < pCount ; n++ )
+	{
+		const uint8_t* src = pSource + n * 3;
+		uint8_t* dst = rDest + n * 4;
+		dst[0] = src[SWAP_RED_BLUE ? 2 : 0];
+		dst[1] = src[1];
+		dst[2] = src[SWAP_RED_BLUE ? 0 : 2];
+		dst[3] = 255;
+	}
+}
+
+void ExpandRGBToRGBA(uint8_t* rDest,const uint8_t* pSource,size_t pCount)
+{
+	ExpandToRGBA<false>(rDest,pSource,pCount);
+}
+
+void ExpandBGRToRGBA(uint8_t* rDest,const uint8_t* pSource,size_t pCount)
+{
+	ExpandToRGBA<true>(rDest,pSource,pCount);
+}
+
+void PackRGB565(uint16_t* rDest,const uint32_t* pSource,size_t pCount)
+{
+	size_t n = 0;
+	switch( gInstructions )
+	{
+#if defined(__SSE2__)
+	case Instructions::SSE2:
+		n = PackRGB565_SSE2(rDest,pSource,pCount);
+		break;
+#endif
+#if defined(PIXELS_HAVE_AVX2)
+	case Instructions::AVX2:
+		n = PackRGB565_AVX2(rDest,pSource,pCount);
+		break;
+#endif
+#if defined(__ARM_NEON)
+	case Instructions::NEON:
+		n = PackRGB565_NEON(rDest,pSource,pCount);
+		break;
+#endif
+	default:
+		break;
+	}
+
+	for( ; n < pCount ; n++ )
+	{
+		const uint32_t c = pSource[n];
+		rDest[n] = (uint16_t)(((c >> 8) & 0xf800) | ((c >> 5) & 0x07e0) | ((c >> 3) & 0x001f));
+	}
+}
+
+}// namespace pixels
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+}//namespace eui{
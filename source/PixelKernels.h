@@ -0,0 +1,75 @@
+#ifndef PixelKernels_H__
+#define PixelKernels_H__
+
+#include <cstdint>
+#include <cstddef>
+
+namespace eui{
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * @brief The inner loops of loading and converting images, each works on a run of pixels, often one row.
+ * There are versions for SSE2 and AVX2 on x86, picked at run time from what the CPU has, and NEON on ARM when the compiler has it turned on.
+ * The plain C++ versions do what the others can not and the pixels left over. All versions give exactly the same results.
+ */
+namespace pixels{
+
+enum struct Instructions
+{
+	SCALAR,
+	SSE2,
+	AVX2,
+	NEON
+};
+
+/**
+ * @brief The instructions the kernels are using, the best the CPU has unless changed with SetInstructions.
+ */
+Instructions GetInstructions();
+
+/**
+ * @brief Makes the kernels use pInstructions, returns false and changes nothing if the CPU or the build does not have them.
+ * SCALAR always works. For benchmarks and checking the versions against each other, do not call while images are being loaded.
+ */
+bool SetInstructions(Instructions pInstructions);
+
+const char* GetInstructionsName(Instructions pInstructions);
+
+/**
+ * @brief Undoes the PNG filter of a row in place, returns false if pFilter is not one of the five PNG has.
+ * pPrevious is the row before with its filter undone, all zeros for the first row. The pPixelBytes before
+ * rRow and pPrevious are read as the pixel to the left of the first and must be zero.
+ */
+bool UnfilterRow(uint8_t pFilter,uint8_t* rRow,const uint8_t* pPrevious,size_t pRowBytes,size_t pPixelBytes);
+
+/**
+ * @brief Swaps the first and third byte of pCount three byte pixels, BGR to RGB or back. rDest can be pSource.
+ */
+void SwapRedBlue3(uint8_t* rDest,const uint8_t* pSource,size_t pCount);
+
+/**
+ * @brief Swaps the first and third byte of pCount four byte pixels, BGRA to RGBA or back. rDest can be pSource.
+ * On little endian CPUs this also converts between RGBA and Colour.
+ */
+void SwapRedBlue4(uint8_t* rDest,const uint8_t* pSource,size_t pCount);
+
+/**
+ * @brief RGB to RGBA with alpha 255. rDest can not be pSource.
+ */
+void ExpandRGBToRGBA(uint8_t* rDest,const uint8_t* pSource,size_t pCount);
+
+/**
+ * @brief BGR to RGBA, or RGB to BGRA, with alpha 255. rDest can not be pSource.
+ */
+void ExpandBGRToRGBA(uint8_t* rDest,const uint8_t* pSource,size_t pCount);
+
+/**
+ * @brief Colour to RGB565, the top bits of each channel are kept.
+ */
+void PackRGB565(uint16_t* rDest,const uint32_t* pSource,size_t pCount);
+
+}// namespace pixels
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+}//namespace eui{
+
+#endif //#ifndef PixelKernels_H__
@@ -27,8 +27,10 @@ ResouceMap::ResouceMap(const tinyjson::JsonValue &root,eui::Graphics* pGraphics)
                     }
                     else if( obj.HasValue("texture") )
                     {
-                        VERBOSE_MESSAGE("Texture resource " << obj["texture"].GetString());
-                        this->set(name,pGraphics->TextureLoad(obj["texture"]));
+                        // Small images, such as icons, can share a texture. Saves changing texture for each one when drawing.
+                        const bool useAtlas = obj.HasValue("atlas") && obj["atlas"].GetBoolean();
+                        VERBOSE_MESSAGE("Texture resource " << obj["texture"].GetString() << (useAtlas?" in atlas":""));
+                        this->set(name,pGraphics->TextureLoad(obj["texture"],false,false,useAtlas));
                     }
                 }
             }
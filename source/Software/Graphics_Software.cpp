@@ -0,0 +1,421 @@
+#include "Graphics.h"
+#include "Diagnostics.h"
+#include "SoftwareRasterizer.h"
+#include "SoftwareTexture.h"
+#include "../GL/FreeTypeFont.h"
+#include "../ImageLoader.h"
+#include "../PixelKernels.h"
+
+#include <math.h>
+#include <algorithm>
+#include <cstring>
+
+// The Graphics facade for systems with no GPU, everything is drawn by the CPU into a frame buffer in memory.
+// Shapes are always anti aliased, drawn as the signed distance field shader would, whatever the shape rendering is set to.
+// Layers and the texture atlas are not used, there is no VRAM to save and no texture binds to save.
+namespace eui{
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+Graphics::Graphics()
+{
+	mImageLoader = std::make_unique<IMAGE_LOADER>();
+	mRasterizer = std::make_unique<SoftwareRasterizer>();
+	InitRoundedRect();
+}
+
+Graphics::~Graphics()
+{
+	VERBOSE_MESSAGE("Software renderer destructor called");
+
+	// delete all free type fonts.
+	mFreeTypeFonts.Clear();
+	mGlyphRasterizer.reset();
+	if( mFreetype != nullptr )
+	{
+		// Made with FT_New_Library, so FT_Done_FreeType would try to free our memory functions.
+		if( FT_Done_Library(mFreetype) == FT_Err_Ok )
+		{
+			mFreetype = nullptr;
+			mFreetypeMemory.reset();
+			VERBOSE_MESSAGE("Freetype font library deleted");
+		}
+	}
+
+	// Images still loading are not wanted now, the workers skip them.
+	for( auto& load : mTextureLoads.pending )
+	{
+		load.job->cancelled = true;
+	}
+	mImageDecoder.reset();
+
+	mTextures.Clear();
+	VERBOSE_MESSAGE("All done");
+}
+
+void Graphics::InitialiseGL(int pWidth,int pHeight)
+{
+	mPhysical.Width = pWidth;
+	mPhysical.Height = pHeight;
+
+	SetDisplayRotation(ROTATE_FRAME_LANDSCAPE);
+
+	VERBOSE_MESSAGE("Physical display resolution is " << mPhysical.Width << "x" << mPhysical.Height );
+
+	mRasterizer->SetSize(mReported.Width,mReported.Height);
+	BuildDebugTexture();
+	InitFreeTypeFont();
+
+	VERBOSE_MESSAGE("Software renderer Ready");
+}
+
+void Graphics::BeginFrame()
+{
+	mDiagnostics.frameNumber++;
+	mBatching.current = DrawListStatistics();
+	mLayers.current = LayerStatistics();
+	TextRunsAgeOut();
+	TextureLoadsUpload();
+
+	// The rotation may have been changed since the last frame.
+	if( mRasterizer->GetWidth() != mReported.Width || mRasterizer->GetHeight() != mReported.Height )
+	{
+		mRasterizer->SetSize(mReported.Width,mReported.Height);
+		mRedraw.bufferAge = 0;
+	}
+
+	BuildRedrawRegions();
+	SetRedrawRegion(0);
+}
+
+void Graphics::EndFrame()
+{
+	mBatching.lastFrame = mBatching.current;
+	FinishFrameStatistics(0);
+
+	mLayers.current.budget = mLayers.budget;
+	mLayers.lastFrame = mLayers.current;
+
+	mRasterizer->ClearClip();
+	mRedraw.bufferAge = 0;// The platform code has to tell us again for the next frame.
+}
+
+void Graphics::SetRedrawRegion(size_t pIndex)
+{
+	assert(pIndex < mRedraw.regions.size());
+
+	mRedraw.currentRegion = pIndex;
+	if( mRedraw.statistics.fullRedraw )
+	{
+		mRasterizer->ClearClip();
+	}
+	else
+	{// The frame buffer is in display coordinates, so unlike GL the rotation does not come into it.
+		const Rectangle& r = mRedraw.regions[pIndex];
+		mRasterizer->SetClip((int)std::floor(r.left),(int)std::floor(r.top),(int)std::ceil(r.right),(int)std::ceil(r.bottom));
+	}
+}
+
+Graphics::LayerState Graphics::LayerBegin(uint32_t& rLayer,const Rectangle& pRect,bool pContentChanged)
+{// Drawing a layer would cost as much as drawing what is in it.
+	mLayers.current.unavailable++;
+	return LayerState::UNAVAILABLE;
+}
+
+void Graphics::LayerEnd()
+{
+}
+
+void Graphics::LayerDraw(uint32_t pLayer,const Rectangle& pRect)
+{
+}
+
+void Graphics::FontPrint(const uint32_t pID,float pX,float pY,Colour pColour,const std::string_view& pText)
+{
+	FreeTypeFont& font = mFreeTypeFonts.Get(pID);
+
+	mWorkBuffers.vertices.Restart();
+	mWorkBuffers.uvs.Restart();
+	mWorkBuffers.glyphTextures.clear();
+	font.BuildQuads(pText,pX,pY,mWorkBuffers.vertices,mWorkBuffers.uvs,mWorkBuffers.glyphTextures);
+
+	DrawGlyphs(font,mWorkBuffers.glyphTextures.data(),mWorkBuffers.vertices.Data(),mWorkBuffers.uvs.Data(),mWorkBuffers.vertices.Used(),pColour);
+}
+
+void Graphics::TextDraw(const TextRunData::TextRun& pRun,Colour pColour)
+{
+	DrawGlyphs(mFreeTypeFonts.Get(pRun.font),pRun.textures.data(),pRun.vertices.data(),pRun.uvs.data(),pRun.vertices.size(),pColour);
+}
+
+void Graphics::DrawGlyphs(const FreeTypeFont& pFont,const uint32_t* pTextures,const VertXY* pVerts,const VertXY* pUVs,size_t pNumVerts,Colour pColour)
+{
+	// Six vertices a glyph, the first is the top left and the third the bottom right. Glyphs are not scaled so are copied a pixel to a texel.
+	for( size_t n = 0 ; n + 6 <= pNumVerts ; n += 6 )
+	{
+		const SoftwareTexture& texture = mTextures.Get(pTextures[n / 6]);
+		const int x = (int)std::ceil(pVerts[n].x - 0.5f);
+		const int y = (int)std::ceil(pVerts[n].y - 0.5f);
+		const int width = (int)(pVerts[n+2].x - pVerts[n].x + 0.5f);
+		const int height = (int)(pVerts[n+2].y - pVerts[n].y + 0.5f);
+		const int sourceX = (int)((pUVs[n].x * texture.mWidth) + 0.001f);
+		const int sourceY = (int)((pUVs[n].y * texture.mHeight) + 0.001f);
+		mRasterizer->DrawAlphaBlit(texture,sourceX,sourceY,x,y,width,height,pColour);
+		mBatching.current.primitives++;
+	}
+}
+
+void Graphics::DrawRectangle(const Rectangle& pRect,Colour pColour,Colour pBorder,float pRadius,float pThickness,uint32_t pTexture,BoarderStyle pBoarderStyle)
+{
+	SoftwareRasterizer::Shape shape;
+	if( pTexture )
+	{
+		shape.texture = &mTextures.Get(pTexture);
+		shape.fill = pColour == COLOUR_NONE ? COLOUR_WHITE : pColour;
+	}
+	else
+	{
+		shape.fill = pColour;
+	}
+
+	shape.thickness = pBorder != COLOUR_NONE ? pThickness : 0.0f;
+	if( shape.fill == COLOUR_NONE && shape.thickness <= 0.0f )
+	{
+		return;
+	}
+
+	shape.centreX = pRect.GetCenterX();
+	shape.centreY = pRect.GetCenterY();
+	shape.halfWidth = pRect.GetWidth() * 0.5f;
+	shape.halfHeight = pRect.GetHeight() * 0.5f;
+	shape.radius = pRect.GetMinSize() * pRadius;
+	shape.boarder = pBorder;
+	shape.style = pBoarderStyle;
+	mRasterizer->DrawShape(shape);
+	mBatching.current.primitives++;
+	mDiagnostics.current.shapeDrawCalls++;
+}
+
+void Graphics::DrawTexture(const Rectangle& pRect,uint32_t pTexture,Colour pColour)
+{
+	DrawRectangle(pRect,pColour,COLOUR_NONE,0.0f,0.0f,pTexture,BS_SOLID);
+}
+
+void Graphics::DrawLine(float pFromX,float pFromY,float pToX,float pToY,Colour pColour,float pWidth)
+{
+	// A box along the line. Thin lines are a pixel wide, wide ones go past the ends by half the width as the GL ones do.
+	const float dx = pToX - pFromX;
+	const float dy = pToY - pFromY;
+	const float length = std::sqrt((dx*dx) + (dy*dy));
+
+	SoftwareRasterizer::Shape shape;
+	shape.centreX = (pFromX + pToX) * 0.5f;
+	shape.centreY = (pFromY + pToY) * 0.5f;
+	shape.axisX = length > 0.0f ? dx / length : 1.0f;
+	shape.axisY = length > 0.0f ? dy / length : 0.0f;
+	if( pWidth < 2 )
+	{
+		shape.halfWidth = std::max(length * 0.5f,0.5f);
+		shape.halfHeight = 0.5f;
+	}
+	else
+	{
+		shape.halfWidth = (length + pWidth) * 0.5f;
+		shape.halfHeight = pWidth * 0.5f;
+	}
+	shape.fill = pColour;
+	mRasterizer->DrawShape(shape);
+	mBatching.current.primitives++;
+	mDiagnostics.current.shapeDrawCalls++;
+}
+
+void Graphics::DrawRoundedLine(float pFromX,float pFromY,float pToX,float pToY,Colour pColour,float pWidth)
+{
+	const float dx = pToX - pFromX;
+	const float dy = pToY - pFromY;
+	const float length = std::sqrt((dx*dx) + (dy*dy));
+
+	// A rounded rectangle with the radius half the width is a capsule.
+	SoftwareRasterizer::Shape shape;
+	shape.centreX = (pFromX + pToX) * 0.5f;
+	shape.centreY = (pFromY + pToY) * 0.5f;
+	shape.axisX = length > 0.0f ? dx / length : 1.0f;
+	shape.axisY = length > 0.0f ? dy / length : 0.0f;
+	shape.halfWidth = (length + pWidth) * 0.5f;
+	shape.halfHeight = pWidth * 0.5f;
+	shape.radius = shape.halfHeight;
+	shape.fill = pColour;
+	mRasterizer->DrawShape(shape);
+	mBatching.current.primitives++;
+	mDiagnostics.current.shapeDrawCalls++;
+}
+
+uint32_t Graphics::TextureCreate(int pWidth,int pHeight,const uint8_t* pPixels,TextureFormat pFormat,bool pFiltered,bool pGenerateMipmaps,bool pUseAtlas)
+{
+	if( pWidth <= 0 || pHeight <= 0 )
+	{
+		THROW_MEANINGFUL_EXCEPTION("TextureCreate passed an invalid size, " + std::to_string(pWidth) + "x" + std::to_string(pHeight));
+	}
+
+	auto texture = std::make_unique<SoftwareTexture>(pFormat,pWidth,pHeight,pFiltered);
+	if( pPixels != nullptr )
+	{
+		texture->Fill(0,0,pWidth,pHeight,pPixels,pFormat);
+		CountTextureUpload(pWidth,pHeight,pFormat);
+	}
+	const uint32_t handle = mTextures.Add(std::move(texture));
+
+	VERBOSE_MESSAGE("Texture " << handle << " created, " << pWidth << "x" << pHeight << " Filtered = " << (pFiltered?"true":"false"));
+	return handle;
+}
+
+void Graphics::TextureFill(uint32_t pTexture,int pX,int pY,int pWidth,int pHeight,const uint8_t* pPixels,TextureFormat pFormat,bool pGenerateMips)
+{
+	SoftwareTexture& texture = mTextures.Get(pTexture);
+	if( pX < 0 || pY < 0 || pWidth <= 0 || pHeight <= 0 || pX + pWidth > texture.mWidth || pY + pHeight > texture.mHeight )
+	{
+		THROW_MEANINGFUL_EXCEPTION("TextureFill passed an area outside of the texture");
+	}
+	texture.Fill(pX,pY,pWidth,pHeight,pPixels,pFormat);
+	CountTextureUpload(pWidth,pHeight,pFormat);
+}
+
+void Graphics::TextureDelete(uint32_t pTexture)
+{
+	if( pTexture == mDiagnostics.texture )
+	{
+		THROW_MEANINGFUL_EXCEPTION("An attempt was made to delete the debug texture, do not do this!");
+	}
+
+	TextureLoadForget(pTexture);
+	if( mTextures.Remove(pTexture) == false )
+	{
+		VERBOSE_MESSAGE("Tried to delete texture that does not exist, or has already been deleted. " << pTexture);
+	}
+}
+
+uint32_t Graphics::TextureCreatePlaceholder()
+{// A copy, it is only 16x16.
+	return mTextures.Add(std::make_unique<SoftwareTexture>(mTextures.Get(mDiagnostics.texture)));
+}
+
+void Graphics::TextureReplacePlaceholder(uint32_t pPlaceholder,uint32_t pTexture)
+{
+	mTextures.Move(pTexture,pPlaceholder);
+}
+
+int Graphics::TextureGetWidth(uint32_t pTexture)const
+{
+	return mTextures.Get(pTexture).mWidth;
+}
+
+int Graphics::TextureGetHeight(uint32_t pTexture)const
+{
+	return mTextures.Get(pTexture).mHeight;
+}
+
+TextureAtlasStatistics Graphics::GetTextureAtlasStatistics()const
+{
+	return TextureAtlasStatistics();
+}
+
+const GLStateStatistics& Graphics::GetGLStateStatistics()const
+{
+	static const GLStateStatistics none;
+	return none;
+}
+
+bool Graphics::GetGPUFrameTime(double& rMilliseconds)
+{// There is no GPU, the drawing is all in the draw phase of the frame.
+	return false;
+}
+
+void Graphics::SetBatching(bool pEnabled)
+{
+	mBatching.enabled = pEnabled;
+}
+
+void Graphics::FlushDrawList()
+{// Everything is drawn as it is asked for.
+}
+
+const uint32_t* Graphics::GetFrameBufferPixels()const
+{
+	return mRasterizer->GetPixels();
+}
+
+void Graphics::CopyFrameBuffer(uint8_t* rDest,int pPitch,int pBitsPerPixel)const
+{
+	const int width = mRasterizer->GetWidth();
+	if( width != mReported.Width || mRasterizer->GetHeight() != mReported.Height )
+	{// Not drawn at this size yet.
+		return;
+	}
+
+	// Where each row of the display starts in the frame buffer and how far to move for the next pixel along it.
+	const uint32_t* pixels = mRasterizer->GetPixels();
+	for( int y = 0 ; y < mPhysical.Height ; y++ )
+	{
+		const uint32_t* src;
+		ptrdiff_t step;
+		switch( mDisplayRotation )
+		{
+		case ROTATE_FRAME_BUFFER_90:
+			src = pixels + ((mPhysical.Width - 1) * width) + y;
+			step = -width;
+			break;
+
+		case ROTATE_FRAME_BUFFER_180:
+			src = pixels + ((mPhysical.Height - 1 - y) * width) + (mPhysical.Width - 1);
+			step = -1;
+			break;
+
+		case ROTATE_FRAME_BUFFER_270:
+			src = pixels + (mPhysical.Height - 1 - y);
+			step = width;
+			break;
+
+		default:
+			src = pixels + (y * width);
+			step = 1;
+			break;
+		}
+
+		uint8_t* row = rDest + (y * pPitch);
+		if( pBitsPerPixel == 32 )
+		{
+			if( step == 1 )
+			{
+				std::memcpy(row,src,mPhysical.Width * sizeof(uint32_t));
+			}
+			else
+			{
+				uint32_t* dst = (uint32_t*)row;
+				for( int x = 0 ; x < mPhysical.Width ; x++, src += step )
+				{
+					dst[x] = *src;
+				}
+			}
+		}
+		else if( pBitsPerPixel == 16 )
+		{
+			uint16_t* dst = (uint16_t*)row;
+			if( step == 1 )
+			{
+				eui::pixels::PackRGB565(dst,src,mPhysical.Width);// Qualified, pixels is also the frame buffer here.
+			}
+			else
+			{
+				for( int x = 0 ; x < mPhysical.Width ; x++, src += step )
+				{
+					const Colour c = *src;
+					dst[x] = (uint16_t)(((GetRed(c) >> 3) << 11) | ((GetGreen(c) >> 2) << 5) | (GetBlue(c) >> 3));
+				}
+			}
+		}
+		else
+		{
+			THROW_MEANINGFUL_EXCEPTION("CopyFrameBuffer only supports 16 and 32 bits per pixel, not " + std::to_string(pBitsPerPixel));
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+}//namespace eui{
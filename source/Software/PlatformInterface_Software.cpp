@@ -0,0 +1,191 @@
+#include "Diagnostics.h"
+#include "Graphics.h"
+#include "Application.h"
+#include "Element.h"
+
+#include <assert.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <linux/fb.h>
+
+#include <chrono>
+#include <thread>
+
+// For systems with no GPU. Everything is drawn by the CPU, the frame is then copied to the linux frame buffer device if there is one.
+// If there is not, or it can not be used, the frame is only drawn into memory. The application can read it with Graphics::GetFrameBufferPixels,
+// handy for tests and for sending the display somewhere else.
+// Set EDGEUI_FRAME_BUFFER to pick the device, the default is /dev/fb0. Set it to an empty string to only draw into memory.
+
+namespace eui{
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+class PlatformInterface_Software
+{
+public:
+	PlatformInterface_Software(Application* pApplication);
+	~PlatformInterface_Software();
+
+	void MainLoop();
+
+private:
+	Application* mUsersApplication = nullptr;
+	Graphics* mGraphics = nullptr;
+
+	/**
+	 * @brief The linux frame buffer device, if it is being used.
+	 */
+	struct
+	{
+		int device = -1;
+		uint8_t* memory = nullptr;
+		size_t size = 0;
+		int width = 0;
+		int height = 0;
+		int pitch = 0;			//!< Bytes from the start of one row to the next.
+		int bitsPerPixel = 0;
+	}mFrameBuffer;
+
+	/**
+	 * @brief Opens and maps the frame buffer device, returns false if it can not be used.
+	 */
+	bool OpenFrameBuffer(const char* pDevice);
+	void CloseFrameBuffer();
+	void SwapBuffers();
+};
+
+PlatformInterface_Software::PlatformInterface_Software(Application* pApplication):
+	mUsersApplication(pApplication)
+{
+	const char* device = getenv("EDGEUI_FRAME_BUFFER");
+	if( device == nullptr )
+	{
+		device = "/dev/fb0";
+	}
+
+	int width = mUsersApplication->GetEmulatedWidth();
+	int height = mUsersApplication->GetEmulatedHeight();
+	if( device[0] != 0 && OpenFrameBuffer(device) )
+	{
+		width = mFrameBuffer.width;
+		height = mFrameBuffer.height;
+	}
+	else
+	{
+		VERBOSE_MESSAGE("No frame buffer device, drawing into memory only at " << width << "x" << height);
+	}
+
+	mGraphics = new Graphics();
+	mGraphics->InitialiseGL(width,height);
+	mUsersApplication->OnOpen(mGraphics);
+}
+
+PlatformInterface_Software::~PlatformInterface_Software()
+{
+	delete mGraphics;
+	CloseFrameBuffer();
+}
+
+bool PlatformInterface_Software::OpenFrameBuffer(const char* pDevice)
+{
+	mFrameBuffer.device = open(pDevice,O_RDWR);
+	if( mFrameBuffer.device < 0 )
+	{
+		VERBOSE_MESSAGE("Failed to open frame buffer device " << pDevice);
+		return false;
+	}
+
+	fb_var_screeninfo variableInfo;
+	fb_fix_screeninfo fixedInfo;
+	if( ioctl(mFrameBuffer.device,FBIOGET_VSCREENINFO,&variableInfo) != 0 || ioctl(mFrameBuffer.device,FBIOGET_FSCREENINFO,&fixedInfo) != 0 )
+	{
+		VERBOSE_MESSAGE("Failed to read the frame buffer information of " << pDevice);
+		CloseFrameBuffer();
+		return false;
+	}
+
+	// 32 bit is expected to be XRGB8888, what a Colour is, so rows can be copied. 16 bit is RGB565.
+	if( variableInfo.bits_per_pixel != 32 && variableInfo.bits_per_pixel != 16 )
+	{
+		VERBOSE_MESSAGE("Frame buffer " << pDevice << " is " << variableInfo.bits_per_pixel << " bits per pixel, only 16 and 32 are supported");
+		CloseFrameBuffer();
+		return false;
+	}
+
+	mFrameBuffer.width = (int)variableInfo.xres;
+	mFrameBuffer.height = (int)variableInfo.yres;
+	mFrameBuffer.pitch = (int)fixedInfo.line_length;
+	mFrameBuffer.bitsPerPixel = (int)variableInfo.bits_per_pixel;
+	mFrameBuffer.size = (size_t)fixedInfo.line_length * variableInfo.yres;
+
+	void* memory = mmap(nullptr,mFrameBuffer.size,PROT_READ|PROT_WRITE,MAP_SHARED,mFrameBuffer.device,0);
+	if( memory == MAP_FAILED )
+	{
+		VERBOSE_MESSAGE("Failed to map frame buffer " << pDevice);
+		CloseFrameBuffer();
+		return false;
+	}
+	mFrameBuffer.memory = (uint8_t*)memory;
+
+	VERBOSE_MESSAGE("Using frame buffer " << pDevice << " " << mFrameBuffer.width << "x" << mFrameBuffer.height << " " << mFrameBuffer.bitsPerPixel << " bits per pixel");
+	return true;
+}
+
+void PlatformInterface_Software::CloseFrameBuffer()
+{
+	if( mFrameBuffer.memory )
+	{
+		munmap(mFrameBuffer.memory,mFrameBuffer.size);
+		mFrameBuffer.memory = nullptr;
+	}
+
+	if( mFrameBuffer.device >= 0 )
+	{
+		close(mFrameBuffer.device);
+		mFrameBuffer.device = -1;
+	}
+}
+
+void PlatformInterface_Software::SwapBuffers()
+{
+	if( mFrameBuffer.memory )
+	{
+		mGraphics->CopyFrameBuffer(mFrameBuffer.memory,mFrameBuffer.pitch,mFrameBuffer.bitsPerPixel);
+	}
+}
+
+void PlatformInterface_Software::MainLoop()
+{
+	do
+	{
+		assert(mUsersApplication);
+		assert(mGraphics);
+
+		const auto loopTime = std::chrono::system_clock::now() + std::chrono::milliseconds(mUsersApplication->GetUpdateInterval());
+
+		// There is only the one buffer and it is kept from frame to frame, so only what changed has to be drawn.
+		mGraphics->SetBufferAge(1);
+		const uint32_t frame = mGraphics->GetFrameNumber();
+		mUsersApplication->OnFrame(mGraphics,mGraphics->GetDisplayRect());
+		if( mGraphics->GetFrameNumber() != frame )
+		{
+			mUsersApplication->GetProfiler().Begin(FramePhase::SWAP);
+			SwapBuffers();
+			mUsersApplication->GetProfiler().End(FramePhase::SWAP);
+		}
+
+		// There are no events to wait for, so just sleep until the next frame is due.
+		std::this_thread::sleep_until(loopTime);
+	}while(mUsersApplication->GetKeepGoing());
+
+	mUsersApplication->OnClose();
+}
+
+void Application::MainLoop(Application* pApplication)
+{
+	PlatformInterface_Software platform(pApplication);
+	platform.MainLoop();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+}//namespace eui{
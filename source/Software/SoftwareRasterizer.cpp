@@ -0,0 +1,242 @@
+#include "SoftwareRasterizer.h"
+#include "SoftwareSpans.h"
+
+#include <math.h>
+#include <algorithm>
+#include <limits>
+#include <cassert>
+
+namespace eui{
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+void SoftwareRasterizer::SetSize(int pWidth,int pHeight)
+{
+	mWidth = std::max(0,pWidth);
+	mHeight = std::max(0,pHeight);
+	mPixels.assign(mWidth * mHeight,COLOUR_BLACK);
+	mRow.resize(mWidth);
+	ClearClip();
+}
+
+void SoftwareRasterizer::SetClip(int pLeft,int pTop,int pRight,int pBottom)
+{
+	mClip.left = std::clamp(pLeft,0,mWidth);
+	mClip.top = std::clamp(pTop,0,mHeight);
+	mClip.right = std::clamp(pRight,mClip.left,mWidth);
+	mClip.bottom = std::clamp(pBottom,mClip.top,mHeight);
+}
+
+void SoftwareRasterizer::DrawShape(const Shape& pShape)
+{
+	const float hw = pShape.halfWidth;
+	const float hh = pShape.halfHeight;
+	if( hw <= 0.0f || hh <= 0.0f )
+	{
+		return;
+	}
+
+	const float r = std::clamp(pShape.radius,0.0f,std::min(hw,hh));
+	const float t = pShape.thickness;
+	const float ax = pShape.axisX;
+	const float ay = pShape.axisY;
+	const float cx = pShape.centreX;
+	const float cy = pShape.centreY;
+	const bool axisAligned = ax == 1.0f && ay == 0.0f;
+
+	// A pixel bigger all round than the shape so the anti aliased edge is not cut off, as the GL quad is.
+	const float ex = hw + 1.0f;
+	const float ey = hh + 1.0f;
+	const float extentY = (fabs(ay) * ex) + (fabs(ax) * ey);
+	const int top = std::max(mClip.top,(int)floor(cy - extentY));
+	const int bottom = std::min(mClip.bottom,(int)ceil(cy + extentY));
+
+	for( int y = top ; y < bottom ; y++ )
+	{
+		const float dy = (y + 0.5f) - cy;
+
+		// Where this row crosses the box, |dx*a + b| <= e for both of the box's axes.
+		float lo = -std::numeric_limits<float>::max();
+		float hi = std::numeric_limits<float>::max();
+		auto Limit = [&lo,&hi](float a,float b,float e)
+		{
+			if( fabs(a) < 1e-6f )
+			{
+				if( fabs(b) > e )
+				{
+					lo = hi + 1.0f;
+				}
+				return;
+			}
+			float p = (-e - b) / a;
+			float q = (e - b) / a;
+			if( p > q )
+			{
+				std::swap(p,q);
+			}
+			lo = std::max(lo,p);
+			hi = std::min(hi,q);
+		};
+		Limit(ax,dy * ay,ex);
+		Limit(-ay,dy * ax,ey);
+		if( lo > hi )
+		{
+			continue;
+		}
+
+		const int x0 = std::max(mClip.left,(int)floor(cx + lo));
+		const int x1 = std::min(mClip.right,(int)ceil(cx + hi));
+		if( x0 >= x1 )
+		{
+			continue;
+		}
+
+		// The pixels of the row fully inside the fill, if there are any. The maths is the same as ShadePixel's with d <= -(t + 0.5).
+		int solidStart = x1,solidEnd = x1;
+		if( axisAligned )
+		{
+			const float qy = fabs(dy) - hh + r;
+			const float inner = r - t - 0.5f;
+			float halfSpan = -1.0f;
+			if( qy <= 0.0f )
+			{
+				if( qy <= inner )
+				{
+					halfSpan = hw - t - 0.5f;
+				}
+			}
+			else if( inner >= qy )
+			{
+				halfSpan = hw - r + sqrt((inner * inner) - (qy * qy));
+			}
+
+			if( halfSpan >= 0.0f )
+			{
+				solidStart = std::max(x0,(int)ceil(cx - halfSpan - 0.5f));
+				solidEnd = std::min(x1,(int)floor(cx + halfSpan - 0.5f) + 1);
+				if( solidStart >= solidEnd )
+				{
+					solidStart = solidEnd = x1;
+				}
+			}
+		}
+
+		uint32_t* row = mPixels.data() + (y * mWidth);
+		auto ShadeRun = [&](int pFrom,int pTo)
+		{
+			for( int x = pFrom ; x < pTo ; x++ )
+			{
+				const float dx = (x + 0.5f) - cx;
+				const Colour c = ShadePixel(pShape,r,(dx * ax) + (dy * ay),(dy * ax) - (dx * ay));
+				if( GetAlpha(c) > 0 )
+				{
+					row[x] = spans::BlendPixel(c,row[x]);
+				}
+			}
+		};
+
+		ShadeRun(x0,solidStart);
+		if( solidStart < solidEnd )
+		{
+			if( pShape.texture )
+			{
+				uint32_t* src = mRow.data();
+				for( int x = solidStart ; x < solidEnd ; x++ )
+				{
+					*src++ = GetFillColour(pShape,(x + 0.5f) - cx,dy);
+				}
+				spans::BlendSpan(row + solidStart,mRow.data(),solidEnd - solidStart);
+			}
+			else
+			{
+				spans::FillSpan(row + solidStart,solidEnd - solidStart,pShape.fill);
+			}
+		}
+		ShadeRun(solidEnd,x1);
+	}
+}
+
+void SoftwareRasterizer::DrawAlphaBlit(const SoftwareTexture& pTexture,int pSourceX,int pSourceY,int pX,int pY,int pWidth,int pHeight,Colour pColour)
+{
+	assert(pTexture.mFormat == TextureFormat::FORMAT_ALPHA);
+
+	// Clip to the texture and then to the frame buffer, moving the source with the destination.
+	const int left = std::max({pX,mClip.left,pX - pSourceX});
+	const int top = std::max({pY,mClip.top,pY - pSourceY});
+	const int right = std::min({pX + pWidth,mClip.right,pX - pSourceX + pTexture.mWidth});
+	const int bottom = std::min({pY + pHeight,mClip.bottom,pY - pSourceY + pTexture.mHeight});
+	if( left >= right || top >= bottom )
+	{
+		return;
+	}
+
+	for( int y = top ; y < bottom ; y++ )
+	{
+		const uint8_t* mask = pTexture.mAlpha.data() + ((pSourceY + y - pY) * pTexture.mWidth) + (pSourceX + left - pX);
+		spans::BlendMaskSpan(mPixels.data() + (y * mWidth) + left,mask,right - left,pColour);
+	}
+}
+
+Colour SoftwareRasterizer::ShadePixel(const Shape& pShape,float pRadius,float pLocalX,float pLocalY)
+{
+	const float qx = fabs(pLocalX) - pShape.halfWidth + pRadius;
+	const float qy = fabs(pLocalY) - pShape.halfHeight + pRadius;
+	const float mx = std::max(qx,0.0f);
+	const float my = std::max(qy,0.0f);
+	const float d = std::min(std::max(qx,qy),0.0f) + sqrt((mx * mx) + (my * my)) - pRadius;
+
+	const float shape = std::clamp(0.5f - d,0.0f,1.0f);
+	if( shape <= 0.0f )
+	{
+		return COLOUR_NONE;
+	}
+	const float fill = std::clamp(0.5f - (d + pShape.thickness),0.0f,1.0f);
+	const float boarder = shape - fill;
+
+	float shade = 1.0f;
+	if( pShape.style != BS_SOLID && boarder > 0.0f )
+	{// The top and left are lit for raised, the bottom and right for depressed, and get darker going in from the edge.
+		const float nearTopLeft = std::min(pShape.halfWidth + pLocalX,pShape.halfHeight + pLocalY);
+		const float nearBottomRight = std::min(pShape.halfWidth - pLocalX,pShape.halfHeight - pLocalY);
+		bool light = nearBottomRight >= nearTopLeft;
+		if( pShape.style == BS_DEPRESSED )
+		{
+			light = !light;
+		}
+		const float across = std::clamp(-d / std::max(pShape.thickness,1.0f),0.0f,1.0f);
+		shade = light ? Lerp(1.0f,0.784f,across) : Lerp(0.392f,0.0f,across);
+	}
+
+	const Colour fillColour = fill > 0.0f ? GetFillColour(pShape,pLocalX,pLocalY) : COLOUR_NONE;
+	const float fillAlpha = ColourToFloat(GetAlpha(fillColour)) * fill;
+	const float boarderAlpha = ColourToFloat(GetAlpha(pShape.boarder)) * boarder;
+	const float alpha = fillAlpha + boarderAlpha;
+	if( alpha <= 0.0f )
+	{
+		return COLOUR_NONE;
+	}
+
+	auto Mix = [&](uint8_t pFill,uint8_t pBoarder)
+	{
+		const float c = ((pFill * fillAlpha) + (pBoarder * shade * boarderAlpha)) / alpha;
+		return (uint8_t)std::min(c + 0.5f,255.0f);
+	};
+	return MakeColour(
+			Mix(GetRed(fillColour),GetRed(pShape.boarder)),
+			Mix(GetGreen(fillColour),GetGreen(pShape.boarder)),
+			Mix(GetBlue(fillColour),GetBlue(pShape.boarder)),
+			(uint8_t)std::min((alpha * 255.0f) + 0.5f,255.0f));
+}
+
+Colour SoftwareRasterizer::GetFillColour(const Shape& pShape,float pLocalX,float pLocalY)
+{
+	if( pShape.texture == nullptr )
+	{
+		return pShape.fill;
+	}
+
+	const float u = (pLocalX + pShape.halfWidth) / (pShape.halfWidth * 2.0f);
+	const float v = (pLocalY + pShape.halfHeight) / (pShape.halfHeight * 2.0f);
+	return ModulateColour(pShape.texture->Sample(u,v),pShape.fill);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+}//namespace eui{
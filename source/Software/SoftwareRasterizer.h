@@ -0,0 +1,81 @@
+#ifndef SoftwareRasterizer_H__
+#define SoftwareRasterizer_H__
+
+#include "Graphics.h"
+#include "SoftwareTexture.h"
+
+#include <vector>
+
+namespace eui{
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * @brief Draws into a frame buffer in memory, for systems with no GPU.
+ * Everything the Graphics facade draws is a rounded box, the same one the signed distance field shader draws, or a glyph.
+ * Rows of a box that are all inside it are blended with the span functions in SoftwareSpans.h, only the pixels on
+ * the edges and the boarder are worked out one at a time. Pixels are Colour values, top row first.
+ */
+struct SoftwareRasterizer
+{
+	/**
+	 * @brief A rounded box centred on centreX,centreY. axisX,axisY is the unit direction of its width, so lines can be drawn at any angle.
+	 * All sizes are in pixels, a thickness of zero means no boarder.
+	 */
+	struct Shape
+	{
+		float centreX = 0.0f,centreY = 0.0f;
+		float axisX = 1.0f,axisY = 0.0f;
+		float halfWidth = 0.0f,halfHeight = 0.0f;
+		float radius = 0.0f;
+		float thickness = 0.0f;
+		Colour fill = COLOUR_NONE;
+		Colour boarder = COLOUR_NONE;
+		BoarderStyle style = BS_SOLID;
+		const SoftwareTexture* texture = nullptr;	//!< If set the fill is the texture times the fill colour, stretched over the box.
+	};
+
+	void SetSize(int pWidth,int pHeight);
+	int GetWidth()const{return mWidth;}
+	int GetHeight()const{return mHeight;}
+	const uint32_t* GetPixels()const{return mPixels.data();}
+
+	/**
+	 * @brief Only pixels inside the rectangle are drawn, in whole pixels. Clipped to the frame buffer.
+	 */
+	void SetClip(int pLeft,int pTop,int pRight,int pBottom);
+	void ClearClip(){SetClip(0,0,mWidth,mHeight);}
+
+	void DrawShape(const Shape& pShape);
+
+	/**
+	 * @brief Blends pColour through part of an alpha only texture, one texel to one pixel. Used for the glyphs of fonts.
+	 */
+	void DrawAlphaBlit(const SoftwareTexture& pTexture,int pSourceX,int pSourceY,int pX,int pY,int pWidth,int pHeight,Colour pColour);
+
+private:
+	std::vector<uint32_t> mPixels;
+	int mWidth = 0;
+	int mHeight = 0;
+
+	struct
+	{
+		int left = 0,top = 0,right = 0,bottom = 0;	//!< Right and bottom are not included.
+	}mClip;
+
+	std::vector<uint32_t> mRow;	//!< Work buffer for textured rows, the pixels to be blended.
+
+	/**
+	 * @brief Works out the colour of a pixel from its position inside the shape, as the signed distance field shader does.
+	 * The alpha includes how much of the pixel is covered.
+	 */
+	static Colour ShadePixel(const Shape& pShape,float pRadius,float pLocalX,float pLocalY);
+
+	/**
+	 * @brief The fill colour at a point inside the shape, the texture is sampled if it has one.
+	 */
+	static Colour GetFillColour(const Shape& pShape,float pLocalX,float pLocalY);
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+}//namespace eui{
+
+#endif //#ifndef SoftwareRasterizer_H__
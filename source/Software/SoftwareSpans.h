@@ -0,0 +1,236 @@
+#ifndef SoftwareSpans_H__
+#define SoftwareSpans_H__
+
+#include "GraphicsTypes.h"
+
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+#include <cstring>
+
+#if defined(__SSE2__)
+	#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+	#include <arm_neon.h>
+#endif
+
+namespace eui{
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * @brief The inner loops of the software renderer, they blend a run of pixels along one row of the frame buffer.
+ * The blend is the one GL is set up with, source alpha and one minus source alpha, done on all four channels.
+ * Pixels are Colour values. Uses SSE2 or NEON when the compiler has them turned on, the plain C++ does the pixels left over.
+ * All versions round the same way, so the results do not depend on the CPU.
+ */
+namespace spans{
+
+/**
+ * @brief ((pSource * pAlpha) + (pDest * (255 - pAlpha))) / 255, rounded to nearest.
+ */
+inline uint32_t BlendChannel(uint32_t pSource,uint32_t pDest,uint32_t pAlpha)
+{
+	const uint32_t t = (pSource * pAlpha) + (pDest * (255 - pAlpha)) + 128;
+	return (t + (t >> 8)) >> 8;
+}
+
+inline Colour BlendPixel(Colour pSource,Colour pDest,uint32_t pAlpha)
+{
+	return	(BlendChannel(GetAlpha(pSource),GetAlpha(pDest),pAlpha) << 24) |
+			(BlendChannel(GetRed(pSource),GetRed(pDest),pAlpha) << 16) |
+			(BlendChannel(GetGreen(pSource),GetGreen(pDest),pAlpha) << 8) |
+			(BlendChannel(GetBlue(pSource),GetBlue(pDest),pAlpha));
+}
+
+inline Colour BlendPixel(Colour pSource,Colour pDest)
+{
+	return BlendPixel(pSource,pDest,GetAlpha(pSource));
+}
+
+#if defined(__SSE2__)
+/**
+ * @brief The divide by 255 of BlendChannel on eight 16 bit values, pValue already has the 128 added.
+ */
+inline __m128i Divide255(__m128i pValue)
+{
+	return _mm_srli_epi16(_mm_add_epi16(pValue,_mm_srli_epi16(pValue,8)),8);
+}
+
+/**
+ * @brief Blends two pixels, unpacked to 16 bits a channel, with their own alphas.
+ */
+inline __m128i Blend16(__m128i pSource,__m128i pDest,__m128i pAlpha)
+{
+	const __m128i inverse = _mm_sub_epi16(_mm_set1_epi16(255),pAlpha);
+	const __m128i t = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(pSource,pAlpha),_mm_mullo_epi16(pDest,inverse)),_mm_set1_epi16(128));
+	return Divide255(t);
+}
+#elif defined(__ARM_NEON)
+/**
+ * @brief Blends one channel of eight pixels, see BlendChannel.
+ */
+inline uint8x8_t Blend8(uint8x8_t pSource,uint8x8_t pDest,uint8x8_t pAlpha,uint8x8_t pInverse)
+{
+	uint16x8_t t = vmlal_u8(vmull_u8(pSource,pAlpha),pDest,pInverse);
+	t = vaddq_u16(t,vdupq_n_u16(128));
+	return vshrn_n_u16(vsraq_n_u16(t,t,8),8);
+}
+#endif
+
+/**
+ * @brief Blends pColour over pCount pixels.
+ */
+inline void FillSpan(uint32_t* rDest,size_t pCount,Colour pColour)
+{
+	const uint32_t alpha = GetAlpha(pColour);
+	if( alpha == 0 )
+	{
+		return;
+	}
+
+	if( alpha == 255 )
+	{
+		std::fill(rDest,rDest + pCount,pColour);
+		return;
+	}
+
+	size_t n = 0;
+#if defined(__SSE2__)
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i source = _mm_unpacklo_epi8(_mm_set1_epi32((int)pColour),zero);
+	const __m128i sourceTerm = _mm_add_epi16(_mm_mullo_epi16(source,_mm_set1_epi16((short)alpha)),_mm_set1_epi16(128));
+	const __m128i inverse = _mm_set1_epi16((short)(255 - alpha));
+	for( ; n + 4 <= pCount ; n += 4 )
+	{
+		const __m128i d = _mm_loadu_si128((const __m128i*)(rDest + n));
+		const __m128i lo = Divide255(_mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(d,zero),inverse),sourceTerm));
+		const __m128i hi = Divide255(_mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(d,zero),inverse),sourceTerm));
+		_mm_storeu_si128((__m128i*)(rDest + n),_mm_packus_epi16(lo,hi));
+	}
+#elif defined(__ARM_NEON)
+	const uint8x16_t source = vreinterpretq_u8_u32(vdupq_n_u32(pColour));
+	const uint16x8_t sourceTerm = vaddq_u16(vmull_u8(vget_low_u8(source),vdup_n_u8((uint8_t)alpha)),vdupq_n_u16(128));
+	const uint8x8_t inverse = vdup_n_u8((uint8_t)(255 - alpha));
+	for( ; n + 4 <= pCount ; n += 4 )
+	{
+		const uint8x16_t d = vld1q_u8((const uint8_t*)(rDest + n));
+		const uint16x8_t lo = vmlal_u8(sourceTerm,vget_low_u8(d),inverse);
+		const uint16x8_t hi = vmlal_u8(sourceTerm,vget_high_u8(d),inverse);
+		vst1q_u8((uint8_t*)(rDest + n),vcombine_u8(vshrn_n_u16(vsraq_n_u16(lo,lo,8),8),vshrn_n_u16(vsraq_n_u16(hi,hi,8),8)));
+	}
+#endif
+	for( ; n < pCount ; n++ )
+	{
+		rDest[n] = BlendPixel(pColour,rDest[n],alpha);
+	}
+}
+
+/**
+ * @brief Blends pCount pixels, each with its own alpha, over the frame buffer.
+ */
+inline void BlendSpan(uint32_t* rDest,const uint32_t* pSource,size_t pCount)
+{
+	size_t n = 0;
+#if defined(__SSE2__)
+	const __m128i zero = _mm_setzero_si128();
+	for( ; n + 4 <= pCount ; n += 4 )
+	{
+		const __m128i s = _mm_loadu_si128((const __m128i*)(pSource + n));
+		const __m128i d = _mm_loadu_si128((const __m128i*)(rDest + n));
+
+		const __m128i sLo = _mm_unpacklo_epi8(s,zero);
+		const __m128i sHi = _mm_unpackhi_epi8(s,zero);
+		const __m128i aLo = _mm_shufflehi_epi16(_mm_shufflelo_epi16(sLo,_MM_SHUFFLE(3,3,3,3)),_MM_SHUFFLE(3,3,3,3));
+		const __m128i aHi = _mm_shufflehi_epi16(_mm_shufflelo_epi16(sHi,_MM_SHUFFLE(3,3,3,3)),_MM_SHUFFLE(3,3,3,3));
+
+		const __m128i lo = Blend16(sLo,_mm_unpacklo_epi8(d,zero),aLo);
+		const __m128i hi = Blend16(sHi,_mm_unpackhi_epi8(d,zero),aHi);
+		_mm_storeu_si128((__m128i*)(rDest + n),_mm_packus_epi16(lo,hi));
+	}
+#elif defined(__ARM_NEON)
+	for( ; n + 8 <= pCount ; n += 8 )
+	{// Loads the channels into their own registers, B,G,R,A as that is the order of a Colour in memory.
+		const uint8x8x4_t s = vld4_u8((const uint8_t*)(pSource + n));
+		uint8x8x4_t d = vld4_u8((const uint8_t*)(rDest + n));
+		const uint8x8_t inverse = vmvn_u8(s.val[3]);
+		for( int c = 0 ; c < 4 ; c++ )
+		{
+			d.val[c] = Blend8(s.val[c],d.val[c],s.val[3],inverse);
+		}
+		vst4_u8((uint8_t*)(rDest + n),d);
+	}
+#endif
+	for( ; n < pCount ; n++ )
+	{
+		rDest[n] = BlendPixel(pSource[n],rDest[n]);
+	}
+}
+
+/**
+ * @brief Blends pColour over pCount pixels, the alpha of each is scaled by the coverage in pMask. Used for glyphs and anti aliased edges.
+ */
+inline void BlendMaskSpan(uint32_t* rDest,const uint8_t* pMask,size_t pCount,Colour pColour)
+{
+	const uint32_t alpha = GetAlpha(pColour);
+	if( alpha == 0 )
+	{
+		return;
+	}
+
+	size_t n = 0;
+#if defined(__SSE2__)
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i source = _mm_unpacklo_epi8(_mm_set1_epi32((int)pColour),zero);
+	const __m128i colourAlpha = _mm_set1_epi16((short)alpha);
+	for( ; n + 4 <= pCount ; n += 4 )
+	{
+		uint32_t mask4;
+		std::memcpy(&mask4,pMask + n,sizeof(mask4));
+		if( mask4 == 0 )
+		{
+			continue;
+		}
+
+		// Each coverage value times the colour's alpha, spread over the four channels of its pixel.
+		__m128i m = _mm_unpacklo_epi8(_mm_cvtsi32_si128((int)mask4),zero);
+		m = Divide255(_mm_add_epi16(_mm_mullo_epi16(m,colourAlpha),_mm_set1_epi16(128)));
+		m = _mm_unpacklo_epi16(m,m);
+		const __m128i aLo = _mm_unpacklo_epi32(m,m);
+		const __m128i aHi = _mm_unpackhi_epi32(m,m);
+
+		const __m128i d = _mm_loadu_si128((const __m128i*)(rDest + n));
+		const __m128i lo = Blend16(source,_mm_unpacklo_epi8(d,zero),aLo);
+		const __m128i hi = Blend16(source,_mm_unpackhi_epi8(d,zero),aHi);
+		_mm_storeu_si128((__m128i*)(rDest + n),_mm_packus_epi16(lo,hi));
+	}
+#elif defined(__ARM_NEON)
+	const uint8x8_t colourAlpha = vdup_n_u8((uint8_t)alpha);
+	const uint8x8_t channels[4] = {vdup_n_u8(GetBlue(pColour)),vdup_n_u8(GetGreen(pColour)),vdup_n_u8(GetRed(pColour)),vdup_n_u8((uint8_t)alpha)};
+	for( ; n + 8 <= pCount ; n += 8 )
+	{
+		uint16x8_t t = vaddq_u16(vmull_u8(vld1_u8(pMask + n),colourAlpha),vdupq_n_u16(128));
+		const uint8x8_t a = vshrn_n_u16(vsraq_n_u16(t,t,8),8);
+		const uint8x8_t inverse = vmvn_u8(a);
+
+		uint8x8x4_t d = vld4_u8((const uint8_t*)(rDest + n));
+		for( int c = 0 ; c < 4 ; c++ )
+		{
+			d.val[c] = Blend8(channels[c],d.val[c],a,inverse);
+		}
+		vst4_u8((uint8_t*)(rDest + n),d);
+	}
+#endif
+	for( ; n < pCount ; n++ )
+	{
+		if( pMask[n] )
+		{
+			const uint32_t t = (pMask[n] * alpha) + 128;
+			rDest[n] = BlendPixel(pColour,rDest[n],(t + (t >> 8)) >> 8);
+		}
+	}
+}
+
+}//namespace spans{
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+}//namespace eui{
+
+#endif //#ifndef SoftwareSpans_H__
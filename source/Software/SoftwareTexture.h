@@ -0,0 +1,156 @@
+#ifndef SoftwareTexture_H__
+#define SoftwareTexture_H__
+
+#include "Graphics.h"
+#include "../PixelKernels.h"
+
+#include <vector>
+#include <cmath>
+#include <algorithm>
+
+namespace eui{
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * @brief A texture for the software renderer, the pixels are kept in the form the rasterizer reads them.
+ * RGB and RGBA are converted to Colour values. Alpha only textures, the fonts, keep a byte per pixel so glyphs can be blended straight from them.
+ * Like the GL textures coordinates wrap, sampling is nearest or, if filtered, bilinear. Mipmaps are not made.
+ */
+struct SoftwareTexture
+{
+	SoftwareTexture() = delete; // Forces user to use references.
+	SoftwareTexture(TextureFormat pFormat,int pWidth,int pHeight,bool pFiltered):
+		mFormat(pFormat),
+		mWidth(pWidth),
+		mHeight(pHeight),
+		mFiltered(pFiltered)
+	{
+		if( mFormat == TextureFormat::FORMAT_ALPHA )
+		{
+			mAlpha.resize(mWidth * mHeight);
+		}
+		else
+		{
+			mPixels.resize(mWidth * mHeight);
+		}
+	}
+
+	const TextureFormat mFormat;
+	const int mWidth;
+	const int mHeight;
+	const bool mFiltered;
+
+	std::vector<Colour> mPixels;	//!< For FORMAT_RGB and FORMAT_RGBA.
+	std::vector<uint8_t> mAlpha;	//!< For FORMAT_ALPHA.
+
+	/**
+	 * @brief Copies pixels in one of the TextureFormat layouts into the texture, converting them.
+	 */
+	void Fill(int pX,int pY,int pWidth,int pHeight,const uint8_t* pPixels,TextureFormat pFormat)
+	{
+		const int bytesPerPixel = pFormat == TextureFormat::FORMAT_RGBA ? 4 : (pFormat == TextureFormat::FORMAT_RGB ? 3 : 1);
+		for( int y = 0 ; y < pHeight ; y++ )
+		{
+			const uint8_t* src = pPixels + (y * pWidth * bytesPerPixel);
+			const size_t dst = ((pY + y) * mWidth) + pX;
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+			if( mFormat != TextureFormat::FORMAT_ALPHA && pFormat != TextureFormat::FORMAT_ALPHA )
+			{// Colour is blue, green, red then alpha in memory, so the kernels can write the row straight in.
+				uint8_t* dest = (uint8_t*)&mPixels[dst];
+				if( pFormat == TextureFormat::FORMAT_RGBA )
+				{
+					pixels::SwapRedBlue4(dest,src,pWidth);
+				}
+				else
+				{
+					pixels::ExpandBGRToRGBA(dest,src,pWidth);
+				}
+				continue;
+			}
+#endif
+			for( int x = 0 ; x < pWidth ; x++, src += bytesPerPixel )
+			{
+				Colour c;
+				switch( pFormat )
+				{
+				case TextureFormat::FORMAT_RGBA:
+					c = MakeColour(src[0],src[1],src[2],src[3]);
+					break;
+
+				case TextureFormat::FORMAT_RGB:
+					c = MakeColour(src[0],src[1],src[2]);
+					break;
+
+				default:
+					c = MakeColour(0,0,0,src[0]);// What GL gives when sampling an alpha texture.
+					break;
+				}
+
+				if( mFormat == TextureFormat::FORMAT_ALPHA )
+				{
+					mAlpha[dst + x] = GetAlpha(c);
+				}
+				else
+				{
+					mPixels[dst + x] = c;
+				}
+			}
+		}
+	}
+
+	Colour GetTexel(int pX,int pY)const
+	{
+		// Wraps, the same as GL_REPEAT.
+		pX %= mWidth;
+		pY %= mHeight;
+		if( pX < 0 ){pX += mWidth;}
+		if( pY < 0 ){pY += mHeight;}
+
+		const size_t index = (pY * mWidth) + pX;
+		if( mFormat == TextureFormat::FORMAT_ALPHA )
+		{
+			return MakeColour(0,0,0,mAlpha[index]);
+		}
+		return mPixels[index];
+	}
+
+	/**
+	 * @brief Samples the texture at pU,pV, zero to one over the texture. Texel centres are at half texels, as in GL.
+	 */
+	Colour Sample(float pU,float pV)const
+	{
+		const float x = (pU * mWidth) - 0.5f;
+		const float y = (pV * mHeight) - 0.5f;
+		if( mFiltered == false )
+		{
+			return GetTexel((int)std::floor(x + 0.5f),(int)std::floor(y + 0.5f));
+		}
+
+		const float fx = std::floor(x);
+		const float fy = std::floor(y);
+		const int x0 = (int)fx;
+		const int y0 = (int)fy;
+		const uint32_t wx = (uint32_t)((x - fx) * 256.0f);
+		const uint32_t wy = (uint32_t)((y - fy) * 256.0f);
+
+		const Colour c00 = GetTexel(x0,y0);
+		const Colour c10 = GetTexel(x0 + 1,y0);
+		const Colour c01 = GetTexel(x0,y0 + 1);
+		const Colour c11 = GetTexel(x0 + 1,y0 + 1);
+
+		// Eight bits of weight each way, the sum of the four weights is 65536.
+		Colour result = 0;
+		for( int shift = 0 ; shift < 32 ; shift += 8 )
+		{
+			const uint32_t top = (((c00 >> shift) & 0xff) * (256 - wx)) + (((c10 >> shift) & 0xff) * wx);
+			const uint32_t bottom = (((c01 >> shift) & 0xff) * (256 - wx)) + (((c11 >> shift) & 0xff) * wx);
+			const uint32_t value = ((top * (256 - wy)) + (bottom * wy) + 32768) >> 16;
+			result |= std::min(value,255u) << shift;
+		}
+		return result;
+	}
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+}//namespace eui{
+
+#endif //#ifndef SoftwareTexture_H__
@@ -0,0 +1,195 @@
+#include "TextureCache.h"
+#include "Diagnostics.h"
+
+#include <iostream>
+#include <cstring>
+#include <cstdio>
+#include <climits>
+#include <cstdlib>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace eui{
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+// An entry is the header, the path of the image, then the pixels from a 16 byte boundary.
+static const char ENTRY_MAGIC[4] = {'E','U','T','C'};
+static const uint32_t ENTRY_VERSION = 1;// Change when the decoders give different pixels, so old entries are not used.
+
+struct EntryHeader
+{
+	char magic[4];
+	uint32_t version;
+	uint64_t sourceBytes;
+	int64_t sourceModifiedSeconds;
+	int64_t sourceModifiedNanoseconds;
+	uint32_t width;
+	uint32_t height;
+	uint32_t bytesPerPixel;		//!< 3 for RGB, 4 for RGBA.
+	uint32_t pathBytes;
+};
+
+static size_t GetPixelsOffset(uint32_t pPathBytes)
+{
+	return (sizeof(EntryHeader) + pPathBytes + 15) & ~(size_t)15;
+}
+
+static bool WriteAll(int pFile,const void* pData,size_t pBytes)
+{
+	const uint8_t* data = (const uint8_t*)pData;
+	while( pBytes > 0 )
+	{
+		const ssize_t written = write(pFile,data,pBytes);
+		if( written <= 0 )
+		{
+			return false;
+		}
+		data += written;
+		pBytes -= (size_t)written;
+	}
+	return true;
+}
+
+TextureCache::TextureCache(const std::string& pDirectory) :
+	mDirectory(pDirectory)
+{
+}
+
+bool TextureCache::Find(const std::string& pFilename,Source& rSource,MappedFile& rFile,int& rWidth,int& rHeight,bool& rHasAlpha,const uint8_t*& rPixels)
+{
+	if( MapEntry(pFilename,rSource,rFile,rWidth,rHeight,rHasAlpha,rPixels) )
+	{
+		hits++;
+		return true;
+	}
+	misses++;
+	return false;
+}
+
+bool TextureCache::MapEntry(const std::string& pFilename,Source& rSource,MappedFile& rFile,int& rWidth,int& rHeight,bool& rHasAlpha,const uint8_t*& rPixels)
+{
+	char path[PATH_MAX];
+	struct stat info;
+	if( realpath(pFilename.c_str(),path) == nullptr || stat(path,&info) != 0 )
+	{// The decoder will fail to open it too.
+		rSource = Source();
+		return false;
+	}
+	rSource.path = path;
+	rSource.bytes = (uint64_t)info.st_size;
+	rSource.modifiedSeconds = (int64_t)info.st_mtim.tv_sec;
+	rSource.modifiedNanoseconds = (int64_t)info.st_mtim.tv_nsec;
+
+	const std::string entryName = GetEntryName(rSource.path);
+	if( access(entryName.c_str(),F_OK) != 0 )
+	{
+		return false;
+	}
+
+	// The pixels are read once to upload them.
+	if( rFile.Open(entryName,MADV_SEQUENTIAL) == false || rFile.GetSize() < sizeof(EntryHeader) )
+	{
+		rFile.Close();
+		return false;
+	}
+
+	EntryHeader header;
+	memcpy(&header,rFile.GetData(),sizeof(header));
+	const size_t pixelsOffset = GetPixelsOffset(header.pathBytes);
+	if( memcmp(header.magic,ENTRY_MAGIC,4) != 0 || header.version != ENTRY_VERSION ||
+		(header.bytesPerPixel != 3 && header.bytesPerPixel != 4) ||
+		header.pathBytes != rSource.path.size() || rFile.GetSize() < pixelsOffset ||
+		rFile.GetSize() - pixelsOffset != (size_t)header.width * header.height * header.bytesPerPixel )
+	{
+		VERBOSE_MESSAGE("Texture cache entry " << entryName << " is not valid, " << pFilename << " will be decoded");
+		rFile.Close();
+		return false;
+	}
+
+	if( memcmp(rFile.GetData() + sizeof(EntryHeader),rSource.path.data(),header.pathBytes) != 0 )
+	{// Another image whose path has the same hash.
+		rFile.Close();
+		return false;
+	}
+
+	if( header.sourceBytes != rSource.bytes || header.sourceModifiedSeconds != rSource.modifiedSeconds || header.sourceModifiedNanoseconds != rSource.modifiedNanoseconds )
+	{
+		VERBOSE_MESSAGE("Texture cache entry for " << pFilename << " is out of date");
+		stale++;
+		rFile.Close();
+		return false;
+	}
+
+	rWidth = (int)header.width;
+	rHeight = (int)header.height;
+	rHasAlpha = header.bytesPerPixel == 4;
+	rPixels = rFile.GetData() + pixelsOffset;
+	return true;
+}
+
+bool TextureCache::Store(const Source& pSource,int pWidth,int pHeight,bool pHasAlpha,const uint8_t* pPixels)
+{
+	if( pSource.path.size() == 0 )
+	{
+		return false;
+	}
+
+	EntryHeader header = {};
+	memcpy(header.magic,ENTRY_MAGIC,4);
+	header.version = ENTRY_VERSION;
+	header.sourceBytes = pSource.bytes;
+	header.sourceModifiedSeconds = pSource.modifiedSeconds;
+	header.sourceModifiedNanoseconds = pSource.modifiedNanoseconds;
+	header.width = (uint32_t)pWidth;
+	header.height = (uint32_t)pHeight;
+	header.bytesPerPixel = pHasAlpha ? 4 : 3;
+	header.pathBytes = (uint32_t)pSource.path.size();
+
+	const size_t padding = GetPixelsOffset(header.pathBytes) - sizeof(EntryHeader) - header.pathBytes;
+	const uint8_t zeros[16] = {};
+
+	// Written to a file of its own and renamed over the entry, so a reader sees all of the old entry or all of the new one.
+	std::string temporaryName = mDirectory + "/XXXXXX";
+	const int file = mkstemp(&temporaryName[0]);
+	if( file < 0 )
+	{
+		VERBOSE_MESSAGE("Failed to make a texture cache entry in " << mDirectory);
+		failedWrites++;
+		return false;
+	}
+
+	const bool written = WriteAll(file,&header,sizeof(header)) &&
+						WriteAll(file,pSource.path.data(),header.pathBytes) &&
+						WriteAll(file,zeros,padding) &&
+						WriteAll(file,pPixels,(size_t)pWidth * pHeight * header.bytesPerPixel);
+	const bool closed = close(file) == 0;
+	if( written == false || closed == false || rename(temporaryName.c_str(),GetEntryName(pSource.path).c_str()) != 0 )
+	{
+		VERBOSE_MESSAGE("Failed to write the texture cache entry for " << pSource.path);
+		unlink(temporaryName.c_str());
+		failedWrites++;
+		return false;
+	}
+
+	writes++;
+	return true;
+}
+
+std::string TextureCache::GetEntryName(const std::string& pPath)const
+{
+	// FNV-1a, std::hash is not the same from one build to the next and the names have to be.
+	uint64_t hash = 0xcbf29ce484222325ull;
+	for( char c : pPath )
+	{
+		hash = (hash ^ (uint8_t)c) * 0x100000001b3ull;
+	}
+
+	char name[17];
+	snprintf(name,sizeof(name),"%016llx",(unsigned long long)hash);
+	return mDirectory + "/" + name + ".tex";
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+}//namespace eui{
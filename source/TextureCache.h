@@ -0,0 +1,66 @@
+#ifndef TEXTURE_CACHE_H__
+#define TEXTURE_CACHE_H__
+
+#include "MappedFile.h"
+
+#include <string>
+#include <atomic>
+#include <stdint.h>
+
+namespace eui{
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * @brief Decoded images kept on disk, so the same images are not decoded again every start. See Graphics::SetTextureCache.
+ * Each image has a file, named from a hash of its path, holding the size and modified time the image had when it was decoded
+ * and the pixels as they are given to TextureCreate. They are not compressed so they can be uploaded straight from the mapping.
+ * An image that has changed since is decoded again and its entry replaced. Entries are written to a temporary file then renamed,
+ * so a reader never sees half of one. Safe to use from the decoder worker threads.
+ */
+struct TextureCache
+{
+	/**
+	 * @brief What an entry is checked against, the image as it is on disk now.
+	 */
+	struct Source
+	{
+		std::string path;		//!< Made absolute, so the same image gets the same entry whatever the working directory.
+		uint64_t bytes = 0;
+		int64_t modifiedSeconds = 0;
+		int64_t modifiedNanoseconds = 0;
+	};
+
+	std::atomic<uint32_t> hits{0};		//!< Images loaded from the cache.
+	std::atomic<uint32_t> misses{0};	//!< Images not in the cache, or that had changed, that were decoded.
+	std::atomic<uint32_t> stale{0};		//!< Of the misses, those whose entry was out of date.
+	std::atomic<uint32_t> writes{0};	//!< Entries written.
+	std::atomic<uint32_t> failedWrites{0};
+
+	/**
+	 * @brief Entries go in pDirectory, which must exist.
+	 */
+	TextureCache(const std::string& pDirectory);
+
+	/**
+	 * @brief Maps the entry of pFilename into rFile if it is there and up to date. rPixels points into rFile, RGBA if rHasAlpha else RGB.
+	 * rSource is set even when there is no entry, Store needs it. Returns false, and counts a miss, if the image has to be decoded.
+	 */
+	bool Find(const std::string& pFilename,Source& rSource,MappedFile& rFile,int& rWidth,int& rHeight,bool& rHasAlpha,const uint8_t*& rPixels);
+
+	/**
+	 * @brief Stores the pixels decoded from pSource, as it was before decoding, replacing any entry it had. Returns false if they could not be written.
+	 */
+	bool Store(const Source& pSource,int pWidth,int pHeight,bool pHasAlpha,const uint8_t* pPixels);
+
+	const std::string& GetDirectory()const{return mDirectory;}
+
+private:
+	const std::string mDirectory;
+
+	bool MapEntry(const std::string& pFilename,Source& rSource,MappedFile& rFile,int& rWidth,int& rHeight,bool& rHasAlpha,const uint8_t*& rPixels);
+	std::string GetEntryName(const std::string& pPath)const;
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+}//namespace eui{
+
+#endif //#ifndef TEXTURE_CACHE_H__
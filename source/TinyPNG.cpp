@@ -2,6 +2,7 @@
 #include <fstream>
 #include <iostream>
 #include <array>
+#include <cstring>
 
 #include <assert.h>
 #include <endian.h>
@@ -9,68 +10,12 @@
 #include <zlib.h> // TODO write my own decompressor. For now use this one.
 
 #include "TinyPNG.h"
+#include "PixelKernels.h"
 
 namespace tinypng{ // Using a namespace to try to prevent name clashes as my class names are kind of obvious :)
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 
-// x	the byte being filtered;
-// a	the byte corresponding to x in the pixel immediately before the pixel containing x (or the byte immediately before x, when the bit depth is less than 8);
-// b	the byte corresponding to x in the previous scanline;
-// c	the byte corresponding to b in the pixel immediately before the pixel containing b (or the byte immediately before b, when the bit depth is less than 8).
-
-// Type	Name	Filter Function	Reconstruction Function
-// 0	None	Filt(x) = Orig(x)	Recon(x) = Filt(x)
-// 1	Sub     Filt(x) = Orig(x) - Orig(a)	Recon(x) = Filt(x) + Recon(a)
-// 2	Up      Filt(x) = Orig(x) - Orig(b)	Recon(x) = Filt(x) + Recon(b)
-// 3	Average	Filt(x) = Orig(x) - floor((Orig(a) + Orig(b)) / 2)	Recon(x) = Filt(x) + floor((Recon(a) + Recon(b)) / 2)
-// 4	Paeth	Filt(x) = Orig(x) - PaethPredictor(Orig(a), Orig(b), Orig(c))	Recon(x) = Filt(x) + PaethPredictor(Recon(a), Recon(b), Recon(c))
-
-inline uint8_t PreviousPixel(const uint8_t* pC)
-{
-    const int a = *(pC - 1);
-    const int x = *pC;
-    return (uint8_t)((x + a));
-}
-
-inline uint8_t PreviousRow(const uint8_t* pC,size_t pWidth)
-{
-    const int b = *(pC - pWidth);
-    const int x = *pC;
-    return (uint8_t)((x + b));
-}
-
-inline uint8_t Average(const uint8_t* pC,size_t pWidth)
-{
-    const int a = *(pC - 1);
-    const int b = *(pC - pWidth);
-    const int x = *pC;
-    return (uint8_t)((x + ((a + b) / 2)));
-}
-
-inline uint8_t Paeth(const uint8_t* pC,size_t pWidth)
-{
-    const int a = *(pC - 1);
-    const int b = *(pC - pWidth);
-    const int c = *(pC - 1 - pWidth);
-    const int x = *pC;
-    const int p = a + b - c;
-    const int pa = std::abs(p - a);
-    const int pb = std::abs(p - b);
-    const int pc = std::abs(p - c);
-
-    if( pa <= pb && pa <= pc )
-    {
-        return (uint8_t)(x+a);
-    }
-    else if( pb <= pc )
-    {
-        return (uint8_t)(x+b);
-    }
-
-    return (uint8_t)(x+c);
-}
-
 struct PNGChunk
 {
     uint32_t mLength;
@@ -87,13 +32,13 @@ struct PNGChunk
                 mChunkName[3] == pChunkName[3];
     }
 
-    PNGChunk(const std::vector<uint8_t>& pMemory,size_t& pCurrentPosition) :
+    PNGChunk(const uint8_t* pMemory,size_t pSize,size_t& pCurrentPosition) :
         mLength(0),
         mData(nullptr),
         mOK(false)
     {
-        const uint8_t* data = pMemory.data() + pCurrentPosition;
-        const uint8_t* end = pMemory.data() + pMemory.size();
+        const uint8_t* data = pMemory + pCurrentPosition;
+        const uint8_t* end = pMemory + pSize;
 
         assert( data + 4 <= end );
         if( data + 4 <= end )
@@ -179,68 +124,111 @@ bool Loader::LoadFromFile(const std::string& pFilename)
     return false;
 }
 
-bool Loader::LoadFromMemory(const std::vector<uint8_t>& pMemory)
+bool Loader::LoadFromMemory(const uint8_t* pMemory,size_t pSize)
 {
-    // This is a bit of a slow way to check the header, but this is endian safe.
-    if( pMemory[0] != 0x89 || // Has the high bit set to detect transmission systems that do not support 8-bit data and to reduce the chance that a text file is mistakenly interpreted as a PNG, or vice versa.
-        pMemory[1] != 0x50 || pMemory[2] != 0x4E || pMemory[3] != 0x47 || // In ASCII, the letters PNG, allowing a person to identify the format easily if it is viewed in a text editor.
-        pMemory[4] != 0x0D || pMemory[5] != 0x0A || // A DOS-style line ending (CRLF) to detect DOS-Unix line ending conversion of the data.
-        pMemory[6] != 0x1A || // A byte that stops display of the file under DOS when the command type has been used—the end-of-file character.
-        pMemory[7] != 0x0A ) // A Unix-style line ending (LF) to detect Unix-DOS line ending conversion.
+    Clear();
+    if( ReadHeaderFromMemory(pMemory,pSize) == false )
     {
-        if( mVerbose )
-        {
-            std::cerr << "Loading PNG failed, header is not a valid PNG header\n";
-        }
         return false;
     }
 
-    std::vector<uint8_t> compressionData;
+    mRGBA.resize((size_t)mWidth * mHeight * 4);
+    if( DecodeFromMemory(pMemory,pSize,mRGBA.data(),true) == false )
+    {
+        Clear();
+        return false;
+    }
+    return true;
+}
 
-    // Good header, now proceed to the chunks.
-    size_t currentReadPos = 8;
-    while(true)
+bool Loader::ReadHeaderFromMemory(const uint8_t* pMemory,size_t pSize)
+{
+    size_t imageData;
+    return ReadChunksToImageData(pMemory,pSize,imageData);
+}
+
+bool Loader::DecodeFromMemory(const uint8_t* pMemory,size_t pSize,uint8_t* rPixels,bool pRGBA)
+{
+    size_t currentReadPos;
+    if( ReadChunksToImageData(pMemory,pSize,currentReadPos) == false )
+    {
+        return false;
+    }
+
+    // Each row has the bytes of one pixel in front of it that are always zero, so the filters can read the pixel before the first.
+    // The first row is filtered against a row of zeros.
+    const size_t rowBytes = GetRowBytes();
+    const size_t filterBytes = GetFilterBytes();
+    mRows.assign((filterBytes + rowBytes) * 2,0);
+    uint8_t* previous = mRows.data() + filterBytes;
+    uint8_t* current = previous + rowBytes + filterBytes;
+
+    z_stream infstream = {};
+    infstream.zalloc = Z_NULL;
+    infstream.zfree = Z_NULL;
+    infstream.opaque = Z_NULL;
+    if( inflateInit(&infstream) != Z_OK )
+    {
+        return false;
+    }
+
+    // Inflates exactly pBytes bytes, the IDAT chunks are handed to zlib as it needs them. They have to follow one another.
+    auto Inflate = [&](uint8_t* pDest,size_t pBytes)
     {
-        PNGChunk chunk(pMemory,currentReadPos);
-        if( chunk.mOK )
+        infstream.next_out = pDest;
+        infstream.avail_out = (uInt)pBytes;
+        while( infstream.avail_out > 0 )
         {
-            if( chunk == "IHDR" )
+            const int result = inflate(&infstream,Z_NO_FLUSH);
+            if( result == Z_STREAM_END )
             {
-                if( ReadImageHeader(chunk) == false )
-                {
-                    return false;
-                }
+                return infstream.avail_out == 0;
             }
-            else if( chunk == "IDAT" )
+            else if( result != Z_OK && result != Z_BUF_ERROR )
             {
-                compressionData.insert(compressionData.end(),chunk.mData,chunk.mData + chunk.mLength);
-
+                return false;
             }
-            else if( chunk == "IEND" )
-            {
-                return BuildImage(compressionData);
-            }
-            else if( mVerbose )
-            {
-                std::clog << "Chunk: " << std::string(chunk.mChunkName,4) << "\n";
+
+            if( infstream.avail_out > 0 )
+            {// It has used all the chunk, on to the next.
+                if( currentReadPos + 12 > pSize )
+                {
+                    return false;
+                }
+                PNGChunk chunk(pMemory,pSize,currentReadPos);
+                if( chunk.mOK == false || (chunk == "IDAT") == false )
+                {
+                    return false;
+                }
+                infstream.next_in = (Bytef *)chunk.mData;
+                infstream.avail_in = chunk.mLength;
             }
         }
-        else
+        return true;
+    };
+
+    const size_t destRowBytes = (size_t)mWidth * (pRGBA ? 4 : 3);
+    bool ok = true;
+    for( uint32_t y = 0 ; y < mHeight && ok ; y++, rPixels += destRowBytes )
+    {
+        // First byte of each row is the filter type.
+        // The spec calls it a filter but its more of a post process reconstitution as they
+        // modify the data to make the compression more optimal.
+        uint8_t filter;
+        ok = Inflate(&filter,1) && Inflate(current,rowBytes) && eui::pixels::UnfilterRow(filter,current,previous,rowBytes,filterBytes);
+        if( ok )
         {
-            if( mVerbose )
-            {
-                std::cerr << "Failed to read chunk\n";
-            }
-            return false;
+            ConvertRow(current,rPixels,pRGBA);
+            std::swap(previous,current);
         }
     }
+    inflateEnd(&infstream);
 
-    if( mVerbose )
+    if( ok == false && mVerbose )
     {
-        std::cerr << "End of file hit without finding required IEND chunk, invalid file format\n";
+        std::cerr << "Image data is corrupt or too short\n";
     }
-
-    return false;
+    return ok;
 }
 
 bool Loader::GetRGB(std::vector<uint8_t>& rRGB)const
@@ -248,12 +236,13 @@ bool Loader::GetRGB(std::vector<uint8_t>& rRGB)const
     rRGB.resize(mWidth*mHeight*3);
 
     uint8_t* dest = rRGB.data();
+    const uint8_t* src = mRGBA.data();
 
-    for( uint32_t n = 0 ; n < (mWidth*mHeight) ; n++, dest += 3 )
+    for( uint32_t n = 0 ; n < (mWidth*mHeight) ; n++, dest += 3, src += 4 )
     {
-        dest[0] = mRed[n];
-        dest[1] = mGreen[n];
-        dest[2] = mBlue[n];
+        dest[0] = src[0];
+        dest[1] = src[1];
+        dest[2] = src[2];
     }
 
     return true;
@@ -261,18 +250,7 @@ bool Loader::GetRGB(std::vector<uint8_t>& rRGB)const
 
 bool Loader::GetRGBA(std::vector<uint8_t>& rRGBA)const
 {
-    rRGBA.resize(mWidth*mHeight*4);
-
-    uint8_t* dest = rRGBA.data();
-
-    for( uint32_t n = 0 ; n < (mWidth*mHeight) ; n++, dest += 4 )
-    {
-        dest[0] = mRed[n];
-        dest[1] = mGreen[n];
-        dest[2] = mBlue[n];
-        dest[3] = mAlpha[n];
-    }
-
+    rRGBA = mRGBA;
     return true;
 }
 
@@ -281,12 +259,123 @@ void Loader::Clear()
     mWidth = 0;
     mHeight = 0;
     mBitDepth = 0;
+    mChannels = 0;
+    mHasAlpha = false;
     mType = CT_INVALID;
+    mPaletteSize = 0;
+    mHasTransparentColour = false;
 
-    mRed.resize(0);
-    mGreen.resize(0);
-    mBlue.resize(0);
-    mAlpha.resize(0);
+    mRGBA.resize(0);
+}
+
+bool Loader::ReadChunksToImageData(const uint8_t* pMemory,size_t pSize,size_t& rImageData)
+{
+    // This is a bit of a slow way to check the header, but this is endian safe.
+    if( pSize < 8 ||
+        pMemory[0] != 0x89 || // Has the high bit set to detect transmission systems that do not support 8-bit data and to reduce the chance that a text file is mistakenly interpreted as a PNG, or vice versa.
+        pMemory[1] != 0x50 || pMemory[2] != 0x4E || pMemory[3] != 0x47 || // In ASCII, the letters PNG, allowing a person to identify the format easily if it is viewed in a text editor.
+        pMemory[4] != 0x0D || pMemory[5] != 0x0A || // A DOS-style line ending (CRLF) to detect DOS-Unix line ending conversion of the data.
+        pMemory[6] != 0x1A || // A byte that stops display of the file under DOS when the command type has been used—the end-of-file character.
+        pMemory[7] != 0x0A ) // A Unix-style line ending (LF) to detect Unix-DOS line ending conversion.
+    {
+        if( mVerbose )
+        {
+            std::cerr << "Loading PNG failed, header is not a valid PNG header\n";
+        }
+        return false;
+    }
+
+    // Not Clear, LoadFromMemory decodes into mRGBA.
+    mType = CT_INVALID;
+    mHasAlpha = false;
+    mPaletteSize = 0;
+    mHasTransparentColour = false;
+
+    // Good header, now proceed to the chunks.
+    size_t currentReadPos = 8;
+    while( currentReadPos + 12 <= pSize )
+    {
+        const size_t chunkStart = currentReadPos;
+        PNGChunk chunk(pMemory,pSize,currentReadPos);
+        if( chunk.mOK == false )
+        {
+            break;
+        }
+
+        if( chunk == "IHDR" )
+        {
+            if( ReadImageHeader(chunk) == false )
+            {
+                return false;
+            }
+        }
+        else if( mType == CT_INVALID )
+        {
+            if( mVerbose )
+            {
+                std::cerr << "First chunk is not IHDR, invalid file format\n";
+            }
+            return false;
+        }
+        else if( chunk == "PLTE" )
+        {
+            mPaletteSize = std::min(chunk.mLength / 3,256u);
+            for( uint32_t n = 0 ; n < mPaletteSize ; n++ )
+            {
+                mPalette[n][0] = chunk.mData[n*3+0];
+                mPalette[n][1] = chunk.mData[n*3+1];
+                mPalette[n][2] = chunk.mData[n*3+2];
+                mPalette[n][3] = 255;
+            }
+        }
+        else if( chunk == "tRNS" )
+        {
+            if( mType == CT_INDEX_COLOUR )
+            {// The alpha of the first entries of the palette, the rest are opaque.
+                for( uint32_t n = 0 ; n < chunk.mLength && n < mPaletteSize ; n++ )
+                {
+                    mPalette[n][3] = chunk.mData[n];
+                }
+                mHasAlpha = true;
+            }
+            else if( (mType == CT_GREY_SCALE && chunk.mLength >= 2) || (mType == CT_TRUE_COLOUR && chunk.mLength >= 6) )
+            {// The one colour that is transparent, at the bit depth of the image.
+                for( int n = 0 ; n < mChannels ; n++ )
+                {
+                    mTransparentColour[n] = (uint16_t)((chunk.mData[n*2] << 8) | chunk.mData[n*2+1]);
+                }
+                mHasTransparentColour = true;
+                mHasAlpha = true;
+            }
+        }
+        else if( chunk == "IDAT" )
+        {
+            if( mType == CT_INDEX_COLOUR && mPaletteSize == 0 )
+            {
+                if( mVerbose )
+                {
+                    std::cerr << "Index colour image has no PLTE chunk\n";
+                }
+                return false;
+            }
+            rImageData = chunkStart;
+            return true;
+        }
+        else if( chunk == "IEND" )
+        {
+            break;
+        }
+        else if( mVerbose )
+        {
+            std::clog << "Chunk: " << std::string(chunk.mChunkName,4) << "\n";
+        }
+    }
+
+    if( mVerbose )
+    {
+        std::cerr << "No IDAT chunk found, invalid file format\n";
+    }
+    return false;
 }
 
 bool Loader::ReadImageHeader(const PNGChunk& pChunk)
@@ -298,7 +387,7 @@ bool Loader::ReadImageHeader(const PNGChunk& pChunk)
         if( mVerbose )
         {
             std::cerr << "Chunk: IHDR wrong size, should be 13 bytes, is reported as " << pChunk.mLength << " bytes\n";
-        }                    
+        }
         return false;
     }
 
@@ -308,33 +397,38 @@ bool Loader::ReadImageHeader(const PNGChunk& pChunk)
     mHeight = be32toh(*((uint32_t*)data));data += 4;
     mBitDepth = (int)(data[0]);
     mType = (PNGColourType)(data[1]);
-    mCompressionMethod = (PNGColourType)(data[2]);
+    mCompressionMethod = (int)(data[2]);
     mFilterMethod = (int)(data[3]);
     mInterlaceMethod = (int)(data[4]);
 
-    // I will improve this when all is working and I can have a think about a nice clear way to do it.
-    // For now fucus on maintenance and readability.
-    mBytesPerPixel = 0;
-    mHasAlpha = false;
+    bool validBitDepth = false;
     switch( mType )
     {
     case CT_GREY_SCALE:
-    case CT_INDEX_COLOUR:
-        mBytesPerPixel = 2;
+        mChannels = 1;
+        validBitDepth = mBitDepth == 1 || mBitDepth == 2 || mBitDepth == 4 || mBitDepth == 8 || mBitDepth == 16;
         break;
 
     case CT_TRUE_COLOUR:
-        mBytesPerPixel = mBitDepth == 8 ? 3 : 6;
+        mChannels = 3;
+        validBitDepth = mBitDepth == 8 || mBitDepth == 16;
+        break;
+
+    case CT_INDEX_COLOUR:
+        mChannels = 1;
+        validBitDepth = mBitDepth == 1 || mBitDepth == 2 || mBitDepth == 4 || mBitDepth == 8;
         break;
 
     case CT_GREYSCALE_WITH_ALPHA:
         mHasAlpha = true;
-        mBytesPerPixel = 2;
+        mChannels = 2;
+        validBitDepth = mBitDepth == 8 || mBitDepth == 16;
         break;
 
     case CT_TRUE_COLOUR_WITH_ALPHA:
         mHasAlpha = true;
-        mBytesPerPixel = mBitDepth == 8 ? 4 : 8;
+        mChannels = 4;
+        validBitDepth = mBitDepth == 8 || mBitDepth == 16;
         break;
 
     case CT_INVALID:
@@ -343,8 +437,9 @@ bool Loader::ReadImageHeader(const PNGChunk& pChunk)
         {
             std::cerr << "Image contains invalid image type when trying to read image data\n";
         }
+        mType = CT_INVALID;
         return false;
-    }                
+    }
 
     if( mVerbose )
     {
@@ -352,323 +447,141 @@ bool Loader::ReadImageHeader(const PNGChunk& pChunk)
                     " Width " << mWidth <<
                     " Height " << mHeight <<
                     " Bit Depth " << mBitDepth <<
-                    " Bytes Per Pixel " << mBytesPerPixel <<
+                    " Channels " << mChannels <<
                     " Colour Type " << mType <<
                     " Compression Method " << mCompressionMethod <<
-                    " Filter Method " << mFilterMethod <<                     
+                    " Filter Method " << mFilterMethod <<
                     " Interlace Method " << mInterlaceMethod
                     << "\n";
     }
-    return true;
-}
 
-bool Loader::BuildImage(const std::vector<uint8_t>& pCompressionData)
-{
-    // This is a bit ham fisted but as PNG does not tell you what the decompressed IDAT size is I will
-    // create a decompression buffer that is used. It is set to the size of the entire image.
-    std::vector<uint8_t> imageBuffer;
-    imageBuffer.resize(mWidth*mHeight*8);
-
-    if( mVerbose )
+    // Over a gigabyte of RGBA is not an image we want, it is a broken file.
+    if( validBitDepth == false || mWidth == 0 || mHeight == 0 || (uint64_t)mWidth * mHeight > 0x10000000 || mCompressionMethod != 0 || mFilterMethod != 0 )
     {
-        std::clog << "Decompressing " << pCompressionData.size() << " bytes to possibly " << imageBuffer.size() << " bytes";
-    }
-
-    z_stream infstream;
-    infstream.zalloc = Z_NULL;
-    infstream.zfree = Z_NULL;
-    infstream.opaque = Z_NULL;
-    // setup "b" as the input and "c" as the compressed output
-    infstream.avail_in = pCompressionData.size(); // size of input
-    infstream.next_in = (Bytef *)pCompressionData.data(); // input char array
-    infstream.avail_out = (uInt)imageBuffer.size(); // size of output
-    infstream.next_out = (Bytef *)imageBuffer.data(); // output char array
-
-    inflateInit(&infstream);
-    inflate(&infstream, Z_NO_FLUSH);
-    inflateEnd(&infstream);
-
-    if( infstream.total_out <= 0 )
+        if( mVerbose )
+        {
+            std::cerr << "Image header is not valid\n";
+        }
+        mType = CT_INVALID;
         return false;
-
-    if( mVerbose )
-    {
-        std::clog << ", decompressed size is really " << infstream.total_out << "\n";
     }
 
-    std::vector<uint8_t> rowFilters;
-    FillColourPlanes(imageBuffer,rowFilters);
-
-    switch( mType )
+    if( mInterlaceMethod != 0 )
     {
-    case CT_GREY_SCALE:
-        PushGreyscalePixels(imageBuffer,rowFilters);
-        break;
-
-    case CT_TRUE_COLOUR:
-        PushTrueColour(imageBuffer,rowFilters);
-        break;
-
-    case CT_INDEX_COLOUR:
-        PushIndexPixels(imageBuffer,rowFilters);
-        break;
-
-    case CT_GREYSCALE_WITH_ALPHA:
-        PushGreyscaleAlphaPixels(imageBuffer,rowFilters);
-        break;
-
-    case CT_TRUE_COLOUR_WITH_ALPHA:
-        PushTrueColourAlphaPixels(imageBuffer,rowFilters);
-        break;
-
-    case CT_INVALID:
-    default:
         if( mVerbose )
         {
-            std::cerr << "Image contains invalid image type when trying to read image data\n";
+            std::cerr << "Interlaced images are not supported\n";
         }
+        mType = CT_INVALID;
         return false;
     }
-
-    if( mVerbose )
-    {
-        std::cerr << "Chunk IEND found, ending read\n";
-    }
-    return true;   
+    return true;
 }
 
-void Loader::FillColourPlanes(const std::vector<uint8_t>pDecompressedImageData,std::vector<uint8_t>& rRowFilters)
+void Loader::ConvertRow(const uint8_t* pRow,uint8_t* rDest,bool pRGBA)const
 {
-    rRowFilters.resize(mHeight);
-    // Prepare the image buffers.
-    // Internally I store as 8 bit per channel.
-    // So for 16bit channel data we'll be loosing data. 
-    // This is not meant to be an all signing all dancing implementation.
-    // Just a tiny one. :)
-    mRed.resize(mWidth*mHeight);
-    mGreen.resize(mWidth*mHeight);
-    mBlue.resize(mWidth*mHeight);
-    mAlpha.resize(mWidth*mHeight);    
-
-
-    // First we need to fill in all the image data.
-    // I think this will only work for 8 bit. As for 16bit I down sample to 8bit. So may need to rework the logic here.
-    // First byte of the incoming data is always the filter type.
-    // So record it for use later. Can't do the filtering till all data is in.
-    // The spec calls it a filter but its more of a post process reconstitution as they
-    // modify the data to make the compression more optimal.
-    const uint8_t* src = pDecompressedImageData.data();
-    size_t writePos = 0;
-    if( mBitDepth == 8 )
-    {
-        for( size_t y = 0 ; y < mHeight ; y++ )
-        {
-            rRowFilters[y] = src[0];
-            src++;
-            if( mHasAlpha )
-            {
-                for( size_t x = 0 ; x < mWidth ; x++, src += mBytesPerPixel, writePos++)
-                {
-                    mRed[writePos]      = src[0];
-                    mGreen[writePos]    = src[1];
-                    mBlue[writePos]     = src[2];
-                    mAlpha[writePos]    = src[3];
-                }
-            }
-            else
-            {
-                for( size_t x = 0 ; x < mWidth ; x++, src += mBytesPerPixel, writePos++)
-                {
-                    mRed[writePos]      = src[0];
-                    mGreen[writePos]    = src[1];
-                    mBlue[writePos]     = src[2];
-                    mAlpha[writePos]    = 0;
-                }
-            }
-        }
-    }
-    else if( mBitDepth == 16 )
-    {
-        for( size_t y = 0 ; y < mHeight ; y++ )
+    const size_t destChannels = pRGBA ? 4 : 3;
+
+    if( mType == CT_INDEX_COLOUR || (mType == CT_GREY_SCALE && mBitDepth <= 8) )
+    {// Packed samples, the first pixel is in the high bits.
+        const int mask = (1 << mBitDepth) - 1;
+        for( uint32_t x = 0 ; x < mWidth ; x++, rDest += destChannels )
         {
-            rRowFilters[y] = src[0];
-            src++;
-            
-            if( mHasAlpha )
+            const size_t bit = (size_t)x * mBitDepth;
+            const int value = mBitDepth == 8 ? pRow[x] : (pRow[bit / 8] >> (8 - mBitDepth - (bit % 8))) & mask;
+            if( mType == CT_INDEX_COLOUR )
             {
-                for( size_t x = 0 ; x < mWidth ; x++, src += mBytesPerPixel, writePos++)
+                static const uint8_t black[4] = {0,0,0,255};
+                const uint8_t* colour = (uint32_t)value < mPaletteSize ? mPalette[value] : black;
+                for( size_t c = 0 ; c < destChannels ; c++ )
                 {
-                    mRed[writePos]      = src[0];
-                    mGreen[writePos]    = src[2];
-                    mBlue[writePos]     = src[4];
-                    mAlpha[writePos]    = src[6];
+                    rDest[c] = colour[c];
                 }
             }
             else
             {
-                for( size_t x = 0 ; x < mWidth ; x++, src += mBytesPerPixel, writePos++)
+                rDest[0] = rDest[1] = rDest[2] = (uint8_t)(value * 255 / mask);
+                if( pRGBA )
                 {
-                    mRed[writePos]      = src[0];
-                    mGreen[writePos]    = src[2];
-                    mBlue[writePos]     = src[4];
-                    mAlpha[writePos]    = 0;
+                    rDest[3] = mHasTransparentColour && value == mTransparentColour[0] ? 0 : 255;
                 }
-
             }
         }
+        return;
     }
-    else if( mVerbose )
-    {
-        std::cerr << "Invalid bit depth for true colour image, can only be 8 or 16 but we have " << mBitDepth << "\n";
-    }    
-}
 
-void Loader::PushGreyscalePixels(const std::vector<uint8_t>& pImageData,const std::vector<uint8_t>pRowFilters)
-{
-
-}
-
-void Loader::PushTrueColour(const std::vector<uint8_t>& pImageData,const std::vector<uint8_t>pRowFilters)
-{
-    // Now we'll apply the filters.
-    u_int8_t* r = mRed.data();
-    u_int8_t* g = mGreen.data();
-    u_int8_t* b = mBlue.data();
+    // 8 or 16 bits a sample, 16 bit samples are big endian so the high byte is the first.
+    const size_t sampleBytes = mBitDepth / 8;
+    const size_t pixelBytes = sampleBytes * mChannels;
+    auto Sample = [sampleBytes](const uint8_t* pSample){return sampleBytes == 2 ? (uint16_t)((pSample[0] << 8) | pSample[1]) : (uint16_t)pSample[0];};
 
-    for( size_t y = 0 ; y < mHeight ; y++, r += mWidth, g += mWidth, b += mWidth )
+    switch( mType )
     {
-        switch(pRowFilters[y])
+    case CT_GREY_SCALE:
+        for( uint32_t x = 0 ; x < mWidth ; x++, pRow += pixelBytes, rDest += destChannels )
         {
-        case 0:
-            // No nothing
-            break;
-            
-        case 1:
-            // Add the previous value onto the current one.
-            for( size_t x = 1 ; x < mWidth ; x++ )
+            rDest[0] = rDest[1] = rDest[2] = pRow[0];
+            if( pRGBA )
             {
-                r[x] = PreviousPixel(r + x);
-                g[x] = PreviousPixel(g + x);
-                b[x] = PreviousPixel(b + x);
+                rDest[3] = mHasTransparentColour && Sample(pRow) == mTransparentColour[0] ? 0 : 255;
             }
-            break;
-
-        case 2:
-            // Add the previous rows value onto the current one.
-            for( size_t x = 0 ; x < mWidth ; x++ )
-            {
-                r[x] = PreviousRow(r + x,mWidth);
-                g[x] = PreviousRow(g + x,mWidth);
-                b[x] = PreviousRow(b + x,mWidth);
-            }
-            break;
-
-        case 3://Average
-            r[0] = (uint8_t)(((int)(r[0]) + (int)(*(r-mWidth))/2) & 0xff);
-            g[0] = (uint8_t)(((int)(g[0]) + (int)(*(g-mWidth))/2) & 0xff);
-            b[0] = (uint8_t)(((int)(b[0]) + (int)(*(b-mWidth))/2) & 0xff);
-
-            for( size_t x = 1 ; x < mWidth ; x++ )
-            {
-                r[x] = Average(r + x,mWidth);
-                g[x] = Average(g + x,mWidth);
-                b[x] = Average(b + x,mWidth);
-            }
-            break;
-
-        case 4://paeth
-            r[0] = PreviousRow(r,mWidth);
-            g[0] = PreviousRow(g,mWidth);
-            b[0] = PreviousRow(b,mWidth);
-            for( size_t x = 1 ; x < mWidth ; x++ )
-            {
-                r[x] = Paeth(r + x,mWidth);
-                g[x] = Paeth(g + x,mWidth);
-                b[x] = Paeth(b + x,mWidth);
-            }
-            break;
         }
-    }
-}
-
-void Loader::PushIndexPixels(const std::vector<uint8_t>& pImageData,const std::vector<uint8_t>pRowFilters)
-{
-}
-
-void Loader::PushGreyscaleAlphaPixels(const std::vector<uint8_t>& pImageData,const std::vector<uint8_t>pRowFilters)
-{
-}
-
-void Loader::PushTrueColourAlphaPixels(const std::vector<uint8_t>& pImageData,const std::vector<uint8_t>pRowFilters)
-{
-    // Now we'll apply the filters.
-    u_int8_t* r = mRed.data();
-    u_int8_t* g = mGreen.data();
-    u_int8_t* b = mBlue.data();
-    u_int8_t* a = mAlpha.data();
+        break;
 
-    for( size_t y = 0 ; y < mHeight ; y++, r += mWidth, g += mWidth, b += mWidth, a += mWidth )
-    {
-        switch(pRowFilters[y])
+    case CT_TRUE_COLOUR:
+        if( sampleBytes == 1 && pRGBA == false )
         {
-        case 0:
-            // No nothing
+            memcpy(rDest,pRow,(size_t)mWidth * 3);
             break;
-            
-         case 1:
-            // Add the previous value onto the current one.
-            for( size_t x = 1 ; x < mWidth ; x++ )
+        }
+        for( uint32_t x = 0 ; x < mWidth ; x++, pRow += pixelBytes, rDest += destChannels )
+        {
+            rDest[0] = pRow[0];
+            rDest[1] = pRow[sampleBytes];
+            rDest[2] = pRow[sampleBytes*2];
+            if( pRGBA )
             {
-                r[x] = PreviousPixel(r + x);
-                g[x] = PreviousPixel(g + x);
-                b[x] = PreviousPixel(b + x);
-                a[x] = PreviousPixel(a + x);
+                rDest[3] = mHasTransparentColour &&
+                            Sample(pRow) == mTransparentColour[0] &&
+                            Sample(pRow + sampleBytes) == mTransparentColour[1] &&
+                            Sample(pRow + sampleBytes*2) == mTransparentColour[2] ? 0 : 255;
             }
-            break;
+        }
+        break;
 
-        case 2:
-            // Add the previous rows value onto the current one.
-            for( size_t x = 0 ; x < mWidth ; x++ )
+    case CT_GREYSCALE_WITH_ALPHA:
+        for( uint32_t x = 0 ; x < mWidth ; x++, pRow += pixelBytes, rDest += destChannels )
+        {
+            rDest[0] = rDest[1] = rDest[2] = pRow[0];
+            if( pRGBA )
             {
-                r[x] = PreviousRow(r + x,mWidth);
-                g[x] = PreviousRow(g + x,mWidth);
-                b[x] = PreviousRow(b + x,mWidth);
-                a[x] = PreviousRow(a + x,mWidth);
+                rDest[3] = pRow[sampleBytes];
             }
-            break;
-
-        case 3://Average
-            r[0] = (uint8_t)(((int)(r[0]) + (int)(*(r-mWidth))/2) & 0xff);
-            g[0] = (uint8_t)(((int)(g[0]) + (int)(*(g-mWidth))/2) & 0xff);
-            b[0] = (uint8_t)(((int)(b[0]) + (int)(*(b-mWidth))/2) & 0xff);
-            a[0] = (uint8_t)(((int)(a[0]) + (int)(*(a-mWidth))/2) & 0xff);
+        }
+        break;
 
-            for( size_t x = 1 ; x < mWidth ; x++ )
-            {
-                r[x] = Average(r + x,mWidth);
-                g[x] = Average(g + x,mWidth);
-                b[x] = Average(b + x,mWidth);
-                a[x] = Average(a + x,mWidth);
-            }
+    case CT_TRUE_COLOUR_WITH_ALPHA:
+        if( sampleBytes == 1 && pRGBA )
+        {
+            memcpy(rDest,pRow,(size_t)mWidth * 4);
             break;
-
-        case 4://paeth
-            r[0] = PreviousRow(r,mWidth);
-            g[0] = PreviousRow(g,mWidth);
-            b[0] = PreviousRow(b,mWidth);
-            a[0] = PreviousRow(a,mWidth);
-            for( size_t x = 1 ; x < mWidth ; x++ )
+        }
+        for( uint32_t x = 0 ; x < mWidth ; x++, pRow += pixelBytes, rDest += destChannels )
+        {
+            rDest[0] = pRow[0];
+            rDest[1] = pRow[sampleBytes];
+            rDest[2] = pRow[sampleBytes*2];
+            if( pRGBA )
             {
-                r[x] = Paeth(r + x,mWidth);
-                g[x] = Paeth(g + x,mWidth);
-                b[x] = Paeth(b + x,mWidth);
-                a[x] = Paeth(a + x,mWidth);
+                rDest[3] = pRow[sampleBytes*3];
             }
-            break;
         }
+        break;
+
+    default:
+        break;
     }
 }
 
-
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////
 }//namespace tinypng
@@ -27,6 +27,8 @@
 
 #include <vector>
 #include <string>
+#include <algorithm>
+#include <stdint.h>
 
 namespace tinypng{ // Using a namespace to try to prevent name clashes as my class names are kind of obvious :)
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -71,11 +73,39 @@ public:
     /**
      * @brief Decodes the PNG that is held in memory.
      * 
-     * @param pMemory The PNG as loaded from a file in memory.
+     * @param pMemory The PNG as loaded from a file in memory, or a file mapped into memory.
+     * @param pSize The number of bytes at pMemory.
      * @return true  If the PNG was loaded ok.
      * @return false If PNG was corrupt / invalid.
      */
-    bool LoadFromMemory(const std::vector<uint8_t>& pMemory);
+    bool LoadFromMemory(const uint8_t* pMemory,size_t pSize);
+    bool LoadFromMemory(const std::vector<uint8_t>& pMemory){return LoadFromMemory(pMemory.data(),pMemory.size());}
+
+    /**
+     * @brief Reads the chunks before the image data of the PNG held in memory, so the size and alpha are known before DecodeFromMemory.
+     * 
+     * @param pMemory The PNG as loaded from a file in memory, or a file mapped into memory.
+     * @param pSize The number of bytes at pMemory.
+     * @return true If the header is good and the image is a kind that can be decoded.
+     * @return false If PNG was corrupt / invalid, or is interlaced.
+     */
+    bool ReadHeaderFromMemory(const uint8_t* pMemory,size_t pSize);
+    bool ReadHeaderFromMemory(const std::vector<uint8_t>& pMemory){return ReadHeaderFromMemory(pMemory.data(),pMemory.size());}
+
+    /**
+     * @brief Decodes the PNG held in memory in one pass, straight into the caller's buffer.
+     * The image data is inflated a row at a time and the row filters are undone in place against the row before,
+     * so apart from rPixels the only memory used is two rows. Any bit depth and colour type is converted to 8 bits a channel.
+     * 
+     * @param pMemory The PNG as loaded from a file in memory, or a file mapped into memory. It is read once from start to end.
+     * @param pSize The number of bytes at pMemory.
+     * @param rPixels Where the image goes, top row first, GetWidth() * GetHeight() * 4 bytes if pRGBA else * 3.
+     * @param pRGBA If true the pixels are RGBA, alpha is 255 if the PNG has none. If false RGB and alpha is ignored.
+     * @return true If the PNG was decoded ok.
+     * @return false If PNG was corrupt / invalid, or is interlaced. Some of rPixels may have been written.
+     */
+    bool DecodeFromMemory(const uint8_t* pMemory,size_t pSize,uint8_t* rPixels,bool pRGBA);
+    bool DecodeFromMemory(const std::vector<uint8_t>& pMemory,uint8_t* rPixels,bool pRGBA){return DecodeFromMemory(pMemory.data(),pMemory.size(),rPixels,pRGBA);}
 
     uint32_t GetWidth()const{return mWidth;}
     uint32_t GetHeight()const{return mHeight;}
@@ -100,7 +130,7 @@ public:
     bool GetRGBA(std::vector<uint8_t>& rRGBA)const;
 
     /**
-     * @brief Gets the alpha status of the PNG file.
+     * @brief Gets the alpha status of the PNG file, true if it has an alpha channel or a transparent colour.
      * 
      * @return true 
      * @return false 
@@ -118,28 +148,34 @@ private:
     uint32_t mWidth;
     uint32_t mHeight;
     int mBitDepth;
-    int mBytesPerPixel;
+    int mChannels;
     bool mHasAlpha;
     PNGColourType mType;
     int mCompressionMethod;
     int mFilterMethod;
     int mInterlaceMethod;
 
-    // When I load I split out the channels like this to help avoid endian issues.
-    // There will be supporting functions to return the data in the most popular arrangements.
-    std::vector<uint8_t> mRed,mGreen,mBlue,mAlpha;
+    uint8_t mPalette[256][4];       //!< RGBA, alpha from the tRNS chunk.
+    uint32_t mPaletteSize;
+    bool mHasTransparentColour;     //!< From the tRNS chunk, for grey scale and true colour images.
+    uint16_t mTransparentColour[3];
 
-    bool ReadImageHeader(const PNGChunk& pChunk);
-    bool BuildImage(const std::vector<uint8_t>& pCompressionData);    
+    std::vector<uint8_t> mRows;     //!< The row being decoded and the one before it, kept between loads.
+    std::vector<uint8_t> mRGBA;     //!< What LoadFromMemory decoded, for GetRGB and GetRGBA.
 
-    void FillColourPlanes(const std::vector<uint8_t>pDecompressedImageData,std::vector<uint8_t>& rRowFilters);
+    /**
+     * @brief Reads the header, palette and transparency chunks. rImageData is set to the first IDAT chunk.
+     */
+    bool ReadChunksToImageData(const uint8_t* pMemory,size_t pSize,size_t& rImageData);
+    bool ReadImageHeader(const PNGChunk& pChunk);
 
-    void PushGreyscalePixels(const std::vector<uint8_t>& pImageData,const std::vector<uint8_t>pRowFilters);
-    void PushTrueColour(const std::vector<uint8_t>& pImageData,const std::vector<uint8_t>pRowFilters);
-    void PushIndexPixels(const std::vector<uint8_t>& pImageData,const std::vector<uint8_t>pRowFilters);
-    void PushGreyscaleAlphaPixels(const std::vector<uint8_t>& pImageData,const std::vector<uint8_t>pRowFilters);
-    void PushTrueColourAlphaPixels(const std::vector<uint8_t>& pImageData,const std::vector<uint8_t>pRowFilters);
+    size_t GetRowBytes()const{return ((size_t)mWidth * mChannels * mBitDepth + 7) / 8;}
+    size_t GetFilterBytes()const{return std::max(1,mChannels * mBitDepth / 8);}    //!< The distance back to the byte of the pixel before, for the filters.
 
+    /**
+     * @brief Converts a row with the filter undone into 8 bit RGB or RGBA.
+     */
+    void ConvertRow(const uint8_t* pRow,uint8_t* rDest,bool pRGBA)const;
 };
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -27,8 +27,11 @@
 
 #include <vector>
 #include <string>
+#include <algorithm>
 #include <assert.h>
 
+#include "PixelKernels.h"
+
 namespace tinytga{ // Using a namespace to try to prevent name clashes as my class names are kind of obvious :)
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////
 #ifndef VERBOSE_MESSAGE
@@ -101,16 +104,22 @@ class Loader
 public:
 
     /**
-     * @brief Decodes the PNG that is held in memory.
+     * @brief Decodes the TGA that is held in memory.
      * 
-     * @param pMemory The PNG as loaded from a file in memory.
-     * @return true  If the PNG was loaded ok.
-     * @return false If PNG was corrupt / invalid.
+     * @param pMemory The TGA as loaded from a file in memory, or a file mapped into memory.
+     * @param pSize The number of bytes at pMemory.
+     * @return true  If the TGA was loaded ok.
+     * @return false If TGA was corrupt / invalid.
      */
-    bool LoadFromMemory(const std::vector<uint8_t>& pMemory)
+    bool LoadFromMemory(const uint8_t* pMemory,size_t pSize)
     {
+        if( pSize < sizeof(TGAHeader) )
+        {
+            return false;
+        }
+
         // read in the TGA header
-        const TGAHeader *header = (const TGAHeader*)pMemory.data();
+        const TGAHeader *header = (const TGAHeader*)pMemory;
 
         // set up some local flags to determine the image properties
         const uint8_t tga_type = header->type;
@@ -164,105 +173,31 @@ public:
             return false;
         }
 
-        // fill in the target with converted file data
-        int source_byte_size = (header->depth>>3);
-        int y = -1;
-        int y_step = 1;
-        int h = header->height;
-        if(header->flipped == 0)
+        if( mTextureFormat != TGA_A8 && mTextureFormat != TGA_R8G8B8 && mTextureFormat != TGA_R8G8B8A8 )
         {
-            y_step = -1;
-            y = header->height;
+            VERBOSE_MESSAGE("16 bit images not supported");
+            return false;
         }
 
-//        int target_byte_size = has_alpha?4:3;
- //       VERBOSE_MESSAGE("target_byte_size " << target_byte_size);
-
-        // initialise the target image buffer
-        const size_t bufferSize = header->width * header->height;
-
-        // This should reset internal index to 0 and ensure the memory it uses is at least the size we need.
-        // It should not reallocate memory if the buffer is already the correct size, this is a good speed up.
-        mRed.resize(0); // https://en.cppreference.com/w/cpp/container/vector/resize
-        mGreen.resize(0);
-        mBlue.resize(0);
-        mAlpha.resize(0);
-        mRed.reserve(bufferSize); // https://en.cppreference.com/w/cpp/container/vector/reserve
-        mGreen.reserve(bufferSize);
-        mBlue.reserve(bufferSize);
-        mAlpha.reserve(bufferSize);
-
-        //Get a pointer to the image data (stored in BGRA byte sequence)
-        const uint8_t* file_pixel_data = pMemory.data() + header->id_length + header->map_length;
-
-        while( h--)
+        // Kept as they are in the file, BGR or BGRA, and converted when asked for with the pixel kernels.
+        // Rows stay in file order.
+        mHasAlpha = has_alpha;
+        mBytesPerPixel = header->depth >> 3;
+        const size_t pixelStart = sizeof(TGAHeader) + header->id_length + header->map_length;
+        const size_t pixelBytes = (size_t)mWidth * mHeight * mBytesPerPixel;
+        if( pSize < pixelStart + pixelBytes )
         {
-            y += y_step;
-            const uint8_t* source = file_pixel_data;
-
-            //Read next line.
-            file_pixel_data += header->width * source_byte_size;
-
-            for( int x = 0 ; x < header->width ; x++ )
-            {
-                uint8_t component_value[4];
-
-// This is just wrong for 16 bit formats!!! Todo: Fix!
-                for(int c = 0 ; c < source_byte_size ; c++ )
-                {
-                    component_value[c] = *source++;
-                }
-
-                if(source_byte_size == 1)
-                {
-                    component_value[1] = component_value[0];
-                    component_value[2] = component_value[0];
-                    component_value[3] = component_value[0];
-                }
-
-                switch(mTextureFormat)
-                {
-                case TGA_A8:
-                    mRed.push_back(255);
-                    mGreen.push_back(255);
-                    mBlue.push_back(255);
-                    mAlpha.push_back(component_value[3]);
-                    break;
-
-                case TGA_R5G6B5:
-                    assert(!"LoadTGA failed, TGA_R5G6B5 unsupported");
-//                    *dest++ = ((component_value[1]&0xfc)<<3)|(component_value[0]>>3);
-//                    *dest++ = (component_value[2]&0xf8)|(component_value[1]>>5);
-                    break;
-
-                case TGA_R5G5B5A1:
-                    assert(!"LoadTGA failed, TGA_R5G5B5A1 unsupported");
-//                    *dest++ = ((component_value[1]&0xf8)<<3)|((component_value[0]&0xfe)>>2)|(component_value[3]&0x01);
-//                    *dest++ = (component_value[2]&0xf8)|(component_value[1]>>5);
-                    break;
-
-                case TGA_R8G8B8:
-                    mRed.push_back(component_value[2]);
-                    mGreen.push_back(component_value[1]);
-                    mBlue.push_back(component_value[0]);
-                    mAlpha.push_back(255);                    
-                    break;
-
-                case TGA_R8G8B8A8:
-                    mRed.push_back(component_value[2]);
-                    mGreen.push_back(component_value[1]);
-                    mBlue.push_back(component_value[0]);
-                    mAlpha.push_back(component_value[3]);
-                    break;
-
-                default:
-                    assert(!"LoadTGA failed, unknown destination format");
-                }
-            }
+            VERBOSE_MESSAGE("TGA file is too short for its image");
+            return false;
         }
+
+        // This should not reallocate memory if the buffer is already the correct size, this is a good speed up.
+        mPixels.assign(pMemory + pixelStart,pMemory + pixelStart + pixelBytes);
         return true;
     }
 
+    bool LoadFromMemory(const std::vector<uint8_t>& pMemory){return LoadFromMemory(pMemory.data(),pMemory.size());}
+
     uint32_t GetWidth()const{return mWidth;}
     uint32_t GetHeight()const{return mHeight;}
 
@@ -275,15 +210,27 @@ public:
      */
     bool GetRGB(std::vector<uint8_t>& rRGB)const
     {
-        rRGB.resize(mWidth*mHeight*3);
+        const size_t count = (size_t)mWidth * mHeight;
+        rRGB.resize(count * 3);
 
         uint8_t* dest = rRGB.data();
-
-        for( uint32_t n = 0 ; n < (mWidth*mHeight) ; n++, dest += 3 )
+        const uint8_t* source = mPixels.data();
+        if( mBytesPerPixel == 3 )
+        {
+            eui::pixels::SwapRedBlue3(dest,source,count);
+        }
+        else if( mBytesPerPixel == 4 )
         {
-            dest[0] = mRed[n];
-            dest[1] = mGreen[n];
-            dest[2] = mBlue[n];
+            for( size_t n = 0 ; n < count ; n++, dest += 3, source += 4 )
+            {
+                dest[0] = source[2];
+                dest[1] = source[1];
+                dest[2] = source[0];
+            }
+        }
+        else
+        {// Alpha only, so white.
+            std::fill(rRGB.begin(),rRGB.end(),255);
         }
 
         return true;
@@ -299,16 +246,28 @@ public:
      */
     bool GetRGBA(std::vector<uint8_t>& rRGBA)const
     {
-        rRGBA.resize(mWidth*mHeight*4);
+        const size_t count = (size_t)mWidth * mHeight;
+        rRGBA.resize(count * 4);
 
         uint8_t* dest = rRGBA.data();
-
-        for( uint32_t n = 0 ; n < (mWidth*mHeight) ; n++, dest += 4 )
+        const uint8_t* source = mPixels.data();
+        if( mBytesPerPixel == 3 )
+        {
+            eui::pixels::ExpandBGRToRGBA(dest,source,count);
+        }
+        else if( mBytesPerPixel == 4 )
         {
-            dest[0] = mRed[n];
-            dest[1] = mGreen[n];
-            dest[2] = mBlue[n];
-            dest[3] = mAlpha[n];
+            eui::pixels::SwapRedBlue4(dest,source,count);
+        }
+        else
+        {
+            for( size_t n = 0 ; n < count ; n++, dest += 4 )
+            {
+                dest[0] = 255;
+                dest[1] = 255;
+                dest[2] = 255;
+                dest[3] = source[n];
+            }
         }
 
         return true;
@@ -327,9 +286,9 @@ private:
     uint32_t mWidth = 0;
     uint32_t mHeight = 0;
     TGA_TextureFormat mTextureFormat = TGA_INVALID;
-    // When I load I split out the channels like this to help avoid endian issues.
-    // There will be supporting functions to return the data in the most popular arrangements.
-    std::vector<uint8_t> mRed,mGreen,mBlue,mAlpha;
+    uint32_t mBytesPerPixel = 0;
+    // The pixels as they are in the file, the Get functions return them in the most popular arrangements.
+    std::vector<uint8_t> mPixels;
 
 };
 
@@ -0,0 +1,85 @@
+#include "WorkerPool.h"
+#include "Diagnostics.h"
+
+#include <iostream>
+
+namespace eui{
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+void WorkerPool::Group::Wait()
+{
+	std::unique_lock<std::mutex> lock(mMutex);
+	mFinished.wait(lock,[this](){return mRunning == 0;});
+}
+
+WorkerPool::WorkerPool(size_t pWorkers)
+{
+	if( pWorkers == 0 )
+	{// Leave a core for the thread drawing the UI.
+		const size_t cores = std::thread::hardware_concurrency();
+		pWorkers = cores > 1 ? cores - 1 : 1;
+	}
+
+	for( size_t n = 0 ; n < pWorkers ; n++ )
+	{
+		mWorkers.emplace_back(&WorkerPool::Work,this,n);
+	}
+	VERBOSE_MESSAGE("Worker pool started with " << pWorkers << " workers");
+}
+
+WorkerPool::~WorkerPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mStop = true;
+	}
+	mWork.notify_all();
+
+	for( auto& worker : mWorkers )
+	{
+		worker.join();
+	}
+}
+
+void WorkerPool::Add(Group& rGroup,Job pJob)
+{
+	{
+		std::lock_guard<std::mutex> lock(rGroup.mMutex);
+		rGroup.mRunning++;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mQueue.push_back({&rGroup,std::move(pJob)});
+	}
+	mWork.notify_one();
+}
+
+void WorkerPool::Work(size_t pWorker)
+{
+	for(;;)
+	{
+		Queued queued;
+		{
+			std::unique_lock<std::mutex> lock(mMutex);
+			mWork.wait(lock,[this](){return mStop || mQueue.size() > 0;});
+			if( mQueue.size() == 0 )
+			{
+				break;
+			}
+			queued = std::move(mQueue.front());
+			mQueue.pop_front();
+		}
+
+		queued.job(pWorker);
+		queued.job = nullptr;// Let go of what it holds before the group is told, the group's owner may be waiting to go.
+
+		{// Told while locked, once Wait sees zero the group can be gone.
+			std::lock_guard<std::mutex> lock(queued.group->mMutex);
+			queued.group->mRunning--;
+			queued.group->mFinished.notify_all();
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+}//namespace eui{
@@ -0,0 +1,75 @@
+#ifndef WORKER_POOL_H__
+#define WORKER_POOL_H__
+
+#include <vector>
+#include <deque>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <stddef.h>
+
+namespace eui{
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * @brief The threads that fonts and images are loaded on, so loading both at once does not start more threads than there are cores.
+ * Jobs are run in the order they are added. Each job is told which worker runs it, from zero to GetWorkers() - 1,
+ * so users of the pool can keep state for each worker, like a FreeType library, that no other thread touches.
+ */
+struct WorkerPool
+{
+	using Job = std::function<void(size_t pWorker)>;
+
+	/**
+	 * @brief The jobs one user of the pool has added, so it can wait for them before it goes.
+	 */
+	struct Group
+	{
+		/**
+		 * @brief Returns once all the jobs added with this group have run.
+		 */
+		void Wait();
+
+	private:
+		friend struct WorkerPool;
+		std::mutex mMutex;
+		std::condition_variable mFinished;
+		size_t mRunning = 0;	//!< Added and not yet finished.
+	};
+
+	/**
+	 * @brief Starts pWorkers threads, zero picks one less than the number of cores.
+	 */
+	WorkerPool(size_t pWorkers = 0);
+
+	/**
+	 * @brief Runs the jobs waiting then stops the workers.
+	 */
+	~WorkerPool();
+
+	/**
+	 * @brief Queues pJob, rGroup must stay until it has run, see Group::Wait.
+	 */
+	void Add(Group& rGroup,Job pJob);
+	size_t GetWorkers()const{return mWorkers.size();}
+
+private:
+	struct Queued
+	{
+		Group* group;
+		Job job;
+	};
+
+	std::vector<std::thread> mWorkers;
+	std::deque<Queued> mQueue;
+	std::mutex mMutex;
+	std::condition_variable mWork;
+	bool mStop = false;
+
+	void Work(size_t pWorker);
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+}//namespace eui{
+
+#endif //#ifndef WORKER_POOL_H__